@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <math.h>
 
+#include "alloc.h"
 #include "ivp.h"
 #include "misc.h"
 
@@ -34,14 +35,14 @@ int main(int argc, char** argv)
     }
 
     /* print results */
-    unsigned int num_steps = ceil((a + b) / h);
+    unsigned int num_steps = ceil((b - a) / h) + 1;
     char* labels[3] = {"t", "y(t)", NULL};
     print_table(labels, solution, num_steps);
 
     /* tidy up */
-    free(solution[0]);
-    free(solution[1]);
-    free(solution);
+    gaisan_free(solution[0]);
+    gaisan_free(solution[1]);
+    gaisan_free(solution);
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,408 @@
+/**
+ * @file alloc.c
+ * @author Jack McPherson
+ *
+ * Implements Gaisan's memory management.
+ *
+ * Every allocation made by the library goes through `gaisan_malloc` and
+ * friends, which forward to the allocator installed with
+ * `gaisan_set_allocator` (the C library by default). Memory returned to the
+ * caller by any Gaisan routine must be released with `gaisan_free` (or the
+ * matching `*_free` routine).
+ *
+ * Short-lived temporaries are drawn from arenas instead: each thread owns
+ * one, so kernels called repeatedly (e.g. GEMM packing buffers, Strassen
+ * workspaces) reuse the same memory rather than returning to the allocator
+ * on every call.
+ *
+ * */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "constants.h"
+#include "alloc.h"
+
+/**
+ * A chunk of arena memory; `base` is the arena position of its first byte,
+ * so positions increase monotonically across the chain of chunks
+ *
+ * */
+struct ArenaChunk
+{
+    ArenaChunk* prev;
+    size_t base;
+    size_t size;
+    size_t used;
+    unsigned char* data;
+};
+
+static void* default_alloc(size_t size, size_t alignment, void* ctx)
+{
+    (void)ctx;
+
+    if(alignment <= _Alignof(max_align_t))
+    {
+        return malloc(size);
+    }
+
+    /* aligned_alloc requires a whole number of alignment units */
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment *
+            alignment);
+}
+
+static void* default_resize(void* ptr, size_t size, void* ctx)
+{
+    (void)ctx;
+
+    return realloc(ptr, size);
+}
+
+static void default_release(void* ptr, void* ctx)
+{
+    (void)ctx;
+
+    free(ptr);
+}
+
+static GaisanAllocator allocator = {&default_alloc, &default_resize,
+    &default_release, NULL};
+
+static _Thread_local GaisanArena* thread_arena = NULL;
+
+/**
+ * Installs `custom` as the allocator for all subsequent Gaisan allocations
+ *
+ * This must be called before anything is allocated through Gaisan (memory
+ * is always released through the allocator current at the time), and not
+ * concurrently with any other Gaisan call.
+ *
+ * @param custom
+ *      the allocator to install (copied), or `NULL` to restore the C library
+ *          allocator; it is ignored unless all three functions are set
+ *
+ * */
+void gaisan_set_allocator(const GaisanAllocator* custom)
+{
+    if(custom == NULL) /* restore default */
+    {
+        GaisanAllocator defaults = {&default_alloc, &default_resize,
+            &default_release, NULL};
+
+        allocator = defaults;
+        return;
+    }
+
+    if(custom->alloc == NULL || custom->resize == NULL ||
+            custom->release == NULL)
+    {
+        return;
+    }
+
+    allocator = *custom;
+}
+
+/**
+ * Allocates `size` bytes with the default alignment
+ *
+ * @return pointer to the block, or `NULL` on failure
+ *
+ * */
+void* gaisan_malloc(size_t size)
+{
+    return allocator.alloc(size > 0 ? size : 1, _Alignof(max_align_t),
+            allocator.ctx);
+}
+
+/**
+ * Allocates a zeroed array of `count` elements of `size` bytes
+ *
+ * @return pointer to the block, or `NULL` on failure
+ *
+ * */
+void* gaisan_calloc(size_t count, size_t size)
+{
+    if(size != 0 && count > SIZE_MAX / size) /* overflow check */
+    {
+        return NULL;
+    }
+
+    void* ptr = gaisan_malloc(count * size);
+
+    if(ptr != NULL)
+    {
+        memset(ptr, 0, count * size);
+    }
+
+    return ptr;
+}
+
+/**
+ * Resizes the block `ptr` (allocated with the default alignment) to `size`
+ *      bytes, preserving its contents
+ *
+ * @return pointer to the resized block, or `NULL` on failure (in which case
+ *      `ptr` is untouched)
+ *
+ * */
+void* gaisan_realloc(void* ptr, size_t size)
+{
+    if(ptr == NULL)
+    {
+        return gaisan_malloc(size);
+    }
+
+    return allocator.resize(ptr, size > 0 ? size : 1, allocator.ctx);
+}
+
+/**
+ * Allocates `size` bytes aligned to `alignment` (a power of two)
+ *
+ * @return pointer to the block, or `NULL` on failure
+ *
+ * */
+void* gaisan_aligned_alloc(size_t alignment, size_t size)
+{
+    if(alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        return NULL;
+    }
+
+    return allocator.alloc(size > 0 ? size : 1, alignment, allocator.ctx);
+}
+
+/**
+ * Frees a block allocated by any Gaisan allocation routine
+ *
+ * */
+void gaisan_free(void* ptr)
+{
+    if(ptr == NULL) /* null guard */
+    {
+        return;
+    }
+
+    allocator.release(ptr, allocator.ctx);
+}
+
+/**
+ * Initialises an empty arena which obtains memory in chunks of (at least)
+ *      `chunk_size` bytes
+ *
+ * @param chunk_size
+ *      minimum size of each chunk (0 for `ARENA_CHUNK_SIZE`)
+ *
+ * @return pointer to the arena, or `NULL` on failure
+ *
+ * */
+GaisanArena* arena_init(size_t chunk_size)
+{
+    GaisanArena* arena = gaisan_calloc(1, sizeof(GaisanArena));
+
+    if(arena == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    arena->chunk_size = chunk_size > 0 ? chunk_size : ARENA_CHUNK_SIZE;
+
+    return arena;
+}
+
+static void arena_chunk_free(ArenaChunk* chunk)
+{
+    if(chunk == NULL) /* null guard */
+    {
+        return;
+    }
+
+    gaisan_free(chunk->data);
+    gaisan_free(chunk);
+}
+
+/**
+ * Frees `arena` and every chunk it holds
+ *
+ * @param arena
+ *      the arena to be free'd
+ *
+ * */
+void arena_free(GaisanArena* arena)
+{
+    if(arena == NULL) /* null guard */
+    {
+        return;
+    }
+
+    while(arena->head != NULL)
+    {
+        ArenaChunk* prev = arena->head->prev;
+
+        arena_chunk_free(arena->head);
+        arena->head = prev;
+    }
+
+    arena_chunk_free(arena->spare);
+    gaisan_free(arena);
+}
+
+/**
+ * Allocates `size` bytes from `arena`, aligned to `MATRIX_ALIGNMENT`
+ *
+ * The block stays valid until the arena is released to a mark taken before
+ *      it was allocated, or free'd.
+ *
+ * @return pointer to the block (uninitialised), or `NULL` on failure
+ *
+ * */
+void* arena_alloc(GaisanArena* arena, size_t size)
+{
+    if(arena == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    size = (size + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT *
+        MATRIX_ALIGNMENT;
+
+    ArenaChunk* head = arena->head;
+
+    if(head != NULL && head->size - head->used >= size) /* fits */
+    {
+        void* ptr = head->data + head->used;
+
+        head->used += size;
+
+        return ptr;
+    }
+
+    /* start a new chunk, reusing the spare one if it is large enough */
+    ArenaChunk* chunk = arena->spare;
+
+    if(chunk != NULL && chunk->size >= size)
+    {
+        arena->spare = NULL;
+    }
+    else
+    {
+        size_t bytes = size > arena->chunk_size ? size : arena->chunk_size;
+
+        chunk = gaisan_calloc(1, sizeof(ArenaChunk));
+
+        if(chunk == NULL) /* allocation check */
+        {
+            return NULL;
+        }
+
+        chunk->data = gaisan_aligned_alloc(MATRIX_ALIGNMENT, bytes);
+
+        if(chunk->data == NULL) /* allocation check */
+        {
+            gaisan_free(chunk);
+            return NULL;
+        }
+
+        chunk->size = bytes;
+    }
+
+    chunk->prev = head;
+    chunk->base = arena_mark(arena);
+    chunk->used = size;
+    arena->head = chunk;
+
+    return chunk->data;
+}
+
+/**
+ * Returns the current position of `arena`, to be passed to `arena_release`
+ *
+ * */
+size_t arena_mark(GaisanArena* arena)
+{
+    if(arena == NULL || arena->head == NULL) /* empty arena */
+    {
+        return 0;
+    }
+
+    return arena->head->base + arena->head->used;
+}
+
+/**
+ * Releases every allocation made from `arena` since `mark` was taken
+ *
+ * One emptied chunk of the standard size is kept for reuse; oversized
+ *      chunks (made for single large requests) are returned to the allocator
+ *      as soon as they empty, so an arena only retains memory in proportion
+ *      to its chunk size.
+ *
+ * @param arena
+ *      the arena being released
+ * @param mark
+ *      a position previously returned by `arena_mark`
+ *
+ * */
+void arena_release(GaisanArena* arena, size_t mark)
+{
+    if(arena == NULL) /* null guard */
+    {
+        return;
+    }
+
+    while(arena->head != NULL && arena->head->base >= mark)
+    {
+        ArenaChunk* chunk = arena->head;
+
+        if(chunk->prev == NULL && chunk->size <= arena->chunk_size)
+        {
+            break; /* keep the first standard chunk in place */
+        }
+
+        arena->head = chunk->prev;
+
+        if(arena->spare == NULL && chunk->size <= arena->chunk_size)
+        {
+            arena->spare = chunk;
+        }
+        else
+        {
+            arena_chunk_free(chunk);
+        }
+    }
+
+    if(arena->head != NULL && mark >= arena->head->base &&
+            mark - arena->head->base < arena->head->used)
+    {
+        arena->head->used = mark - arena->head->base;
+    }
+}
+
+/**
+ * Returns the calling thread's arena, creating it on first use
+ *
+ * Callers must release everything they allocate from it (mark on entry,
+ *      release on exit) so that nested users compose.
+ *
+ * @return the arena, or `NULL` on failure
+ *
+ * */
+GaisanArena* gaisan_thread_arena(void)
+{
+    if(thread_arena == NULL)
+    {
+        thread_arena = arena_init(ARENA_CHUNK_SIZE);
+    }
+
+    return thread_arena;
+}
+
+/**
+ * Frees the calling thread's arena (it is recreated if used again)
+ *
+ * */
+void gaisan_thread_arena_free(void)
+{
+    arena_free(thread_arena);
+    thread_arena = NULL;
+}
+
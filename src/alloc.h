@@ -0,0 +1,68 @@
+/**
+ * @file alloc.h
+ * @author Jack McPherson
+ *
+ * Declarations for Gaisan's memory management: the library-wide allocator
+ * hook and scoped arena (bump) allocators for temporaries.
+ *
+ * */
+#ifndef ALLOC_H_
+#define ALLOC_H_
+
+#include <stddef.h>
+
+/**
+ * A user-supplied allocator
+ *
+ * `alloc` must return `size` bytes aligned to at least `alignment` (a power
+ * of two), or `NULL`. `resize` behaves like `realloc` and is only used on
+ * blocks allocated with the default alignment. `release` frees any block
+ * returned by the other two and must accept `NULL`. `ctx` is passed through
+ * to every call.
+ *
+ * */
+typedef struct
+{
+    void* (*alloc)(size_t size, size_t alignment, void* ctx);
+    void* (*resize)(void* ptr, size_t size, void* ctx);
+    void (*release)(void* ptr, void* ctx);
+    void* ctx;
+} GaisanAllocator;
+
+/**
+ * A scoped bump allocator
+ *
+ * Allocations are carved sequentially out of chunks obtained from the
+ * library allocator and are never freed individually; instead a position
+ * recorded with `arena_mark` is returned to with `arena_release`, which
+ * discards everything allocated since in one step.
+ *
+ * */
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct
+{
+    ArenaChunk* head; /* chunk currently being carved */
+    ArenaChunk* spare; /* released chunk kept for reuse */
+    size_t chunk_size;
+} GaisanArena;
+
+void gaisan_set_allocator(const GaisanAllocator* allocator);
+
+void* gaisan_malloc(size_t size);
+void* gaisan_calloc(size_t count, size_t size);
+void* gaisan_realloc(void* ptr, size_t size);
+void* gaisan_aligned_alloc(size_t alignment, size_t size);
+void gaisan_free(void* ptr);
+
+GaisanArena* arena_init(size_t chunk_size);
+void arena_free(GaisanArena* arena);
+void* arena_alloc(GaisanArena* arena, size_t size);
+size_t arena_mark(GaisanArena* arena);
+void arena_release(GaisanArena* arena, size_t mark);
+
+GaisanArena* gaisan_thread_arena(void);
+void gaisan_thread_arena_free(void);
+
+#endif /* ALLOC_H_ */
+
@@ -0,0 +1,780 @@
+/**
+ * @file batch.c
+ * @author Jack McPherson
+ *
+ * Implements batched operations over many small matrices of the same size:
+ * multiplication, LU factorisation with partial pivoting, solves and
+ * inversion.
+ *
+ * Matrices are stored interleaved (structure of arrays), so every kernel's
+ * innermost loop runs over matrices with unit stride, and no per-problem
+ * allocation or bookkeeping takes place. Work is split into blocks of
+ * `BATCH_LANE_BLOCK` matrices, which run on the worker pool.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "thread.h"
+#include "matrix.h"
+#include "batch.h"
+
+/**
+ * Returns a pointer to plane `(i, j)` of `batch`
+ *
+ * */
+static long double* batch_plane(const MatrixBatch* batch, unsigned int i,
+        unsigned int j)
+{
+    return batch->data + ((size_t)i * batch->cols + j) * batch->stride;
+}
+
+/**
+ * Returns the number of lane blocks needed to cover `count` matrices
+ *
+ * */
+static unsigned int batch_num_tasks(size_t count)
+{
+    return (unsigned int)((count + BATCH_LANE_BLOCK - 1) / BATCH_LANE_BLOCK);
+}
+
+/**
+ * Allocates a batch of `count` matrices of size `rows` x `cols`, leaving the
+ *      entries uninitialised
+ *
+ * */
+static MatrixBatch* batch_alloc(unsigned int rows, unsigned int cols,
+        size_t count)
+{
+    if(rows == 0 || cols == 0 || count == 0) /* bounds check */
+    {
+        return NULL;
+    }
+
+    MatrixBatch* batch = gaisan_calloc(1, sizeof(MatrixBatch));
+
+    if(batch == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    /* pad each plane so that every plane starts aligned */
+    size_t lanes = MATRIX_ALIGNMENT / sizeof(long double);
+    size_t stride = (count + lanes - 1) / lanes * lanes;
+
+    batch->data = gaisan_aligned_alloc(MATRIX_ALIGNMENT,
+            (size_t)rows * cols * stride * sizeof(long double));
+
+    if(batch->data == NULL) /* allocation check */
+    {
+        gaisan_free(batch);
+        return NULL;
+    }
+
+    batch->rows = rows;
+    batch->cols = cols;
+    batch->count = count;
+    batch->stride = stride;
+
+    return batch;
+}
+
+/**
+ * Initialises a batch of `count` zero matrices of size `rows` x `cols`
+ *
+ * @param rows
+ *      number of rows in each matrix
+ * @param cols
+ *      number of columns in each matrix
+ * @param count
+ *      number of matrices
+ *
+ * @return pointer to the batch, or `NULL` on failure
+ *
+ * */
+MatrixBatch* batch_init(unsigned int rows, unsigned int cols, size_t count)
+{
+    MatrixBatch* batch = batch_alloc(rows, cols, count);
+
+    if(batch == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    memset(batch->data, 0, (size_t)rows * cols * batch->stride *
+            sizeof(long double));
+
+    return batch;
+}
+
+/**
+ * Frees memory consumed by `batch`
+ *
+ * @param batch
+ *      the batch to be free'd
+ *
+ * */
+void batch_free(MatrixBatch* batch)
+{
+    if(batch == NULL) /* null guard */
+    {
+        return;
+    }
+
+    gaisan_free(batch->data);
+    gaisan_free(batch);
+}
+
+/**
+ * Performs a (deep) copy of `batch`
+ *
+ * @param batch
+ *      the batch to be copied
+ *
+ * @return pointer to copy of batch or `NULL` on failure
+ *
+ * */
+MatrixBatch* batch_copy(MatrixBatch* batch)
+{
+    if(batch == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    MatrixBatch* res = batch_alloc(batch->rows, batch->cols, batch->count);
+
+    if(res == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    memcpy(res->data, batch->data, (size_t)batch->rows * batch->cols *
+            batch->stride * sizeof(long double));
+
+    return res;
+}
+
+/**
+ * Returns entry `(i, j)` of matrix `p` of `batch` (NaN if out of bounds)
+ *
+ * */
+long double batch_get(MatrixBatch* batch, size_t p, unsigned int i,
+        unsigned int j)
+{
+    if(batch == NULL) /* null guard */
+    {
+        return NAN;
+    }
+
+    if(p >= batch->count || i >= batch->rows || j >= batch->cols)
+    {
+        return NAN;
+    }
+
+    return batch_plane(batch, i, j)[p];
+}
+
+/**
+ * Sets entry `(i, j)` of matrix `p` of `batch` to `val`
+ *
+ * */
+void batch_set(MatrixBatch* batch, size_t p, unsigned int i, unsigned int j,
+        long double val)
+{
+    if(batch == NULL) /* null guard */
+    {
+        return;
+    }
+
+    if(p >= batch->count || i >= batch->rows || j >= batch->cols)
+    {
+        return;
+    }
+
+    batch_plane(batch, i, j)[p] = val;
+}
+
+/**
+ * Copies `matrix` into slot `p` of `batch`
+ *
+ * @param batch
+ *      the batch being written to
+ * @param p
+ *      index of the matrix within the batch
+ * @param matrix
+ *      the matrix to store (same shape as the batch)
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool batch_set_matrix(MatrixBatch* batch, size_t p, Matrix* matrix)
+{
+    if(batch == NULL || matrix == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    /* bounds check */
+    if(p >= batch->count || matrix->rows != batch->rows ||
+            matrix->cols != batch->cols)
+    {
+        return false;
+    }
+
+    for(unsigned int i=0;i<batch->rows;i++)
+    {
+        const long double* row = matrix->data + (size_t)i * matrix->stride;
+
+        for(unsigned int j=0;j<batch->cols;j++)
+        {
+            batch_plane(batch, i, j)[p] = row[j];
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Copies slot `p` of `batch` out into a new matrix
+ *
+ * @param batch
+ *      the batch being read
+ * @param p
+ *      index of the matrix within the batch
+ *
+ * @return the matrix, or `NULL` on failure
+ *
+ * */
+Matrix* batch_get_matrix(MatrixBatch* batch, size_t p)
+{
+    if(batch == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(p >= batch->count) /* bounds check */
+    {
+        return NULL;
+    }
+
+    Matrix* matrix = matrix_init(batch->rows, batch->cols);
+
+    if(matrix == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    for(unsigned int i=0;i<batch->rows;i++)
+    {
+        long double* row = matrix->data + (size_t)i * matrix->stride;
+
+        for(unsigned int j=0;j<batch->cols;j++)
+        {
+            row[j] = batch_plane(batch, i, j)[p];
+        }
+    }
+
+    return matrix;
+}
+
+/**
+ * Arguments of a batched kernel, shared by every lane block
+ *
+ * */
+typedef struct
+{
+    MatrixBatch* a;
+    MatrixBatch* b;
+    MatrixBatch* c;
+    unsigned int* ipiv;
+    bool* singular;
+} BatchJob;
+
+/**
+ * Multiplies lane block `t`: `C = A * B`
+ *
+ * */
+static void batch_multiply_block(unsigned int t, void* arg)
+{
+    const BatchJob* job = arg;
+    size_t first = (size_t)t * BATCH_LANE_BLOCK;
+    size_t len = job->c->count - first < BATCH_LANE_BLOCK ?
+        job->c->count - first : BATCH_LANE_BLOCK;
+
+    for(unsigned int i=0;i<job->c->rows;i++)
+    {
+        for(unsigned int j=0;j<job->c->cols;j++)
+        {
+            long double* c_ij = batch_plane(job->c, i, j) + first;
+
+            memset(c_ij, 0, len * sizeof(long double));
+
+            for(unsigned int k=0;k<job->a->cols;k++)
+            {
+                const long double* a_ik = batch_plane(job->a, i, k) + first;
+                const long double* b_kj = batch_plane(job->b, k, j) + first;
+
+                for(size_t p=0;p<len;p++)
+                {
+                    c_ij[p] += a_ik[p] * b_kj[p];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Multiplies each matrix of `a` by the corresponding matrix of `b`, storing
+ *      the results in `dst`
+ *
+ * @param dst
+ *      the batch receiving the results (must not be `a` or `b`)
+ * @param a
+ *      batch of LHS matrices
+ * @param b
+ *      batch of RHS matrices
+ *
+ * @return `dst`, or `NULL` on failure
+ *
+ * */
+MatrixBatch* batch_multiply_into(MatrixBatch* dst, MatrixBatch* a,
+        MatrixBatch* b)
+{
+    if(dst == NULL || a == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    /* bounds check */
+    if(a->cols != b->rows || a->count != b->count || dst->count != a->count ||
+            dst->rows != a->rows || dst->cols != b->cols)
+    {
+        return NULL;
+    }
+
+    if(dst->data == a->data || dst->data == b->data) /* aliasing check */
+    {
+        return NULL;
+    }
+
+    BatchJob job = {a, b, dst, NULL, NULL};
+
+    parallel_for(batch_num_tasks(dst->count), &batch_multiply_block, &job);
+
+    return dst;
+}
+
+/**
+ * Multiplies each matrix of `a` by the corresponding matrix of `b`
+ *
+ * @param a
+ *      batch of LHS matrices
+ * @param b
+ *      batch of RHS matrices
+ *
+ * @return batch of products, or `NULL` on failure
+ *
+ * */
+MatrixBatch* batch_multiply(MatrixBatch* a, MatrixBatch* b)
+{
+    if(a == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    MatrixBatch* res = batch_alloc(a->rows, b->cols, a->count);
+
+    if(batch_multiply_into(res, a, b) == NULL) /* check for failure */
+    {
+        batch_free(res);
+        return NULL;
+    }
+
+    return res;
+}
+
+/**
+ * Factorises lane block `t` in place
+ *
+ * */
+static void batch_lu_block(unsigned int t, void* arg)
+{
+    const BatchJob* job = arg;
+    MatrixBatch* a = job->a;
+    unsigned int n = a->rows;
+    size_t first = (size_t)t * BATCH_LANE_BLOCK;
+    size_t len = a->count - first < BATCH_LANE_BLOCK ? a->count - first :
+        BATCH_LANE_BLOCK;
+    unsigned int piv[BATCH_LANE_BLOCK];
+    long double best[BATCH_LANE_BLOCK];
+
+    for(unsigned int k=0;k<n;k++)
+    {
+        unsigned int* ipiv = job->ipiv + (size_t)k * a->stride + first;
+        const long double* a_kk = batch_plane(a, k, k) + first;
+
+        /* choose pivots, every lane independently */
+        for(size_t p=0;p<len;p++)
+        {
+            piv[p] = k;
+            best[p] = fabsl(a_kk[p]);
+        }
+
+        for(unsigned int i=k + 1;i<n;i++)
+        {
+            const long double* a_ik = batch_plane(a, i, k) + first;
+
+            for(size_t p=0;p<len;p++)
+            {
+                long double v = fabsl(a_ik[p]);
+
+                piv[p] = v > best[p] ? i : piv[p];
+                best[p] = v > best[p] ? v : best[p];
+            }
+        }
+
+        for(size_t p=0;p<len;p++) /* interchange rows */
+        {
+            ipiv[p] = piv[p];
+
+            if(piv[p] == k)
+            {
+                continue;
+            }
+
+            for(unsigned int j=0;j<n;j++)
+            {
+                long double* row_k = batch_plane(a, k, j) + first + p;
+                long double* row_r = batch_plane(a, piv[p], j) + first + p;
+                long double tmp = *row_k;
+
+                *row_k = *row_r;
+                *row_r = tmp;
+            }
+        }
+
+        /* a zero pivot leaves the column of L zero, keeping the lane finite */
+        for(size_t p=0;p<len;p++)
+        {
+            if(a_kk[p] == 0.0)
+            {
+                job->singular[first + p] = true;
+            }
+
+            best[p] = a_kk[p] == 0.0 ? 0.0 : 1.0 / a_kk[p];
+        }
+
+        for(unsigned int i=k + 1;i<n;i++)
+        {
+            long double* l_ik = batch_plane(a, i, k) + first;
+
+            for(size_t p=0;p<len;p++)
+            {
+                l_ik[p] *= best[p];
+            }
+
+            for(unsigned int j=k + 1;j<n;j++)
+            {
+                long double* a_ij = batch_plane(a, i, j) + first;
+                const long double* u_kj = batch_plane(a, k, j) + first;
+
+                for(size_t p=0;p<len;p++)
+                {
+                    a_ij[p] -= l_ik[p] * u_kj[p];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Computes the LU factorisation with partial pivoting of every matrix in
+ *      `a`
+ *
+ * Singular matrices do not cause failure; they are flagged in `singular`
+ *      and counted in `num_singular`.
+ *
+ * @param a
+ *      batch of square matrices (not modified)
+ *
+ * @return the batched factorisation, or `NULL` on failure
+ *
+ * */
+BatchLU* batch_lu_factor(MatrixBatch* a)
+{
+    if(a == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(a->rows != a->cols) /* bounds check */
+    {
+        return NULL;
+    }
+
+    BatchLU* lu = gaisan_calloc(1, sizeof(BatchLU));
+
+    if(lu == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    lu->factors = batch_copy(a);
+    lu->ipiv = gaisan_calloc((size_t)a->rows * a->stride, sizeof(unsigned int));
+    lu->singular = gaisan_calloc(a->count, sizeof(bool));
+
+    if(lu->factors == NULL || lu->ipiv == NULL || lu->singular == NULL)
+    {
+        batch_lu_free(lu);
+        return NULL;
+    }
+
+    BatchJob job = {lu->factors, NULL, NULL, lu->ipiv, lu->singular};
+
+    parallel_for(batch_num_tasks(a->count), &batch_lu_block, &job);
+
+    for(size_t p=0;p<a->count;p++)
+    {
+        lu->num_singular += lu->singular[p];
+    }
+
+    return lu;
+}
+
+/**
+ * Frees memory consumed by `lu`
+ *
+ * @param lu
+ *      the factorisation to be free'd
+ *
+ * */
+void batch_lu_free(BatchLU* lu)
+{
+    if(lu == NULL) /* null guard */
+    {
+        return;
+    }
+
+    batch_free(lu->factors);
+    gaisan_free(lu->ipiv);
+    gaisan_free(lu->singular);
+    gaisan_free(lu);
+}
+
+/**
+ * Solves lane block `t` in place: `X = A^-1 X`, where `job->b` holds the
+ *      right-hand sides if they are not already in `job->c`
+ *
+ * */
+static void batch_solve_block(unsigned int t, void* arg)
+{
+    const BatchJob* job = arg;
+    const MatrixBatch* a = job->a;
+    MatrixBatch* x = job->c;
+    unsigned int n = a->rows;
+    unsigned int r = x->cols;
+    size_t first = (size_t)t * BATCH_LANE_BLOCK;
+    size_t len = a->count - first < BATCH_LANE_BLOCK ? a->count - first :
+        BATCH_LANE_BLOCK;
+
+    if(job->b != NULL) /* copy the right-hand sides */
+    {
+        for(unsigned int i=0;i<n;i++)
+        {
+            for(unsigned int c=0;c<r;c++)
+            {
+                memcpy(batch_plane(x, i, c) + first,
+                        batch_plane(job->b, i, c) + first,
+                        len * sizeof(long double));
+            }
+        }
+    }
+
+    for(unsigned int k=0;k<n;k++) /* apply the interchanges */
+    {
+        const unsigned int* ipiv = job->ipiv + (size_t)k * a->stride + first;
+
+        for(size_t p=0;p<len;p++)
+        {
+            if(ipiv[p] == k)
+            {
+                continue;
+            }
+
+            for(unsigned int c=0;c<r;c++)
+            {
+                long double* x_k = batch_plane(x, k, c) + first + p;
+                long double* x_r = batch_plane(x, ipiv[p], c) + first + p;
+                long double tmp = *x_k;
+
+                *x_k = *x_r;
+                *x_r = tmp;
+            }
+        }
+    }
+
+    for(unsigned int k=0;k<n;k++) /* L y = P b */
+    {
+        for(unsigned int i=k + 1;i<n;i++)
+        {
+            const long double* l_ik = batch_plane(a, i, k) + first;
+
+            for(unsigned int c=0;c<r;c++)
+            {
+                long double* x_i = batch_plane(x, i, c) + first;
+                const long double* x_k = batch_plane(x, k, c) + first;
+
+                for(size_t p=0;p<len;p++)
+                {
+                    x_i[p] -= l_ik[p] * x_k[p];
+                }
+            }
+        }
+    }
+
+    for(unsigned int k=n;k-->0;) /* U x = y */
+    {
+        const long double* u_kk = batch_plane(a, k, k) + first;
+
+        for(unsigned int c=0;c<r;c++)
+        {
+            long double* x_k = batch_plane(x, k, c) + first;
+
+            for(size_t p=0;p<len;p++)
+            {
+                x_k[p] /= u_kk[p];
+            }
+
+            for(unsigned int i=0;i<k;i++)
+            {
+                const long double* u_ik = batch_plane(a, i, k) + first;
+                long double* x_i = batch_plane(x, i, c) + first;
+
+                for(size_t p=0;p<len;p++)
+                {
+                    x_i[p] -= u_ik[p] * x_k[p];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Solves `A_p X_p = B_p` for every matrix `p` of the batch, storing the
+ *      solutions in `x`
+ *
+ * Solutions of singular systems are not finite.
+ *
+ * @param lu
+ *      the batched factorisation of `A`
+ * @param x
+ *      batch receiving the solutions (may be `b`)
+ * @param b
+ *      batch of right-hand sides, each `n` x `r`
+ *
+ * @return `x`, or `NULL` on failure
+ *
+ * */
+MatrixBatch* batch_lu_solve_into(BatchLU* lu, MatrixBatch* x,
+        MatrixBatch* b)
+{
+    if(lu == NULL || x == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    MatrixBatch* a = lu->factors;
+
+    /* bounds check */
+    if(b->rows != a->rows || b->count != a->count || x->rows != b->rows ||
+            x->cols != b->cols || x->count != b->count)
+    {
+        return NULL;
+    }
+
+    BatchJob job = {a, x == b ? NULL : b, x, lu->ipiv, NULL};
+
+    parallel_for(batch_num_tasks(a->count), &batch_solve_block, &job);
+
+    return x;
+}
+
+/**
+ * Solves `A_p X_p = B_p` for every matrix `p` of the batch
+ *
+ * @param lu
+ *      the batched factorisation of `A`
+ * @param b
+ *      batch of right-hand sides
+ *
+ * @return batch of solutions, or `NULL` on failure
+ *
+ * */
+MatrixBatch* batch_lu_solve(BatchLU* lu, MatrixBatch* b)
+{
+    if(lu == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    MatrixBatch* res = batch_alloc(b->rows, b->cols, b->count);
+
+    if(batch_lu_solve_into(lu, res, b) == NULL) /* check for failure */
+    {
+        batch_free(res);
+        return NULL;
+    }
+
+    return res;
+}
+
+/**
+ * Inverts every matrix in `a`
+ *
+ * @param a
+ *      batch of square matrices
+ *
+ * @return batch of inverses, or `NULL` on failure (including if any matrix
+ *      is singular; use `batch_lu_factor` to identify which)
+ *
+ * */
+MatrixBatch* batch_invert(MatrixBatch* a)
+{
+    BatchLU* lu = batch_lu_factor(a);
+
+    if(lu == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    MatrixBatch* inv = NULL;
+
+    if(lu->num_singular == 0)
+    {
+        inv = batch_init(a->rows, a->cols, a->count);
+    }
+
+    if(inv != NULL)
+    {
+        for(unsigned int i=0;i<a->rows;i++)
+        {
+            long double* e_ii = batch_plane(inv, i, i);
+
+            for(size_t p=0;p<a->count;p++)
+            {
+                e_ii[p] = 1.0;
+            }
+        }
+
+        batch_lu_solve_into(lu, inv, inv);
+    }
+
+    batch_lu_free(lu);
+
+    return inv;
+}
+
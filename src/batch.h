@@ -0,0 +1,70 @@
+/**
+ * @file batch.h
+ * @author Jack McPherson
+ *
+ * Declarations for batches of small, equally-sized matrices stored in
+ * structure-of-arrays form.
+ *
+ * */
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "matrix.h"
+
+/**
+ * `count` matrices of size `rows` x `cols`, stored interleaved: entry
+ * `(i, j)` of matrix `p` lives at `data[(i * cols + j) * stride + p]`, so
+ * each entry forms a contiguous, aligned plane with one lane per matrix
+ *
+ * */
+typedef struct
+{
+    unsigned int rows;
+    unsigned int cols;
+    size_t count;
+    size_t stride;
+    long double* data;
+} MatrixBatch;
+
+/**
+ * Batched LU factorisation with partial pivoting
+ *
+ * Row `k` of matrix `p` was interchanged with row `ipiv[k * stride + p]`
+ * at step `k` of the elimination.
+ *
+ * */
+typedef struct
+{
+    MatrixBatch* factors;
+    unsigned int* ipiv;
+    bool* singular; /* per matrix */
+    size_t num_singular;
+} BatchLU;
+
+MatrixBatch* batch_init(unsigned int rows, unsigned int cols, size_t count);
+void batch_free(MatrixBatch* batch);
+MatrixBatch* batch_copy(MatrixBatch* batch);
+
+long double batch_get(MatrixBatch* batch, size_t p, unsigned int i,
+        unsigned int j);
+void batch_set(MatrixBatch* batch, size_t p, unsigned int i, unsigned int j,
+        long double val);
+bool batch_set_matrix(MatrixBatch* batch, size_t p, Matrix* matrix);
+Matrix* batch_get_matrix(MatrixBatch* batch, size_t p);
+
+MatrixBatch* batch_multiply(MatrixBatch* a, MatrixBatch* b);
+MatrixBatch* batch_multiply_into(MatrixBatch* dst, MatrixBatch* a,
+        MatrixBatch* b);
+
+BatchLU* batch_lu_factor(MatrixBatch* a);
+void batch_lu_free(BatchLU* lu);
+MatrixBatch* batch_lu_solve(BatchLU* lu, MatrixBatch* b);
+MatrixBatch* batch_lu_solve_into(BatchLU* lu, MatrixBatch* x,
+        MatrixBatch* b);
+MatrixBatch* batch_invert(MatrixBatch* a);
+
+#endif /* BATCH_H_ */
+
@@ -0,0 +1,502 @@
+/**
+ * @file chol.c
+ * @author Jack McPherson
+ *
+ * Implements blocked, right-looking Cholesky (LL^T) and LDL^T factorisations
+ * of symmetric matrices, and solves using them.
+ *
+ * Only the lower triangle of the input is read and only the lower triangle
+ * of the factor is written. The trailing update after each
+ * `CHOL_BLOCK_SIZE` panel is applied one block column at a time to the
+ * blocks on or below the diagonal, so it costs half of the equivalent LU
+ * update.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "view.h"
+#include "chol.h"
+
+/**
+ * Computes `C -= X * Y^T` on and below the diagonal of the `n` x `n` matrix
+ *      `C`, where `X` and `Y` are `n` x `k`; the strict upper triangle of `C`
+ *      is not touched
+ *
+ * */
+static void chol_update(unsigned int n, unsigned int k, const long double* x,
+        unsigned int ldx, const long double* y, unsigned int ldy,
+        long double* c, unsigned int ldc)
+{
+    for(unsigned int j=0;j<n;j+=CHOL_BLOCK_SIZE)
+    {
+        unsigned int nb = n - j < CHOL_BLOCK_SIZE ? n - j : CHOL_BLOCK_SIZE;
+
+        /* diagonal block, one row of its lower triangle at a time */
+        for(unsigned int i=j;i<j+nb;i++)
+        {
+            gemm(1, i - j + 1, k, -1.0, x + (size_t)i * ldx, ldx, 1,
+                    y + (size_t)j * ldy, 1, ldy, 1.0,
+                    c + (size_t)i * ldc + j, ldc, 1);
+        }
+
+        if(j + nb < n) /* blocks below the diagonal */
+        {
+            gemm(n - j - nb, nb, k, -1.0, x + (size_t)(j + nb) * ldx, ldx, 1,
+                    y + (size_t)j * ldy, 1, ldy, 1.0,
+                    c + (size_t)(j + nb) * ldc + j, ldc, 1);
+        }
+    }
+}
+
+/**
+ * Factorises the `nb` x `nb` diagonal block at `a` in place; `d` is `NULL`
+ *      for LL^T and receives the diagonal for LDL^T
+ *
+ * @return true on success, false if the block is not positive definite
+ *      (LL^T) or has a zero pivot (LDL^T)
+ *
+ * */
+static bool chol_diag_block(unsigned int nb, long double* a, unsigned int lda,
+        long double* d)
+{
+    for(unsigned int j=0;j<nb;j++)
+    {
+        long double* row_j = a + (size_t)j * lda;
+        long double pivot = row_j[j];
+
+        for(unsigned int p=0;p<j;p++)
+        {
+            pivot -= row_j[p] * row_j[p] * (d == NULL ? 1.0 : d[p]);
+        }
+
+        if(d == NULL)
+        {
+            if(!(pivot > 0.0)) /* not positive definite */
+            {
+                return false;
+            }
+
+            pivot = sqrtl(pivot);
+            row_j[j] = pivot;
+        }
+        else
+        {
+            if(pivot == 0.0) /* zero pivot */
+            {
+                return false;
+            }
+
+            d[j] = pivot;
+            row_j[j] = 1.0;
+        }
+
+        for(unsigned int i=j+1;i<nb;i++)
+        {
+            long double* row_i = a + (size_t)i * lda;
+            long double sum = row_i[j];
+
+            for(unsigned int p=0;p<j;p++)
+            {
+                sum -= row_i[p] * row_j[p] * (d == NULL ? 1.0 : d[p]);
+            }
+
+            row_i[j] = sum / pivot;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Solves `X * L11^T = A21` in place for the `m` x `nb` block at `a21`, where
+ *      `L11` is lower triangular (unit if `unit`)
+ *
+ * */
+static void chol_panel_solve(unsigned int m, unsigned int nb, bool unit,
+        const long double* l11, unsigned int ldl, long double* a21,
+        unsigned int lda)
+{
+    for(unsigned int i=0;i<m;i++)
+    {
+        long double* row = a21 + (size_t)i * lda;
+
+        for(unsigned int p=0;p<nb;p++)
+        {
+            const long double* l_p = l11 + (size_t)p * ldl;
+            long double sum = row[p];
+
+            for(unsigned int q=0;q<p;q++)
+            {
+                sum -= l_p[q] * row[q];
+            }
+
+            row[p] = unit ? sum : sum / l_p[p];
+        }
+    }
+}
+
+/**
+ * Factorises `A` as `L * L^T` (`ldl` false) or `L * D * L^T` (`ldl` true)
+ *
+ * */
+static Cholesky* chol_factor_impl(MatrixView A, bool ldl)
+{
+    if(A.data == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(A.rows != A.cols) /* bounds check */
+    {
+        return NULL;
+    }
+
+    unsigned int n = A.rows;
+
+    Cholesky* chol = gaisan_calloc(1, sizeof(Cholesky));
+
+    if(chol == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    chol->factor = matrix_init(n, n);
+
+    if(chol->factor == NULL) /* check for failure */
+    {
+        gaisan_free(chol);
+        return NULL;
+    }
+
+    long double* a = chol->factor->data;
+    unsigned int lda = chol->factor->stride;
+
+    /* copy the lower triangle */
+    for(unsigned int i=0;i<n;i++)
+    {
+        view_copy(matrix_subview(chol->factor, i, 0, 1, i + 1),
+                view_sub(A, i, 0, 1, i + 1));
+    }
+
+    /* LDL^T needs D, and L21 * D as a scratch panel */
+    long double* w = NULL;
+
+    if(ldl)
+    {
+        unsigned int nb = n < CHOL_BLOCK_SIZE ? n : CHOL_BLOCK_SIZE;
+
+        chol->diag = gaisan_calloc(n, sizeof(long double));
+        w = gaisan_calloc((size_t)n * nb, sizeof(long double));
+
+        if(chol->diag == NULL || w == NULL) /* allocation check */
+        {
+            gaisan_free(w);
+            chol_free(chol);
+            return NULL;
+        }
+    }
+
+    for(unsigned int j=0;j<n;j+=CHOL_BLOCK_SIZE)
+    {
+        unsigned int nb = n - j < CHOL_BLOCK_SIZE ? n - j : CHOL_BLOCK_SIZE;
+        unsigned int rest = n - j - nb;
+        long double* a11 = a + (size_t)j * lda + j;
+        long double* a21 = a11 + (size_t)nb * lda;
+        long double* d = ldl ? chol->diag + j : NULL;
+
+        if(!chol_diag_block(nb, a11, lda, d)) /* factorisation failed */
+        {
+            gaisan_free(w);
+            chol_free(chol);
+            return NULL;
+        }
+
+        if(rest == 0)
+        {
+            continue;
+        }
+
+        /* L21 = A21 * L11^-T (* D1^-1) */
+        chol_panel_solve(rest, nb, ldl, a11, lda, a21, lda);
+
+        if(!ldl)
+        {
+            /* A22 -= L21 * L21^T */
+            chol_update(rest, nb, a21, lda, a21, lda, a21 + nb, lda);
+            continue;
+        }
+
+        /* W = A21 * L11^-T, L21 = W * D1^-1, A22 -= L21 * W^T */
+        for(unsigned int i=0;i<rest;i++)
+        {
+            long double* row = a21 + (size_t)i * lda;
+
+            for(unsigned int p=0;p<nb;p++)
+            {
+                w[(size_t)i * nb + p] = row[p];
+                row[p] /= d[p];
+            }
+        }
+
+        chol_update(rest, nb, a21, lda, w, nb, a21 + nb, lda);
+    }
+
+    gaisan_free(w);
+
+    return chol;
+}
+
+/**
+ * Computes the Cholesky factorisation `A = L * L^T` of the symmetric
+ *      positive definite matrix `A`
+ *
+ * @param A
+ *      the matrix to factorise (only its lower triangle is read)
+ *
+ * @return the factorisation, or `NULL` on failure (including when `A` is not
+ *      positive definite)
+ *
+ * */
+Cholesky* chol_factor(Matrix* A)
+{
+    return chol_factor_impl(matrix_view(A), false);
+}
+
+/**
+ * Computes the Cholesky factorisation of the symmetric positive definite
+ *      matrix viewed by `A`
+ *
+ * @param A
+ *      view of the matrix to factorise (only its lower triangle is read)
+ *
+ * @return the factorisation, or `NULL` on failure
+ *
+ * */
+Cholesky* chol_factor_view(MatrixView A)
+{
+    return chol_factor_impl(A, false);
+}
+
+/**
+ * Computes the factorisation `A = L * D * L^T` (with `L` unit lower
+ *      triangular and `D` diagonal) of the symmetric matrix `A`
+ *
+ * No pivoting is performed, so `A` should be positive definite or otherwise
+ *      well suited to symmetric elimination in its given order.
+ *
+ * @param A
+ *      the matrix to factorise (only its lower triangle is read)
+ *
+ * @return the factorisation, or `NULL` on failure (including on a zero
+ *      pivot)
+ *
+ * */
+Cholesky* ldl_factor(Matrix* A)
+{
+    return chol_factor_impl(matrix_view(A), true);
+}
+
+/**
+ * Computes the factorisation `A = L * D * L^T` of the symmetric matrix
+ *      viewed by `A`
+ *
+ * @param A
+ *      view of the matrix to factorise (only its lower triangle is read)
+ *
+ * @return the factorisation, or `NULL` on failure
+ *
+ * */
+Cholesky* ldl_factor_view(MatrixView A)
+{
+    return chol_factor_impl(A, true);
+}
+
+/**
+ * Frees memory consumed by `chol`
+ *
+ * @param chol
+ *      the factorisation to be free'd
+ *
+ * */
+void chol_free(Cholesky* chol)
+{
+    if(chol == NULL) /* null guard */
+    {
+        return;
+    }
+
+    matrix_free(chol->factor);
+    gaisan_free(chol->diag);
+    gaisan_free(chol);
+}
+
+/**
+ * Solves `A * x = b` using the factorisation `chol` of `A`, storing the
+ *      result in `x`
+ *
+ * @param chol
+ *      the factorisation of `A`
+ * @param x
+ *      the matrix receiving the solution (same shape as `b`; may be `b`
+ *          itself)
+ * @param b
+ *      the right-hand side(s), one per column
+ *
+ * @return `x`, or `NULL` on failure
+ *
+ * */
+Matrix* chol_solve_into(Cholesky* chol, Matrix* x, Matrix* b)
+{
+    if(chol == NULL || x == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    unsigned int n = chol->factor->rows;
+    const long double* l = chol->factor->data;
+    unsigned int ldl = chol->factor->stride;
+    bool unit = chol->diag != NULL;
+
+    /* bounds check */
+    if(b->rows != n || x->rows != n || x->cols != b->cols)
+    {
+        return NULL;
+    }
+
+    if(x->data != b->data)
+    {
+        for(unsigned int i=0;i<n;i++)
+        {
+            memcpy(x->data + (size_t)i * x->stride,
+                    b->data + (size_t)i * b->stride,
+                    b->cols * sizeof(long double));
+        }
+    }
+
+    trsm_lower(unit, n, x->cols, l, ldl, 1, x->data, x->stride);
+
+    if(unit) /* apply D^-1 */
+    {
+        for(unsigned int i=0;i<n;i++)
+        {
+            long double* row = x->data + (size_t)i * x->stride;
+
+            for(unsigned int j=0;j<x->cols;j++)
+            {
+                row[j] /= chol->diag[i];
+            }
+        }
+    }
+
+    /* L^T is L read with its strides swapped */
+    trsm_upper(unit, n, x->cols, l, 1, ldl, x->data, x->stride);
+
+    return x;
+}
+
+/**
+ * Solves `A * x = b` using the factorisation `chol` of `A`
+ *
+ * @param chol
+ *      the factorisation of `A`
+ * @param b
+ *      the right-hand side(s), one per column
+ *
+ * @return the solution `x`, or `NULL` on failure
+ *
+ * */
+Matrix* chol_solve(Cholesky* chol, Matrix* b)
+{
+    if(chol == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    Matrix* x = matrix_init(b->rows, b->cols);
+
+    if(chol_solve_into(chol, x, b) == NULL) /* check for failure */
+    {
+        matrix_free(x);
+        return NULL;
+    }
+
+    return x;
+}
+
+
+/**
+ * Updates the Cholesky factorisation `chol` of `A` in place to one of
+ *      `A + W * W^T`, in O(n^2) per column of `W`
+ *
+ * Each column is applied as a sequence of Givens rotations. These are
+ *      generated and applied one row of `L` at a time, so `L` is only ever
+ *      traversed along its rows. The result is positive definite whenever
+ *      `A` is, so the update cannot fail numerically.
+ *
+ * @param chol
+ *      an `A = L * L^T` factorisation (LDL^T factorisations are not
+ *          supported)
+ * @param W
+ *      the `n` x `k` update
+ *
+ * @return true on success, false on failure
+ *
+ * */
+bool chol_rank_update(Cholesky* chol, Matrix* W)
+{
+    if(chol == NULL || W == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    unsigned int n = chol->factor->rows;
+
+    if(chol->diag != NULL || W->rows != n) /* bounds check */
+    {
+        return false;
+    }
+
+    /* rotation k takes (L_kk, x_k) to (r, 0): c = r / L_kk, s = x_k / L_kk */
+    long double* c = gaisan_malloc(2 * (size_t)n * sizeof(long double));
+
+    if(c == NULL) /* allocation check */
+    {
+        return false;
+    }
+
+    long double* s = c + n;
+
+    for(unsigned int q=0;q<W->cols;q++)
+    {
+        for(unsigned int i=0;i<n;i++)
+        {
+            long double* row = chol->factor->cells[i];
+            long double x_i = W->cells[i][q];
+
+            for(unsigned int k=0;k<i;k++) /* earlier rotations */
+            {
+                long double l_ik = (row[k] + s[k] * x_i) / c[k];
+
+                x_i = c[k] * x_i - s[k] * l_ik;
+                row[k] = l_ik;
+            }
+
+            long double r = sqrtl(row[i] * row[i] + x_i * x_i);
+
+            c[i] = r / row[i];
+            s[i] = x_i / row[i];
+            row[i] = r;
+        }
+    }
+
+    gaisan_free(c);
+
+    return true;
+}
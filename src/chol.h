@@ -0,0 +1,43 @@
+/**
+ * @file chol.h
+ * @author Jack McPherson
+ *
+ * Declarations for Cholesky (LL^T) and LDL^T factorisations of symmetric
+ * matrices.
+ *
+ * */
+#ifndef CHOL_H_
+#define CHOL_H_
+
+#include <stdbool.h>
+
+#include "matrix.h"
+#include "view.h"
+
+/**
+ * Cholesky-type factorisation of a symmetric matrix `A`
+ *
+ * `factor` holds the lower triangular `L` (its strict upper triangle is
+ * zero). For `A = L * L^T`, `diag` is `NULL`; for `A = L * D * L^T`, `L` has
+ * an implicit unit diagonal and `diag` holds the diagonal of `D`.
+ *
+ * */
+typedef struct
+{
+    Matrix* factor;
+    long double* diag;
+} Cholesky;
+
+Cholesky* chol_factor(Matrix* A);
+Cholesky* ldl_factor(Matrix* A);
+Cholesky* chol_factor_view(MatrixView A);
+Cholesky* ldl_factor_view(MatrixView A);
+void chol_free(Cholesky* chol);
+
+Matrix* chol_solve(Cholesky* chol, Matrix* b);
+Matrix* chol_solve_into(Cholesky* chol, Matrix* x, Matrix* b);
+
+bool chol_rank_update(Cholesky* chol, Matrix* W);
+
+#endif /* CHOL_H_ */
+
@@ -14,6 +14,13 @@
  * */
 #define DEFAULT_STEP_SIZE 0.000000001
 
+/**
+ * default step size for finite difference methods in `float`, where
+ * `DEFAULT_STEP_SIZE` is below the resolution of the type
+ *
+ * */
+#define DEFAULT_STEP_SIZE_F 0.001
+
 /**
  * suitable default tolerance for most numerical methods
  *
@@ -39,16 +46,343 @@
 #define BUF_EXPAND_FACTOR 2
 
 /**
- * default minimum size for Strassen base case
+ * Strassen crossover: operands with any dimension at or below this size are
+ * multiplied with the blocked GEMM kernel instead of recursing
+ *
+ * */
+#define STRASSEN_MIN_SIZE 128
+
+/**
+ * number of sub-products in one step of Strassen's algorithm
+ *
+ * */
+#define STRASSEN_NUM_PRODUCTS 7
+
+/**
+ * alignment (in bytes) of matrix storage and of the start of each matrix row
+ *
+ * */
+#define MATRIX_ALIGNMENT 64
+
+/**
+ * GEMM microkernel tile height (rows of the result held in registers)
+ *
+ * */
+#define GEMM_MR 2
+
+/**
+ * GEMM microkernel tile width (columns of the result held in registers)
+ *
+ * */
+#define GEMM_NR 2
+
+/**
+ * GEMM block size along the shared dimension (packed B micro-panel in L1)
+ *
+ * */
+#define GEMM_KC 256
+
+/**
+ * GEMM block size along the rows of the result (packed A block in L2)
+ *
+ * */
+#define GEMM_MC 96
+
+/**
+ * GEMM block size along the columns of the result (packed B panel in L3)
+ *
+ * */
+#define GEMM_NC 2048
+
+/**
+ * products with fewer multiply-adds than this skip packing entirely
+ *
+ * */
+#define GEMM_SMALL_FLOPS 32768
+
+/**
+ * `double` GEMM microkernel tile height
+ *
+ * */
+#define GEMMD_MR 6
+
+/**
+ * `double` GEMM microkernel tile width (a multiple of the vector width)
+ *
+ * */
+#define GEMMD_NR 8
+
+/**
+ * `float` GEMM microkernel tile height
+ *
+ * */
+#define GEMMF_MR 8
+
+/**
+ * `float` GEMM microkernel tile width (a multiple of the vector width)
+ *
+ * */
+#define GEMMF_NR 32
+
+/**
+ * block size of the blocked triangular solves
+ *
+ * */
+#define TRSM_BLOCK_SIZE 64
+
+/**
+ * panel width of the blocked LU factorisation
+ *
+ * */
+#define LU_BLOCK_SIZE 64
+
+/**
+ * panel width of the blocked Cholesky and LDL^T factorisations
+ *
+ * */
+#define CHOL_BLOCK_SIZE 64
+
+/**
+ * panel width of the blocked Householder QR factorisation
+ *
+ * */
+#define QR_BLOCK_SIZE 32
+
+/**
+ * rows per leaf block in TSQR (raised to twice the column count if needed)
+ *
+ * */
+#define TSQR_BLOCK_ROWS 512
+
+/**
+ * least-squares problems with at least this many rows per column use TSQR
+ *
+ * */
+#define TSQR_MIN_ASPECT 8
+
+/**
+ * approximate multiply-adds per task when sparse products are split into
+ * row blocks
+ *
+ * */
+#define SPARSE_TASK_WORK 65536
+
+/**
+ * default iteration limit for Krylov solvers
+ *
+ * */
+#define KRYLOV_MAX_ITER 1000
+
+/**
+ * default number of GMRES iterations between restarts
+ *
+ * */
+#define GMRES_RESTART 30
+
+/**
+ * default size in bytes of the chunks arenas obtain from the allocator;
+ * large enough to hold the GEMM packing buffers, so that a thread's arena
+ * settles into a single reused chunk
+ *
+ * */
+#define ARENA_CHUNK_SIZE 16777216
+
+/**
+ * side length of the square tiles moved by the blocked transpose; a source
+ * and a destination tile together fit in a 32KiB L1 data cache
+ *
+ * */
+#define TRANSPOSE_BLOCK 32
+
+/**
+ * number of entries from which a transpose is split across threads
+ *
+ * */
+#define TRANSPOSE_PARALLEL_SIZE 262144
+
+/**
+ * number of matrices handled together by each batched kernel task, chosen
+ * so the planes of a block of 4x4 problems stay in L2 cache
+ *
+ * */
+#define BATCH_LANE_BLOCK 256
+
+/**
+ * height of the tiles of C handed to each thread by parallel GEMM
+ *
+ * */
+#define GEMM_TILE_M 192
+
+/**
+ * width of the tiles of C handed to each thread by parallel GEMM
+ *
+ * */
+#define GEMM_TILE_N 512
+
+/**
+ * products with fewer multiply-adds than this are never parallelised
+ *
+ * */
+#define GEMM_PARALLEL_FLOPS 4194304
+
+/**
+ * environment variable holding the default number of threads
+ *
+ * */
+#define GAISAN_NUM_THREADS_ENV "GAISAN_NUM_THREADS"
+
+/**
+ * upper bound on the number of threads Gaisan will use
+ *
+ * */
+#define GAISAN_MAX_THREADS 256
+
+/**
+ * version of the binary matrix file format written by `write_matrix_bin`
+ *
+ * */
+#define MATRIX_BIN_VERSION 1
+
+/**
+ * minimum number of bytes requested per read when loading a text matrix
+ *
+ * */
+#define READ_BLOCK_SIZE 1048576
+
+/**
+ * minimum number of bytes of text handed to each thread when parsing a text
+ *      matrix in parallel
+ *
+ * */
+#define READ_TASK_SIZE 4194304
+
+/**
+ * default memory budget (in bytes) for the tile buffers of an out-of-core
+ *      multiply
+ *
+ * */
+#define OOC_DEFAULT_BUDGET 268435456
+
+/**
+ * number of square tiles resident during an out-of-core multiply (one result
+ *      tile plus two buffers for each operand)
+ *
+ * */
+#define OOC_NUM_TILES 5
+
+/**
+ * out-of-core tile edges are rounded down to a multiple of this (when large
+ *      enough)
+ *
+ * */
+#define OOC_TILE_ALIGN 64
+
+/**
+ * maximum number of nodes in an elementwise matrix expression
+ *
+ * */
+#define EXPR_MAX_NODES 32
+
+/**
+ * number of columns evaluated at a time by a fused elementwise expression
+ *      (intermediate results for one block stay in L1 cache)
+ *
+ * */
+#define EXPR_BLOCK 128
+
+/**
+ * minimum number of elements per thread when evaluating an elementwise
+ *      expression in parallel
+ *
+ * */
+#define EXPR_TASK_SIZE 65536
+
+/**
+ * panel width of the blocked Householder tridiagonalisation
+ *
+ * */
+#define EIG_BLOCK_SIZE 32
+
+/**
+ * tridiagonal problems at or below this size are solved directly by the
+ *      implicit QL method rather than split by divide and conquer
+ *
+ * */
+#define EIG_DC_MIN_SIZE 32
+
+/**
+ * maximum number of implicit QL sweeps spent on any one eigenvalue
+ *
+ * */
+#define EIG_MAX_ITER 60
+
+/**
+ * maximum number of iterations spent on any one root of the secular
+ *      equation
+ *
+ * */
+#define SECULAR_MAX_ITER 200
+
+/**
+ * panel width of the blocked Householder bidiagonalisation
+ *
+ * */
+#define SVD_BLOCK_SIZE 32
+
+/**
+ * maximum number of implicit QR sweeps spent on any one singular value of a
+ *      bidiagonal matrix
+ *
+ * */
+#define SVD_MAX_ITER 75
+
+/**
+ * matrices with at least this many rows per column (after transposing wide
+ *      ones) are QR factorised before bidiagonalisation, so that only the
+ *      square triangular factor is reduced
+ *
+ * */
+#define SVD_QR_ASPECT 2
+
+/**
+ * minimum number of elements per thread when applying a Householder
+ *      reflector during bidiagonalisation
+ *
+ * */
+#define SVD_TASK_SIZE 65536
+
+/**
+ * default number of extra sample columns taken by the randomized SVD
+ *
+ * */
+#define RSVD_OVERSAMPLE 10
+
+/**
+ * default number of power iterations taken by the randomized SVD
+ *
+ * */
+#define RSVD_POWER_ITERS 2
+
+/**
+ * default number of refinement steps taken by mixed-precision iterative
+ *      refinement before falling back to a full precision solve
+ *
+ * */
+#define REFINE_MAX_ITER 30
+
+/**
+ * iterative refinement falls back to a full precision solve once a step
+ *      fails to shrink the backward error by at least this factor
  *
  * */
-#define STRASSEN_MIN_SIZE 3
+#define REFINE_STALL_RATIO 0.5
 
 /**
- * default number of submatrices for Strassen's algorithm
+ * largest total rank of the low-rank updates a linear system absorbs by
+ *      Sherman-Morrison-Woodbury before refactorising its matrix
  *
  * */
-#define STRASSEN_NUM_SUBMATRICES 4
+#define LINSYS_MAX_UPDATE_RANK 32
 
 #endif /* CONSTANTS_H_ */
 
@@ -12,89 +12,97 @@
 #include "diff.h"
 
 /**
- * Calculates the forward finite difference of the function `f` at `x` using
- * step size `h`.
- *
- * @param x
- *      value at which to calculate the forward difference of `f`
- * @param f
- *      function to evaluate
- * @param h
- *      step size to use in finite difference calculation
- *
- * @return forward difference of `f` at `x`
+ * Defines the finite difference methods over `T`, with names suffixed by `s`
  *
  * */
-long double fdiff(long double x, long double (*f)(long double), long double h)
-{
-    if(f == NULL)
-    {
-        return NAN;
-    }
-
-    if(h == 0.0)
-    {
-        return NAN;
+#define DIFF_DEFINE(T, s) \
+    /** \
+     * Calculates the forward finite difference of the function `f` at `x` \
+     * using step size `h`. \
+     * \
+     * @param x \
+     *      value at which to calculate the forward difference of `f` \
+     * @param f \
+     *      function to evaluate \
+     * @param h \
+     *      step size to use in finite difference calculation \
+     * \
+     * @return forward difference of `f` at `x` \
+     * \
+     * */ \
+    T fdiff##s(T x, T (*f)(T), T h) \
+    { \
+        if(f == NULL) \
+        { \
+            return NAN; \
+        } \
+        \
+        if(h == 0.0) \
+        { \
+            return NAN; \
+        } \
+        \
+        return (f(x + h) - f(x)) / h; \
+    } \
+    \
+    /** \
+     * Calculates the backward finite difference of the function `f` at `x` \
+     * using step size `h`. \
+     * \
+     * @param x \
+     *      value at which to calculate the backward difference of `f` \
+     * @param f \
+     *      function to evaluate \
+     * @param h \
+     *      step size to use in finite difference calculation \
+     * \
+     * @return backward difference of `f` at `x` \
+     * \
+     * */ \
+    T bdiff##s(T x, T (*f)(T), T h) \
+    { \
+        if(f == NULL) \
+        { \
+            return NAN; \
+        } \
+        \
+        if(h == 0.0) \
+        { \
+            return NAN; \
+        } \
+        \
+        return (f(x) - f(x - h)) / h; \
+    } \
+    \
+    /** \
+     * Calculates the central finite difference of the function `f` at `x` \
+     * using step size `h`. \
+     * \
+     * @param x \
+     *      value at which to calculate the central difference of `f` \
+     * @param f \
+     *      function to evaluate \
+     * @param h \
+     *      step size to use in finite difference calculation \
+     * \
+     * @return central difference of `f` at `x` \
+     * \
+     * */ \
+    T cdiff##s(T x, T (*f)(T), T h) \
+    { \
+        if(f == NULL) \
+        { \
+            return NAN; \
+        } \
+        \
+        if(h == 0.0) \
+        { \
+            return NAN; \
+        } \
+        \
+        return (f(x + h) - f(x - h)) / (2 * h); \
     }
 
-    return (f(x + h) - f(x)) / h;
-}
-
-/**
- * Calculates the backward finite difference of the function `f` at `x` using
- * step size `h`.
- *
- * @param x
- *      value at which to calculate the backward difference of `f`
- * @param f
- *      function to evaluate
- * @param h
- *      step size to use in finite difference calculation
- *
- * @return backward difference of `f` at `x`
- *
- * */
-long double bdiff(long double x, long double (*f)(long double), long double h)
-{
-    if(f == NULL)
-    {
-        return NAN;
-    }
-
-    if(h == 0.0)
-    {
-        return NAN;
-    }
-
-    return (f(x) - f(x - h)) / h;
-}
-
-/**
- * Calculates the central finite difference of the function `f` at `x` using
- * step size `h`.
- *
- * @param x
- *      value at which to calculate the central difference of `f`
- * @param f
- *      function to evaluate
- * @param h
- *      step size to use in finite difference calculation
- *
- * @return central difference of `f` at `x`
- *
- * */
-long double cdiff(long double x, long double (*f)(long double), long double h)
-{
-    if(f == NULL)
-    {
-        return NAN;
-    }
-
-    if(h == 0.0)
-    {
-        return NAN;
-    }
-
-    return (f(x + h) - f(x - h)) / (2 * h);
-}
-
+DIFF_DEFINE(long double, )
+DIFF_DEFINE(double, _d)
+DIFF_DEFINE(float, _f)
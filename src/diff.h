@@ -4,13 +4,41 @@
  *
  * Declarations for finite difference methods.
  *
+ * Each method is provided in `long double` (e.g. `fdiff`), `double` (e.g.
+ * `fdiff_d`) and `float` (e.g. `fdiff_f`), generated from the same source.
+ * The `gfdiff`, `gbdiff` and `gcdiff` macros select among them by the type
+ * of the function being differentiated.
+ *
  * */
 #ifndef DIFF_H_
 #define DIFF_H_
 
-long double fdiff(long double x, long double (*f)(long double), long double h);
-long double bdiff(long double x, long double (*f)(long double), long double h);
-long double cdiff(long double x, long double (*f)(long double), long double h);
+/**
+ * Declares the finite difference methods over `T`, with names suffixed by `s`
+ *
+ * */
+#define DIFF_DECLARE(T, s) \
+    T fdiff##s(T x, T (*f)(T), T h); \
+    T bdiff##s(T x, T (*f)(T), T h); \
+    T cdiff##s(T x, T (*f)(T), T h);
 
-#endif /* DIFF_H_ */
+DIFF_DECLARE(long double, )
+DIFF_DECLARE(double, _d)
+DIFF_DECLARE(float, _f)
 
+/**
+ * Selects `long_double`, `dbl` or `flt` according to the type of the function
+ * `f` of one real variable
+ *
+ * */
+#define SCALAR_SELECT(f, long_double, dbl, flt) \
+    _Generic((f), \
+            long double (*)(long double): long_double, \
+            double (*)(double): dbl, \
+            float (*)(float): flt)
+
+#define gfdiff(x, f, h) SCALAR_SELECT(f, fdiff, fdiff_d, fdiff_f)(x, f, h)
+#define gbdiff(x, f, h) SCALAR_SELECT(f, bdiff, bdiff_d, bdiff_f)(x, f, h)
+#define gcdiff(x, f, h) SCALAR_SELECT(f, cdiff, cdiff_d, cdiff_f)(x, f, h)
+
+#endif /* DIFF_H_ */
@@ -0,0 +1,1434 @@
+/**
+ * @file eig.c
+ * @author Jack McPherson
+ *
+ * Implements the dense symmetric eigensolver.
+ *
+ * The matrix is first reduced to symmetric tridiagonal form `T = Q^T * A * Q`
+ * by Householder reflections. The reduction is blocked: reflectors are
+ * generated `EIG_BLOCK_SIZE` columns at a time while their effect on the
+ * rest of the panel is tracked in a skinny matrix `W`, after which the
+ * trailing matrix receives a single rank-`2 * EIG_BLOCK_SIZE` update through
+ * GEMM.
+ *
+ * Eigenvalues alone are then found by the implicit QL method in `O(n^2)`.
+ * When eigenvectors are wanted, the tridiagonal problem is solved by
+ * divide and conquer instead: `T` is torn into two halves plus a rank-one
+ * correction, the halves are solved recursively, and the two solutions are
+ * merged by solving the secular equation of the rank-one update. Nearly
+ * decoupled eigenpairs are deflated cheaply, eigenvectors are computed from
+ * a recomputed `z` (Gu and Eisenstat) so they stay orthogonal, and the
+ * expensive step of each merge is a GEMM which skips the zero blocks of the
+ * merged eigenvector matrix. Finally the eigenvectors of `T` are mapped back
+ * to those of `A` by the reflectors, again in blocks.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "thread.h"
+#include "matrix.h"
+#include "view.h"
+#include "eig.h"
+
+/* which halves of the merged problem a column of eigenvectors touches */
+#define EIG_TOP 1
+#define EIG_BOTTOM 2
+#define EIG_MIXED (EIG_TOP | EIG_BOTTOM)
+
+/**
+ * The rank-one-modified diagonal eigenproblem `D + rho * z * z^T` left after
+ *      deflation, whose roots are found in parallel
+ *
+ * Each root `i` is held as an offset `tau[i]` from the pole `d[org[i]]`, so
+ *      that differences between roots and poles are accurate.
+ *
+ * */
+typedef struct
+{
+    unsigned int k;
+    const long double* d; /* poles, ascending */
+    const long double* z;
+    long double rho;
+    unsigned int* org;
+    long double* tau;
+    long double* zhat; /* `z` recomputed from the roots */
+    long double* u; /* `k` x `k` poles less origins, then eigenvectors */
+} SecularJob;
+
+/**
+ * Sorts `idx[0:n]` so that `key[idx[i]]` is ascending (stable merge sort;
+ *      `tmp` is scratch of `n` entries)
+ *
+ * */
+static void eig_sort(unsigned int n, const long double* key,
+        unsigned int* idx, unsigned int* tmp)
+{
+    for(unsigned int width=1;width<n;width*=2)
+    {
+        for(unsigned int lo=0;lo<n;lo+=2 * width)
+        {
+            unsigned int mid = lo + width < n ? lo + width : n;
+            unsigned int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            unsigned int a = lo;
+            unsigned int b = mid;
+
+            for(unsigned int t=lo;t<hi;t++)
+            {
+                if(a < mid && (b >= hi || key[idx[a]] <= key[idx[b]]))
+                {
+                    tmp[t] = idx[a++];
+                }
+                else
+                {
+                    tmp[t] = idx[b++];
+                }
+            }
+        }
+
+        memcpy(idx, tmp, n * sizeof(unsigned int));
+    }
+}
+
+/**
+ * Finds the eigenvalues (and, if `z` is non-`NULL`, eigenvectors) of the
+ *      symmetric tridiagonal matrix with diagonal `d` and off-diagonal `e`
+ *      by the implicit QL method with Wilkinson shifts
+ *
+ * On return `d` holds the eigenvalues, unsorted, and the columns of `z` have
+ *      been rotated accordingly (so if `z` starts as the identity, column
+ *      `i` ends as the eigenvector for `d[i]`). `e` is destroyed; it must
+ *      have room for `n` entries, the last of which is scratch.
+ *
+ * @return true on success, false if an eigenvalue failed to converge
+ *
+ * */
+static bool eig_ql(unsigned int n, long double* d, long double* e,
+        long double* z, unsigned int ldz)
+{
+    if(n == 0) /* trivial case */
+    {
+        return true;
+    }
+
+    e[n - 1] = 0.0;
+
+    /* rotations leave absolute errors of about eps * ||T||, so off-diagonals
+     * that small are negligible even between tiny diagonal entries */
+    long double tnorm = 0.0L;
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        long double row = fabsl(d[i]) + fabsl(e[i]) +
+            (i > 0 ? fabsl(e[i - 1]) : 0.0L);
+
+        tnorm = row > tnorm ? row : tnorm;
+    }
+
+    for(unsigned int l=0;l<n;l++)
+    {
+        unsigned int iter = 0;
+        unsigned int m = l;
+
+        do
+        {
+            /* look for a negligible off-diagonal to split at */
+            for(m=l;m<n - 1;m++)
+            {
+                long double dd = fabsl(d[m]) + fabsl(d[m + 1]);
+
+                if(fabsl(e[m]) <= LDBL_EPSILON * dd ||
+                        fabsl(e[m]) <= LDBL_EPSILON * tnorm)
+                {
+                    break;
+                }
+            }
+
+            if(m == l)
+            {
+                break;
+            }
+
+            if(iter++ == EIG_MAX_ITER) /* check for failure */
+            {
+                return false;
+            }
+
+            /* Wilkinson shift */
+            long double g = (d[l + 1] - d[l]) / (2.0L * e[l]);
+            long double r = hypotl(g, 1.0L);
+            g = d[m] - d[l] + e[l] / (g + copysignl(r, g));
+
+            long double s = 1.0L;
+            long double c = 1.0L;
+            long double p = 0.0L;
+            bool underflow = false;
+
+            /* chase the bulge back up from row m */
+            for(unsigned int i=m;i-->l;)
+            {
+                long double f = s * e[i];
+                long double b = c * e[i];
+
+                r = hypotl(f, g);
+                e[i + 1] = r;
+
+                if(r == 0.0L) /* recover from underflow */
+                {
+                    d[i + 1] -= p;
+                    e[m] = 0.0L;
+                    underflow = true;
+                    break;
+                }
+
+                s = f / r;
+                c = g / r;
+                g = d[i + 1] - p;
+                r = (d[i] - g) * s + 2.0L * c * b;
+                p = s * r;
+                d[i + 1] = g + p;
+                g = c * r - b;
+
+                if(z != NULL) /* rotate columns i and i + 1 */
+                {
+                    for(unsigned int row=0;row<n;row++)
+                    {
+                        long double* zr = z + (size_t)row * ldz;
+                        long double t = zr[i + 1];
+
+                        zr[i + 1] = s * zr[i] + c * t;
+                        zr[i] = c * zr[i] - s * t;
+                    }
+                }
+            }
+
+            if(underflow)
+            {
+                continue;
+            }
+
+            d[l] -= p;
+            e[l] = g;
+            e[m] = 0.0L;
+        }
+        while(m != l);
+    }
+
+    return true;
+}
+
+/**
+ * Generates the Householder reflector `H = I - tau * v * v^T` mapping
+ *      `(alpha, x)` onto `(beta, 0)`
+ *
+ * On return `*alpha` holds `beta` and `x` (of `len` entries, `incx` apart)
+ *      holds the tail of `v`, whose leading entry is an implicit 1.
+ *
+ * @return `tau` (0 if `x` is already zero, in which case `H = I`)
+ *
+ * */
+static long double eig_reflector(unsigned int len, long double* alpha,
+        long double* x, size_t incx)
+{
+    long double sigma = 0.0L;
+
+    for(unsigned int i=0;i<len;i++)
+    {
+        sigma += x[i * incx] * x[i * incx];
+    }
+
+    if(sigma == 0.0L) /* already reduced */
+    {
+        return 0.0L;
+    }
+
+    long double norm = sqrtl(*alpha * *alpha + sigma);
+    long double beta = *alpha >= 0.0L ? -norm : norm;
+    long double scale = 1.0L / (*alpha - beta);
+    long double tau = (beta - *alpha) / beta;
+
+    for(unsigned int i=0;i<len;i++)
+    {
+        x[i * incx] *= scale;
+    }
+
+    *alpha = beta;
+
+    return tau;
+}
+
+/**
+ * Reduces the first `nb` columns of the `nn` x `nn` symmetric matrix at `a`
+ *      (lower triangle only) to tridiagonal form
+ *
+ * The trailing matrix is not updated; instead `W` (`nn` x `nb`) is formed so
+ *      that the update is `A22 -= V * W^T + W * V^T`, where `V` holds the
+ *      reflectors (stored below the subdiagonal of `a`, with their unit
+ *      entries written in place of the subdiagonal, which goes to `e`).
+ *      `v`, `y` and `t` are scratch of `nn`, `nn` and `nb` cells.
+ *
+ * */
+static void eig_panel(unsigned int nn, unsigned int nb, long double* a,
+        unsigned int lda, long double* e, long double* tau, long double* w,
+        long double* v, long double* y, long double* t)
+{
+    for(unsigned int i=0;i<nb;i++)
+    {
+        /* bring column i up to date with the panel's earlier reflectors */
+        if(i > 0)
+        {
+            const long double* w_i = w + (size_t)i * nb;
+            const long double* a_i = a + (size_t)i * lda;
+
+            for(unsigned int r=i;r<nn;r++)
+            {
+                const long double* a_r = a + (size_t)r * lda;
+                const long double* w_r = w + (size_t)r * nb;
+                long double sum = 0.0L;
+
+                for(unsigned int p=0;p<i;p++)
+                {
+                    sum += a_r[p] * w_i[p] + w_r[p] * a_i[p];
+                }
+
+                a[(size_t)r * lda + i] -= sum;
+            }
+        }
+
+        /* annihilate A[i+2:, i] */
+        unsigned int m = nn - i - 1; /* length of the reflector */
+        long double* col = a + (size_t)(i + 1) * lda + i;
+
+        tau[i] = eig_reflector(m - 1, col, col + lda, lda);
+        e[i] = *col;
+        *col = 1.0L;
+
+        for(unsigned int r=0;r<m;r++)
+        {
+            v[r] = col[(size_t)r * lda];
+            y[r] = 0.0L;
+        }
+
+        /* y = A[i+1:, i+1:] * v, using the (stale) lower triangle */
+        for(unsigned int r=0;r<m;r++)
+        {
+            const long double* row = a + (size_t)(i + 1 + r) * lda + i + 1;
+            const long double v_r = v[r];
+            long double sum = 0.0L;
+
+            for(unsigned int c=0;c<r;c++)
+            {
+                sum += row[c] * v[c];
+                y[c] += row[c] * v_r;
+            }
+
+            y[r] += sum + row[r] * v_r;
+        }
+
+        /* correct for the updates still pending on the trailing matrix */
+        if(i > 0)
+        {
+            for(unsigned int p=0;p<i;p++)
+            {
+                t[p] = 0.0L;
+            }
+
+            for(unsigned int r=0;r<m;r++) /* t = W^T * v */
+            {
+                const long double* w_r = w + (size_t)(i + 1 + r) * nb;
+
+                for(unsigned int p=0;p<i;p++)
+                {
+                    t[p] += w_r[p] * v[r];
+                }
+            }
+
+            for(unsigned int r=0;r<m;r++) /* y -= V * t */
+            {
+                const long double* a_r = a + (size_t)(i + 1 + r) * lda;
+                long double sum = 0.0L;
+
+                for(unsigned int p=0;p<i;p++)
+                {
+                    sum += a_r[p] * t[p];
+                }
+
+                y[r] -= sum;
+            }
+
+            for(unsigned int p=0;p<i;p++)
+            {
+                t[p] = 0.0L;
+            }
+
+            for(unsigned int r=0;r<m;r++) /* t = V^T * v */
+            {
+                const long double* a_r = a + (size_t)(i + 1 + r) * lda;
+
+                for(unsigned int p=0;p<i;p++)
+                {
+                    t[p] += a_r[p] * v[r];
+                }
+            }
+
+            for(unsigned int r=0;r<m;r++) /* y -= W * t */
+            {
+                const long double* w_r = w + (size_t)(i + 1 + r) * nb;
+                long double sum = 0.0L;
+
+                for(unsigned int p=0;p<i;p++)
+                {
+                    sum += w_r[p] * t[p];
+                }
+
+                y[r] -= sum;
+            }
+        }
+
+        /* w = tau * y - (tau^2 / 2) * (y^T * v) * v */
+        long double dot = 0.0L;
+
+        for(unsigned int r=0;r<m;r++)
+        {
+            y[r] *= tau[i];
+            dot += y[r] * v[r];
+        }
+
+        long double alpha = -0.5L * tau[i] * dot;
+
+        for(unsigned int r=0;r<=i;r++)
+        {
+            w[(size_t)r * nb + i] = 0.0L;
+        }
+
+        for(unsigned int r=0;r<m;r++)
+        {
+            w[(size_t)(i + 1 + r) * nb + i] = y[r] + alpha * v[r];
+        }
+    }
+}
+
+/**
+ * Reduces the `n` x `n` symmetric matrix at `a` (lower triangle only) to
+ *      tridiagonal form, leaving the diagonal in `d`, the subdiagonal in `e`
+ *      and the reflectors below the subdiagonal of `a` (with scalars `tau`)
+ *
+ * @return true on success, false on allocation failure
+ *
+ * */
+static bool eig_tridiagonalise(unsigned int n, long double* a,
+        unsigned int lda, long double* d, long double* e, long double* tau)
+{
+    GaisanArena* arena = gaisan_thread_arena();
+    size_t mark = arena_mark(arena);
+
+    long double* w = arena_alloc(arena, (size_t)n * EIG_BLOCK_SIZE *
+            sizeof(long double));
+    long double* v = arena_alloc(arena, (size_t)n * sizeof(long double));
+    long double* y = arena_alloc(arena, (size_t)n * sizeof(long double));
+    long double* t = arena_alloc(arena, EIG_BLOCK_SIZE *
+            sizeof(long double));
+
+    if(w == NULL || v == NULL || y == NULL || t == NULL) /* check for failure */
+    {
+        arena_release(arena, mark);
+        return false;
+    }
+
+    for(unsigned int j=0;j + 1<n;j+=EIG_BLOCK_SIZE)
+    {
+        unsigned int nb = n - 1 - j < EIG_BLOCK_SIZE ? n - 1 - j :
+            EIG_BLOCK_SIZE;
+        unsigned int nn = n - j;
+        unsigned int tm = nn - nb; /* order of the trailing matrix */
+        long double* panel = a + (size_t)j * lda + j;
+
+        eig_panel(nn, nb, panel, lda, e + j, tau + j, w, v, y, t);
+
+        /* A22 -= V * W^T + W * V^T, one block column of the lower triangle
+         * at a time */
+        const long double* vb = panel + (size_t)nb * lda;
+        const long double* wb = w + (size_t)nb * nb;
+        long double* a22 = panel + (size_t)nb * lda + nb;
+
+        for(unsigned int c=0;c<tm;c+=EIG_BLOCK_SIZE)
+        {
+            unsigned int cols = tm - c < EIG_BLOCK_SIZE ? tm - c :
+                EIG_BLOCK_SIZE;
+            unsigned int rows = tm - c;
+            long double* blk = a22 + (size_t)c * lda + c;
+
+            gemm(rows, cols, nb, -1.0L, vb + (size_t)c * lda, lda, 1,
+                    wb + (size_t)c * nb, 1, nb, 1.0L, blk, lda, 1);
+            gemm(rows, cols, nb, -1.0L, wb + (size_t)c * nb, nb, 1,
+                    vb + (size_t)c * lda, 1, lda, 1.0L, blk, lda, 1);
+        }
+
+        /* put the subdiagonal back in place of the unit entries */
+        for(unsigned int p=0;p<nb;p++)
+        {
+            d[j + p] = panel[(size_t)p * lda + p];
+            panel[(size_t)(p + 1) * lda + p] = e[j + p];
+        }
+    }
+
+    d[n - 1] = a[(size_t)(n - 1) * lda + n - 1];
+
+    arena_release(arena, mark);
+
+    return true;
+}
+
+/**
+ * Computes `Z = Q * Z`, where `Q` is the product of the reflectors left in
+ *      `a` by `eig_tridiagonalise`, for the `n` x `n` matrix `Z`
+ *
+ * Reflectors are applied `EIG_BLOCK_SIZE` at a time in the compact WY form
+ *      `I - V * T * V^T`.
+ *
+ * @return true on success, false on allocation failure
+ *
+ * */
+static bool eig_back_transform(unsigned int n, const long double* a,
+        unsigned int lda, const long double* tau, long double* z,
+        unsigned int ldz)
+{
+    if(n < 3) /* no reflectors */
+    {
+        return true;
+    }
+
+    unsigned int nb_max = EIG_BLOCK_SIZE;
+    GaisanArena* arena = gaisan_thread_arena();
+    size_t mark = arena_mark(arena);
+
+    long double* v = arena_alloc(arena, (size_t)n * nb_max *
+            sizeof(long double));
+    long double* t = arena_alloc(arena, (size_t)nb_max * nb_max *
+            sizeof(long double));
+    long double* g = arena_alloc(arena, (size_t)nb_max * nb_max *
+            sizeof(long double));
+    long double* w = arena_alloc(arena, (size_t)nb_max * n *
+            sizeof(long double));
+
+    if(v == NULL || t == NULL || g == NULL || w == NULL) /* check for failure */
+    {
+        arena_release(arena, mark);
+        return false;
+    }
+
+    /* the last reflector that does anything is H_{n-3} */
+    unsigned int num = n - 2;
+
+    for(unsigned int j0=((num - 1) / nb_max) * nb_max;;j0-=nb_max)
+    {
+        unsigned int nb = num - j0 < nb_max ? num - j0 : nb_max;
+        unsigned int rows = n - 1 - j0;
+
+        /* V, with unit diagonal and zeros above it */
+        for(unsigned int r=0;r<rows;r++)
+        {
+            const long double* a_r = a + (size_t)(j0 + 1 + r) * lda + j0;
+
+            for(unsigned int p=0;p<nb;p++)
+            {
+                v[(size_t)r * nb + p] = r > p ? a_r[p] : (r == p ? 1.0L :
+                        0.0L);
+            }
+        }
+
+        /* T such that H_j0 * ... * H_{j0+nb-1} = I - V * T * V^T */
+        gemm(nb, nb, rows, 1.0L, v, 1, nb, v, nb, 1, 0.0L, g, nb, 1);
+        memset(t, 0, (size_t)nb * nb * sizeof(long double));
+
+        for(unsigned int q=0;q<nb;q++)
+        {
+            t[(size_t)q * nb + q] = tau[j0 + q];
+
+            for(unsigned int i=0;i<q;i++)
+            {
+                long double sum = 0.0L;
+
+                for(unsigned int p=i;p<q;p++)
+                {
+                    sum += t[(size_t)i * nb + p] * g[(size_t)p * nb + q];
+                }
+
+                t[(size_t)i * nb + q] = -tau[j0 + q] * sum;
+            }
+        }
+
+        /* Z -= V * (T * (V^T * Z)) on rows j0+1: */
+        long double* zb = z + (size_t)(j0 + 1) * ldz;
+
+        gemm(nb, n, rows, 1.0L, v, 1, nb, zb, ldz, 1, 0.0L, w, n, 1);
+
+        for(unsigned int i=0;i<nb;i++) /* top row first, T is upper */
+        {
+            long double* w_i = w + (size_t)i * n;
+            const long double t_ii = t[(size_t)i * nb + i];
+
+            for(unsigned int l=0;l<n;l++)
+            {
+                w_i[l] *= t_ii;
+            }
+
+            for(unsigned int p=i + 1;p<nb;p++)
+            {
+                const long double t_ip = t[(size_t)i * nb + p];
+                const long double* w_p = w + (size_t)p * n;
+
+                for(unsigned int l=0;l<n;l++)
+                {
+                    w_i[l] += t_ip * w_p[l];
+                }
+            }
+        }
+
+        gemm(rows, n, nb, -1.0L, v, nb, 1, w, n, 1, 1.0L, zb, ldz, 1);
+
+        if(j0 == 0)
+        {
+            break;
+        }
+    }
+
+    arena_release(arena, mark);
+
+    return true;
+}
+
+/**
+ * Finds root `i` of the secular equation
+ *      `1 / rho + sum_j z_j^2 / (d_j - lambda) = 0`
+ *
+ * The root lies between `d[i]` and `d[i + 1]` (or above `d[k - 1]` for the
+ *      last one). It is located relative to whichever of its two poles is
+ *      nearer, then refined by fitting a simple rational function to each
+ *      side of the sum (Bunch, Nielsen and Sorensen) and solving for its
+ *      root, safeguarded by bisection.
+ *
+ * */
+static void eig_secular_root(const SecularJob* job, unsigned int i)
+{
+    unsigned int k = job->k;
+    const long double* d = job->d;
+    const long double* z = job->z;
+    long double* delta = job->u + i; /* column i of u, k apart */
+    long double rho = job->rho;
+    bool last = i + 1 == k;
+
+    /* the poles relative to the origin are kept in memory so that the
+     * compiler cannot reassociate d[j] - d[org] - tau into
+     * d[j] - (d[org] + tau), which would lose the gap to the nearest pole */
+    for(unsigned int j=0;j<k;j++)
+    {
+        delta[(size_t)j * k] = d[j] - d[i];
+    }
+
+    unsigned int org = i;
+    long double lo = 0.0L;
+    long double hi = 0.0L;
+
+    if(last)
+    {
+        long double zz = 0.0L;
+
+        for(unsigned int j=0;j<k;j++)
+        {
+            zz += z[j] * z[j];
+        }
+
+        hi = rho * zz;
+    }
+    else /* pick the nearer pole by the sign of f at the midpoint */
+    {
+        long double mid = 0.5L * (d[i + 1] - d[i]);
+        long double f = 1.0L / rho;
+
+        for(unsigned int j=0;j<k;j++)
+        {
+            f += z[j] * z[j] / (delta[(size_t)j * k] - mid);
+        }
+
+        if(f >= 0.0L)
+        {
+            hi = mid;
+        }
+        else
+        {
+            org = i + 1;
+            lo = -mid;
+
+            for(unsigned int j=0;j<k;j++)
+            {
+                delta[(size_t)j * k] = d[j] - d[org];
+            }
+        }
+    }
+
+    long double tau = 0.5L * (lo + hi);
+
+    for(unsigned int iter=0;iter<SECULAR_MAX_ITER;iter++)
+    {
+        /* split the sum at the root: psi (poles below) and phi (above) */
+        long double psi = 0.0L;
+        long double dpsi = 0.0L;
+        long double phi = 0.0L;
+        long double dphi = 0.0L;
+
+        for(unsigned int j=0;j<=i;j++)
+        {
+            long double q = z[j] / (delta[(size_t)j * k] - tau);
+
+            psi += z[j] * q;
+            dpsi += q * q;
+        }
+
+        for(unsigned int j=i + 1;j<k;j++)
+        {
+            long double q = z[j] / (delta[(size_t)j * k] - tau);
+
+            phi += z[j] * q;
+            dphi += q * q;
+        }
+
+        long double f = 1.0L / rho + psi + phi;
+
+        if(fabsl(f) <= 8.0L * k * LDBL_EPSILON *
+                (1.0L / rho + fabsl(psi) + fabsl(phi))) /* converged */
+        {
+            break;
+        }
+
+        if(f > 0.0L) /* f increases with tau */
+        {
+            hi = tau;
+        }
+        else
+        {
+            lo = tau;
+        }
+
+        /* fit psi ~ p + q / (a - eta) and phi ~ r + s / (b - eta) */
+        long double a = delta[(size_t)i * k] - tau;
+        long double qa = dpsi * a * a;
+        long double c = 1.0L / rho + psi - dpsi * a;
+        long double next = 0.5L * (lo + hi); /* bisection, by default */
+        long double eta = 0.0L;
+        bool fit = false;
+
+        if(last) /* c + qa / (a - eta) = 0 */
+        {
+            if(c != 0.0L)
+            {
+                eta = a + qa / c;
+                fit = true;
+            }
+        }
+        else /* c (a - eta)(b - eta) + qa (b - eta) + sb (a - eta) = 0 */
+        {
+            long double b = delta[(size_t)(i + 1) * k] - tau;
+            long double sb = dphi * b * b;
+            c += phi - dphi * b;
+
+            long double qb = -(c * (a + b) + qa + sb);
+            long double qc = c * a * b + qa * b + sb * a;
+
+            if(c == 0.0L && qb != 0.0L)
+            {
+                eta = -qc / qb;
+                fit = true;
+            }
+            else if(c != 0.0L)
+            {
+                long double disc = qb * qb - 4.0L * c * qc;
+
+                if(disc >= 0.0L)
+                {
+                    long double h = -0.5L * (qb + copysignl(sqrtl(disc), qb));
+
+                    eta = h / c;
+                    fit = true;
+
+                    if(!(eta > a && eta < b))
+                    {
+                        eta = qc / h;
+                        fit = h != 0.0L;
+                    }
+                }
+            }
+        }
+
+        if(fit && tau + eta > lo && tau + eta < hi) /* safeguard */
+        {
+            next = tau + eta;
+        }
+
+        if(next == tau || hi - lo <= 2.0L * LDBL_EPSILON *
+                fmaxl(fabsl(lo), fabsl(hi)))
+        {
+            tau = next;
+            break;
+        }
+
+        tau = next;
+    }
+
+    job->org[i] = org;
+    job->tau[i] = tau;
+}
+
+/**
+ * Returns `d[j] - lambda_i`, where `lambda_i` is root `i` of `job` (valid
+ *      until column `i` of `job->u` is overwritten by its eigenvector)
+ *
+ * */
+static inline long double eig_gap(const SecularJob* job, unsigned int j,
+        unsigned int i)
+{
+    return job->u[(size_t)j * job->k + i] - job->tau[i];
+}
+
+/**
+ * Finds a band of roots of the secular equation (task `c` of `k`)
+ *
+ * */
+static void eig_secular_task(unsigned int c, void* arg)
+{
+    const SecularJob* job = arg;
+    unsigned int tasks = gaisan_get_num_threads();
+    unsigned int first = (unsigned int)((size_t)job->k * c / tasks);
+    unsigned int last = (unsigned int)((size_t)job->k * (c + 1) / tasks);
+
+    for(unsigned int i=first;i<last;i++)
+    {
+        eig_secular_root(job, i);
+    }
+}
+
+/**
+ * Recomputes a band of `z` from the roots, so that the eigenvectors built
+ *      from it are orthogonal to working precision (task `c`)
+ *
+ * `zhat_j^2 = (lambda_j - d_j) / rho * prod_{i != j} (lambda_i - d_j) /
+ *      (d_i - d_j)`
+ *
+ * */
+static void eig_zhat_task(unsigned int c, void* arg)
+{
+    SecularJob* job = arg;
+    unsigned int tasks = gaisan_get_num_threads();
+    unsigned int first = (unsigned int)((size_t)job->k * c / tasks);
+    unsigned int last = (unsigned int)((size_t)job->k * (c + 1) / tasks);
+
+    for(unsigned int j=first;j<last;j++)
+    {
+        long double prod = -eig_gap(job, j, j) / job->rho;
+
+        for(unsigned int i=0;i<job->k;i++)
+        {
+            if(i != j)
+            {
+                prod *= -eig_gap(job, j, i) / (job->d[i] - job->d[j]);
+            }
+        }
+
+        job->zhat[j] = copysignl(sqrtl(fabsl(prod)), job->z[j]);
+    }
+}
+
+/**
+ * Forms a band of the eigenvectors `u_i = (D - lambda_i)^-1 * zhat` of the
+ *      rank-one-modified problem, normalised (task `c`)
+ *
+ * */
+static void eig_vectors_task(unsigned int c, void* arg)
+{
+    SecularJob* job = arg;
+    unsigned int k = job->k;
+    unsigned int tasks = gaisan_get_num_threads();
+    unsigned int first = (unsigned int)((size_t)k * c / tasks);
+    unsigned int last = (unsigned int)((size_t)k * (c + 1) / tasks);
+
+    for(unsigned int i=first;i<last;i++)
+    {
+        long double norm = 0.0L;
+
+        for(unsigned int j=0;j<k;j++)
+        {
+            long double u = job->zhat[j] / eig_gap(job, j, i);
+
+            job->u[(size_t)j * k + i] = u;
+            norm += u * u;
+        }
+
+        norm = 1.0L / sqrtl(norm);
+
+        for(unsigned int j=0;j<k;j++)
+        {
+            job->u[(size_t)j * k + i] *= norm;
+        }
+    }
+}
+
+/**
+ * Merges the solutions of the two halves of a torn tridiagonal problem
+ *
+ * On entry `d[0:m]` and `d[m:n]` hold the (ascending) eigenvalues of the two
+ *      halves and `q` the block diagonal matrix of their eigenvectors; the
+ *      whole problem is that plus `rho * u * u^T` with
+ *      `u = e_{m-1} + sign * e_m`. On return `d` and `q` hold the ascending
+ *      eigenvalues and eigenvectors of the whole.
+ *
+ * @return true on success, false on allocation failure
+ *
+ * */
+static bool eig_merge(unsigned int n, unsigned int m, long double* d,
+        long double* q, unsigned int ldq, long double rho, long double sign)
+{
+    GaisanArena* arena = gaisan_thread_arena();
+    size_t mark = arena_mark(arena);
+
+    long double* z = arena_alloc(arena, 5 * (size_t)n * sizeof(long double));
+    unsigned int* idx = arena_alloc(arena, 6 * (size_t)n *
+            sizeof(unsigned int));
+
+    if(z == NULL || idx == NULL) /* check for failure */
+    {
+        arena_release(arena, mark);
+        return false;
+    }
+
+    long double* ds = z + n; /* poles, sorted */
+    long double* dk = ds + n; /* non-deflated poles */
+    long double* zk = dk + n; /* non-deflated weights */
+    long double* vals = zk + n; /* merged eigenvalues */
+    unsigned int* perm = idx; /* column of q behind each sorted pole */
+    unsigned int* type = perm + n; /* halves touched by each column */
+    unsigned int* nd = type + n; /* non-deflated sorted poles */
+    unsigned int* df = nd + n; /* deflated sorted poles */
+    unsigned int* order = df + n;
+    unsigned int* tmp = order + n;
+
+    /* z = Q^T * u: last row of the top block, first row of the bottom */
+    for(unsigned int j=0;j<n;j++)
+    {
+        z[j] = j < m ? q[(size_t)(m - 1) * ldq + j] :
+            sign * q[(size_t)m * ldq + j];
+        perm[j] = j;
+    }
+
+    /* normalise so that ||z|| = 1 */
+    long double norm = 0.0L;
+
+    for(unsigned int j=0;j<n;j++)
+    {
+        norm += z[j] * z[j];
+    }
+
+    norm = sqrtl(norm);
+    rho *= norm * norm;
+
+    eig_sort(n, d, perm, tmp);
+
+    long double dmax = 0.0L;
+    long double zmax = 0.0L;
+
+    for(unsigned int j=0;j<n;j++)
+    {
+        ds[j] = d[perm[j]];
+        type[j] = perm[j] < m ? EIG_TOP : EIG_BOTTOM;
+        dmax = fmaxl(dmax, fabsl(ds[j]));
+        zmax = fmaxl(zmax, fabsl(z[perm[j]] / norm));
+    }
+
+    for(unsigned int j=0;j<n;j++)
+    {
+        zk[j] = z[perm[j]] / norm;
+    }
+
+    memcpy(z, zk, n * sizeof(long double));
+
+    /* deflate negligible weights and (nearly) repeated poles */
+    long double tol = 8.0L * LDBL_EPSILON * fmaxl(dmax, zmax);
+    unsigned int k = 0;
+    unsigned int num_df = 0;
+    unsigned int pj = n;
+
+    for(unsigned int j=0;j<n;j++)
+    {
+        if(rho * fabsl(z[j]) <= tol)
+        {
+            df[num_df++] = j;
+            continue;
+        }
+
+        if(pj == n)
+        {
+            pj = j;
+            continue;
+        }
+
+        /* rotate to zero the weight of pj if it nearly shares j's pole */
+        long double s = z[pj];
+        long double c = z[j];
+        long double r = hypotl(c, s);
+        long double t = ds[j] - ds[pj];
+
+        c /= r;
+        s = -s / r;
+
+        if(fabsl(t * c * s) <= tol)
+        {
+            z[j] = r;
+            z[pj] = 0.0L;
+
+            for(unsigned int row=0;row<n;row++)
+            {
+                long double* q_r = q + (size_t)row * ldq;
+                long double x = q_r[perm[pj]];
+                long double y = q_r[perm[j]];
+
+                q_r[perm[pj]] = c * x + s * y;
+                q_r[perm[j]] = c * y - s * x;
+            }
+
+            type[j] |= type[pj];
+            type[pj] |= type[j];
+
+            t = ds[pj] * c * c + ds[j] * s * s;
+            ds[j] = ds[pj] * s * s + ds[j] * c * c;
+            ds[pj] = t;
+
+            df[num_df++] = pj;
+        }
+        else
+        {
+            nd[k++] = pj;
+        }
+
+        pj = j;
+    }
+
+    if(pj != n)
+    {
+        nd[k++] = pj;
+    }
+
+    /* eigenpairs of the deflated part are known already */
+    for(unsigned int t=0;t<num_df;t++)
+    {
+        vals[k + t] = ds[df[t]];
+    }
+
+    long double* r = NULL; /* new eigenvectors of the non-deflated part */
+
+    if(k > 0)
+    {
+        for(unsigned int i=0;i<k;i++)
+        {
+            dk[i] = ds[nd[i]];
+            zk[i] = z[nd[i]];
+        }
+
+        long double* work = arena_alloc(arena, (2 * (size_t)k + 2 *
+                    (size_t)n * k + (size_t)k * k) * sizeof(long double));
+        unsigned int* org = arena_alloc(arena, k * sizeof(unsigned int));
+
+        if(work == NULL || org == NULL) /* check for failure */
+        {
+            arena_release(arena, mark);
+            return false;
+        }
+
+        SecularJob job = {k, dk, zk, rho, org, work, work + k,
+            work + 2 * (size_t)k};
+        long double* qk = job.u + (size_t)k * k; /* Q's non-deflated cols */
+        r = qk + (size_t)n * k;
+        unsigned int tasks = gaisan_get_num_threads();
+
+        parallel_for(tasks, eig_secular_task, &job);
+        parallel_for(tasks, eig_zhat_task, &job);
+        parallel_for(tasks, eig_vectors_task, &job);
+
+        for(unsigned int i=0;i<k;i++)
+        {
+            vals[i] = dk[org[i]] + job.tau[i];
+        }
+
+        /* order the columns top-only, mixed, bottom-only so that each half
+         * of Q multiplies only the columns that are non-zero in it */
+        unsigned int counts[3] = {0, 0, 0};
+        unsigned int rank[4] = {0, 0, 2, 1}; /* by type */
+
+        for(unsigned int i=0;i<k;i++)
+        {
+            counts[rank[type[nd[i]]]]++;
+        }
+
+        unsigned int start[3] = {0, counts[0], counts[0] + counts[1]};
+
+        for(unsigned int i=0;i<k;i++)
+        {
+            order[start[rank[type[nd[i]]]]++] = i;
+        }
+
+        for(unsigned int row=0;row<n;row++)
+        {
+            const long double* q_r = q + (size_t)row * ldq;
+            long double* qk_r = qk + (size_t)row * k;
+
+            for(unsigned int c=0;c<k;c++)
+            {
+                qk_r[c] = q_r[perm[nd[order[c]]]];
+            }
+        }
+
+        /* permute the rows of U to match, using r as scratch */
+        for(unsigned int c=0;c<k;c++)
+        {
+            memcpy(r + (size_t)c * k, job.u + (size_t)order[c] * k,
+                    k * sizeof(long double));
+        }
+
+        memcpy(job.u, r, (size_t)k * k * sizeof(long double));
+
+        unsigned int k1 = counts[0];
+        unsigned int k2 = counts[1];
+        unsigned int k3 = counts[2];
+
+        gemm(m, k, k1 + k2, 1.0L, qk, k, 1, job.u, k, 1, 0.0L, r, k, 1);
+        gemm(n - m, k, k2 + k3, 1.0L, qk + (size_t)m * k + k1, k, 1,
+                job.u + (size_t)k1 * k, k, 1, 0.0L, r + (size_t)m * k, k, 1);
+    }
+
+    /* sort all n eigenpairs and write them back */
+    for(unsigned int c=0;c<n;c++)
+    {
+        order[c] = c;
+    }
+
+    eig_sort(n, vals, order, tmp);
+
+    long double* row_buf = zk; /* free again */
+
+    for(unsigned int row=0;row<n;row++)
+    {
+        long double* q_r = q + (size_t)row * ldq;
+
+        for(unsigned int c=0;c<n;c++)
+        {
+            unsigned int src = order[c];
+
+            row_buf[c] = src < k ? r[(size_t)row * k + src] :
+                q_r[perm[df[src - k]]];
+        }
+
+        memcpy(q_r, row_buf, n * sizeof(long double));
+    }
+
+    for(unsigned int c=0;c<n;c++)
+    {
+        d[c] = vals[order[c]];
+    }
+
+    arena_release(arena, mark);
+
+    return true;
+}
+
+/**
+ * Finds the eigenvalues and eigenvectors of the symmetric tridiagonal matrix
+ *      with diagonal `d` and off-diagonal `e` by divide and conquer
+ *
+ * On return `d` holds the eigenvalues in ascending order and the `n` x `n`
+ *      matrix at `q` the corresponding eigenvectors (by column). `e` is
+ *      destroyed.
+ *
+ * @return true on success, false on failure
+ *
+ * */
+static bool eig_dc(unsigned int n, long double* d, long double* e,
+        long double* q, unsigned int ldq)
+{
+    if(n <= EIG_DC_MIN_SIZE) /* small enough to solve directly */
+    {
+        long double off[EIG_DC_MIN_SIZE];
+        unsigned int idx[EIG_DC_MIN_SIZE];
+        unsigned int tmp[EIG_DC_MIN_SIZE];
+        long double vals[EIG_DC_MIN_SIZE];
+        long double row[EIG_DC_MIN_SIZE];
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            long double* q_i = q + (size_t)i * ldq;
+
+            for(unsigned int j=0;j<n;j++)
+            {
+                q_i[j] = i == j ? 1.0L : 0.0L;
+            }
+
+            off[i] = i + 1 < n ? e[i] : 0.0L;
+        }
+
+        if(!eig_ql(n, d, off, q, ldq))
+        {
+            return false;
+        }
+
+        /* sort ascending */
+        for(unsigned int i=0;i<n;i++)
+        {
+            idx[i] = i;
+        }
+
+        eig_sort(n, d, idx, tmp);
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            long double* q_i = q + (size_t)i * ldq;
+
+            for(unsigned int j=0;j<n;j++)
+            {
+                row[j] = q_i[idx[j]];
+            }
+
+            memcpy(q_i, row, n * sizeof(long double));
+            vals[i] = d[idx[i]];
+        }
+
+        memcpy(d, vals, n * sizeof(long double));
+
+        return true;
+    }
+
+    /* tear T at the middle: T = diag(T1, T2) + rho * u * u^T */
+    unsigned int m = n / 2;
+    long double beta = e[m - 1];
+    long double rho = fabsl(beta);
+
+    d[m - 1] -= rho;
+    d[m] -= rho;
+
+    if(!eig_dc(m, d, e, q, ldq) ||
+            !eig_dc(n - m, d + m, e + m, q + (size_t)m * ldq + m, ldq))
+    {
+        return false;
+    }
+
+    /* the off-diagonal blocks of diag(Q1, Q2) */
+    for(unsigned int i=0;i<n;i++)
+    {
+        long double* q_i = q + (size_t)i * ldq;
+
+        if(i < m)
+        {
+            memset(q_i + m, 0, (n - m) * sizeof(long double));
+        }
+        else
+        {
+            memset(q_i, 0, m * sizeof(long double));
+        }
+    }
+
+    return eig_merge(n, m, d, q, ldq, rho, beta < 0.0L ? -1.0L : 1.0L);
+}
+
+/**
+ * Finds the eigenvalues (and optionally eigenvectors) of a symmetric
+ *      tridiagonal matrix
+ *
+ * Eigenvalues alone are found by the implicit QL method; eigenvectors by
+ *      divide and conquer.
+ *
+ * @param n
+ *      order of the matrix
+ * @param d
+ *      the `n` diagonal entries; on return, the eigenvalues in ascending
+ *          order
+ * @param e
+ *      the `n - 1` off-diagonal entries (destroyed)
+ * @param vectors
+ *      an `n` x `n` matrix to receive the eigenvectors (by column), or
+ *          `NULL` if they are not wanted
+ *
+ * @return true on success, false on failure
+ *
+ * */
+bool eig_tridiag(unsigned int n, long double* d, long double* e,
+        Matrix* vectors)
+{
+    if(d == NULL || (e == NULL && n > 1)) /* null guard */
+    {
+        return false;
+    }
+
+    if(n == 0 || (vectors != NULL && (vectors->rows != n ||
+                    vectors->cols != n))) /* bounds check */
+    {
+        return false;
+    }
+
+    if(vectors != NULL)
+    {
+        return eig_dc(n, d, e, vectors->data, vectors->stride);
+    }
+
+    /* eig_ql needs one entry of scratch beyond the off-diagonal */
+    GaisanArena* arena = gaisan_thread_arena();
+    size_t mark = arena_mark(arena);
+    long double* off = arena_alloc(arena, 2 * (size_t)n * sizeof(long double));
+    unsigned int* idx = arena_alloc(arena, 2 * (size_t)n *
+            sizeof(unsigned int));
+
+    if(off == NULL || idx == NULL) /* check for failure */
+    {
+        arena_release(arena, mark);
+        return false;
+    }
+
+    long double* vals = off + n;
+
+    for(unsigned int i=0;i + 1<n;i++)
+    {
+        off[i] = e[i];
+    }
+
+    bool ok = eig_ql(n, d, off, NULL, 0);
+
+    if(ok) /* sort ascending */
+    {
+        for(unsigned int i=0;i<n;i++)
+        {
+            idx[i] = i;
+            vals[i] = d[i];
+        }
+
+        eig_sort(n, vals, idx, idx + n);
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            d[i] = vals[idx[i]];
+        }
+    }
+
+    arena_release(arena, mark);
+
+    return ok;
+}
+
+/**
+ * Computes the eigendecomposition of the symmetric matrix `A`
+ *
+ * @param A
+ *      the symmetric matrix to decompose (only its lower triangle is read;
+ *          not modified)
+ * @param vectors
+ *      whether to compute eigenvectors as well as eigenvalues (skipping
+ *          them is several times faster)
+ *
+ * @return the eigendecomposition, or `NULL` on failure
+ *
+ * */
+SymEig* eig_sym(Matrix* A, bool vectors)
+{
+    return eig_sym_view(matrix_view(A), vectors);
+}
+
+/**
+ * Computes the eigendecomposition of the symmetric matrix viewed by `A`
+ *
+ * @param A
+ *      view of the symmetric matrix to decompose (only its lower triangle is
+ *          read; not modified)
+ * @param vectors
+ *      whether to compute eigenvectors as well as eigenvalues (skipping
+ *          them is several times faster)
+ *
+ * @return the eigendecomposition, or `NULL` on failure
+ *
+ * */
+SymEig* eig_sym_view(MatrixView A, bool vectors)
+{
+    if(A.data == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(A.rows != A.cols) /* bounds check */
+    {
+        return NULL;
+    }
+
+    unsigned int n = A.rows;
+    SymEig* eig = gaisan_calloc(1, sizeof(SymEig));
+    Matrix* work = matrix_init(n, n);
+    long double* e = gaisan_calloc(2 * (size_t)n, sizeof(long double));
+
+    if(eig == NULL || work == NULL || e == NULL) /* check for failure */
+    {
+        gaisan_free(eig);
+        matrix_free(work);
+        gaisan_free(e);
+        return NULL;
+    }
+
+    long double* tau = e + n;
+
+    eig->n = n;
+    eig->values = gaisan_calloc(n, sizeof(long double));
+
+    if(vectors)
+    {
+        eig->vectors = matrix_init(n, n);
+    }
+
+    bool ok = eig->values != NULL && (!vectors || eig->vectors != NULL);
+
+    ok = ok && view_copy(matrix_view(work), A) &&
+        eig_tridiagonalise(n, work->data, work->stride, eig->values, e, tau);
+    ok = ok && eig_tridiag(n, eig->values, e, eig->vectors);
+
+    if(ok && vectors)
+    {
+        ok = eig_back_transform(n, work->data, work->stride, tau,
+                eig->vectors->data, eig->vectors->stride);
+    }
+
+    matrix_free(work);
+    gaisan_free(e);
+
+    if(!ok) /* check for failure */
+    {
+        eig_sym_free(eig);
+        return NULL;
+    }
+
+    return eig;
+}
+
+/**
+ * Frees memory consumed by `eig`
+ *
+ * @param eig
+ *      the eigendecomposition to be free'd
+ *
+ * */
+void eig_sym_free(SymEig* eig)
+{
+    if(eig == NULL) /* null guard */
+    {
+        return;
+    }
+
+    gaisan_free(eig->values);
+    matrix_free(eig->vectors);
+    gaisan_free(eig);
+}
@@ -0,0 +1,38 @@
+/**
+ * @file eig.h
+ * @author Jack McPherson
+ *
+ * Declarations for the dense symmetric eigensolver.
+ *
+ * */
+#ifndef EIG_H_
+#define EIG_H_
+
+#include <stdbool.h>
+
+#include "matrix.h"
+#include "view.h"
+
+/**
+ * Eigendecomposition `A = V * diag(values) * V^T` of a symmetric matrix `A`
+ *
+ * `values` holds the `n` eigenvalues in ascending order. Column `i` of
+ * `vectors` is a unit eigenvector for `values[i]`; the columns are mutually
+ * orthogonal. `vectors` is `NULL` if only eigenvalues were requested.
+ *
+ * */
+typedef struct
+{
+    unsigned int n;
+    long double* values;
+    Matrix* vectors;
+} SymEig;
+
+SymEig* eig_sym(Matrix* A, bool vectors);
+SymEig* eig_sym_view(MatrixView A, bool vectors);
+void eig_sym_free(SymEig* eig);
+
+bool eig_tridiag(unsigned int n, long double* d, long double* e,
+        Matrix* vectors);
+
+#endif /* EIG_H_ */
@@ -0,0 +1,546 @@
+/**
+ * @file expr.c
+ * @author Jack McPherson
+ *
+ * Implements lazily evaluated, fused elementwise matrix expressions.
+ *
+ * An expression such as `(a + b - c) * k` built with `matrix_add` and friends
+ * makes one full pass over memory (and allocates one temporary) per
+ * operation. Here the same expression is first recorded as a small graph and
+ * then evaluated block by block: for each block of `EXPR_BLOCK` columns of a
+ * row, every operation is applied in turn to intermediate results held in
+ * small, cache-resident scratch buffers, and only the final result is
+ * written out. Each operand is therefore read once and the destination
+ * written once, whatever the number of operations.
+ *
+ * Evaluation applies exactly the same floating-point operations, in the same
+ * order, as the equivalent chain of unfused calls, so results are identical.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "thread.h"
+#include "matrix.h"
+#include "view.h"
+#include "expr.h"
+
+/**
+ * Evaluation order and scratch assignment for an expression
+ *
+ * */
+typedef struct
+{
+    ExprRef root;
+    unsigned int num_steps;
+    unsigned int steps[EXPR_MAX_NODES]; /* operation nodes, in order */
+    unsigned int slot[EXPR_MAX_NODES]; /* scratch block of each step */
+    unsigned int num_slots;
+} ExprPlan;
+
+/**
+ * Arguments shared by the tasks evaluating an expression
+ *
+ * */
+typedef struct
+{
+    const MatrixExpr* expr;
+    const ExprPlan* plan;
+    MatrixView dst;
+    unsigned int num_tasks;
+    atomic_bool failed; /* set by a task that could not get scratch memory */
+} ExprJob;
+
+/**
+ * Initialises `expr` as an empty expression
+ *
+ * @param expr
+ *      the expression to initialise
+ *
+ * */
+void expr_init(MatrixExpr* expr)
+{
+    if(expr == NULL) /* null guard */
+    {
+        return;
+    }
+
+    expr->num_nodes = 0;
+}
+
+/**
+ * Appends `node` to `expr`
+ *
+ * @return handle to the new node, or `EXPR_INVALID` if `expr` is full
+ *
+ * */
+static ExprRef expr_push(MatrixExpr* expr, ExprNode node)
+{
+    if(expr->num_nodes == EXPR_MAX_NODES) /* bounds check */
+    {
+        return EXPR_INVALID;
+    }
+
+    expr->nodes[expr->num_nodes] = node;
+
+    return expr->num_nodes++;
+}
+
+/**
+ * Returns whether `ref` names a node of `expr`
+ *
+ * */
+static bool expr_valid(const MatrixExpr* expr, ExprRef ref)
+{
+    return ref != EXPR_INVALID && ref < expr->num_nodes;
+}
+
+/**
+ * Appends an operation on `a` (and `b`, for binary operations) to `expr`
+ *
+ * @return handle to the new node, or `EXPR_INVALID` on failure
+ *
+ * */
+static ExprRef expr_op(MatrixExpr* expr, ExprOp op, long double k,
+        ExprRef a, ExprRef b)
+{
+    if(expr == NULL || !expr_valid(expr, a)) /* null guard */
+    {
+        return EXPR_INVALID;
+    }
+
+    const ExprNode* na = &expr->nodes[a];
+
+    if(op != EXPR_SCALE) /* binary operation */
+    {
+        if(!expr_valid(expr, b))
+        {
+            return EXPR_INVALID;
+        }
+
+        const ExprNode* nb = &expr->nodes[b];
+
+        if(na->rows != nb->rows || na->cols != nb->cols) /* bounds check */
+        {
+            return EXPR_INVALID;
+        }
+    }
+
+    ExprNode node;
+    memset(&node, 0, sizeof(node));
+    node.op = op;
+    node.rows = na->rows;
+    node.cols = na->cols;
+    node.k = k;
+    node.a = a;
+    node.b = op == EXPR_SCALE ? EXPR_INVALID : b;
+
+    return expr_push(expr, node);
+}
+
+/**
+ * Adds the matrix `matrix` to `expr` as an operand
+ *
+ * @param expr
+ *      the expression being built
+ * @param matrix
+ *      the operand (referenced, not copied)
+ *
+ * @return handle to the operand, or `EXPR_INVALID` on failure
+ *
+ * */
+ExprRef expr_matrix(MatrixExpr* expr, Matrix* matrix)
+{
+    if(matrix == NULL) /* null guard */
+    {
+        return EXPR_INVALID;
+    }
+
+    return expr_view(expr, matrix_view(matrix));
+}
+
+/**
+ * Adds the view `view` to `expr` as an operand
+ *
+ * @param expr
+ *      the expression being built
+ * @param view
+ *      the operand (referenced, not copied)
+ *
+ * @return handle to the operand, or `EXPR_INVALID` on failure
+ *
+ * */
+ExprRef expr_view(MatrixExpr* expr, MatrixView view)
+{
+    if(expr == NULL || view.data == NULL) /* null guard */
+    {
+        return EXPR_INVALID;
+    }
+
+    ExprNode node;
+    memset(&node, 0, sizeof(node));
+    node.op = EXPR_LEAF;
+    node.rows = view.rows;
+    node.cols = view.cols;
+    node.a = EXPR_INVALID;
+    node.b = EXPR_INVALID;
+    node.leaf = view;
+
+    return expr_push(expr, node);
+}
+
+/**
+ * Records `a + b` in `expr`
+ *
+ * @return handle to the sum, or `EXPR_INVALID` on failure (including
+ *      operands of differing shapes)
+ *
+ * */
+ExprRef expr_add(MatrixExpr* expr, ExprRef a, ExprRef b)
+{
+    return expr_op(expr, EXPR_ADD, 1.0L, a, b);
+}
+
+/**
+ * Records `a - b` in `expr`
+ *
+ * @return handle to the difference, or `EXPR_INVALID` on failure (including
+ *      operands of differing shapes)
+ *
+ * */
+ExprRef expr_subtract(MatrixExpr* expr, ExprRef a, ExprRef b)
+{
+    return expr_op(expr, EXPR_SUBTRACT, 1.0L, a, b);
+}
+
+/**
+ * Records `k * a` in `expr`
+ *
+ * @return handle to the product, or `EXPR_INVALID` on failure
+ *
+ * */
+ExprRef expr_scale(MatrixExpr* expr, long double k, ExprRef a)
+{
+    return expr_op(expr, EXPR_SCALE, k, a, EXPR_INVALID);
+}
+
+/**
+ * Records `k * x + y` in `expr`
+ *
+ * @return handle to the result, or `EXPR_INVALID` on failure (including
+ *      operands of differing shapes)
+ *
+ * */
+ExprRef expr_axpy(MatrixExpr* expr, long double k, ExprRef x, ExprRef y)
+{
+    return expr_op(expr, EXPR_AXPY, k, x, y);
+}
+
+/**
+ * Works out which operations are needed to evaluate `root` and assigns each
+ *      a scratch block, reusing blocks once their values are dead
+ *
+ * */
+static void expr_plan(const MatrixExpr* expr, ExprRef root, ExprPlan* plan)
+{
+    bool needed[EXPR_MAX_NODES] = {false};
+    unsigned int last_use[EXPR_MAX_NODES] = {0};
+    unsigned int free_slots[EXPR_MAX_NODES];
+    unsigned int num_free = 0;
+
+    plan->root = root;
+    plan->num_steps = 0;
+    plan->num_slots = 0;
+
+    /* nodes refer only to earlier nodes, so one backward sweep suffices */
+    needed[root] = true;
+
+    for(unsigned int n=root + 1;n-->0;)
+    {
+        const ExprNode* node = &expr->nodes[n];
+
+        if(!needed[n] || node->op == EXPR_LEAF)
+        {
+            continue;
+        }
+
+        needed[node->a] = true;
+        last_use[node->a] = last_use[node->a] > n ? last_use[node->a] : n;
+
+        if(node->b != EXPR_INVALID)
+        {
+            needed[node->b] = true;
+            last_use[node->b] = last_use[node->b] > n ? last_use[node->b] :
+                n;
+        }
+    }
+
+    for(unsigned int n=0;n<=root;n++)
+    {
+        const ExprNode* node = &expr->nodes[n];
+
+        if(!needed[n] || node->op == EXPR_LEAF)
+        {
+            continue;
+        }
+
+        /* release operands used for the last time (results are written
+         * elementwise, so one may share an operand's block) */
+        ExprRef operands[2] = {node->a, node->b};
+
+        for(unsigned int o=0;o<2;o++)
+        {
+            ExprRef c = operands[o];
+
+            if(c != EXPR_INVALID && expr->nodes[c].op != EXPR_LEAF &&
+                    last_use[c] == n && (o == 0 || c != operands[0]))
+            {
+                free_slots[num_free++] = plan->slot[c];
+            }
+        }
+
+        plan->slot[n] = num_free > 0 ? free_slots[--num_free] :
+            plan->num_slots++;
+        plan->steps[plan->num_steps++] = n;
+    }
+}
+
+/**
+ * Locates the values of node `n` for columns `[j, j + w)` of row `i`
+ *
+ * @param step
+ *      receives the distance between consecutive values
+ *
+ * @return pointer to the first value
+ *
+ * */
+static const long double* expr_operand(const MatrixExpr* expr,
+        const ExprPlan* plan, long double* scratch, ExprRef n,
+        unsigned int i, unsigned int j, size_t* step)
+{
+    const ExprNode* node = &expr->nodes[n];
+
+    if(node->op == EXPR_LEAF)
+    {
+        *step = node->leaf.cs;
+        return node->leaf.data + (size_t)i * node->leaf.rs +
+            (size_t)j * node->leaf.cs;
+    }
+
+    *step = 1;
+    return scratch + (size_t)plan->slot[n] * EXPR_BLOCK;
+}
+
+/**
+ * Evaluates columns `[j, j + w)` of row `i` of the expression into `dst`
+ *
+ * */
+static void expr_block(const MatrixExpr* expr, const ExprPlan* plan,
+        long double* scratch, MatrixView dst, unsigned int i, unsigned int j,
+        unsigned int w)
+{
+    for(unsigned int s=0;s<plan->num_steps;s++)
+    {
+        unsigned int n = plan->steps[s];
+        const ExprNode* node = &expr->nodes[n];
+        long double k = node->k;
+
+        size_t sa = 0;
+        size_t sb = 0;
+        size_t so = 1;
+        const long double* a = expr_operand(expr, plan, scratch, node->a, i,
+                j, &sa);
+        const long double* b = node->b == EXPR_INVALID ? NULL :
+            expr_operand(expr, plan, scratch, node->b, i, j, &sb);
+        long double* out = scratch + (size_t)plan->slot[n] * EXPR_BLOCK;
+
+        if(n == plan->root) /* final result goes straight to `dst` */
+        {
+            out = dst.data + (size_t)i * dst.rs + (size_t)j * dst.cs;
+            so = dst.cs;
+        }
+
+        switch(node->op)
+        {
+            case EXPR_ADD:
+                for(unsigned int t=0;t<w;t++)
+                {
+                    out[t * so] = a[t * sa] + b[t * sb];
+                }
+                break;
+            case EXPR_SUBTRACT:
+                for(unsigned int t=0;t<w;t++)
+                {
+                    out[t * so] = a[t * sa] - b[t * sb];
+                }
+                break;
+            case EXPR_SCALE:
+                for(unsigned int t=0;t<w;t++)
+                {
+                    out[t * so] = k * a[t * sa];
+                }
+                break;
+            case EXPR_AXPY:
+                for(unsigned int t=0;t<w;t++)
+                {
+                    out[t * so] = k * a[t * sa] + b[t * sb];
+                }
+                break;
+            case EXPR_LEAF:
+                break;
+        }
+    }
+}
+
+/**
+ * Evaluates band `task` of the rows of the expression
+ *
+ * */
+static void expr_task(unsigned int task, void* arg)
+{
+    ExprJob* job = arg;
+    unsigned int rows = job->dst.rows;
+    unsigned int first = (unsigned int)((size_t)rows * task / job->num_tasks);
+    unsigned int last = (unsigned int)((size_t)rows * (task + 1) /
+            job->num_tasks);
+
+    GaisanArena* arena = gaisan_thread_arena();
+    size_t mark = arena_mark(arena);
+    long double* scratch = arena_alloc(arena, (size_t)job->plan->num_slots *
+            EXPR_BLOCK * sizeof(long double));
+
+    if(scratch == NULL) /* allocation check */
+    {
+        atomic_store(&job->failed, true);
+        return;
+    }
+
+    for(unsigned int i=first;i<last;i++)
+    {
+        for(unsigned int j=0;j<job->dst.cols;j+=EXPR_BLOCK)
+        {
+            unsigned int w = job->dst.cols - j < EXPR_BLOCK ?
+                job->dst.cols - j : EXPR_BLOCK;
+
+            expr_block(job->expr, job->plan, scratch, job->dst, i, j, w);
+        }
+    }
+
+    arena_release(arena, mark);
+}
+
+/**
+ * Evaluates node `root` of `expr` into the view `dst` in a single fused pass
+ *
+ * `dst` may be one of the expression's operands, but must not otherwise
+ *      overlap them.
+ *
+ * @param dst
+ *      the view receiving the result
+ * @param expr
+ *      the expression
+ * @param root
+ *      the node to evaluate
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool expr_eval_view(MatrixView dst, MatrixExpr* expr, ExprRef root)
+{
+    if(expr == NULL || dst.data == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(!expr_valid(expr, root) || dst.rows != expr->nodes[root].rows ||
+            dst.cols != expr->nodes[root].cols) /* bounds check */
+    {
+        return false;
+    }
+
+    if(expr->nodes[root].op == EXPR_LEAF) /* nothing to compute */
+    {
+        return view_copy(dst, expr->nodes[root].leaf);
+    }
+
+    ExprPlan plan;
+    expr_plan(expr, root, &plan);
+
+    size_t size = (size_t)dst.rows * dst.cols;
+    size_t tasks = size / EXPR_TASK_SIZE;
+    unsigned int threads = gaisan_get_num_threads();
+
+    tasks = tasks > threads ? threads : tasks;
+    tasks = tasks > dst.rows ? dst.rows : tasks;
+    tasks = tasks == 0 ? 1 : tasks;
+
+    ExprJob job = {expr, &plan, dst, (unsigned int)tasks, false};
+    parallel_for((unsigned int)tasks, expr_task, &job);
+
+    return !atomic_load(&job.failed);
+}
+
+/**
+ * Evaluates node `root` of `expr` into the matrix `dst` in a single fused
+ *      pass
+ *
+ * `dst` may be one of the expression's operands.
+ *
+ * @param dst
+ *      the matrix receiving the result
+ * @param expr
+ *      the expression
+ * @param root
+ *      the node to evaluate
+ *
+ * @return `dst`, or `NULL` on failure
+ *
+ * */
+Matrix* expr_eval_into(Matrix* dst, MatrixExpr* expr, ExprRef root)
+{
+    if(dst == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    return expr_eval_view(matrix_view(dst), expr, root) ? dst : NULL;
+}
+
+/**
+ * Evaluates node `root` of `expr` in a single fused pass
+ *
+ * @param expr
+ *      the expression
+ * @param root
+ *      the node to evaluate
+ *
+ * @return the result, or `NULL` on failure
+ *
+ * */
+Matrix* expr_eval(MatrixExpr* expr, ExprRef root)
+{
+    if(expr == NULL || !expr_valid(expr, root)) /* null guard */
+    {
+        return NULL;
+    }
+
+    Matrix* res = matrix_init(expr->nodes[root].rows,
+            expr->nodes[root].cols);
+
+    if(res == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    if(expr_eval_into(res, expr, root) == NULL) /* check for failure */
+    {
+        matrix_free(res);
+        return NULL;
+    }
+
+    return res;
+}
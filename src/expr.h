@@ -0,0 +1,87 @@
+/**
+ * @file expr.h
+ * @author Jack McPherson
+ *
+ * Declarations for lazily evaluated, fused elementwise matrix expressions.
+ *
+ * */
+#ifndef EXPR_H_
+#define EXPR_H_
+
+#include <stdbool.h>
+#include <limits.h>
+
+#include "constants.h"
+#include "matrix.h"
+#include "view.h"
+
+/**
+ * Handle to a node of a `MatrixExpr`
+ *
+ * */
+typedef unsigned int ExprRef;
+
+/**
+ * Handle returned when a node cannot be created (a shape mismatch, an
+ * invalid operand or a full expression)
+ *
+ * */
+#define EXPR_INVALID UINT_MAX
+
+/**
+ * Elementwise operations available in an expression
+ *
+ * */
+typedef enum
+{
+    EXPR_LEAF, /* an operand matrix */
+    EXPR_ADD, /* a + b */
+    EXPR_SUBTRACT, /* a - b */
+    EXPR_SCALE, /* k * a */
+    EXPR_AXPY /* k * a + b */
+} ExprOp;
+
+/**
+ * A node of an expression graph
+ *
+ * */
+typedef struct
+{
+    ExprOp op;
+    unsigned int rows;
+    unsigned int cols;
+    long double k; /* scalar of `EXPR_SCALE` and `EXPR_AXPY` */
+    ExprRef a;
+    ExprRef b;
+    MatrixView leaf; /* operand of `EXPR_LEAF` */
+} ExprNode;
+
+/**
+ * An elementwise matrix expression, built up node by node and evaluated in a
+ * single fused pass by `expr_eval`
+ *
+ * Nodes only ever refer to earlier nodes, so the graph is acyclic. Building
+ * an expression does no arithmetic and allocates nothing; operand matrices
+ * are referenced, not copied, and must outlive evaluation.
+ *
+ * */
+typedef struct
+{
+    unsigned int num_nodes;
+    ExprNode nodes[EXPR_MAX_NODES];
+} MatrixExpr;
+
+void expr_init(MatrixExpr* expr);
+
+ExprRef expr_matrix(MatrixExpr* expr, Matrix* matrix);
+ExprRef expr_view(MatrixExpr* expr, MatrixView view);
+ExprRef expr_add(MatrixExpr* expr, ExprRef a, ExprRef b);
+ExprRef expr_subtract(MatrixExpr* expr, ExprRef a, ExprRef b);
+ExprRef expr_scale(MatrixExpr* expr, long double k, ExprRef a);
+ExprRef expr_axpy(MatrixExpr* expr, long double k, ExprRef x, ExprRef y);
+
+Matrix* expr_eval(MatrixExpr* expr, ExprRef root);
+Matrix* expr_eval_into(Matrix* dst, MatrixExpr* expr, ExprRef root);
+bool expr_eval_view(MatrixView dst, MatrixExpr* expr, ExprRef root);
+
+#endif /* EXPR_H_ */
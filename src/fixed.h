@@ -0,0 +1,545 @@
+/**
+ * @file fixed.h
+ * @author Jack McPherson
+ *
+ * Fixed-size square matrix types `Mat2` to `Mat8` and vector types `Vec2` to
+ * `Vec8`, with inline operations.
+ *
+ * These are plain values: they live on the stack (or inside other structs),
+ * allocate nothing, and every loop has a compile-time trip count, so the
+ * compiler unrolls and inlines them completely. Determinants and inverses
+ * of 2x2, 3x3 and 4x4 matrices use closed-form cofactor expansions; larger
+ * sizes use Gaussian elimination with partial pivoting.
+ *
+ * For each size `N` the following are provided (shown for `N` = 3):
+ *
+ * - `Mat3 mat3_identity(void)`
+ * - `Mat3 mat3_add(const Mat3* a, const Mat3* b)`
+ * - `Mat3 mat3_subtract(const Mat3* a, const Mat3* b)`
+ * - `Mat3 mat3_scale(long double k, const Mat3* a)`
+ * - `Mat3 mat3_multiply(const Mat3* a, const Mat3* b)`
+ * - `Vec3 mat3_multiply_vec(const Mat3* a, const Vec3* x)`
+ * - `Mat3 mat3_transpose(const Mat3* a)`
+ * - `long double mat3_det(const Mat3* a)`
+ * - `bool mat3_invert(const Mat3* a, Mat3* inv)` (false if singular)
+ * - `bool mat3_from_matrix(Mat3* dst, Matrix* src)`
+ * - `bool mat3_store(const Mat3* a, Matrix* dst)`
+ * - `Matrix* mat3_to_matrix(const Mat3* a)`
+ * - `Vec3 vec3_add(const Vec3* x, const Vec3* y)`
+ * - `Vec3 vec3_subtract(const Vec3* x, const Vec3* y)`
+ * - `Vec3 vec3_scale(long double k, const Vec3* x)`
+ * - `long double vec3_dot(const Vec3* x, const Vec3* y)`
+ *
+ * */
+#ifndef FIXED_H_
+#define FIXED_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "matrix.h"
+
+/**
+ * Defines the types `MatN` and `VecN` and every operation on them that does
+ * not depend on the size, where `N` is `n`
+ *
+ * */
+#define FIXED_DEFINE(n) \
+    typedef struct \
+    { \
+        long double m[n][n]; \
+    } Mat##n; \
+    \
+    typedef struct \
+    { \
+        long double v[n]; \
+    } Vec##n; \
+    \
+    static inline Mat##n mat##n##_identity(void) \
+    { \
+        Mat##n res = {{{0.0}}}; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            res.m[i][i] = 1.0; \
+        } \
+        return res; \
+    } \
+    \
+    static inline Mat##n mat##n##_add(const Mat##n* a, const Mat##n* b) \
+    { \
+        Mat##n res; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                res.m[i][j] = a->m[i][j] + b->m[i][j]; \
+            } \
+        } \
+        return res; \
+    } \
+    \
+    static inline Mat##n mat##n##_subtract(const Mat##n* a, \
+            const Mat##n* b) \
+    { \
+        Mat##n res; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                res.m[i][j] = a->m[i][j] - b->m[i][j]; \
+            } \
+        } \
+        return res; \
+    } \
+    \
+    static inline Mat##n mat##n##_scale(long double k, const Mat##n* a) \
+    { \
+        Mat##n res; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                res.m[i][j] = k * a->m[i][j]; \
+            } \
+        } \
+        return res; \
+    } \
+    \
+    static inline Mat##n mat##n##_multiply(const Mat##n* a, \
+            const Mat##n* b) \
+    { \
+        Mat##n res; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                long double sum = 0.0; \
+                for(unsigned int k=0;k<n;k++) \
+                { \
+                    sum += a->m[i][k] * b->m[k][j]; \
+                } \
+                res.m[i][j] = sum; \
+            } \
+        } \
+        return res; \
+    } \
+    \
+    static inline Vec##n mat##n##_multiply_vec(const Mat##n* a, \
+            const Vec##n* x) \
+    { \
+        Vec##n res; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            long double sum = 0.0; \
+            for(unsigned int k=0;k<n;k++) \
+            { \
+                sum += a->m[i][k] * x->v[k]; \
+            } \
+            res.v[i] = sum; \
+        } \
+        return res; \
+    } \
+    \
+    static inline Mat##n mat##n##_transpose(const Mat##n* a) \
+    { \
+        Mat##n res; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                res.m[j][i] = a->m[i][j]; \
+            } \
+        } \
+        return res; \
+    } \
+    \
+    static inline bool mat##n##_from_matrix(Mat##n* dst, Matrix* src) \
+    { \
+        if(dst == NULL || src == NULL) /* null guard */ \
+        { \
+            return false; \
+        } \
+        if(src->rows != n || src->cols != n) /* bounds check */ \
+        { \
+            return false; \
+        } \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                dst->m[i][j] = src->data[(size_t)i * src->stride + j]; \
+            } \
+        } \
+        return true; \
+    } \
+    \
+    static inline bool mat##n##_store(const Mat##n* a, Matrix* dst) \
+    { \
+        if(a == NULL || dst == NULL) /* null guard */ \
+        { \
+            return false; \
+        } \
+        if(dst->rows != n || dst->cols != n) /* bounds check */ \
+        { \
+            return false; \
+        } \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                dst->data[(size_t)i * dst->stride + j] = a->m[i][j]; \
+            } \
+        } \
+        return true; \
+    } \
+    \
+    static inline Matrix* mat##n##_to_matrix(const Mat##n* a) \
+    { \
+        if(a == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        Matrix* res = matrix_init(n, n); \
+        if(res != NULL) \
+        { \
+            mat##n##_store(a, res); \
+        } \
+        return res; \
+    } \
+    \
+    static inline Vec##n vec##n##_add(const Vec##n* x, const Vec##n* y) \
+    { \
+        Vec##n res; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            res.v[i] = x->v[i] + y->v[i]; \
+        } \
+        return res; \
+    } \
+    \
+    static inline Vec##n vec##n##_subtract(const Vec##n* x, \
+            const Vec##n* y) \
+    { \
+        Vec##n res; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            res.v[i] = x->v[i] - y->v[i]; \
+        } \
+        return res; \
+    } \
+    \
+    static inline Vec##n vec##n##_scale(long double k, const Vec##n* x) \
+    { \
+        Vec##n res; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            res.v[i] = k * x->v[i]; \
+        } \
+        return res; \
+    } \
+    \
+    static inline long double vec##n##_dot(const Vec##n* x, \
+            const Vec##n* y) \
+    { \
+        long double sum = 0.0; \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            sum += x->v[i] * y->v[i]; \
+        } \
+        return sum; \
+    }
+
+/**
+ * Defines `matN_det` and `matN_invert` by Gaussian elimination with partial
+ * pivoting, where `N` is `n`
+ *
+ * */
+#define FIXED_DEFINE_ELIM(n) \
+    static inline long double mat##n##_det(const Mat##n* a) \
+    { \
+        Mat##n lu = *a; \
+        long double det = 1.0; \
+        for(unsigned int k=0;k<n;k++) \
+        { \
+            unsigned int p = k; \
+            for(unsigned int i=k + 1;i<n;i++) \
+            { \
+                p = fabsl(lu.m[i][k]) > fabsl(lu.m[p][k]) ? i : p; \
+            } \
+            if(lu.m[p][k] == 0.0) /* singular */ \
+            { \
+                return 0.0; \
+            } \
+            if(p != k) \
+            { \
+                for(unsigned int j=k;j<n;j++) \
+                { \
+                    long double tmp = lu.m[k][j]; \
+                    lu.m[k][j] = lu.m[p][j]; \
+                    lu.m[p][j] = tmp; \
+                } \
+                det = -det; \
+            } \
+            det *= lu.m[k][k]; \
+            for(unsigned int i=k + 1;i<n;i++) \
+            { \
+                long double l = lu.m[i][k] / lu.m[k][k]; \
+                for(unsigned int j=k + 1;j<n;j++) \
+                { \
+                    lu.m[i][j] -= l * lu.m[k][j]; \
+                } \
+            } \
+        } \
+        return det; \
+    } \
+    \
+    static inline bool mat##n##_invert(const Mat##n* a, Mat##n* inv) \
+    { \
+        if(a == NULL || inv == NULL) /* null guard */ \
+        { \
+            return false; \
+        } \
+        Mat##n lu = *a; \
+        Mat##n res = mat##n##_identity(); \
+        for(unsigned int k=0;k<n;k++) /* Gauss-Jordan */ \
+        { \
+            unsigned int p = k; \
+            for(unsigned int i=k + 1;i<n;i++) \
+            { \
+                p = fabsl(lu.m[i][k]) > fabsl(lu.m[p][k]) ? i : p; \
+            } \
+            if(lu.m[p][k] == 0.0) /* singular */ \
+            { \
+                return false; \
+            } \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                long double tmp = lu.m[k][j]; \
+                lu.m[k][j] = lu.m[p][j]; \
+                lu.m[p][j] = tmp; \
+                tmp = res.m[k][j]; \
+                res.m[k][j] = res.m[p][j]; \
+                res.m[p][j] = tmp; \
+            } \
+            long double d = 1.0 / lu.m[k][k]; \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                lu.m[k][j] *= d; \
+                res.m[k][j] *= d; \
+            } \
+            for(unsigned int i=0;i<n;i++) \
+            { \
+                long double l = lu.m[i][k]; \
+                if(i == k || l == 0.0) \
+                { \
+                    continue; \
+                } \
+                for(unsigned int j=0;j<n;j++) \
+                { \
+                    lu.m[i][j] -= l * lu.m[k][j]; \
+                    res.m[i][j] -= l * res.m[k][j]; \
+                } \
+            } \
+        } \
+        *inv = res; \
+        return true; \
+    }
+
+FIXED_DEFINE(2)
+FIXED_DEFINE(3)
+FIXED_DEFINE(4)
+FIXED_DEFINE(5)
+FIXED_DEFINE(6)
+FIXED_DEFINE(7)
+FIXED_DEFINE(8)
+
+FIXED_DEFINE_ELIM(5)
+FIXED_DEFINE_ELIM(6)
+FIXED_DEFINE_ELIM(7)
+FIXED_DEFINE_ELIM(8)
+
+static inline long double mat2_det(const Mat2* a)
+{
+    return a->m[0][0] * a->m[1][1] - a->m[0][1] * a->m[1][0];
+}
+
+static inline bool mat2_invert(const Mat2* a, Mat2* inv)
+{
+    if(a == NULL || inv == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    long double det = mat2_det(a);
+
+    if(det == 0.0) /* singular */
+    {
+        return false;
+    }
+
+    long double d = 1.0 / det;
+    Mat2 res = {{
+        {a->m[1][1] * d, -a->m[0][1] * d},
+        {-a->m[1][0] * d, a->m[0][0] * d}
+    }};
+
+    *inv = res;
+
+    return true;
+}
+
+static inline long double mat3_det(const Mat3* a)
+{
+    return a->m[0][0] * (a->m[1][1] * a->m[2][2] - a->m[1][2] * a->m[2][1]) -
+        a->m[0][1] * (a->m[1][0] * a->m[2][2] - a->m[1][2] * a->m[2][0]) +
+        a->m[0][2] * (a->m[1][0] * a->m[2][1] - a->m[1][1] * a->m[2][0]);
+}
+
+static inline bool mat3_invert(const Mat3* a, Mat3* inv)
+{
+    if(a == NULL || inv == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    /* cofactors of the first row */
+    long double c00 = a->m[1][1] * a->m[2][2] - a->m[1][2] * a->m[2][1];
+    long double c01 = a->m[1][2] * a->m[2][0] - a->m[1][0] * a->m[2][2];
+    long double c02 = a->m[1][0] * a->m[2][1] - a->m[1][1] * a->m[2][0];
+    long double det = a->m[0][0] * c00 + a->m[0][1] * c01 +
+        a->m[0][2] * c02;
+
+    if(det == 0.0) /* singular */
+    {
+        return false;
+    }
+
+    long double d = 1.0 / det;
+    Mat3 res = {{
+        {
+            c00 * d,
+            (a->m[0][2] * a->m[2][1] - a->m[0][1] * a->m[2][2]) * d,
+            (a->m[0][1] * a->m[1][2] - a->m[0][2] * a->m[1][1]) * d
+        },
+        {
+            c01 * d,
+            (a->m[0][0] * a->m[2][2] - a->m[0][2] * a->m[2][0]) * d,
+            (a->m[0][2] * a->m[1][0] - a->m[0][0] * a->m[1][2]) * d
+        },
+        {
+            c02 * d,
+            (a->m[0][1] * a->m[2][0] - a->m[0][0] * a->m[2][1]) * d,
+            (a->m[0][0] * a->m[1][1] - a->m[0][1] * a->m[1][0]) * d
+        }
+    }};
+
+    *inv = res;
+
+    return true;
+}
+
+/**
+ * 2x2 minors of the top (`s`) and bottom (`c`) row pairs of a 4x4 matrix,
+ * from which its determinant and adjugate follow
+ *
+ * */
+typedef struct
+{
+    long double s[6];
+    long double c[6];
+} Mat4Minors;
+
+static inline Mat4Minors mat4_minors(const Mat4* a)
+{
+    Mat4Minors r;
+
+    r.s[0] = a->m[0][0] * a->m[1][1] - a->m[1][0] * a->m[0][1];
+    r.s[1] = a->m[0][0] * a->m[1][2] - a->m[1][0] * a->m[0][2];
+    r.s[2] = a->m[0][0] * a->m[1][3] - a->m[1][0] * a->m[0][3];
+    r.s[3] = a->m[0][1] * a->m[1][2] - a->m[1][1] * a->m[0][2];
+    r.s[4] = a->m[0][1] * a->m[1][3] - a->m[1][1] * a->m[0][3];
+    r.s[5] = a->m[0][2] * a->m[1][3] - a->m[1][2] * a->m[0][3];
+
+    r.c[5] = a->m[2][2] * a->m[3][3] - a->m[3][2] * a->m[2][3];
+    r.c[4] = a->m[2][1] * a->m[3][3] - a->m[3][1] * a->m[2][3];
+    r.c[3] = a->m[2][1] * a->m[3][2] - a->m[3][1] * a->m[2][2];
+    r.c[2] = a->m[2][0] * a->m[3][3] - a->m[3][0] * a->m[2][3];
+    r.c[1] = a->m[2][0] * a->m[3][2] - a->m[3][0] * a->m[2][2];
+    r.c[0] = a->m[2][0] * a->m[3][1] - a->m[3][0] * a->m[2][1];
+
+    return r;
+}
+
+static inline long double mat4_det(const Mat4* a)
+{
+    Mat4Minors r = mat4_minors(a);
+
+    return r.s[0] * r.c[5] - r.s[1] * r.c[4] + r.s[2] * r.c[3] +
+        r.s[3] * r.c[2] - r.s[4] * r.c[1] + r.s[5] * r.c[0];
+}
+
+static inline bool mat4_invert(const Mat4* a, Mat4* inv)
+{
+    if(a == NULL || inv == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    Mat4Minors r = mat4_minors(a);
+    const long double* s = r.s;
+    const long double* c = r.c;
+    long double det = s[0] * c[5] - s[1] * c[4] + s[2] * c[3] +
+        s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+
+    if(det == 0.0) /* singular */
+    {
+        return false;
+    }
+
+    long double d = 1.0 / det;
+    Mat4 res;
+
+    res.m[0][0] = (a->m[1][1] * c[5] - a->m[1][2] * c[4] +
+            a->m[1][3] * c[3]) * d;
+    res.m[0][1] = (-a->m[0][1] * c[5] + a->m[0][2] * c[4] -
+            a->m[0][3] * c[3]) * d;
+    res.m[0][2] = (a->m[3][1] * s[5] - a->m[3][2] * s[4] +
+            a->m[3][3] * s[3]) * d;
+    res.m[0][3] = (-a->m[2][1] * s[5] + a->m[2][2] * s[4] -
+            a->m[2][3] * s[3]) * d;
+
+    res.m[1][0] = (-a->m[1][0] * c[5] + a->m[1][2] * c[2] -
+            a->m[1][3] * c[1]) * d;
+    res.m[1][1] = (a->m[0][0] * c[5] - a->m[0][2] * c[2] +
+            a->m[0][3] * c[1]) * d;
+    res.m[1][2] = (-a->m[3][0] * s[5] + a->m[3][2] * s[2] -
+            a->m[3][3] * s[1]) * d;
+    res.m[1][3] = (a->m[2][0] * s[5] - a->m[2][2] * s[2] +
+            a->m[2][3] * s[1]) * d;
+
+    res.m[2][0] = (a->m[1][0] * c[4] - a->m[1][1] * c[2] +
+            a->m[1][3] * c[0]) * d;
+    res.m[2][1] = (-a->m[0][0] * c[4] + a->m[0][1] * c[2] -
+            a->m[0][3] * c[0]) * d;
+    res.m[2][2] = (a->m[3][0] * s[4] - a->m[3][1] * s[2] +
+            a->m[3][3] * s[0]) * d;
+    res.m[2][3] = (-a->m[2][0] * s[4] + a->m[2][1] * s[2] -
+            a->m[2][3] * s[0]) * d;
+
+    res.m[3][0] = (-a->m[1][0] * c[3] + a->m[1][1] * c[1] -
+            a->m[1][2] * c[0]) * d;
+    res.m[3][1] = (a->m[0][0] * c[3] - a->m[0][1] * c[1] +
+            a->m[0][2] * c[0]) * d;
+    res.m[3][2] = (-a->m[3][0] * s[3] + a->m[3][1] * s[1] -
+            a->m[3][2] * s[0]) * d;
+    res.m[3][3] = (a->m[2][0] * s[3] - a->m[2][1] * s[1] +
+            a->m[2][2] * s[0]) * d;
+
+    *inv = res;
+
+    return true;
+}
+
+#endif /* FIXED_H_ */
+
@@ -0,0 +1,700 @@
+/**
+ * @file gemm.c
+ * @author Jack McPherson
+ *
+ * Implements a packed, cache-blocked general matrix-matrix multiply.
+ *
+ * The loop structure follows the usual five-loop GEMM design: the result is
+ * split into `GEMM_NC`-wide column panels, the shared dimension into
+ * `GEMM_KC`-deep slabs and the rows into `GEMM_MC`-tall blocks. Each slab of
+ * B and block of A is packed into contiguous micro-panels so that the
+ * register-blocked microkernel streams through memory with unit stride.
+ *
+ * Large products are additionally split into tiles of C which are computed
+ * in parallel on the worker pool (see thread.h).
+ *
+ * The triangular solves are blocked so that all but an O(n^2) fraction of
+ * their work is done by GEMM.
+ *
+ * Transposition works on `TRANSPOSE_BLOCK`-square tiles, so that both the
+ * rows read and the rows written stay in cache while a tile is moved, and
+ * large transposes spread their tiles over the worker pool.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "thread.h"
+
+/**
+ * Packs the `mc` x `kc` block of A at `a` into `GEMM_MR`-row micro-panels,
+ *      zero-padding the final panel
+ *
+ * */
+static void gemm_pack_a(unsigned int mc, unsigned int kc, const long double* a,
+        unsigned int rsa, unsigned int csa, long double* buf)
+{
+    for(unsigned int i=0;i<mc;i+=GEMM_MR)
+    {
+        unsigned int mr = mc - i < GEMM_MR ? mc - i : GEMM_MR;
+
+        for(unsigned int p=0;p<kc;p++)
+        {
+            const long double* col = a + (size_t)i * rsa + (size_t)p * csa;
+
+            for(unsigned int ii=0;ii<GEMM_MR;ii++)
+            {
+                *buf++ = ii < mr ? col[(size_t)ii * rsa] : 0.0;
+            }
+        }
+    }
+}
+
+/**
+ * Packs the `kc` x `nc` slab of B at `b` into `GEMM_NR`-column micro-panels,
+ *      zero-padding the final panel
+ *
+ * */
+static void gemm_pack_b(unsigned int kc, unsigned int nc, const long double* b,
+        unsigned int rsb, unsigned int csb, long double* buf)
+{
+    for(unsigned int j=0;j<nc;j+=GEMM_NR)
+    {
+        unsigned int nr = nc - j < GEMM_NR ? nc - j : GEMM_NR;
+
+        for(unsigned int p=0;p<kc;p++)
+        {
+            const long double* row = b + (size_t)p * rsb + (size_t)j * csb;
+
+            for(unsigned int jj=0;jj<GEMM_NR;jj++)
+            {
+                *buf++ = jj < nr ? row[(size_t)jj * csb] : 0.0;
+            }
+        }
+    }
+}
+
+/**
+ * Computes `C += alpha * A * B` for one `mr` x `nr` tile of C from packed
+ *      micro-panels of A and B; the full `GEMM_MR` x `GEMM_NR` tile is
+ *      accumulated in registers
+ *
+ * */
+static void gemm_microkernel(unsigned int kc, long double alpha,
+        const long double* restrict a, const long double* restrict b,
+        unsigned int mr, unsigned int nr, long double* c, unsigned int rsc,
+        unsigned int csc)
+{
+    long double acc[GEMM_MR][GEMM_NR] = {{0.0}};
+
+    for(unsigned int p=0;p<kc;p++)
+    {
+        for(unsigned int i=0;i<GEMM_MR;i++)
+        {
+            const long double a_ip = a[i];
+
+            for(unsigned int j=0;j<GEMM_NR;j++)
+            {
+                acc[i][j] += a_ip * b[j];
+            }
+        }
+
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+
+    for(unsigned int i=0;i<mr;i++)
+    {
+        for(unsigned int j=0;j<nr;j++)
+        {
+            c[(size_t)i * rsc + (size_t)j * csc] += alpha * acc[i][j];
+        }
+    }
+}
+
+/**
+ * Scales the `m` x `n` matrix `c` by `beta` (a `beta` of zero clears `c`)
+ *
+ * */
+static void gemm_scale_c(unsigned int m, unsigned int n, long double beta,
+        long double* c, unsigned int rsc, unsigned int csc)
+{
+    if(beta == 1.0)
+    {
+        return;
+    }
+
+    for(unsigned int i=0;i<m;i++)
+    {
+        long double* row = c + (size_t)i * rsc;
+
+        for(unsigned int j=0;j<n;j++)
+        {
+            row[(size_t)j * csc] = beta == 0.0 ? 0.0 :
+                beta * row[(size_t)j * csc];
+        }
+    }
+}
+
+/**
+ * Accumulates `C += alpha * A * B` directly, without packing; used for small
+ *      products and when the packing buffers cannot be allocated
+ *
+ * */
+static void gemm_direct(unsigned int m, unsigned int n, unsigned int k,
+        long double alpha, const long double* a, unsigned int rsa,
+        unsigned int csa, const long double* b, unsigned int rsb,
+        unsigned int csb, long double* c, unsigned int rsc, unsigned int csc)
+{
+    for(unsigned int i=0;i<m;i++)
+    {
+        for(unsigned int p=0;p<k;p++)
+        {
+            const long double a_ip = alpha * a[(size_t)i * rsa +
+                (size_t)p * csa];
+            const long double* row_b = b + (size_t)p * rsb;
+            long double* row_c = c + (size_t)i * rsc;
+
+            for(unsigned int j=0;j<n;j++)
+            {
+                row_c[(size_t)j * csc] += a_ip * row_b[(size_t)j * csb];
+            }
+        }
+    }
+}
+
+/**
+ * Accumulates `C += alpha * A * B` using the packed, cache-blocked kernel
+ *
+ * Each cell of C sees the same sequence of operations however C is split
+ *      into tiles, so calling this on tiles of C gives bitwise identical
+ *      results to calling it on the whole.
+ *
+ * */
+static void gemm_blocked(unsigned int m, unsigned int n, unsigned int k,
+        long double alpha, const long double* a, unsigned int rsa,
+        unsigned int csa, const long double* b, unsigned int rsb,
+        unsigned int csb, long double* c, unsigned int rsc, unsigned int csc)
+{
+    /* packing buffers, sized for the blocks actually used */
+    unsigned int mc_max = m < GEMM_MC ? m : GEMM_MC;
+    unsigned int kc_max = k < GEMM_KC ? k : GEMM_KC;
+    unsigned int nc_max = n < GEMM_NC ? n : GEMM_NC;
+
+    mc_max = (mc_max + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    nc_max = (nc_max + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+
+    size_t a_bytes = (size_t)mc_max * kc_max * sizeof(long double);
+    size_t b_bytes = (size_t)kc_max * nc_max * sizeof(long double);
+
+    a_bytes = (a_bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT *
+        MATRIX_ALIGNMENT;
+    b_bytes = (b_bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT *
+        MATRIX_ALIGNMENT;
+
+    /* drawn from this thread's arena, so repeated calls reuse them */
+    GaisanArena* arena = gaisan_thread_arena();
+    size_t mark = arena_mark(arena);
+    long double* a_buf = arena_alloc(arena, a_bytes);
+    long double* b_buf = arena_alloc(arena, b_bytes);
+
+    if(a_buf == NULL || b_buf == NULL) /* allocation check */
+    {
+        arena_release(arena, mark);
+        gemm_direct(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, csc);
+        return;
+    }
+
+    for(unsigned int jc=0;jc<n;jc+=GEMM_NC) /* L3: column panels of C */
+    {
+        unsigned int nc = n - jc < GEMM_NC ? n - jc : GEMM_NC;
+
+        for(unsigned int pc=0;pc<k;pc+=GEMM_KC) /* L1: slabs of A and B */
+        {
+            unsigned int kc = k - pc < GEMM_KC ? k - pc : GEMM_KC;
+
+            gemm_pack_b(kc, nc, b + (size_t)pc * rsb + (size_t)jc * csb,
+                    rsb, csb, b_buf);
+
+            for(unsigned int ic=0;ic<m;ic+=GEMM_MC) /* L2: row blocks of C */
+            {
+                unsigned int mc = m - ic < GEMM_MC ? m - ic : GEMM_MC;
+
+                gemm_pack_a(mc, kc, a + (size_t)ic * rsa + (size_t)pc * csa,
+                        rsa, csa, a_buf);
+
+                /* macrokernel: sweep micro-tiles of this block of C */
+                for(unsigned int jr=0;jr<nc;jr+=GEMM_NR)
+                {
+                    unsigned int nr = nc - jr < GEMM_NR ? nc - jr : GEMM_NR;
+
+                    for(unsigned int ir=0;ir<mc;ir+=GEMM_MR)
+                    {
+                        unsigned int mr = mc - ir < GEMM_MR ? mc - ir :
+                            GEMM_MR;
+
+                        gemm_microkernel(kc, alpha,
+                                a_buf + (size_t)ir * kc,
+                                b_buf + (size_t)jr * kc,
+                                mr, nr,
+                                c + (size_t)(ic + ir) * rsc +
+                                    (size_t)(jc + jr) * csc,
+                                rsc, csc);
+                    }
+                }
+            }
+        }
+    }
+
+    arena_release(arena, mark);
+}
+
+/**
+ * Arguments of a parallel GEMM, shared by every tile task
+ *
+ * */
+typedef struct
+{
+    unsigned int m;
+    unsigned int n;
+    unsigned int k;
+    long double alpha;
+    const long double* a;
+    unsigned int rsa;
+    unsigned int csa;
+    const long double* b;
+    unsigned int rsb;
+    unsigned int csb;
+    long double* c;
+    unsigned int rsc;
+    unsigned int csc;
+    unsigned int tiles_n; /* number of tile columns */
+} GemmJob;
+
+/**
+ * Computes tile `t` of a parallel GEMM (tiles are numbered row-major)
+ *
+ * */
+static void gemm_tile(unsigned int t, void* arg)
+{
+    const GemmJob* job = arg;
+
+    unsigned int i = (t / job->tiles_n) * GEMM_TILE_M;
+    unsigned int j = (t % job->tiles_n) * GEMM_TILE_N;
+    unsigned int m = job->m - i < GEMM_TILE_M ? job->m - i : GEMM_TILE_M;
+    unsigned int n = job->n - j < GEMM_TILE_N ? job->n - j : GEMM_TILE_N;
+
+    gemm_blocked(m, n, job->k, job->alpha,
+            job->a + (size_t)i * job->rsa, job->rsa, job->csa,
+            job->b + (size_t)j * job->csb, job->rsb, job->csb,
+            job->c + (size_t)i * job->rsc + (size_t)j * job->csc,
+            job->rsc, job->csc);
+}
+
+/**
+ * Computes `C = alpha * A * B + beta * C`
+ *
+ * Every operand is described by a base pointer together with a row stride
+ *      and a column stride (in cells), so that row-major, column-major and
+ *      transposed operands are all handled without copying.
+ *
+ * @param m
+ *      number of rows of A and C
+ * @param n
+ *      number of columns of B and C
+ * @param k
+ *      number of columns of A and rows of B
+ * @param alpha
+ *      scalar multiple of `A * B`
+ * @param a
+ *      the `m` x `k` matrix A
+ * @param rsa
+ *      row stride of A
+ * @param csa
+ *      column stride of A
+ * @param b
+ *      the `k` x `n` matrix B
+ * @param rsb
+ *      row stride of B
+ * @param csb
+ *      column stride of B
+ * @param beta
+ *      scalar multiple of C (if zero, C need not be initialised)
+ * @param c
+ *      the `m` x `n` matrix C, which receives the result
+ * @param rsc
+ *      row stride of C
+ * @param csc
+ *      column stride of C
+ *
+ * */
+void gemm(unsigned int m, unsigned int n, unsigned int k, long double alpha,
+        const long double* a, unsigned int rsa, unsigned int csa,
+        const long double* b, unsigned int rsb, unsigned int csb,
+        long double beta, long double* c, unsigned int rsc, unsigned int csc)
+{
+    if(a == NULL || b == NULL || c == NULL) /* null guard */
+    {
+        return;
+    }
+
+    if(m == 0 || n == 0) /* trivial case */
+    {
+        return;
+    }
+
+    gemm_scale_c(m, n, beta, c, rsc, csc);
+
+    if(k == 0 || alpha == 0.0) /* nothing to accumulate */
+    {
+        return;
+    }
+
+    /* small products are dominated by packing costs, so multiply directly */
+    if((size_t)m * n * k < GEMM_SMALL_FLOPS)
+    {
+        gemm_direct(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, csc);
+        return;
+    }
+
+    /* large products are split into a fixed grid of tiles of C; the grid
+     * depends only on the problem size, so results do not depend on the
+     * number of threads */
+    if((size_t)m * n * k >= GEMM_PARALLEL_FLOPS &&
+            gaisan_get_num_threads() > 1)
+    {
+        GemmJob job = {m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, csc,
+            (n + GEMM_TILE_N - 1) / GEMM_TILE_N};
+        unsigned int tiles_m = (m + GEMM_TILE_M - 1) / GEMM_TILE_M;
+
+        parallel_for(tiles_m * job.tiles_n, &gemm_tile, &job);
+
+        return;
+    }
+
+    gemm_blocked(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, csc);
+}
+
+/**
+ * Solves `T * X = B` in place for `X`, where `T` is `n` x `n` lower
+ *      triangular and `B` is `n` x `r`
+ *
+ * @param unit
+ *      whether `T` has an implicit unit diagonal (its diagonal is not read)
+ * @param n
+ *      order of `T`
+ * @param r
+ *      number of right-hand sides (columns of `X`)
+ * @param t
+ *      the triangular matrix `T` (only its lower triangle is read)
+ * @param rst
+ *      row stride of `T`
+ * @param cst
+ *      column stride of `T`
+ * @param x
+ *      on entry `B`, on exit `X` (row-major)
+ * @param ldx
+ *      row stride of `X`
+ *
+ * */
+void trsm_lower(bool unit, unsigned int n, unsigned int r,
+        const long double* t, unsigned int rst, unsigned int cst,
+        long double* x, unsigned int ldx)
+{
+    if(t == NULL || x == NULL) /* null guard */
+    {
+        return;
+    }
+
+    for(unsigned int j=0;j<n;j+=TRSM_BLOCK_SIZE)
+    {
+        unsigned int nb = n - j < TRSM_BLOCK_SIZE ? n - j : TRSM_BLOCK_SIZE;
+
+        /* forward substitution within the diagonal block */
+        for(unsigned int i=j;i<j+nb;i++)
+        {
+            long double* row_i = x + (size_t)i * ldx;
+
+            for(unsigned int p=j;p<i;p++)
+            {
+                const long double t_ip = t[(size_t)i * rst + (size_t)p * cst];
+                const long double* row_p = x + (size_t)p * ldx;
+
+                for(unsigned int l=0;l<r;l++)
+                {
+                    row_i[l] -= t_ip * row_p[l];
+                }
+            }
+
+            if(!unit)
+            {
+                const long double t_ii = t[(size_t)i * rst + (size_t)i * cst];
+
+                for(unsigned int l=0;l<r;l++)
+                {
+                    row_i[l] /= t_ii;
+                }
+            }
+        }
+
+        /* eliminate the solved block from the rows below */
+        if(j + nb < n)
+        {
+            gemm(n - j - nb, r, nb, -1.0,
+                    t + (size_t)(j + nb) * rst + (size_t)j * cst, rst, cst,
+                    x + (size_t)j * ldx, ldx, 1, 1.0,
+                    x + (size_t)(j + nb) * ldx, ldx, 1);
+        }
+    }
+}
+
+/**
+ * Solves `T * X = B` in place for `X`, where `T` is `n` x `n` upper
+ *      triangular and `B` is `n` x `r`
+ *
+ * @param unit
+ *      whether `T` has an implicit unit diagonal (its diagonal is not read)
+ * @param n
+ *      order of `T`
+ * @param r
+ *      number of right-hand sides (columns of `X`)
+ * @param t
+ *      the triangular matrix `T` (only its upper triangle is read)
+ * @param rst
+ *      row stride of `T`
+ * @param cst
+ *      column stride of `T`
+ * @param x
+ *      on entry `B`, on exit `X` (row-major)
+ * @param ldx
+ *      row stride of `X`
+ *
+ * */
+void trsm_upper(bool unit, unsigned int n, unsigned int r,
+        const long double* t, unsigned int rst, unsigned int cst,
+        long double* x, unsigned int ldx)
+{
+    if(t == NULL || x == NULL) /* null guard */
+    {
+        return;
+    }
+
+    for(unsigned int end=n;end>0;)
+    {
+        unsigned int nb = end < TRSM_BLOCK_SIZE ? end : TRSM_BLOCK_SIZE;
+        unsigned int j = end - nb;
+
+        /* back substitution within the diagonal block */
+        for(unsigned int i=end;i-->j;)
+        {
+            long double* row_i = x + (size_t)i * ldx;
+
+            for(unsigned int p=i+1;p<end;p++)
+            {
+                const long double t_ip = t[(size_t)i * rst + (size_t)p * cst];
+                const long double* row_p = x + (size_t)p * ldx;
+
+                for(unsigned int l=0;l<r;l++)
+                {
+                    row_i[l] -= t_ip * row_p[l];
+                }
+            }
+
+            if(!unit)
+            {
+                const long double t_ii = t[(size_t)i * rst + (size_t)i * cst];
+
+                for(unsigned int l=0;l<r;l++)
+                {
+                    row_i[l] /= t_ii;
+                }
+            }
+        }
+
+        /* eliminate the solved block from the rows above */
+        if(j > 0)
+        {
+            gemm(j, r, nb, -1.0, t + (size_t)j * cst, rst, cst,
+                    x + (size_t)j * ldx, ldx, 1, 1.0, x, ldx, 1);
+        }
+
+        end = j;
+    }
+}
+
+/**
+ * Transposes the tile of rows `[i0, i1)` and columns `[j0, j1)` of A into B
+ *
+ * */
+static void transpose_tile(unsigned int i0, unsigned int i1, unsigned int j0,
+        unsigned int j1, const long double* a, unsigned int lda,
+        long double* b, unsigned int ldb)
+{
+    for(unsigned int j=j0;j<j1;j++)
+    {
+        long double* row_b = b + (size_t)j * ldb;
+
+        for(unsigned int i=i0;i<i1;i++)
+        {
+            row_b[i] = a[(size_t)i * lda + j];
+        }
+    }
+}
+
+/**
+ * Arguments of a parallel transpose, shared by every band of tiles
+ *
+ * */
+typedef struct
+{
+    unsigned int m;
+    unsigned int n;
+    const long double* a;
+    unsigned int lda;
+    long double* b;
+    unsigned int ldb;
+} TransposeJob;
+
+/**
+ * Transposes the `t`th band of `TRANSPOSE_BLOCK` rows of A
+ *
+ * */
+static void transpose_band(unsigned int t, void* arg)
+{
+    const TransposeJob* job = arg;
+    unsigned int i0 = t * TRANSPOSE_BLOCK;
+    unsigned int i1 = job->m - i0 < TRANSPOSE_BLOCK ? job->m :
+        i0 + TRANSPOSE_BLOCK;
+
+    for(unsigned int j0=0;j0<job->n;j0+=TRANSPOSE_BLOCK)
+    {
+        unsigned int j1 = job->n - j0 < TRANSPOSE_BLOCK ? job->n :
+            j0 + TRANSPOSE_BLOCK;
+
+        transpose_tile(i0, i1, j0, j1, job->a, job->lda, job->b, job->ldb);
+    }
+}
+
+/**
+ * Computes `B = A^T`
+ *
+ * @param m
+ *      number of rows of `A`
+ * @param n
+ *      number of columns of `A`
+ * @param a
+ *      the `m` x `n` row-major matrix `A`
+ * @param lda
+ *      row stride of `A`
+ * @param b
+ *      the `n` x `m` row-major matrix receiving the result (must not overlap
+ *          `A`)
+ * @param ldb
+ *      row stride of `B`
+ *
+ * */
+void transpose(unsigned int m, unsigned int n, const long double* a,
+        unsigned int lda, long double* b, unsigned int ldb)
+{
+    if(a == NULL || b == NULL) /* null guard */
+    {
+        return;
+    }
+
+    TransposeJob job = {m, n, a, lda, b, ldb};
+    unsigned int bands = (m + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+
+    if((size_t)m * n < TRANSPOSE_PARALLEL_SIZE) /* not worth waking the pool */
+    {
+        for(unsigned int t=0;t<bands;t++)
+        {
+            transpose_band(t, &job);
+        }
+
+        return;
+    }
+
+    parallel_for(bands, &transpose_band, &job);
+}
+
+/**
+ * Swaps the tile of rows `[i0, i1)` and columns `[j0, j1)` of A with its
+ *      mirror image, transposing both (or transposes it in place if it lies
+ *      on the diagonal)
+ *
+ * */
+static void transpose_swap_tile(unsigned int i0, unsigned int i1,
+        unsigned int j0, unsigned int j1, long double* a, unsigned int lda)
+{
+    for(unsigned int i=i0;i<i1;i++)
+    {
+        long double* row_a = a + (size_t)i * lda;
+
+        for(unsigned int j=i0 == j0 ? i + 1 : j0;j<j1;j++)
+        {
+            long double* mirror = a + (size_t)j * lda + i;
+            long double tmp = row_a[j];
+
+            row_a[j] = *mirror;
+            *mirror = tmp;
+        }
+    }
+}
+
+/**
+ * Transposes the band of tiles on and right of the `t`th diagonal tile
+ *
+ * */
+static void transpose_inplace_band(unsigned int t, void* arg)
+{
+    const TransposeJob* job = arg;
+    unsigned int i0 = t * TRANSPOSE_BLOCK;
+    unsigned int i1 = job->n - i0 < TRANSPOSE_BLOCK ? job->n :
+        i0 + TRANSPOSE_BLOCK;
+
+    for(unsigned int j0=i0;j0<job->n;j0+=TRANSPOSE_BLOCK)
+    {
+        unsigned int j1 = job->n - j0 < TRANSPOSE_BLOCK ? job->n :
+            j0 + TRANSPOSE_BLOCK;
+
+        transpose_swap_tile(i0, i1, j0, j1, job->b, job->ldb);
+    }
+}
+
+/**
+ * Transposes the `n` x `n` row-major matrix `A` in place
+ *
+ * @param n
+ *      order of `A`
+ * @param a
+ *      the matrix `A`
+ * @param lda
+ *      row stride of `A`
+ *
+ * */
+void transpose_inplace(unsigned int n, long double* a, unsigned int lda)
+{
+    if(a == NULL) /* null guard */
+    {
+        return;
+    }
+
+    TransposeJob job = {n, n, a, lda, a, lda};
+    unsigned int bands = (n + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+
+    if((size_t)n * n < TRANSPOSE_PARALLEL_SIZE) /* not worth waking the pool */
+    {
+        for(unsigned int t=0;t<bands;t++)
+        {
+            transpose_inplace_band(t, &job);
+        }
+
+        return;
+    }
+
+    parallel_for(bands, &transpose_inplace_band, &job);
+}
@@ -0,0 +1,31 @@
+/**
+ * @file gemm.h
+ * @author Jack McPherson
+ *
+ * Declarations for the dense kernels: general matrix-matrix multiply (GEMM),
+ * triangular solve with multiple right-hand sides (TRSM) and transposition.
+ *
+ * */
+#ifndef GEMM_H_
+#define GEMM_H_
+
+#include <stdbool.h>
+
+void gemm(unsigned int m, unsigned int n, unsigned int k, long double alpha,
+        const long double* a, unsigned int rsa, unsigned int csa,
+        const long double* b, unsigned int rsb, unsigned int csb,
+        long double beta, long double* c, unsigned int rsc, unsigned int csc);
+
+void trsm_lower(bool unit, unsigned int n, unsigned int r,
+        const long double* t, unsigned int rst, unsigned int cst,
+        long double* x, unsigned int ldx);
+void trsm_upper(bool unit, unsigned int n, unsigned int r,
+        const long double* t, unsigned int rst, unsigned int cst,
+        long double* x, unsigned int ldx);
+
+void transpose(unsigned int m, unsigned int n, const long double* a,
+        unsigned int lda, long double* b, unsigned int ldb);
+void transpose_inplace(unsigned int n, long double* a, unsigned int lda);
+
+#endif /* GEMM_H_ */
+
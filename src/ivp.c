@@ -6,88 +6,101 @@
  *
  * */
 #include <stdlib.h>
-#include <math.h>
+#include <limits.h>
+#include <tgmath.h>
 
 #include "constants.h"
+#include "alloc.h"
 #include "diff.h"
 #include "ivp.h"
 
 /**
- * Solves the IVP `y'(t)=f(t,y), y(a)=y_0` via Euler's method
- *
- * @param a
- *      start of the solution interval
- * @param b
- *      end of the solution interval 
- * @param y_0
- *      initial value of IVP (i.e. value of `f(a)`)
- * @param f
- *      the function to integrate
- * @param h
- *      the step size to use for Euler's method calculations
- * 
- * @return array of x, y pairs constituting the solution of the IVP
+ * Defines the IVP methods over `T`, with names suffixed by `s`
  *
  * */
-long double** euler(long double a, long double b, long double y_0,
-        long double (*f)(long double, long double), long double h)
-{
-    if(f == NULL) /* null guard */
-    {
-        return NULL;
-    }
-
-    if(h == 0)
-    {
-        return NULL;
-    }
-
-    if(a == b)
-    {
-        return NULL;
-    }
-
-    unsigned int n = ceil((a + b) / h); /* number of steps */
-
-    /* allocate solution array */
-    long double** soln = calloc(2, sizeof(long double*));
-
-    if(soln == NULL) /* allocation check */
-    {
-        return NULL;
-    }
-
-    soln[0] = calloc(n, sizeof(long double));
-
-    if(soln[0] == NULL) /* allocation check */
-    {
-        free(soln);
-        return NULL;
-    }
-
-    soln[1] = calloc(n, sizeof(long double));
-
-    if(soln[1] == NULL) /* allocation check */
-    {
-        free(soln[0]);
-        free(soln);
-        return NULL;
+#define IVP_DEFINE(T, s) \
+    /** \
+     * Solves the IVP `y'(t)=f(t,y), y(a)=y_0` via Euler's method \
+     * \
+     * @param a \
+     *      start of the solution interval \
+     * @param b \
+     *      end of the solution interval \
+     * @param y_0 \
+     *      initial value of IVP (i.e. value of `f(a)`) \
+     * @param f \
+     *      the function to integrate \
+     * @param h \
+     *      the step size to use for Euler's method calculations \
+     * \
+     * @return array of x, y pairs constituting the solution of the IVP, \
+     *      with `ceil((b - a) / h) + 1` points starting at `(a, y_0)`; \
+     *      `NULL` unless `a < b` and `h > 0` \
+     * \
+     * */ \
+    T** euler##s(T a, T b, T y_0, T (*f)(T, T), T h) \
+    { \
+        if(f == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        if(h <= 0 || b <= a) /* bounds check */ \
+        { \
+            return NULL; \
+        } \
+        \
+        T steps = ceil((b - a) / h); \
+        \
+        if(steps >= UINT_MAX) /* bounds check */ \
+        { \
+            return NULL; \
+        } \
+        \
+        unsigned int n = (unsigned int)steps + 1; /* number of points */ \
+        \
+        /* allocate solution array */ \
+        T** soln = gaisan_calloc(2, sizeof(T*)); \
+        \
+        if(soln == NULL) /* allocation check */ \
+        { \
+            return NULL; \
+        } \
+        \
+        soln[0] = gaisan_calloc(n, sizeof(T)); \
+        \
+        if(soln[0] == NULL) /* allocation check */ \
+        { \
+            gaisan_free(soln); \
+            return NULL; \
+        } \
+        \
+        soln[1] = gaisan_calloc(n, sizeof(T)); \
+        \
+        if(soln[1] == NULL) /* allocation check */ \
+        { \
+            gaisan_free(soln[0]); \
+            gaisan_free(soln); \
+            return NULL; \
+        } \
+        \
+        /* setup aliases */ \
+        T* t = soln[0]; \
+        T* y = soln[1]; \
+        \
+        t[0] = a; /* initial point */ \
+        y[0] = y_0; /* initial value */ \
+        \
+        /* iterate */ \
+        for(unsigned int i=1;i<n;i++) \
+        { \
+            t[i] = t[i-1] + h; \
+            y[i] = y[i-1] + h * f(t[i-1], y[i-1]); \
+        } \
+        \
+        return soln; \
     }
 
-    /* setup aliases */
-    long double* t = soln[0];
-    long double* y = soln[1];
-
-    t[0] = a; /* initial point */
-    y[0] = y_0; /* initial value */
-
-    /* iterate */
-    for(unsigned int i=1;i<n;i++)
-    {
-        t[i] = t[i-1] + h;
-        y[i] = y[i-1] + h * f(t[i], y[i]);
-    }
-
-    return soln;
-}
-
+IVP_DEFINE(long double, )
+IVP_DEFINE(double, _d)
+IVP_DEFINE(float, _f)
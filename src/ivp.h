@@ -4,12 +4,29 @@
  *
  * Declarations for IVP methods.
  *
+ * `euler` is also provided in `double` (`euler_d`) and `float` (`euler_f`),
+ * generated from the same source. The `geuler` macro selects among them by
+ * the type of the right-hand side `f`.
+ *
  * */
 #ifndef IVP_H_
 #define IVP_H_
 
-long double** euler(long double a, long double b, long double y_0,
-        long double (*f)(long double, long double), long double h);
+/**
+ * Declares the IVP methods over `T`, with names suffixed by `s`
+ *
+ * */
+#define IVP_DECLARE(T, s) \
+    T** euler##s(T a, T b, T y_0, T (*f)(T, T), T h);
 
-#endif /* IVP_H_ */
+IVP_DECLARE(long double, )
+IVP_DECLARE(double, _d)
+IVP_DECLARE(float, _f)
+
+#define geuler(a, b, y_0, f, h) \
+    _Generic((f), \
+            long double (*)(long double, long double): euler, \
+            double (*)(double, double): euler_d, \
+            float (*)(float, float): euler_f)(a, b, y_0, f, h)
 
+#endif /* IVP_H_ */
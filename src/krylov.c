@@ -0,0 +1,1126 @@
+/**
+ * @file krylov.c
+ * @author Jack McPherson
+ *
+ * Implements preconditioned Krylov subspace methods for the linear system
+ * `Ax = b`: conjugate gradient (symmetric positive definite `A`), BiCGSTAB
+ * and restarted GMRES (general `A`).
+ *
+ * The operator is only touched through matrix-vector products, so sparse
+ * operators never need more than O(nnz) memory. GMRES and BiCGSTAB are
+ * right-preconditioned, so every reported residual is the true residual of
+ * the unpreconditioned system.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "sparse.h"
+#include "krylov.h"
+
+/**
+ * Wraps the dense square matrix `A` as an operator
+ *
+ * @param A
+ *      the matrix (not copied; must outlive the operator)
+ *
+ * @return the operator (with `n` zero if `A` is not square)
+ *
+ * */
+KrylovOp krylov_op_dense(Matrix* A)
+{
+    KrylovOp op = {0, NULL, NULL};
+
+    if(A != NULL && A->rows == A->cols)
+    {
+        op.n = A->rows;
+        op.dense = A;
+    }
+
+    return op;
+}
+
+/**
+ * Wraps the sparse square matrix `A` as an operator
+ *
+ * @param A
+ *      the matrix (not copied; must outlive the operator)
+ *
+ * @return the operator (with `n` zero if `A` is not square)
+ *
+ * */
+KrylovOp krylov_op_sparse(SparseMatrix* A)
+{
+    KrylovOp op = {0, NULL, NULL};
+
+    if(A != NULL && A->rows == A->cols)
+    {
+        op.n = A->rows;
+        op.sparse = A;
+    }
+
+    return op;
+}
+
+/**
+ * Computes `y = Ax`
+ *
+ * @param op
+ *      the operator `A`
+ * @param x
+ *      vector of length `n`
+ * @param y
+ *      vector of length `n` receiving the result (must not overlap `x`)
+ *
+ * */
+void krylov_op_apply(const KrylovOp* op, const long double* x, long double* y)
+{
+    if(op == NULL || x == NULL || y == NULL) /* null guard */
+    {
+        return;
+    }
+
+    if(op->sparse != NULL)
+    {
+        sparse_spmv(op->sparse, 1.0, x, 0.0, y);
+    }
+    else if(op->dense != NULL)
+    {
+        gemm(op->n, 1, op->n, 1.0, op->dense->data, op->dense->stride, 1, x,
+                1, 1, 0.0, y, 1, 1);
+    }
+}
+
+/**
+ * Returns `op` in CSR form (always a new matrix, to be free'd by the caller)
+ *
+ * */
+static SparseMatrix* krylov_op_csr(const KrylovOp* op)
+{
+    if(op->sparse != NULL)
+    {
+        return sparse_convert(op->sparse, SPARSE_CSR);
+    }
+
+    return sparse_from_dense(op->dense, SPARSE_CSR);
+}
+
+/**
+ * Computes the incomplete LU factorisation of `csr` in place, with no fill
+ *      outside its sparsity pattern
+ *
+ * @return true on success, false on a missing or zero pivot
+ *
+ * */
+static bool precond_ilu0(Precond* precond, SparseMatrix* csr)
+{
+    unsigned int n = csr->rows;
+    size_t* pos = gaisan_malloc((size_t)n * sizeof(size_t));
+
+    if(pos == NULL) /* allocation check */
+    {
+        return false;
+    }
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        pos[i] = SIZE_MAX;
+        precond->diag_pos[i] = SIZE_MAX;
+
+        for(size_t e=csr->ptr[i];e<csr->ptr[i + 1];e++)
+        {
+            if(csr->idx[e] == i)
+            {
+                precond->diag_pos[i] = e;
+            }
+        }
+
+        if(precond->diag_pos[i] == SIZE_MAX) /* missing pivot */
+        {
+            gaisan_free(pos);
+            return false;
+        }
+    }
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        for(size_t e=csr->ptr[i];e<csr->ptr[i + 1];e++) /* scatter row i */
+        {
+            pos[csr->idx[e]] = e;
+        }
+
+        /* eliminate with every earlier row k in the pattern of row i */
+        for(size_t e=csr->ptr[i];e<precond->diag_pos[i];e++)
+        {
+            unsigned int k = csr->idx[e];
+            long double l_ik = csr->vals[e] * precond->diag[k];
+
+            csr->vals[e] = l_ik;
+
+            for(size_t f=precond->diag_pos[k] + 1;f<csr->ptr[k + 1];f++)
+            {
+                size_t dst = pos[csr->idx[f]];
+
+                if(dst != SIZE_MAX) /* no fill */
+                {
+                    csr->vals[dst] -= l_ik * csr->vals[f];
+                }
+            }
+        }
+
+        for(size_t e=csr->ptr[i];e<csr->ptr[i + 1];e++) /* gather row i */
+        {
+            pos[csr->idx[e]] = SIZE_MAX;
+        }
+
+        long double u_ii = csr->vals[precond->diag_pos[i]];
+
+        if(u_ii == 0.0) /* zero pivot */
+        {
+            gaisan_free(pos);
+            return false;
+        }
+
+        precond->diag[i] = 1.0 / u_ii;
+    }
+
+    gaisan_free(pos);
+
+    return true;
+}
+
+/**
+ * Computes the incomplete Cholesky factor of the lower triangle of `csr`,
+ *      with no fill outside its sparsity pattern
+ *
+ * @return the factor, or `NULL` on failure (a missing diagonal or loss of
+ *      positive definiteness)
+ *
+ * */
+static SparseMatrix* precond_ic0(Precond* precond, SparseMatrix* csr)
+{
+    unsigned int n = csr->rows;
+    size_t nnz = 0;
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        for(size_t e=csr->ptr[i];e<csr->ptr[i + 1];e++)
+        {
+            nnz += csr->idx[e] <= i;
+        }
+    }
+
+    SparseBuilder* builder = sparse_builder_init(n, n);
+
+    if(builder == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    for(unsigned int i=0;i<n;i++) /* lower triangle, diagonal last */
+    {
+        for(size_t e=csr->ptr[i];e<csr->ptr[i + 1];e++)
+        {
+            if(csr->idx[e] <= i &&
+                    !sparse_builder_add(builder, i, csr->idx[e], csr->vals[e]))
+            {
+                sparse_builder_free(builder);
+                return NULL;
+            }
+        }
+    }
+
+    SparseMatrix* l = sparse_from_builder(builder, SPARSE_CSR);
+
+    sparse_builder_free(builder);
+
+    if(l == NULL || l->nnz != nnz) /* check for failure */
+    {
+        sparse_free(l);
+        return NULL;
+    }
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        size_t last = l->ptr[i + 1] - 1;
+
+        if(l->ptr[i + 1] == l->ptr[i] || l->idx[last] != i) /* no diagonal */
+        {
+            sparse_free(l);
+            return NULL;
+        }
+
+        for(size_t e=l->ptr[i];e<last;e++)
+        {
+            unsigned int k = l->idx[e];
+            long double sum = l->vals[e];
+            size_t p = l->ptr[i];
+            size_t q = l->ptr[k];
+
+            /* sum over j < k of L(i, j) * L(k, j), merging sorted rows */
+            while(p < e && q < l->ptr[k + 1] - 1)
+            {
+                if(l->idx[p] < l->idx[q])
+                {
+                    p++;
+                }
+                else if(l->idx[p] > l->idx[q])
+                {
+                    q++;
+                }
+                else
+                {
+                    sum -= l->vals[p++] * l->vals[q++];
+                }
+            }
+
+            l->vals[e] = sum * precond->diag[k];
+        }
+
+        long double d = l->vals[last];
+
+        for(size_t e=l->ptr[i];e<last;e++)
+        {
+            d -= l->vals[e] * l->vals[e];
+        }
+
+        if(!(d > 0.0)) /* not positive definite */
+        {
+            sparse_free(l);
+            return NULL;
+        }
+
+        l->vals[last] = sqrtl(d);
+        precond->diag[i] = 1.0 / l->vals[last];
+    }
+
+    return l;
+}
+
+/**
+ * Builds a preconditioner for `op`
+ *
+ * @param op
+ *      the operator being preconditioned
+ * @param type
+ *      the kind of preconditioner
+ *
+ * @return the preconditioner, or `NULL` on failure (including a zero
+ *      diagonal, a zero ILU pivot, or a non-SPD operator for IC(0))
+ *
+ * */
+Precond* precond_init(const KrylovOp* op, PrecondType type)
+{
+    if(op == NULL || op->n == 0) /* null guard */
+    {
+        return NULL;
+    }
+
+    Precond* precond = gaisan_calloc(1, sizeof(Precond));
+
+    if(precond == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    precond->type = type;
+    precond->n = op->n;
+
+    if(type == PRECOND_NONE)
+    {
+        return precond;
+    }
+
+    precond->diag = gaisan_calloc(op->n, sizeof(long double));
+
+    if(precond->diag == NULL) /* allocation check */
+    {
+        precond_free(precond);
+        return NULL;
+    }
+
+    if(type == PRECOND_JACOBI)
+    {
+        for(unsigned int i=0;i<op->n;i++)
+        {
+            long double a_ii = 0.0;
+
+            if(op->dense != NULL)
+            {
+                a_ii = op->dense->data[(size_t)i * op->dense->stride + i];
+            }
+            else
+            {
+                /* diagonal sits in column (row) i of either format */
+                const SparseMatrix* s = op->sparse;
+
+                for(size_t e=s->ptr[i];e<s->ptr[i + 1];e++)
+                {
+                    if(s->idx[e] == i)
+                    {
+                        a_ii = s->vals[e];
+                    }
+                }
+            }
+
+            if(a_ii == 0.0) /* zero diagonal */
+            {
+                precond_free(precond);
+                return NULL;
+            }
+
+            precond->diag[i] = 1.0 / a_ii;
+        }
+
+        return precond;
+    }
+
+    SparseMatrix* csr = krylov_op_csr(op);
+
+    if(csr == NULL) /* check for failure */
+    {
+        precond_free(precond);
+        return NULL;
+    }
+
+    if(type == PRECOND_ILU0)
+    {
+        precond->diag_pos = gaisan_calloc(op->n, sizeof(size_t));
+
+        if(precond->diag_pos == NULL || !precond_ilu0(precond, csr))
+        {
+            sparse_free(csr);
+            precond_free(precond);
+            return NULL;
+        }
+
+        precond->factors = csr;
+    }
+    else
+    {
+        precond->factors = precond_ic0(precond, csr);
+        sparse_free(csr);
+
+        if(precond->factors == NULL) /* check for failure */
+        {
+            precond_free(precond);
+            return NULL;
+        }
+    }
+
+    return precond;
+}
+
+/**
+ * Frees memory consumed by `precond`
+ *
+ * @param precond
+ *      the preconditioner to be free'd
+ *
+ * */
+void precond_free(Precond* precond)
+{
+    if(precond == NULL) /* null guard */
+    {
+        return;
+    }
+
+    gaisan_free(precond->diag);
+    gaisan_free(precond->diag_pos);
+    sparse_free(precond->factors);
+    gaisan_free(precond);
+}
+
+/**
+ * Applies the preconditioner: `z = M^-1 r`
+ *
+ * @param precond
+ *      the preconditioner
+ * @param r
+ *      vector of length `n`
+ * @param z
+ *      vector of length `n` receiving the result (may equal `r`)
+ *
+ * */
+void precond_apply(const Precond* precond, const long double* r,
+        long double* z)
+{
+    if(precond == NULL || r == NULL || z == NULL) /* null guard */
+    {
+        return;
+    }
+
+    if(precond->type == PRECOND_NONE)
+    {
+        if(z != r)
+        {
+            memmove(z, r, precond->n * sizeof(long double));
+        }
+
+        return;
+    }
+
+    unsigned int n = precond->n;
+    const SparseMatrix* f = precond->factors;
+
+    switch(precond->type)
+    {
+        case PRECOND_JACOBI:
+            for(unsigned int i=0;i<n;i++)
+            {
+                z[i] = r[i] * precond->diag[i];
+            }
+
+            break;
+        case PRECOND_ILU0:
+            for(unsigned int i=0;i<n;i++) /* L y = r */
+            {
+                long double sum = r[i];
+
+                for(size_t e=f->ptr[i];e<precond->diag_pos[i];e++)
+                {
+                    sum -= f->vals[e] * z[f->idx[e]];
+                }
+
+                z[i] = sum;
+            }
+
+            for(unsigned int i=n;i-->0;) /* U z = y */
+            {
+                long double sum = z[i];
+
+                for(size_t e=precond->diag_pos[i] + 1;e<f->ptr[i + 1];e++)
+                {
+                    sum -= f->vals[e] * z[f->idx[e]];
+                }
+
+                z[i] = sum * precond->diag[i];
+            }
+
+            break;
+        case PRECOND_IC0:
+            for(unsigned int i=0;i<n;i++) /* L y = r */
+            {
+                long double sum = r[i];
+
+                for(size_t e=f->ptr[i];e<f->ptr[i + 1] - 1;e++)
+                {
+                    sum -= f->vals[e] * z[f->idx[e]];
+                }
+
+                z[i] = sum * precond->diag[i];
+            }
+
+            for(unsigned int i=n;i-->0;) /* L^T z = y, by columns of L^T */
+            {
+                z[i] *= precond->diag[i];
+
+                for(size_t e=f->ptr[i];e<f->ptr[i + 1] - 1;e++)
+                {
+                    z[f->idx[e]] -= f->vals[e] * z[i];
+                }
+            }
+
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Returns the default solver options: `DEFAULT_TOLERANCE`,
+ *      `KRYLOV_MAX_ITER` iterations, restarts every `GMRES_RESTART`
+ *      iterations and no preconditioner
+ *
+ * */
+KrylovOpts krylov_default_opts(void)
+{
+    KrylovOpts opts = {DEFAULT_TOLERANCE, KRYLOV_MAX_ITER, GMRES_RESTART,
+        NULL};
+
+    return opts;
+}
+
+/**
+ * Frees memory consumed by `result`
+ *
+ * @param result
+ *      the result to be free'd
+ *
+ * */
+void krylov_result_free(KrylovResult* result)
+{
+    if(result == NULL) /* null guard */
+    {
+        return;
+    }
+
+    gaisan_free(result->history);
+    gaisan_free(result);
+}
+
+static long double krylov_dot(unsigned int n, const long double* x,
+        const long double* y)
+{
+    long double sum = 0.0;
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        sum += x[i] * y[i];
+    }
+
+    return sum;
+}
+
+static long double krylov_norm(unsigned int n, const long double* x)
+{
+    return sqrtl(krylov_dot(n, x, x));
+}
+
+/**
+ * Computes `z = M^-1 r`, where a missing preconditioner is the identity
+ *
+ * */
+static void krylov_precondition(const Precond* precond, unsigned int n,
+        const long double* r, long double* z)
+{
+    if(precond == NULL)
+    {
+        memcpy(z, r, n * sizeof(long double));
+        return;
+    }
+
+    precond_apply(precond, r, z);
+}
+
+/**
+ * Computes `r = b - Ax`
+ *
+ * */
+static void krylov_residual(const KrylovOp* op, const long double* b,
+        const long double* x, long double* r)
+{
+    krylov_op_apply(op, x, r);
+
+    for(unsigned int i=0;i<op->n;i++)
+    {
+        r[i] = b[i] - r[i];
+    }
+}
+
+/**
+ * Appends the relative residual `res` to the history of `result`
+ *
+ * */
+static bool krylov_record(KrylovResult* result, long double res)
+{
+    if(result->history_len % INIT_BUF_LEN == 0) /* buffer full, expand */
+    {
+        size_t cap = (size_t)result->history_len + INIT_BUF_LEN;
+        long double* history = gaisan_realloc(result->history,
+                cap * sizeof(long double));
+
+        if(history == NULL) /* allocation check */
+        {
+            return false;
+        }
+
+        result->history = history;
+    }
+
+    result->history[result->history_len++] = res;
+    result->residual = res;
+
+    return true;
+}
+
+/**
+ * Validates the arguments shared by every solver and allocates the result
+ *
+ * */
+static KrylovResult* krylov_start(const KrylovOp* op, const long double* b,
+        long double* x, const KrylovOpts* opts)
+{
+    if(op == NULL || b == NULL || x == NULL || opts == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(op->n == 0 || opts->tol <= 0.0) /* bounds check */
+    {
+        return NULL;
+    }
+
+    if(opts->precond != NULL && opts->precond->n != op->n)
+    {
+        return NULL;
+    }
+
+    return gaisan_calloc(1, sizeof(KrylovResult));
+}
+
+/**
+ * Replaces the recurrence residual of `result` with the true relative
+ *      residual of `x`
+ *
+ * */
+static KrylovResult* krylov_finish(KrylovResult* result, const KrylovOp* op,
+        const long double* b, const long double* x, long double* r,
+        long double b_norm)
+{
+    krylov_residual(op, b, x, r);
+    result->residual = krylov_norm(op->n, r) / b_norm;
+
+    return result;
+}
+
+/**
+ * Solves `Ax = b` by the preconditioned conjugate gradient method
+ *
+ * @param op
+ *      the operator `A`, which must be symmetric positive definite
+ * @param b
+ *      the right-hand side
+ * @param x
+ *      on entry the initial guess, on exit the solution
+ * @param opts
+ *      solver options (`NULL` for the defaults); a preconditioner must be
+ *          symmetric positive definite (Jacobi or IC(0))
+ *
+ * @return the convergence report, or `NULL` on failure
+ *
+ * */
+KrylovResult* krylov_cg(const KrylovOp* op, const long double* b,
+        long double* x, const KrylovOpts* opts)
+{
+    KrylovOpts defaults = krylov_default_opts();
+
+    opts = opts == NULL ? &defaults : opts;
+
+    KrylovResult* result = krylov_start(op, b, x, opts);
+
+    if(result == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    unsigned int n = op->n;
+    long double* work = gaisan_calloc((size_t)4 * n, sizeof(long double));
+
+    if(work == NULL) /* allocation check */
+    {
+        krylov_result_free(result);
+        return NULL;
+    }
+
+    long double* r = work;
+    long double* z = r + n;
+    long double* p = z + n;
+    long double* q = p + n;
+    long double b_norm = krylov_norm(n, b);
+
+    if(b_norm == 0.0) /* trivial case */
+    {
+        memset(x, 0, n * sizeof(long double));
+        result->converged = krylov_record(result, 0.0);
+        gaisan_free(work);
+        return result;
+    }
+
+    krylov_residual(op, b, x, r);
+    krylov_precondition(opts->precond, n, r, z);
+    memcpy(p, z, n * sizeof(long double));
+
+    long double rz = krylov_dot(n, r, z);
+    long double res = krylov_norm(n, r) / b_norm;
+
+    while(krylov_record(result, res))
+    {
+        if(res <= opts->tol)
+        {
+            result->converged = true;
+            break;
+        }
+
+        if(result->iterations == opts->max_iter)
+        {
+            break;
+        }
+
+        krylov_op_apply(op, p, q);
+
+        long double pq = krylov_dot(n, p, q);
+
+        if(!(pq > 0.0)) /* breakdown: A is not positive definite */
+        {
+            break;
+        }
+
+        long double alpha = rz / pq;
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * q[i];
+        }
+
+        result->iterations++;
+        res = krylov_norm(n, r) / b_norm;
+
+        krylov_precondition(opts->precond, n, r, z);
+
+        long double rz_next = krylov_dot(n, r, z);
+        long double beta = rz_next / rz;
+
+        rz = rz_next;
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            p[i] = z[i] + beta * p[i];
+        }
+    }
+
+    krylov_finish(result, op, b, x, r, b_norm);
+    gaisan_free(work);
+
+    return result;
+}
+
+/**
+ * Solves `Ax = b` by the right-preconditioned BiCGSTAB method
+ *
+ * @param op
+ *      the operator `A`
+ * @param b
+ *      the right-hand side
+ * @param x
+ *      on entry the initial guess, on exit the solution
+ * @param opts
+ *      solver options (`NULL` for the defaults)
+ *
+ * @return the convergence report, or `NULL` on failure
+ *
+ * */
+KrylovResult* krylov_bicgstab(const KrylovOp* op, const long double* b,
+        long double* x, const KrylovOpts* opts)
+{
+    KrylovOpts defaults = krylov_default_opts();
+
+    opts = opts == NULL ? &defaults : opts;
+
+    KrylovResult* result = krylov_start(op, b, x, opts);
+
+    if(result == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    unsigned int n = op->n;
+    long double* work = gaisan_calloc((size_t)7 * n, sizeof(long double));
+
+    if(work == NULL) /* allocation check */
+    {
+        krylov_result_free(result);
+        return NULL;
+    }
+
+    long double* r = work;
+    long double* r_hat = r + n;
+    long double* p = r_hat + n;
+    long double* v = p + n;
+    long double* s = v + n;
+    long double* t = s + n;
+    long double* y = t + n; /* preconditioned direction */
+    long double b_norm = krylov_norm(n, b);
+
+    if(b_norm == 0.0) /* trivial case */
+    {
+        memset(x, 0, n * sizeof(long double));
+        result->converged = krylov_record(result, 0.0);
+        gaisan_free(work);
+        return result;
+    }
+
+    krylov_residual(op, b, x, r);
+    memcpy(r_hat, r, n * sizeof(long double));
+
+    long double rho = 1.0;
+    long double alpha = 1.0;
+    long double omega = 1.0;
+    long double res = krylov_norm(n, r) / b_norm;
+
+    while(krylov_record(result, res))
+    {
+        if(res <= opts->tol)
+        {
+            result->converged = true;
+            break;
+        }
+
+        if(result->iterations == opts->max_iter)
+        {
+            break;
+        }
+
+        long double rho_next = krylov_dot(n, r_hat, r);
+
+        if(rho_next == 0.0 || omega == 0.0) /* breakdown */
+        {
+            break;
+        }
+
+        long double beta = (rho_next / rho) * (alpha / omega);
+
+        rho = rho_next;
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            p[i] = r[i] + beta * (p[i] - omega * v[i]);
+        }
+
+        krylov_precondition(opts->precond, n, p, y);
+        krylov_op_apply(op, y, v);
+
+        long double r_hat_v = krylov_dot(n, r_hat, v);
+
+        if(r_hat_v == 0.0) /* breakdown */
+        {
+            break;
+        }
+
+        alpha = rho / r_hat_v;
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            x[i] += alpha * y[i];
+            s[i] = r[i] - alpha * v[i];
+        }
+
+        result->iterations++;
+
+        if(krylov_norm(n, s) / b_norm <= opts->tol) /* converged half way */
+        {
+            memcpy(r, s, n * sizeof(long double));
+            res = krylov_norm(n, r) / b_norm;
+            continue;
+        }
+
+        krylov_precondition(opts->precond, n, s, y);
+        krylov_op_apply(op, y, t);
+
+        long double tt = krylov_dot(n, t, t);
+
+        omega = tt == 0.0 ? 0.0 : krylov_dot(n, t, s) / tt;
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            x[i] += omega * y[i];
+            r[i] = s[i] - omega * t[i];
+        }
+
+        res = krylov_norm(n, r) / b_norm;
+    }
+
+    krylov_finish(result, op, b, x, r, b_norm);
+    gaisan_free(work);
+
+    return result;
+}
+
+/**
+ * Solves `Ax = b` by right-preconditioned GMRES, restarted every
+ *      `opts->restart` iterations
+ *
+ * @param op
+ *      the operator `A`
+ * @param b
+ *      the right-hand side
+ * @param x
+ *      on entry the initial guess, on exit the solution
+ * @param opts
+ *      solver options (`NULL` for the defaults)
+ *
+ * @return the convergence report, or `NULL` on failure
+ *
+ * */
+KrylovResult* krylov_gmres(const KrylovOp* op, const long double* b,
+        long double* x, const KrylovOpts* opts)
+{
+    KrylovOpts defaults = krylov_default_opts();
+
+    opts = opts == NULL ? &defaults : opts;
+
+    KrylovResult* result = krylov_start(op, b, x, opts);
+
+    if(result == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    unsigned int n = op->n;
+    unsigned int m = opts->restart > 0 ? opts->restart : GMRES_RESTART;
+
+    m = m > n ? n : m;
+
+    /* Krylov basis, then Hessenberg matrix, rotations and reduced RHS */
+    size_t len = ((size_t)m + 1) * n + (size_t)2 * n +
+        ((size_t)m + 1) * m + (size_t)4 * (m + 1);
+    long double* work = gaisan_calloc(len, sizeof(long double));
+
+    if(work == NULL) /* allocation check */
+    {
+        krylov_result_free(result);
+        return NULL;
+    }
+
+    long double* basis = work;
+    long double* w = basis + ((size_t)m + 1) * n;
+    long double* z = w + n;
+    long double* h = z + n; /* (m + 1) x m, row-major */
+    long double* cs = h + ((size_t)m + 1) * m;
+    long double* sn = cs + m + 1;
+    long double* g = sn + m + 1;
+    long double* y = g + m + 1;
+    long double b_norm = krylov_norm(n, b);
+
+    if(b_norm == 0.0) /* trivial case */
+    {
+        memset(x, 0, n * sizeof(long double));
+        result->converged = krylov_record(result, 0.0);
+        gaisan_free(work);
+        return result;
+    }
+
+    krylov_residual(op, b, x, basis);
+
+    long double beta = krylov_norm(n, basis);
+    bool ok = krylov_record(result, beta / b_norm);
+
+    while(ok && beta / b_norm > opts->tol &&
+            result->iterations < opts->max_iter)
+    {
+        unsigned int k = 0;
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            basis[i] /= beta;
+        }
+
+        memset(g, 0, ((size_t)m + 1) * sizeof(long double));
+        g[0] = beta;
+
+        /* Arnoldi process with modified Gram-Schmidt */
+        while(k < m && result->iterations < opts->max_iter)
+        {
+            long double* v_next = basis + ((size_t)k + 1) * n;
+
+            krylov_precondition(opts->precond, n, basis + (size_t)k * n, z);
+            krylov_op_apply(op, z, w);
+
+            for(unsigned int i=0;i<=k;i++)
+            {
+                long double h_ik = krylov_dot(n, w, basis + (size_t)i * n);
+
+                h[(size_t)i * m + k] = h_ik;
+
+                for(unsigned int j=0;j<n;j++)
+                {
+                    w[j] -= h_ik * basis[(size_t)i * n + j];
+                }
+            }
+
+            long double h_next = krylov_norm(n, w);
+
+            for(unsigned int j=0;j<n;j++)
+            {
+                v_next[j] = h_next == 0.0 ? 0.0 : w[j] / h_next;
+            }
+
+            /* reduce column k to upper triangular with Givens rotations */
+            for(unsigned int i=0;i<k;i++)
+            {
+                long double h_i = h[(size_t)i * m + k];
+                long double h_j = h[((size_t)i + 1) * m + k];
+
+                h[(size_t)i * m + k] = cs[i] * h_i + sn[i] * h_j;
+                h[((size_t)i + 1) * m + k] = -sn[i] * h_i + cs[i] * h_j;
+            }
+
+            long double h_kk = h[(size_t)k * m + k];
+            long double rad = hypotl(h_kk, h_next);
+
+            cs[k] = rad == 0.0 ? 1.0 : h_kk / rad;
+            sn[k] = rad == 0.0 ? 0.0 : h_next / rad;
+            h[(size_t)k * m + k] = rad;
+            g[k + 1] = -sn[k] * g[k];
+            g[k] = cs[k] * g[k];
+
+            k++;
+            result->iterations++;
+
+            if(!(ok = krylov_record(result, fabsl(g[k]) / b_norm)))
+            {
+                break;
+            }
+
+            if(fabsl(g[k]) / b_norm <= opts->tol || h_next == 0.0)
+            {
+                break; /* converged, or the Krylov space is invariant */
+            }
+        }
+
+        /* solve the triangular system H y = g and update x */
+        for(unsigned int i=k;i-->0;)
+        {
+            long double sum = g[i];
+
+            for(unsigned int j=i + 1;j<k;j++)
+            {
+                sum -= h[(size_t)i * m + j] * y[j];
+            }
+
+            y[i] = h[(size_t)i * m + i] == 0.0 ? 0.0 :
+                sum / h[(size_t)i * m + i];
+        }
+
+        memset(w, 0, n * sizeof(long double));
+
+        for(unsigned int i=0;i<k;i++)
+        {
+            for(unsigned int j=0;j<n;j++)
+            {
+                w[j] += y[i] * basis[(size_t)i * n + j];
+            }
+        }
+
+        krylov_precondition(opts->precond, n, w, z);
+
+        for(unsigned int j=0;j<n;j++)
+        {
+            x[j] += z[j];
+        }
+
+        /* restart from the true residual */
+        krylov_residual(op, b, x, basis);
+        beta = krylov_norm(n, basis);
+
+        if(k == 0 || beta == 0.0)
+        {
+            break;
+        }
+    }
+
+    krylov_finish(result, op, b, x, w, b_norm);
+    result->converged = result->residual <= opts->tol;
+    gaisan_free(work);
+
+    return result;
+}
+
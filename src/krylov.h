@@ -0,0 +1,92 @@
+/**
+ * @file krylov.h
+ * @author Jack McPherson
+ *
+ * Declarations for preconditioned Krylov subspace solvers (CG, BiCGSTAB and
+ * restarted GMRES) acting on dense or sparse operators.
+ *
+ * */
+#ifndef KRYLOV_H_
+#define KRYLOV_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "matrix.h"
+#include "sparse.h"
+
+/**
+ * A square linear operator: exactly one of `dense` and `sparse` is set
+ *
+ * */
+typedef struct
+{
+    unsigned int n;
+    Matrix* dense;
+    SparseMatrix* sparse;
+} KrylovOp;
+
+typedef enum
+{
+    PRECOND_NONE,
+    PRECOND_JACOBI, /* inverse of the diagonal */
+    PRECOND_ILU0, /* incomplete LU with no fill */
+    PRECOND_IC0 /* incomplete Cholesky with no fill (SPD operators only) */
+} PrecondType;
+
+/**
+ * A preconditioner `M`, applied as `z = M^-1 r`
+ *
+ * For ILU(0), `factors` holds unit lower L and upper U in CSR form sharing
+ * the pattern of the operator, with `diag_pos[i]` the position of U's
+ * diagonal in row `i`. For IC(0), `factors` holds the lower triangle of L.
+ * `diag` holds the reciprocals of the relevant diagonal.
+ *
+ * */
+typedef struct
+{
+    PrecondType type;
+    unsigned int n;
+    long double* diag;
+    SparseMatrix* factors;
+    size_t* diag_pos;
+} Precond;
+
+typedef struct
+{
+    long double tol; /* stop once ||b - Ax|| <= tol * ||b|| */
+    unsigned int max_iter;
+    unsigned int restart; /* GMRES restart length */
+    const Precond* precond; /* NULL for no preconditioning */
+} KrylovOpts;
+
+typedef struct
+{
+    bool converged;
+    unsigned int iterations;
+    long double residual; /* final relative residual ||b - Ax|| / ||b|| */
+    long double* history; /* relative residual after 0, 1, ... iterations */
+    unsigned int history_len;
+} KrylovResult;
+
+KrylovOp krylov_op_dense(Matrix* A);
+KrylovOp krylov_op_sparse(SparseMatrix* A);
+void krylov_op_apply(const KrylovOp* op, const long double* x, long double* y);
+
+Precond* precond_init(const KrylovOp* op, PrecondType type);
+void precond_free(Precond* precond);
+void precond_apply(const Precond* precond, const long double* r,
+        long double* z);
+
+KrylovOpts krylov_default_opts(void);
+void krylov_result_free(KrylovResult* result);
+
+KrylovResult* krylov_cg(const KrylovOp* op, const long double* b,
+        long double* x, const KrylovOpts* opts);
+KrylovResult* krylov_bicgstab(const KrylovOp* op, const long double* b,
+        long double* x, const KrylovOpts* opts);
+KrylovResult* krylov_gmres(const KrylovOp* op, const long double* b,
+        long double* x, const KrylovOpts* opts);
+
+#endif /* KRYLOV_H_ */
+
@@ -1,8 +1,100 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "lu.h"
+#include "chol.h"
+#include "qr.h"
 #include "lin.h"
 
+/**
+ * Frees the cached factorisation of `linsys` and any updates applied to it
+ *
+ * */
+static void linsys_discard(LinSys* linsys)
+{
+    lu_free(linsys->lu);
+    chol_free(linsys->chol);
+    qr_free(linsys->qr);
+    matrix_free(linsys->U);
+    matrix_free(linsys->V);
+    matrix_free(linsys->Z);
+    lu_free(linsys->cap);
+
+    linsys->lu = NULL;
+    linsys->chol = NULL;
+    linsys->qr = NULL;
+    linsys->U = NULL;
+    linsys->V = NULL;
+    linsys->Z = NULL;
+    linsys->cap = NULL;
+}
+
+/**
+ * Factorises `A` if it has changed since it was last factorised
+ *
+ * @return true if a factorisation is available, false otherwise (e.g. for an
+ *      underdetermined system)
+ *
+ * */
+static bool linsys_factorise(LinSys* linsys)
+{
+    if(!linsys->stale)
+    {
+        return linsys->lu != NULL || linsys->chol != NULL ||
+            linsys->qr != NULL;
+    }
+
+    linsys_discard(linsys);
+    linsys->stale = false;
+
+    if(linsys_overdetermined(linsys)) /* least squares */
+    {
+        linsys->qr = qr_factor(linsys->A);
+        return linsys->qr != NULL;
+    }
+
+    if(linsys_underdetermined(linsys))
+    {
+        return false;
+    }
+
+    if(linsys->spd) /* Cholesky, falling back to LU if A is not SPD */
+    {
+        linsys->chol = chol_factor(linsys->A);
+
+        if(linsys->chol != NULL)
+        {
+            return true;
+        }
+    }
+
+    linsys->lu = lu_factor(linsys->A);
+
+    return linsys->lu != NULL;
+}
+
+/**
+ * Solves with the cached factorisation alone, ignoring pending updates
+ *
+ * */
+static Matrix* linsys_base_solve(LinSys* linsys, Matrix* b)
+{
+    if(linsys->qr != NULL)
+    {
+        return qr_solve(linsys->qr, b);
+    }
+
+    if(linsys->chol != NULL)
+    {
+        return chol_solve(linsys->chol, b);
+    }
+
+    return lu_solve(linsys->lu, b);
+}
+
 LinSys* linsys_init(Matrix* A, Matrix* b)
 {
     if(A == NULL || b == NULL)
@@ -10,12 +102,12 @@ LinSys* linsys_init(Matrix* A, Matrix* b)
         return NULL;
     }
 
-    if(A->rows != b->rows || b->cols != 1) /* bounds check */
+    if(A->rows != b->rows) /* bounds check */
     {
         return NULL;
     }
 
-    LinSys* sys = calloc(1, sizeof(LinSys));
+    LinSys* sys = gaisan_calloc(1, sizeof(LinSys));
 
     if(sys == NULL) /* allocation check */
     {
@@ -26,6 +118,7 @@ LinSys* linsys_init(Matrix* A, Matrix* b)
 
     if(sys->A == NULL) /* check for failure */
     {
+        gaisan_free(sys);
         return NULL;
     }
 
@@ -33,14 +126,14 @@ LinSys* linsys_init(Matrix* A, Matrix* b)
 
     if(sys->b == NULL) /* check for failure */
     {
-        free(sys->A);
+        matrix_free(sys->A);
+        gaisan_free(sys);
         return NULL;
     }
 
-    /* assign fields */
-    sys->A = A;
-    sys->b = b;
     sys->x = NULL;
+    sys->spd = false;
+    sys->stale = true; /* factorised by the first solve */
 
     return sys;
 }
@@ -52,10 +145,241 @@ void linsys_free(LinSys* linsys)
         return;
     }
 
-    free(linsys->A);
-    free(linsys->b);
-    free(linsys->x);
-    free(linsys);
+    linsys_discard(linsys);
+    matrix_free(linsys->A);
+    matrix_free(linsys->b);
+    matrix_free(linsys->x);
+    gaisan_free(linsys);
+}
+
+void linsys_set_spd(LinSys* linsys, bool spd)
+{
+    if(linsys == NULL) /* null guard */
+    {
+        return;
+    }
+
+    if(linsys->spd != spd) /* changes which factorisation is used */
+    {
+        linsys->stale = true;
+    }
+
+    linsys->spd = spd;
+}
+
+/**
+ * Replaces the matrix of `linsys` with a copy of `A`; it is refactorised by
+ *      the next solve
+ *
+ * @param linsys
+ *      the system
+ * @param A
+ *      the new matrix (with as many rows as `b`)
+ *
+ * @return true on success, false on failure
+ *
+ * */
+bool linsys_set_matrix(LinSys* linsys, Matrix* A)
+{
+    if(linsys == NULL || A == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(A->rows != linsys->b->rows) /* bounds check */
+    {
+        return false;
+    }
+
+    Matrix* copy = matrix_copy(A);
+
+    if(copy == NULL) /* check for failure */
+    {
+        return false;
+    }
+
+    matrix_free(linsys->A);
+    linsys->A = copy;
+    linsys->stale = true;
+
+    return true;
+}
+
+/**
+ * Replaces the right-hand side(s) of `linsys` with a copy of `b`, keeping
+ *      the factorisation of `A`
+ *
+ * @param linsys
+ *      the system
+ * @param b
+ *      the new right-hand side(s), one per column
+ *
+ * @return true on success, false on failure
+ *
+ * */
+bool linsys_set_rhs(LinSys* linsys, Matrix* b)
+{
+    if(linsys == NULL || b == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(b->rows != linsys->A->rows) /* bounds check */
+    {
+        return false;
+    }
+
+    Matrix* copy = matrix_copy(b);
+
+    if(copy == NULL) /* check for failure */
+    {
+        return false;
+    }
+
+    matrix_free(linsys->b);
+    linsys->b = copy;
+
+    return true;
+}
+
+/**
+ * Marks the factorisation of `linsys` as out of date, after `A` has been
+ *      modified in place; it is rebuilt by the next solve
+ *
+ * @param linsys
+ *      the system
+ *
+ * */
+void linsys_invalidate(LinSys* linsys)
+{
+    if(linsys == NULL) /* null guard */
+    {
+        return;
+    }
+
+    linsys->stale = true;
+}
+
+/**
+ * Applies the low-rank change `A += U * V^T` to `linsys`
+ *
+ * A factorisation that has already been built is kept, so that subsequent
+ *      solves cost O(n^2) rather than O(n^3). For a Cholesky factorisation
+ *      and `U == V` (so `A` stays symmetric positive definite) the factor is
+ *      updated directly. Otherwise the change is absorbed by the
+ *      Sherman-Morrison-Woodbury formula, which costs O(n^2 k) per update
+ *      and O(nk) extra per solve, for `k` the total rank of the updates
+ *      since the last factorisation. Once `k` would exceed
+ *      `LINSYS_MAX_UPDATE_RANK`, `A` is refactorised by the next solve.
+ *
+ * @param linsys
+ *      the system, with `A` square
+ * @param U
+ *      `n` x `k`
+ * @param V
+ *      `n` x `k`
+ *
+ * @return true on success, false on failure
+ *
+ * */
+bool linsys_update(LinSys* linsys, Matrix* U, Matrix* V)
+{
+    if(linsys == NULL || U == NULL || V == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    unsigned int n = linsys->A->rows;
+    unsigned int k = U->cols;
+
+    /* bounds check */
+    if(linsys->A->cols != n || U->rows != n || V->rows != n || V->cols != k)
+    {
+        return false;
+    }
+
+    gemm(n, n, k, 1.0, U->data, U->stride, 1, V->data, 1, V->stride, 1.0,
+            linsys->A->data, linsys->A->stride, 1);
+
+    if(linsys->stale) /* factorised from the new A when next needed */
+    {
+        return true;
+    }
+
+    if(linsys->chol != NULL && linsys->U == NULL && U == V &&
+            chol_rank_update(linsys->chol, U))
+    {
+        return true;
+    }
+
+    unsigned int rank = k + (linsys->U != NULL ? linsys->U->cols : 0);
+
+    if((linsys->lu == NULL && linsys->chol == NULL) ||
+            rank > LINSYS_MAX_UPDATE_RANK)
+    {
+        linsys->stale = true;
+        return true;
+    }
+
+    /* Sherman-Morrison-Woodbury: append U, V and A_0^-1 * U */
+    Matrix* Z = linsys_base_solve(linsys, U);
+    Matrix* U_all = NULL;
+    Matrix* V_all = NULL;
+    Matrix* Z_all = NULL;
+
+    if(linsys->U == NULL)
+    {
+        U_all = matrix_copy(U);
+        V_all = matrix_copy(V);
+        Z_all = Z;
+        Z = NULL;
+    }
+    else
+    {
+        U_all = matrix_right_augment(linsys->U, U);
+        V_all = matrix_right_augment(linsys->V, V);
+        Z_all = Z != NULL ? matrix_right_augment(linsys->Z, Z) : NULL;
+    }
+
+    matrix_free(Z);
+
+    /* capacitance matrix I + V^T * A_0^-1 * U */
+    Matrix* C = matrix_identity(rank);
+
+    if(C != NULL && V_all != NULL && Z_all != NULL)
+    {
+        gemm(rank, rank, n, 1.0, V_all->data, 1, V_all->stride,
+                Z_all->data, Z_all->stride, 1, 1.0, C->data, C->stride, 1);
+    }
+
+    LU* cap = C != NULL && V_all != NULL && Z_all != NULL ? lu_factor(C) :
+        NULL;
+
+    matrix_free(C);
+
+    /* failure, or A_0 + U * V^T too close to singular to update */
+    if(U_all == NULL || cap == NULL || cap->singular)
+    {
+        matrix_free(U_all);
+        matrix_free(V_all);
+        matrix_free(Z_all);
+        lu_free(cap);
+
+        linsys->stale = true;
+        return true;
+    }
+
+    matrix_free(linsys->U);
+    matrix_free(linsys->V);
+    matrix_free(linsys->Z);
+    lu_free(linsys->cap);
+
+    linsys->U = U_all;
+    linsys->V = V_all;
+    linsys->Z = Z_all;
+    linsys->cap = cap;
+
+    return true;
 }
 
 void linsys_solve(LinSys* linsys)
@@ -65,7 +389,86 @@ void linsys_solve(LinSys* linsys)
         return;
     }
 
-    linsys->x = matrix_gauss_elim(linsys->A, linsys->b);
+    matrix_free(linsys->x); /* never leave a stale solution behind */
+    linsys->x = NULL;
+
+    if(!linsys_factorise(linsys)) /* check for failure */
+    {
+        return;
+    }
+
+    linsys->x = linsys_solve_rhs(linsys, linsys->b);
+}
+
+/**
+ * Solves `A * x = b` for the given right-hand side(s), reusing (or building)
+ *      the cached factorisation of `A`; `linsys->b` and `linsys->x` are left
+ *      untouched
+ *
+ * @param linsys
+ *      the system
+ * @param b
+ *      the right-hand side(s), one per column; solving many at once is
+ *          cheaper than solving them one by one
+ *
+ * @return the solution `x` (the least-squares solution if the system is
+ *      overdetermined), or `NULL` on failure
+ *
+ * */
+Matrix* linsys_solve_rhs(LinSys* linsys, Matrix* b)
+{
+    if(linsys == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(b->rows != linsys->A->rows) /* bounds check */
+    {
+        return NULL;
+    }
+
+    if(!linsys_factorise(linsys)) /* check for failure */
+    {
+        return NULL;
+    }
+
+    Matrix* x = linsys_base_solve(linsys, b);
+
+    if(x == NULL || linsys->U == NULL)
+    {
+        return x;
+    }
+
+    /* Woodbury: x = y - Z * (I + V^T * Z)^-1 * V^T * y, y = A_0^-1 * b */
+    unsigned int n = linsys->A->rows;
+    unsigned int k = linsys->U->cols;
+    Matrix* w = matrix_init(k, b->cols);
+
+    if(w == NULL) /* allocation check */
+    {
+        matrix_free(x);
+        return NULL;
+    }
+
+    gemm(k, b->cols, n, 1.0, linsys->V->data, 1, linsys->V->stride,
+            x->data, x->stride, 1, 0.0, w->data, w->stride, 1);
+
+    Matrix* t = lu_solve(linsys->cap, w);
+
+    matrix_free(w);
+
+    if(t == NULL) /* check for failure */
+    {
+        matrix_free(x);
+        return NULL;
+    }
+
+    gemm(n, b->cols, k, -1.0, linsys->Z->data, linsys->Z->stride, 1,
+            t->data, t->stride, 1, 1.0, x->data, x->stride, 1);
+
+    matrix_free(t);
+
+    return x;
 }
 
 bool linsys_underdetermined(LinSys* linsys)
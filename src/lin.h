@@ -4,21 +4,52 @@
 #include <stdbool.h>
 
 #include "matrix.h"
-
+#include "lu.h"
+#include "chol.h"
+#include "qr.h"
+
+/**
+ * A linear system `A * x = b`, with the factorisation of `A` cached between
+ * solves
+ *
+ * The factorisation is built by the first solve and reused until `A`
+ * changes. Low-rank changes made through `linsys_update` are absorbed
+ * without refactorising: either directly into a Cholesky factor, or by
+ * Sherman-Morrison-Woodbury, in which case the cached factorisation is of
+ * `A_0` and `A = A_0 + U * V^T`.
+ *
+ * */
 typedef struct
 {
     Matrix* A;
     Matrix* b;
     Matrix* x;
+    bool spd; /* A is symmetric positive definite */
+
+    bool stale; /* A has changed since it was last factorised */
+    LU* lu;
+    Cholesky* chol;
+    QR* qr; /* overdetermined systems only */
+
+    Matrix* U; /* accumulated updates (n x k), NULL if there are none */
+    Matrix* V;
+    Matrix* Z; /* A_0^-1 * U */
+    LU* cap; /* LU of the capacitance matrix I + V^T * Z */
 } LinSys;
 
 LinSys* linsys_init(Matrix* A, Matrix* b);
 void linsys_free(LinSys* linsys);
 
+void linsys_set_spd(LinSys* linsys, bool spd);
+bool linsys_set_matrix(LinSys* linsys, Matrix* A);
+bool linsys_set_rhs(LinSys* linsys, Matrix* b);
+void linsys_invalidate(LinSys* linsys);
+bool linsys_update(LinSys* linsys, Matrix* U, Matrix* V);
+
 void linsys_solve(LinSys* linsys);
+Matrix* linsys_solve_rhs(LinSys* linsys, Matrix* b);
 
 bool linsys_underdetermined(LinSys* linsys);
 bool linsys_overdetermined(LinSys* linsys);
 
 #endif /* LIN_H_ */
-
@@ -0,0 +1,354 @@
+/**
+ * @file lu.c
+ * @author Jack McPherson
+ *
+ * Implements a blocked, right-looking LU factorisation with partial pivoting
+ * and the solves, determinants and inverses derived from it.
+ *
+ * Each panel of `LU_BLOCK_SIZE` columns is factorised column by column; the
+ * matching block row of U is then obtained with a triangular solve and the
+ * trailing submatrix is updated with a single GEMM, so the bulk of the work
+ * runs in the level-3 kernels. Row interchanges are recorded in a
+ * permutation vector and applied to right-hand sides as they are gathered,
+ * so no rows of `b` are ever swapped.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "view.h"
+#include "lu.h"
+
+/**
+ * Factorises the panel of columns `[j0, j0 + nb)` of the `n` x `n` matrix
+ *      at `a` (rows `j0` onwards), swapping whole rows as pivots are chosen
+ *
+ * */
+static void lu_panel(unsigned int n, unsigned int j0, unsigned int nb,
+        long double* a, unsigned int lda, LU* lu)
+{
+    for(unsigned int j=j0;j<j0+nb;j++)
+    {
+        /* partial pivoting: largest magnitude in column j */
+        unsigned int p = j;
+        long double max_val = fabsl(a[(size_t)j * lda + j]);
+
+        for(unsigned int i=j+1;i<n;i++)
+        {
+            if(fabsl(a[(size_t)i * lda + j]) > max_val)
+            {
+                max_val = fabsl(a[(size_t)i * lda + j]);
+                p = i;
+            }
+        }
+
+        if(p != j)
+        {
+            long double* row_j = a + (size_t)j * lda;
+            long double* row_p = a + (size_t)p * lda;
+            long double tmp = 0.0;
+
+            for(unsigned int l=0;l<n;l++)
+            {
+                tmp = row_j[l];
+                row_j[l] = row_p[l];
+                row_p[l] = tmp;
+            }
+
+            unsigned int tmp_perm = lu->perm[j];
+            lu->perm[j] = lu->perm[p];
+            lu->perm[p] = tmp_perm;
+            lu->sign = -lu->sign;
+        }
+
+        const long double pivot = a[(size_t)j * lda + j];
+
+        if(pivot == 0.0) /* column already eliminated */
+        {
+            lu->singular = true;
+            continue;
+        }
+
+        /* multipliers, then rank-1 update of the rest of the panel */
+        const long double* row_j = a + (size_t)j * lda;
+
+        for(unsigned int i=j+1;i<n;i++)
+        {
+            long double* row_i = a + (size_t)i * lda;
+            const long double l_ij = row_i[j] / pivot;
+
+            row_i[j] = l_ij;
+
+            for(unsigned int l=j+1;l<j0+nb;l++)
+            {
+                row_i[l] -= l_ij * row_j[l];
+            }
+        }
+    }
+}
+
+/**
+ * Computes the LU factorisation (with partial pivoting) of the square
+ *      matrix `A`
+ *
+ * A singular `A` still yields a factorisation, with `singular` set; it may
+ *      be used for determinants but not for solves.
+ *
+ * @param A
+ *      the matrix to factorise (not modified)
+ *
+ * @return the factorisation, or `NULL` on failure
+ *
+ * */
+LU* lu_factor(Matrix* A)
+{
+    return lu_factor_view(matrix_view(A));
+}
+
+/**
+ * Computes the LU factorisation (with partial pivoting) of the square
+ *      matrix viewed by `A`
+ *
+ * @param A
+ *      view of the matrix to factorise (not modified)
+ *
+ * @return the factorisation, or `NULL` on failure
+ *
+ * */
+LU* lu_factor_view(MatrixView A)
+{
+    if(A.data == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(A.rows != A.cols) /* bounds check */
+    {
+        return NULL;
+    }
+
+    LU* lu = gaisan_calloc(1, sizeof(LU));
+
+    if(lu == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    unsigned int n = A.rows;
+
+    lu->factors = matrix_init(n, n);
+    lu->perm = gaisan_calloc(n, sizeof(unsigned int));
+
+    if(lu->factors == NULL || lu->perm == NULL) /* check for failure */
+    {
+        lu_free(lu);
+        return NULL;
+    }
+
+    view_copy(matrix_view(lu->factors), A);
+
+    lu->sign = 1;
+    lu->singular = false;
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        lu->perm[i] = i;
+    }
+
+    long double* a = lu->factors->data;
+    unsigned int lda = lu->factors->stride;
+
+    for(unsigned int j=0;j<n;j+=LU_BLOCK_SIZE)
+    {
+        unsigned int nb = n - j < LU_BLOCK_SIZE ? n - j : LU_BLOCK_SIZE;
+        unsigned int rest = n - j - nb;
+
+        lu_panel(n, j, nb, a, lda, lu);
+
+        if(rest == 0)
+        {
+            continue;
+        }
+
+        /* U12 = L11^-1 * A12 */
+        trsm_lower(true, nb, rest, a + (size_t)j * lda + j, lda, 1,
+                a + (size_t)j * lda + j + nb, lda);
+
+        /* A22 -= L21 * U12 */
+        gemm(rest, rest, nb, -1.0, a + (size_t)(j + nb) * lda + j, lda, 1,
+                a + (size_t)j * lda + j + nb, lda, 1, 1.0,
+                a + (size_t)(j + nb) * lda + j + nb, lda, 1);
+    }
+
+    return lu;
+}
+
+/**
+ * Frees memory consumed by `lu`
+ *
+ * @param lu
+ *      the factorisation to be free'd
+ *
+ * */
+void lu_free(LU* lu)
+{
+    if(lu == NULL) /* null guard */
+    {
+        return;
+    }
+
+    matrix_free(lu->factors);
+    gaisan_free(lu->perm);
+    gaisan_free(lu);
+}
+
+/**
+ * Solves `A * x = b` using the factorisation `lu` of `A`, storing the result
+ *      in `x`
+ *
+ * Each column of `b` is a separate right-hand side and costs O(n^2).
+ *
+ * @param lu
+ *      the factorisation of `A`
+ * @param x
+ *      the matrix receiving the solution (same shape as `b`, and not sharing
+ *          storage with it)
+ * @param b
+ *      the right-hand side(s)
+ *
+ * @return `x`, or `NULL` on failure (including when `A` is singular)
+ *
+ * */
+Matrix* lu_solve_into(LU* lu, Matrix* x, Matrix* b)
+{
+    if(lu == NULL || x == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    unsigned int n = lu->factors->rows;
+
+    /* bounds check */
+    if(b->rows != n || x->rows != n || x->cols != b->cols)
+    {
+        return NULL;
+    }
+
+    if(lu->singular || x->data == b->data)
+    {
+        return NULL;
+    }
+
+    /* gather P * b */
+    for(unsigned int i=0;i<n;i++)
+    {
+        const long double* src = b->data + (size_t)lu->perm[i] * b->stride;
+        long double* dst = x->data + (size_t)i * x->stride;
+
+        for(unsigned int l=0;l<b->cols;l++)
+        {
+            dst[l] = src[l];
+        }
+    }
+
+    /* L * y = P * b, then U * x = y */
+    trsm_lower(true, n, x->cols, lu->factors->data, lu->factors->stride, 1,
+            x->data, x->stride);
+    trsm_upper(false, n, x->cols, lu->factors->data, lu->factors->stride, 1,
+            x->data, x->stride);
+
+    return x;
+}
+
+/**
+ * Solves `A * x = b` using the factorisation `lu` of `A`
+ *
+ * @param lu
+ *      the factorisation of `A`
+ * @param b
+ *      the right-hand side(s), one per column
+ *
+ * @return the solution `x`, or `NULL` on failure (including when `A` is
+ *      singular)
+ *
+ * */
+Matrix* lu_solve(LU* lu, Matrix* b)
+{
+    if(lu == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    Matrix* x = matrix_init(b->rows, b->cols);
+
+    if(lu_solve_into(lu, x, b) == NULL) /* check for failure */
+    {
+        matrix_free(x);
+        return NULL;
+    }
+
+    return x;
+}
+
+/**
+ * Returns the determinant of the factorised matrix
+ *
+ * @param lu
+ *      the factorisation of `A`
+ *
+ * @return the determinant of `A`, or `NAN` on failure
+ *
+ * */
+long double lu_det(LU* lu)
+{
+    if(lu == NULL) /* null guard */
+    {
+        return NAN;
+    }
+
+    long double det = lu->sign;
+
+    for(unsigned int i=0;i<lu->factors->rows;i++)
+    {
+        det *= lu->factors->data[(size_t)i * lu->factors->stride + i];
+    }
+
+    return det;
+}
+
+/**
+ * Returns the inverse of the factorised matrix
+ *
+ * @param lu
+ *      the factorisation of `A`
+ *
+ * @return the inverse of `A`, or `NULL` on failure (including when `A` is
+ *      singular)
+ *
+ * */
+Matrix* lu_inverse(LU* lu)
+{
+    if(lu == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    Matrix* I = matrix_identity(lu->factors->rows);
+
+    if(I == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    Matrix* inverse = lu_solve(lu, I);
+
+    matrix_free(I);
+
+    return inverse;
+}
+
@@ -0,0 +1,41 @@
+/**
+ * @file lu.h
+ * @author Jack McPherson
+ *
+ * Declarations for LU factorisation with partial pivoting.
+ *
+ * */
+#ifndef LU_H_
+#define LU_H_
+
+#include <stdbool.h>
+
+#include "matrix.h"
+#include "view.h"
+
+/**
+ * LU factorisation `P * A = L * U` of a square matrix `A`
+ *
+ * `factors` holds the strictly lower part of the unit lower triangular `L`
+ * and the upper triangular `U`. Row `i` of `P * A` is row `perm[i]` of `A`.
+ *
+ * */
+typedef struct
+{
+    Matrix* factors;
+    unsigned int* perm;
+    int sign; /* determinant of `P` (+1 or -1) */
+    bool singular;
+} LU;
+
+LU* lu_factor(Matrix* A);
+LU* lu_factor_view(MatrixView A);
+void lu_free(LU* lu);
+
+Matrix* lu_solve(LU* lu, Matrix* b);
+Matrix* lu_solve_into(LU* lu, Matrix* x, Matrix* b);
+long double lu_det(LU* lu);
+Matrix* lu_inverse(LU* lu);
+
+#endif /* LU_H_ */
+
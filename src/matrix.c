@@ -5,19 +5,115 @@
  * Implements methods for manipulating matrices (and, by extension, vectors).
  *
  * */
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <stdbool.h>
 #include <math.h>
 #include <time.h>
 #include <string.h>
 #include <limits.h>
+#include <sys/mman.h>
 
 #include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "thread.h"
 #include "matrix.h"
+#include "lu.h"
+
+/**
+ * Returns the row stride (in cells) used for a matrix with `cols` columns,
+ *      i.e. `cols` rounded up to a whole number of `MATRIX_ALIGNMENT` blocks
+ *
+ * @param cols
+ *      number of columns in the matrix
+ *
+ * @return the padded row stride
+ *
+ * */
+static unsigned int matrix_padded_stride(unsigned int cols)
+{
+    unsigned int align = MATRIX_ALIGNMENT / sizeof(long double);
+
+    if(align == 0)
+    {
+        align = 1;
+    }
+
+    return ((cols + align - 1) / align) * align;
+}
+
+/**
+ * (Re)allocates the storage of `matrix` so that it holds `capacity` rows of
+ *      `stride` cells, preserving existing cells and zeroing all new ones
+ *
+ * @param matrix
+ *      the matrix whose storage is being (re)allocated
+ * @param capacity
+ *      number of rows to allocate
+ * @param stride
+ *      row stride (in cells) of the new storage
+ *
+ * @return true on success, false otherwise (`matrix` is left untouched)
+ *
+ * */
+static bool matrix_reserve(Matrix* matrix, unsigned int capacity,
+        unsigned int stride)
+{
+    if(matrix->mapping != NULL) /* mapped matrices are read-only */
+    {
+        return false;
+    }
+
+    size_t bytes = (size_t)capacity * stride * sizeof(long double);
+
+    long double* data = gaisan_aligned_alloc(MATRIX_ALIGNMENT, bytes);
+
+    if(data == NULL) /* allocation check */
+    {
+        return false;
+    }
+
+    long double** cells = gaisan_calloc(capacity, sizeof(long double*));
+
+    if(cells == NULL) /* allocation check */
+    {
+        gaisan_free(data);
+        return false;
+    }
+
+    memset(data, 0, bytes);
+
+    /* carry existing rows across */
+    for(unsigned int i=0;i<matrix->rows;i++)
+    {
+        memcpy(data + (size_t)i * stride,
+                matrix->data + (size_t)i * matrix->stride,
+                matrix->cols * sizeof(long double));
+    }
+
+    for(unsigned int i=0;i<capacity;i++)
+    {
+        cells[i] = data + (size_t)i * stride;
+    }
+
+    gaisan_free(matrix->data);
+    gaisan_free(matrix->cells);
+
+    matrix->data = data;
+    matrix->cells = cells;
+    matrix->stride = stride;
+    matrix->capacity = capacity;
+
+    return true;
+}
 
 /**
  * Initialises a matrix with `rows` rows and `cols` columns (zero-initialised)
  *
+ * All cells are held in a single aligned, contiguous buffer.
+ *
  * @param rows
  *      number of rows in the matrix
  * @param cols
@@ -32,34 +128,21 @@ Matrix* matrix_init(unsigned int rows, unsigned int cols)
         return NULL;
     }
 
-    Matrix* matrix = calloc(1, sizeof(Matrix));
+    Matrix* matrix = gaisan_calloc(1, sizeof(Matrix));
 
     if(matrix == NULL) /* allocation check */
     {
         return NULL;
     }
 
-    matrix->rows = rows;
-    matrix->cols = cols;
-
-    matrix->cells = calloc(rows, sizeof(long double*));
-
-    if(matrix->cells == NULL) /* allocation check */
+    if(!matrix_reserve(matrix, rows, matrix_padded_stride(cols)))
     {
+        gaisan_free(matrix);
         return NULL;
     }
 
-    /* allocate columns */
-    for(unsigned int i=0;i<rows;i++)
-    {
-        matrix->cells[i] = calloc(cols, sizeof(long double));
-
-        if(matrix->cells[i] == NULL) /* allocation check */
-        {
-            free(matrix->cells);
-            return NULL;
-        }
-    }
+    matrix->rows = rows;
+    matrix->cols = cols;
 
     return matrix;
 }
@@ -77,17 +160,59 @@ void matrix_free(Matrix* matrix)
         return;
     }
 
-    /* free columns */
-    for(unsigned int i=0;i<matrix->rows;i++)
+    if(matrix->mapping != NULL) /* data belongs to a file mapping */
+    {
+        munmap(matrix->mapping, matrix->mapping_len);
+    }
+    else
     {
-        free(matrix->cells[i]);
+        gaisan_free(matrix->data);
     }
 
-    free(matrix->cells); /* free rows */
+    gaisan_free(matrix->cells);
     matrix->rows = 0;
     matrix->cols = 0;
 
-    free(matrix);
+    gaisan_free(matrix);
+}
+
+/**
+ * Fills `scratch` with a copy of `matrix` whose storage is drawn from
+ *      `arena`
+ *
+ * The copy must not be passed to `matrix_free` or resized; it lives until
+ *      the arena is released.
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+static bool matrix_scratch_copy(GaisanArena* arena, Matrix* matrix,
+        Matrix* scratch)
+{
+    size_t bytes = (size_t)matrix->rows * matrix->stride * sizeof(long double);
+
+    scratch->rows = matrix->rows;
+    scratch->cols = matrix->cols;
+    scratch->stride = matrix->stride;
+    scratch->capacity = matrix->rows;
+    scratch->mapping = NULL;
+    scratch->mapping_len = 0;
+    scratch->data = arena_alloc(arena, bytes);
+    scratch->cells = arena_alloc(arena, matrix->rows * sizeof(long double*));
+
+    if(scratch->data == NULL || scratch->cells == NULL) /* check for failure */
+    {
+        return false;
+    }
+
+    memcpy(scratch->data, matrix->data, bytes);
+
+    for(unsigned int i=0;i<matrix->rows;i++)
+    {
+        scratch->cells[i] = scratch->data + (size_t)i * matrix->stride;
+    }
+
+    return true;
 }
 
 /**
@@ -118,13 +243,12 @@ Matrix* matrix_copy(Matrix* matrix)
         return NULL;
     }
 
-    /* traverse matrix, copying elementwise */
+    /* copy row by row (strides may differ) */
     for(unsigned int i=0;i<matrix->rows;i++)
     {
-        for(unsigned int j=0;j<matrix->cols;j++)
-        {
-            res->cells[i][j] = matrix->cells[i][j];
-        }
+        memcpy(res->data + (size_t)i * res->stride,
+                matrix->data + (size_t)i * matrix->stride,
+                matrix->cols * sizeof(long double));
     }
 
     return res;
@@ -151,26 +275,21 @@ void matrix_swap_rows(unsigned int a, unsigned int b, Matrix* matrix)
     }
 
     /* bounds check */
-    if(a > matrix->rows || b > matrix->rows || a == b)
+    if(a >= matrix->rows || b >= matrix->rows || a == b)
     {
         return;
     }
 
-    long double* tmp = calloc(matrix->cols, sizeof(long double));
-
-    if(tmp == NULL)
-    {
-        return;
-    }
+    long double* row_a = matrix->data + (size_t)a * matrix->stride;
+    long double* row_b = matrix->data + (size_t)b * matrix->stride;
+    long double tmp = 0.0;
 
     for(unsigned int i=0;i<matrix->cols;i++)
     {
-        tmp[i] = matrix->cells[a][i];
-        matrix->cells[a][i] = matrix->cells[b][i];
-        matrix->cells[b][i] = tmp[i];
+        tmp = row_a[i];
+        row_a[i] = row_b[i];
+        row_b[i] = tmp;
     }
-
-    free(tmp);
 }
 
 /**
@@ -191,17 +310,18 @@ void matrix_scale_row(unsigned int a, long double k, Matrix* matrix)
         return;
     }
 
-    if(a > matrix->rows) /* bounds check */
+    if(a >= matrix->rows) /* bounds check */
     {
         return;
     }
 
     long double factor = k == 0.0 ? 1.0 : k;
+    long double* row = matrix->data + (size_t)a * matrix->stride;
 
     /* iteratively scale each row */
     for(unsigned int i=0;i<matrix->cols;i++)
     {
-        matrix->cells[a][i] *= factor;
+        row[i] *= factor;
     }
 }
 
@@ -227,20 +347,31 @@ void matrix_add_row(unsigned int a, unsigned int b, long double k,
     }
 
     /* bounds check */
-    if(a > matrix->rows || b > matrix->rows || a == b)
+    if(a >= matrix->rows || b >= matrix->rows || a == b)
     {
         return;
     }
 
     long double factor = k == 0.0 ? 1.0 : k;
+    long double* row_a = matrix->data + (size_t)a * matrix->stride;
+    const long double* row_b = matrix->data + (size_t)b * matrix->stride;
 
     /* iteratively add to each row */
     for(unsigned int i=0;i<matrix->cols;i++)
     {
-        matrix->cells[a][i] += factor * matrix->cells[b][i];
+        row_a[i] += factor * row_b[i];
     }
 }
 
+/**
+ * Appends a (zeroed) row to the bottom of `matrix`
+ *
+ * Storage grows geometrically, so repeated appends are amortised O(cols).
+ *
+ * @param matrix
+ *      the matrix being extended
+ *
+ * */
 void matrix_append_row(Matrix* matrix)
 {
     if(matrix == NULL) /* null guard */
@@ -248,12 +379,29 @@ void matrix_append_row(Matrix* matrix)
         return;
     }
 
-    matrix->cells = realloc(matrix->cells,
-            (matrix->rows + 1) * sizeof(long double*));
-    matrix->cells[matrix->rows] = calloc(matrix->cols, sizeof(long double));
+    if(matrix->rows == matrix->capacity) /* out of rows, expand */
+    {
+        if(!matrix_reserve(matrix, matrix->capacity * BUF_EXPAND_FACTOR,
+                    matrix->stride))
+        {
+            return;
+        }
+    }
+
+    memset(matrix->cells[matrix->rows], 0,
+            matrix->stride * sizeof(long double));
     matrix->rows++;
 }
 
+/**
+ * Appends a (zeroed) column to the right of `matrix`
+ *
+ * Row stride grows geometrically, so repeated appends are amortised O(rows).
+ *
+ * @param matrix
+ *      the matrix being extended
+ *
+ * */
 void matrix_append_col(Matrix* matrix)
 {
     if(matrix == NULL) /* null guard */
@@ -261,44 +409,117 @@ void matrix_append_col(Matrix* matrix)
         return;
     }
 
+    if(matrix->mapping != NULL) /* mapped matrices are read-only */
+    {
+        return;
+    }
+
+    if(matrix->cols == matrix->stride) /* out of columns, expand */
+    {
+        if(!matrix_reserve(matrix, matrix->capacity,
+                    matrix_padded_stride(matrix->cols * BUF_EXPAND_FACTOR)))
+        {
+            return;
+        }
+    }
+
     for(unsigned int i=0;i<matrix->rows;i++)
     {
-        matrix->cells[i] = realloc(matrix->cells[i],
-                (matrix->cols + 1) * sizeof(long double));
         matrix->cells[i][matrix->cols] = 0;
     }
 
     matrix->cols++;
 }
 
-void matrix_drop_row(Matrix* matrix)
+/**
+ * Removes the bottom row of `matrix` (storage is retained for reuse)
+ *
+ * @param matrix
+ *      the matrix being shrunk
+ *
+ * */
+void matrix_pop_row(Matrix* matrix)
 {
     if(matrix == NULL) /* null guard */
     {
         return;
     }
 
-    matrix->cells = realloc(matrix->cells,
-            (matrix->rows - 1) * sizeof(long double*));
+    if(matrix->rows == 0) /* bounds check */
+    {
+        return;
+    }
+
     matrix->rows--;
 }
 
-void matrix_drop_col(Matrix* matrix)
+/**
+ * Removes the rightmost column of `matrix` (storage is retained for reuse)
+ *
+ * @param matrix
+ *      the matrix being shrunk
+ *
+ * */
+void matrix_pop_col(Matrix* matrix)
 {
     if(matrix == NULL) /* null guard */
     {
         return;
     }
 
-    for(unsigned int i=0;i<matrix->rows;i++)
+    if(matrix->cols == 0) /* bounds check */
     {
-        matrix->cells[i] = realloc(matrix->cells[i],
-                (matrix->cols - 1) * sizeof(long double));
+        return;
     }
 
     matrix->cols--;
 }
 
+/**
+ * Adds two matrices, `a` and `b`, storing the result in `dst`
+ *
+ * `dst` may be the same matrix as `a` and/or `b`.
+ *
+ * @param dst
+ *      the matrix receiving the result (same shape as `a` and `b`)
+ * @param a
+ *      first matrix
+ * @param b
+ *      second matrix
+ *
+ * @return `dst`, or `NULL` on failure
+ *
+ * */
+Matrix* matrix_add_into(Matrix* dst, Matrix* a, Matrix* b)
+{
+    if(dst == NULL || a == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    /* bounds check */
+    if(a->rows != b->rows || a->cols != b->cols || dst->rows != a->rows ||
+            dst->cols != a->cols)
+    {
+        return NULL;
+    }
+
+    /* traverse both matrices, adding elementwise */
+    for(unsigned int i=0;i<a->rows;i++)
+    {
+        const long double* row_a = a->data + (size_t)i * a->stride;
+        const long double* row_b = b->data + (size_t)i * b->stride;
+        long double* row_dst = dst->data + (size_t)i * dst->stride;
+
+        for(unsigned int j=0;j<a->cols;j++)
+        {
+            row_dst[j] = row_a[j] + row_b[j];
+        }
+    }
+
+    return dst;
+}
+
 /**
  * Add two matrices, `a` and `b`
  *
@@ -317,28 +538,58 @@ Matrix* matrix_add(Matrix* a, Matrix* b)
         return NULL;
     }
 
-    if(a->rows != b->rows || a->cols != b->cols) /* bounds check */
+    Matrix* res = matrix_init(a->rows, a->cols);
+
+    if(matrix_add_into(res, a, b) == NULL) /* check for failure */
     {
+        matrix_free(res);
         return NULL;
     }
 
-    Matrix* res = matrix_init(a->rows, a->cols);
+    return res;
+}
 
-    if(res == NULL) /* check for failure */
+/**
+ * Multiplies `matrix` by a scalar `k`, storing the result in `dst`
+ *
+ * `dst` may be the same matrix as `matrix` (i.e. scaling in place).
+ *
+ * @param dst
+ *      the matrix receiving the result (same shape as `matrix`)
+ * @param k
+ *      scalar to multiply the matrix `matrix` by
+ * @param matrix
+ *      the matrix being scaled
+ *
+ * @return `dst`, or `NULL` on failure
+ *
+ * */
+Matrix* matrix_scale_into(Matrix* dst, long double k, Matrix* matrix)
+{
+    if(dst == NULL || matrix == NULL) /* null guard */
     {
         return NULL;
     }
 
-    /* traverse both matrices, adding elementwise */
-    for(unsigned int i=0;i<a->rows;i++)
+    /* bounds check */
+    if(dst->rows != matrix->rows || dst->cols != matrix->cols)
     {
-        for(unsigned int j=0;j<a->cols;j++)
+        return NULL;
+    }
+
+    /* traverse matrix, multiplying by scalar k */
+    for(unsigned int i=0;i<matrix->rows;i++)
+    {
+        const long double* row = matrix->data + (size_t)i * matrix->stride;
+        long double* row_dst = dst->data + (size_t)i * dst->stride;
+
+        for(unsigned int j=0;j<matrix->cols;j++)
         {
-            res->cells[i][j] = a->cells[i][j] + b->cells[i][j];
+            row_dst[j] = k * row[j];
         }
     }
 
-    return res;
+    return dst;
 }
 
 /**
@@ -361,21 +612,58 @@ Matrix* matrix_scale(long double k, Matrix* matrix)
 
     Matrix* res = matrix_init(matrix->rows, matrix->cols);
 
-    if(res == NULL) /* check for failure */
+    if(matrix_scale_into(res, k, matrix) == NULL) /* check for failure */
     {
+        matrix_free(res);
         return NULL;
     }
 
-    /* traverse matrix, multiplying by scalar k */
-    for(unsigned int i=0;i<matrix->rows;i++)
+    return res;
+}
+
+/**
+ * Subtracts the matrix `b` from `a`, storing the result in `dst`
+ *
+ * `dst` may be the same matrix as `a` and/or `b`.
+ *
+ * @param dst
+ *      the matrix receiving the result (same shape as `a` and `b`)
+ * @param a
+ *      the matrix being subtracted from
+ * @param b
+ *      the matrix subtracted from `a`
+ *
+ * @return `dst`, or `NULL` on failure
+ *
+ * */
+Matrix* matrix_subtract_into(Matrix* dst, Matrix* a, Matrix* b)
+{
+    if(dst == NULL || a == NULL || b == NULL) /* null guard */
     {
-        for(unsigned int j=0;j<matrix->cols;j++)
+        return NULL;
+    }
+
+    /* bounds check */
+    if(a->rows != b->rows || a->cols != b->cols || dst->rows != a->rows ||
+            dst->cols != a->cols)
+    {
+        return NULL;
+    }
+
+    /* traverse both matrices, subtracting elementwise */
+    for(unsigned int i=0;i<a->rows;i++)
+    {
+        const long double* row_a = a->data + (size_t)i * a->stride;
+        const long double* row_b = b->data + (size_t)i * b->stride;
+        long double* row_dst = dst->data + (size_t)i * dst->stride;
+
+        for(unsigned int j=0;j<a->cols;j++)
         {
-            res->cells[i][j] = k * matrix->cells[i][j];
+            row_dst[j] = row_a[j] - row_b[j];
         }
     }
 
-    return res;
+    return dst;
 }
 
 /**
@@ -396,66 +684,121 @@ Matrix* matrix_subtract(Matrix* a, Matrix* b)
         return NULL;
     }
 
-    Matrix* negated_b = matrix_scale(-1, b);
-    
-    if(negated_b == NULL) /* check for failure */
+    Matrix* res = matrix_init(a->rows, a->cols);
+
+    if(matrix_subtract_into(res, a, b) == NULL) /* check for failure */
     {
+        matrix_free(res);
         return NULL;
     }
 
-    Matrix* res = matrix_add(a, negated_b);
+    return res;
+}
 
-    free(negated_b);
+/**
+ * Adds `k` times the matrix `x` to the matrix `y` in place (i.e.
+ *      `y += k * x`)
+ *
+ * @param k
+ *      scalar that `x` is multiplied by
+ * @param x
+ *      the matrix being added
+ * @param y
+ *      the matrix being added to (same shape as `x`)
+ *
+ * @return `y`, or `NULL` on failure
+ *
+ * */
+Matrix* matrix_axpy(long double k, Matrix* x, Matrix* y)
+{
+    if(x == NULL || y == NULL) /* null guard */
+    {
+        return NULL;
+    }
 
-    return res;
+    if(x->rows != y->rows || x->cols != y->cols) /* bounds check */
+    {
+        return NULL;
+    }
+
+    for(unsigned int i=0;i<x->rows;i++)
+    {
+        const long double* row_x = x->data + (size_t)i * x->stride;
+        long double* row_y = y->data + (size_t)i * y->stride;
+
+        for(unsigned int j=0;j<x->cols;j++)
+        {
+            row_y[j] += k * row_x[j];
+        }
+    }
+
+    return y;
 }
 
 /**
- * Multiplies two matrices, `a` and `b`
+ * Multiplies two matrices, `a` and `b`, storing the result in `dst`
  *
+ * `dst` must not share storage with `a` or `b`.
+ *
+ * @param dst
+ *      the matrix receiving the result (`a->rows` by `b->cols`)
  * @param a
  *      LHS matrix
  * @param b
  *      RHS matrix
  *
- * @return result of `a` * `b`, or `NULL` on failure
+ * @return `dst`, or `NULL` on failure
  *
  * */
-Matrix* matrix_multiply(Matrix* a, Matrix* b)
+Matrix* matrix_multiply_into(Matrix* dst, Matrix* a, Matrix* b)
 {
-    if(a == NULL || b == NULL) /* null guard */
+    if(dst == NULL || a == NULL || b == NULL) /* null guard */
     {
         return NULL;
     }
 
-    if(a->cols != b->rows) /* bounds check */
+    /* bounds check */
+    if(a->cols != b->rows || dst->rows != a->rows || dst->cols != b->cols)
     {
         return NULL;
     }
 
-    Matrix* res = matrix_init(a->rows, b->cols);
-
-    if(res == NULL) /* check for failure */
+    if(dst->data == a->data || dst->data == b->data) /* aliasing check */
     {
         return NULL;
     }
 
-    long double sum = 0.0; /* sum */
+    /* packed, cache-blocked kernel */
+    gemm(a->rows, b->cols, a->cols, 1.0, a->data, a->stride, 1, b->data,
+            b->stride, 1, 0.0, dst->data, dst->stride, 1);
 
-    /* traverse matrices, performing naive matrix multiplication */
-    for(unsigned int i=0;i<a->rows;i++)
+    return dst;
+}
+
+/**
+ * Multiplies two matrices, `a` and `b`
+ *
+ * @param a
+ *      LHS matrix
+ * @param b
+ *      RHS matrix
+ *
+ * @return result of `a` * `b`, or `NULL` on failure
+ *
+ * */
+Matrix* matrix_multiply(Matrix* a, Matrix* b)
+{
+    if(a == NULL || b == NULL) /* null guard */
     {
-        for(unsigned int j=0;j<b->cols;j++)
-        {
-            sum = 0.0;
+        return NULL;
+    }
 
-            for(unsigned int k=0;k<a->cols;k++)
-            {
-                sum += a->cells[i][k] * b->cells[k][j];
-            }
+    Matrix* res = matrix_init(a->rows, b->cols);
 
-            res->cells[i][j] = sum;
-        }
+    if(matrix_multiply_into(res, a, b) == NULL) /* check for failure */
+    {
+        matrix_free(res);
+        return NULL;
     }
 
     return res;
@@ -490,9 +833,12 @@ bool matrix_equal(Matrix* a, Matrix* b)
     /* compare elementwise */
     for(unsigned int i=0;i<a->rows;i++)
     {
+        const long double* row_a = a->data + (size_t)i * a->stride;
+        const long double* row_b = b->data + (size_t)i * b->stride;
+
         for(unsigned int j=0;j<a->cols;j++)
         {
-            if(a->cells[i][j] != b->cells[i][j])
+            if(row_a[j] != row_b[j])
             {
                 return false;
             }
@@ -503,7 +849,7 @@ bool matrix_equal(Matrix* a, Matrix* b)
 }
 
 /**
- * Computes the inverse of the matrix, `matrix`
+ * Computes the inverse of the matrix, `matrix`, via its LU factorisation
  *
  * @param matrix
  *      the square matrix to be inverted
@@ -523,32 +869,82 @@ Matrix* matrix_invert(Matrix* matrix)
         return NULL;
     }
 
-    Matrix* I = matrix_identity(matrix->rows);
+    LU* lu = lu_factor(matrix);
 
-    if(I == NULL)
+    if(lu == NULL) /* check for failure */
     {
         return NULL;
     }
 
-    /* handle the case where identity is provided as input */
-    if(matrix_equal(matrix, I))
+    Matrix* inverse = lu_inverse(lu);
+
+    lu_free(lu);
+
+    return inverse;
+}
+
+/**
+ * Transposes the matrix `matrix`, storing the result in `dst`
+ *
+ * `dst` must not share storage with `matrix`.
+ *
+ * @param dst
+ *      the matrix receiving the result (`matrix->cols` by `matrix->rows`)
+ * @param matrix
+ *      the matrix to be transposed
+ *
+ * @return `dst`, or `NULL` on failure
+ *
+ * */
+Matrix* matrix_transpose_into(Matrix* dst, Matrix* matrix)
+{
+    if(dst == NULL || matrix == NULL) /* null guard */
     {
-        return I;
+        return NULL;
     }
 
-    Matrix* A = matrix_copy(matrix);
+    /* bounds check */
+    if(dst->rows != matrix->cols || dst->cols != matrix->rows)
+    {
+        return NULL;
+    }
 
-    if(A == NULL) /* check for failure */
+    if(dst->data == matrix->data) /* aliasing check */
     {
         return NULL;
     }
-    
-    Matrix* inverse = matrix_gauss_elim(A, I);
 
-    matrix_free(A);
-    matrix_free(I);
+    transpose(matrix->rows, matrix->cols, matrix->data, matrix->stride,
+            dst->data, dst->stride);
 
-    return inverse;
+    return dst;
+}
+
+/**
+ * Transposes the square matrix `matrix` in place
+ *
+ * @param matrix
+ *      the matrix to be transposed
+ *
+ * @return `matrix`, or `NULL` on failure (including if `matrix` is not
+ *      square)
+ *
+ * */
+Matrix* matrix_transpose_inplace(Matrix* matrix)
+{
+    if(matrix == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(matrix->rows != matrix->cols) /* bounds check */
+    {
+        return NULL;
+    }
+
+    transpose_inplace(matrix->rows, matrix->data, matrix->stride);
+
+    return matrix;
 }
 
 /**
@@ -569,19 +965,12 @@ Matrix* matrix_transpose(Matrix* matrix)
 
     Matrix* transpose = matrix_init(matrix->cols, matrix->rows);
 
-    if(transpose == NULL)
+    if(matrix_transpose_into(transpose, matrix) == NULL)
     {
+        matrix_free(transpose);
         return NULL;
     }
 
-    for(unsigned int i=0;i<matrix->rows;i++)
-    {
-        for(unsigned int j=0;j<matrix->cols;j++)
-        {
-            transpose->cells[j][i] = matrix->cells[i][j];
-        }
-    }
-
     return transpose;
 }
 
@@ -610,7 +999,7 @@ Matrix* matrix_identity(unsigned int n)
 
     for(unsigned int i=0;i<n;i++)
     {
-        identity->cells[i][i] = 1;
+        identity->data[(size_t)i * identity->stride + i] = 1;
     }
 
     return identity;
@@ -636,13 +1025,20 @@ Matrix* matrix_randmat(unsigned int rows, unsigned int cols)
 
     Matrix* matrix = matrix_init(rows, cols);
 
+    if(matrix == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
     srand(time(NULL));
 
     for(unsigned int i=0;i<rows;i++)
     {
+        long double* row = matrix->data + (size_t)i * matrix->stride;
+
         for(unsigned int j=0;j<cols;j++)
         {
-            matrix->cells[i][j] = rand();
+            row[j] = rand();
         }
     }
 
@@ -675,19 +1071,20 @@ Matrix* matrix_right_augment(Matrix* a, Matrix* b)
 
     Matrix* c = matrix_init(a->rows, a->cols + b->cols);
 
+    if(c == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    /* each row of `c` is a row of `a` followed by a row of `b` */
     for(unsigned int i=0;i<c->rows;i++)
     {
-        for(unsigned int j=0;j<c->cols;j++)
-        {
-            if(j < a->cols)
-            {
-                c->cells[i][j] = a->cells[i][j];
-            }
-            else
-            {
-                c->cells[i][j] = b->cells[i][j-a->cols];
-            }
-        }
+        long double* row = c->data + (size_t)i * c->stride;
+
+        memcpy(row, a->data + (size_t)i * a->stride,
+                a->cols * sizeof(long double));
+        memcpy(row + a->cols, b->data + (size_t)i * b->stride,
+                b->cols * sizeof(long double));
     }
 
     return c;
@@ -719,19 +1116,20 @@ Matrix* matrix_bottom_augment(Matrix* a, Matrix* b)
 
     Matrix* c = matrix_init(a->rows + b->rows, a->cols);
 
+    if(c == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    /* rows of `a` followed by rows of `b` */
     for(unsigned int i=0;i<c->rows;i++)
     {
-        for(unsigned int j=0;j<c->cols;j++)
-        {
-            if(i < a->rows)
-            {
-                c->cells[i][j] = a->cells[i][j];
-            }
-            else
-            {
-                c->cells[i][j] = b->cells[i-a->rows][j];
-            }
-        }
+        const long double* src = i < a->rows ?
+            a->data + (size_t)i * a->stride :
+            b->data + (size_t)(i - a->rows) * b->stride;
+
+        memcpy(c->data + (size_t)i * c->stride, src,
+                c->cols * sizeof(long double));
     }
 
     return c;
@@ -750,15 +1148,19 @@ int find_max_row(unsigned int col, unsigned int start_row, Matrix* matrix)
     }
 
     unsigned int max_pos = start_row;
-    long double max_val = fabs(matrix->cells[start_row][col]);
+    const long double* cell = matrix->data + (size_t)start_row * matrix->stride
+        + col;
+    long double max_val = fabsl(*cell);
 
     for(unsigned int i=start_row;i<matrix->rows;i++)
     {
-        if(fabs(matrix->cells[i][col]) > max_val)
+        if(fabsl(*cell) > max_val)
         {
-            max_val = fabs(matrix->cells[i][col]);
+            max_val = fabsl(*cell);
             max_pos = i;
         }
+
+        cell += matrix->stride;
     }
 
     return max_pos;
@@ -783,7 +1185,7 @@ Matrix* matrix_gauss_elim(Matrix* A, Matrix* b)
         return NULL;
     }
 
-    if(A->cols != A->rows) /* bounds check */
+    if(A->cols != A->rows || b->rows != A->rows) /* bounds check */
     {
         return NULL;
     }
@@ -795,20 +1197,22 @@ Matrix* matrix_gauss_elim(Matrix* A, Matrix* b)
         return NULL;
     }
 
-    /* create working copies of relevant matrices */
-    Matrix* A_copy = matrix_copy(A);
+    /* create working copies of relevant matrices in scratch memory */
+    GaisanArena* arena = gaisan_thread_arena();
+    size_t mark = arena_mark(arena);
+    Matrix A_work;
+    Matrix b_work;
 
-    if(A_copy == NULL)
+    if(!matrix_scratch_copy(arena, A, &A_work) ||
+            !matrix_scratch_copy(arena, b, &b_work))
     {
+        arena_release(arena, mark);
+        matrix_free(x);
         return NULL;
     }
 
-    Matrix* b_copy = matrix_copy(b);
-
-    if(b_copy == NULL)
-    {
-        return NULL;
-    }
+    Matrix* A_copy = &A_work;
+    Matrix* b_copy = &b_work;
 
     unsigned int m = A_copy->rows;
     unsigned int n = A_copy->cols;
@@ -836,6 +1240,12 @@ Matrix* matrix_gauss_elim(Matrix* A, Matrix* b)
             for(unsigned int i=h+1;i<m;i++)
             {
                 f = A_copy->cells[i][k] / A_copy->cells[h][k];
+
+                if(f == 0.0) /* matrix_add_row treats a zero factor as 1 */
+                {
+                    continue;
+                }
+
                 A_copy->cells[i][k] = 0;
                 
                 matrix_add_row(i, h, -1 * f, A_copy);
@@ -851,15 +1261,17 @@ Matrix* matrix_gauss_elim(Matrix* A, Matrix* b)
     /* perform back-substitution */
     for(unsigned int i=n-1;i!=UINT_MAX;i--)
     {
+        if(A_copy->cells[i][i] == 0.0) /* infinitely many solutions */
+        {
+            arena_release(arena, mark);
+            matrix_free(x);
+            return NULL;
+        }
+
         for(unsigned int j=i;j<n;j++)
         {
             for(unsigned int l=0;l<b_copy->cols;l++)
             {
-                if(A_copy->cells[i][i] == 0.0) /* infinitely many solutions */
-                {
-                    return NULL;
-                }
-
                 b_copy->cells[i][l] -= A_copy->cells[i][j] * x->cells[j][l];
             }
         }
@@ -871,174 +1283,432 @@ Matrix* matrix_gauss_elim(Matrix* A, Matrix* b)
     }
 
     /* tidy up */
-    matrix_free(A_copy);
-    matrix_free(b_copy);
+    arena_release(arena, mark);
 
     return x;
 }
 
-void pad_to_power_2(Matrix* matrix)
+/**
+ * Computes `c = a + b` (or `c = a - b` if `sign` is negative) for `m` x `n`
+ *      strided blocks
+ *
+ * */
+static void strassen_combine(unsigned int m, unsigned int n,
+        const long double* a, unsigned int lda, int sign,
+        const long double* b, unsigned int ldb, long double* c,
+        unsigned int ldc)
 {
-    if(matrix == NULL) /* null guard */
+    for(unsigned int i=0;i<m;i++)
     {
-        return;
-    }
+        const long double* row_a = a + (size_t)i * lda;
+        const long double* row_b = b + (size_t)i * ldb;
+        long double* row_c = c + (size_t)i * ldc;
 
-    unsigned int n = matrix->rows;
-    n--;
-    n |= n >> 1;
-    n |= n >> 2;
-    n |= n >> 4;
-    n |= n >> 8;
-    n |= n >> 16;
-    n++;
+        if(sign < 0)
+        {
+            for(unsigned int j=0;j<n;j++)
+            {
+                row_c[j] = row_a[j] - row_b[j];
+            }
+        }
+        else
+        {
+            for(unsigned int j=0;j<n;j++)
+            {
+                row_c[j] = row_a[j] + row_b[j];
+            }
+        }
+    }
+}
 
-    for(unsigned int i=matrix->rows;i<n;i++)
+/**
+ * Returns the number of cells of workspace needed by a serial Strassen-
+ *      Winograd product of an `m` x `k` and a `k` x `n` matrix
+ *
+ * */
+static size_t strassen_workspace(unsigned int m, unsigned int k,
+        unsigned int n)
+{
+    if(m <= STRASSEN_MIN_SIZE || k <= STRASSEN_MIN_SIZE ||
+            n <= STRASSEN_MIN_SIZE)
     {
-        matrix_append_row(matrix);
-        matrix_append_col(matrix);
+        return 0;
     }
+
+    size_t hm = m / 2;
+    size_t hk = k / 2;
+    size_t hn = n / 2;
+
+    return hm * (hk > hn ? hk : hn) + hk * hn +
+        strassen_workspace(hm, hk, hn);
 }
 
-void trim(unsigned int n, Matrix* matrix)
+static void strassen_rec(unsigned int m, unsigned int k, unsigned int n,
+        const long double* a, unsigned int lda, const long double* b,
+        unsigned int ldb, long double* c, unsigned int ldc, long double* ws);
+
+/**
+ * Computes `c = a * b` for even `m`, `k` and `n` with one level of the
+ *      Strassen-Winograd algorithm, recursing serially on the seven
+ *      sub-products
+ *
+ * Quadrants are addressed in place within `a`, `b` and `c`; the only
+ *      temporaries are two blocks, X and Y, taken from the front of `ws`.
+ *      The schedule is that of Boyer, Dumas, Pernet and Zhou (2009).
+ *
+ * */
+static void strassen_winograd(unsigned int m, unsigned int k, unsigned int n,
+        const long double* a, unsigned int lda, const long double* b,
+        unsigned int ldb, long double* c, unsigned int ldc, long double* ws)
 {
-    if(matrix == NULL) /* null guard */
+    unsigned int hm = m / 2;
+    unsigned int hk = k / 2;
+    unsigned int hn = n / 2;
+
+    /* quadrant views */
+    const long double* a11 = a;
+    const long double* a12 = a + hk;
+    const long double* a21 = a + (size_t)hm * lda;
+    const long double* a22 = a21 + hk;
+    const long double* b11 = b;
+    const long double* b12 = b + hn;
+    const long double* b21 = b + (size_t)hk * ldb;
+    const long double* b22 = b21 + hn;
+    long double* c11 = c;
+    long double* c12 = c + hn;
+    long double* c21 = c + (size_t)hm * ldc;
+    long double* c22 = c21 + hn;
+
+    /* temporaries */
+    long double* x = ws;
+    long double* y = x + (size_t)hm * (hk > hn ? hk : hn);
+    long double* rest = y + (size_t)hk * hn;
+
+    strassen_combine(hm, hk, a11, lda, -1, a21, lda, x, hk);  /* S3 */
+    strassen_combine(hk, hn, b22, ldb, -1, b12, ldb, y, hn);  /* T3 */
+    strassen_rec(hm, hk, hn, x, hk, y, hn, c21, ldc, rest);   /* P7 */
+    strassen_combine(hm, hk, a21, lda, 1, a22, lda, x, hk);   /* S1 */
+    strassen_combine(hk, hn, b12, ldb, -1, b11, ldb, y, hn);  /* T1 */
+    strassen_rec(hm, hk, hn, x, hk, y, hn, c22, ldc, rest);   /* P5 */
+    strassen_combine(hm, hk, x, hk, -1, a11, lda, x, hk);     /* S2 */
+    strassen_combine(hk, hn, b22, ldb, -1, y, hn, y, hn);     /* T2 */
+    strassen_rec(hm, hk, hn, x, hk, y, hn, c12, ldc, rest);   /* P6 */
+    strassen_combine(hm, hk, a12, lda, -1, x, hk, x, hk);     /* S4 */
+    strassen_rec(hm, hk, hn, x, hk, b22, ldb, c11, ldc, rest); /* P3 */
+    strassen_rec(hm, hk, hn, a11, lda, b11, ldb, x, hn, rest); /* P1 */
+    strassen_combine(hm, hn, x, hn, 1, c12, ldc, c12, ldc);   /* U2 */
+    strassen_combine(hm, hn, c12, ldc, 1, c21, ldc, c21, ldc); /* U3 */
+    strassen_combine(hm, hn, c12, ldc, 1, c22, ldc, c12, ldc); /* U4 */
+    strassen_combine(hm, hn, c21, ldc, 1, c22, ldc, c22, ldc); /* U7 */
+    strassen_combine(hm, hn, c12, ldc, 1, c11, ldc, c12, ldc); /* U5 */
+    strassen_combine(hk, hn, y, hn, -1, b21, ldb, y, hn);     /* T4 */
+    strassen_rec(hm, hk, hn, a22, lda, y, hn, c11, ldc, rest); /* P4 */
+    strassen_combine(hm, hn, c21, ldc, -1, c11, ldc, c21, ldc); /* U6 */
+
+    /* U1 = P1 + P2, accumulated straight into C11 */
+    for(unsigned int i=0;i<hm;i++)
+    {
+        memcpy(c11 + (size_t)i * ldc, x + (size_t)i * hn,
+                hn * sizeof(long double));
+    }
+
+    gemm(hm, hn, hk, 1.0, a12, lda, 1, b21, ldb, 1, 1.0, c11, ldc, 1);
+}
+
+/**
+ * Fixes up the rows and columns of `c = a * b` not covered by the even-sized
+ *      leading block, which is assumed to hold `a[0:me,0:ke] * b[0:ke,0:ne]`
+ *      (dynamic peeling)
+ *
+ * */
+static void strassen_peel(unsigned int m, unsigned int k, unsigned int n,
+        const long double* a, unsigned int lda, const long double* b,
+        unsigned int ldb, long double* c, unsigned int ldc)
+{
+    unsigned int me = m & ~1u;
+    unsigned int ke = k & ~1u;
+    unsigned int ne = n & ~1u;
+
+    if(k != ke) /* rank-1 update from the odd column of a */
     {
-        return;
+        gemm(me, ne, 1, 1.0, a + ke, lda, 1, b + (size_t)ke * ldb, ldb, 1,
+                1.0, c, ldc, 1);
     }
 
-    if(n >= matrix->rows) /* trivial case */
+    if(n != ne) /* odd column of c */
     {
-        return;
+        gemm(m, 1, k, 1.0, a, lda, 1, b + ne, ldb, 1, 0.0, c + ne, ldc, 1);
     }
 
-    unsigned int start = matrix->rows;
+    if(m != me) /* odd row of c */
+    {
+        gemm(1, ne, k, 1.0, a + (size_t)me * lda, lda, 1, b, ldb, 1, 0.0,
+                c + (size_t)me * ldc, ldc, 1);
+    }
+}
 
-    for(unsigned int i=0;i<start-n;i++)
+/**
+ * Computes `c = a * b` recursively, falling back to GEMM below the
+ *      crossover size
+ *
+ * */
+static void strassen_rec(unsigned int m, unsigned int k, unsigned int n,
+        const long double* a, unsigned int lda, const long double* b,
+        unsigned int ldb, long double* c, unsigned int ldc, long double* ws)
+{
+    if(m <= STRASSEN_MIN_SIZE || k <= STRASSEN_MIN_SIZE ||
+            n <= STRASSEN_MIN_SIZE) /* base case */
     {
-        matrix_drop_row(matrix);
-        matrix_drop_col(matrix);
+        gemm(m, n, k, 1.0, a, lda, 1, b, ldb, 1, 0.0, c, ldc, 1);
+        return;
     }
+
+    strassen_winograd(m & ~1u, k & ~1u, n & ~1u, a, lda, b, ldb, c, ldc, ws);
+    strassen_peel(m, k, n, a, lda, b, ldb, c, ldc);
 }
 
 /**
- * Multiplies the two matrices `a` and `b` using Strassen's algorithm
+ * One of the seven sub-products of a parallel Strassen-Winograd step
  *
- * Note that both matrices must be square and that, for matrices of dimension
- *      less than or equal to STRASSEN_MIN_SIZE, this method is equivalent
- *      to naive matrix multiplication.
+ * */
+typedef struct
+{
+    const long double* a;
+    unsigned int lda;
+    const long double* b;
+    unsigned int ldb;
+    long double* c;
+    unsigned int ldc;
+} StrassenProduct;
+
+/**
+ * Shared state of a parallel Strassen-Winograd step
+ *
+ * */
+typedef struct
+{
+    unsigned int m;
+    unsigned int k;
+    unsigned int n;
+    StrassenProduct products[STRASSEN_NUM_PRODUCTS];
+    long double* ws; /* one serial workspace per product, back to back */
+    size_t ws_len;
+} StrassenJob;
+
+/**
+ * Computes sub-product `p` of a parallel Strassen-Winograd step
+ *
+ * */
+static void strassen_product(unsigned int p, void* arg)
+{
+    const StrassenJob* job = arg;
+    const StrassenProduct* prod = &job->products[p];
+
+    strassen_rec(job->m, job->k, job->n, prod->a, prod->lda, prod->b,
+            prod->ldb, prod->c, prod->ldc, job->ws + p * job->ws_len);
+}
+
+/**
+ * Computes `c = a * b` for even `m`, `k` and `n` with one level of the
+ *      Strassen-Winograd algorithm, evaluating the seven sub-products
+ *      concurrently on the worker pool
  *
+ * Four of the products land directly in the quadrants of `c`; the rest, and
+ *      all of the operand sums, are taken from `ws`, followed by a serial
+ *      workspace for each product.
+ *
+ * */
+static void strassen_parallel(unsigned int m, unsigned int k, unsigned int n,
+        const long double* a, unsigned int lda, const long double* b,
+        unsigned int ldb, long double* c, unsigned int ldc, long double* ws)
+{
+    unsigned int hm = m / 2;
+    unsigned int hk = k / 2;
+    unsigned int hn = n / 2;
+    size_t sa = (size_t)hm * hk;
+    size_t sb = (size_t)hk * hn;
+    size_t sc = (size_t)hm * hn;
+
+    /* quadrant views */
+    const long double* a11 = a;
+    const long double* a12 = a + hk;
+    const long double* a21 = a + (size_t)hm * lda;
+    const long double* a22 = a21 + hk;
+    const long double* b11 = b;
+    const long double* b12 = b + hn;
+    const long double* b21 = b + (size_t)hk * ldb;
+    const long double* b22 = b21 + hn;
+    long double* c11 = c;
+    long double* c12 = c + hn;
+    long double* c21 = c + (size_t)hm * ldc;
+    long double* c22 = c21 + hn;
+
+    /* temporaries */
+    long double* s1 = ws;
+    long double* s2 = s1 + sa;
+    long double* s3 = s2 + sa;
+    long double* s4 = s3 + sa;
+    long double* t1 = s4 + sa;
+    long double* t2 = t1 + sb;
+    long double* t3 = t2 + sb;
+    long double* t4 = t3 + sb;
+    long double* p1 = t4 + sb;
+    long double* p2 = p1 + sc;
+    long double* p4 = p2 + sc;
+
+    strassen_combine(hm, hk, a21, lda, 1, a22, lda, s1, hk);
+    strassen_combine(hm, hk, s1, hk, -1, a11, lda, s2, hk);
+    strassen_combine(hm, hk, a11, lda, -1, a21, lda, s3, hk);
+    strassen_combine(hm, hk, a12, lda, -1, s2, hk, s4, hk);
+    strassen_combine(hk, hn, b12, ldb, -1, b11, ldb, t1, hn);
+    strassen_combine(hk, hn, b22, ldb, -1, t1, hn, t2, hn);
+    strassen_combine(hk, hn, b22, ldb, -1, b12, ldb, t3, hn);
+    strassen_combine(hk, hn, t2, hn, -1, b21, ldb, t4, hn);
+
+    StrassenJob job = {hm, hk, hn, {
+            {a11, lda, b11, ldb, p1, hn},   /* P1 */
+            {a12, lda, b21, ldb, p2, hn},   /* P2 */
+            {s4, hk, b22, ldb, c11, ldc},   /* P3 */
+            {a22, lda, t4, hn, p4, hn},     /* P4 */
+            {s1, hk, t1, hn, c22, ldc},     /* P5 */
+            {s2, hk, t2, hn, c12, ldc},     /* P6 */
+            {s3, hk, t3, hn, c21, ldc}},    /* P7 */
+        p4 + sc, strassen_workspace(hm, hk, hn)};
+
+    parallel_for(STRASSEN_NUM_PRODUCTS, &strassen_product, &job);
+
+    strassen_combine(hm, hn, p1, hn, 1, c12, ldc, c12, ldc);   /* U2 */
+    strassen_combine(hm, hn, c12, ldc, 1, c21, ldc, c21, ldc); /* U3 */
+    strassen_combine(hm, hn, c12, ldc, 1, c22, ldc, c12, ldc); /* U4 */
+    strassen_combine(hm, hn, c21, ldc, 1, c22, ldc, c22, ldc); /* U7 */
+    strassen_combine(hm, hn, c12, ldc, 1, c11, ldc, c12, ldc); /* U5 */
+    strassen_combine(hm, hn, c21, ldc, -1, p4, hn, c21, ldc);  /* U6 */
+    strassen_combine(hm, hn, p1, hn, 1, p2, hn, c11, ldc);     /* U1 */
+}
+
+/**
+ * Multiplies the two matrices `a` and `b` using the Strassen-Winograd
+ *      algorithm, storing the result in `dst`
+ *
+ * Odd dimensions are handled by dynamic peeling and recursion stops at
+ *      STRASSEN_MIN_SIZE, below which the blocked GEMM kernel is used. All
+ *      temporaries are drawn from a single workspace allocated up front.
+ *      When between 2 and STRASSEN_NUM_PRODUCTS threads are in use the seven
+ *      top-level sub-products run concurrently; with more threads the GEMM
+ *      base cases are parallelised instead.
+ *
+ * `dst` must not share storage with `a` or `b`.
+ *
+ * @param dst
+ *      the matrix receiving the result (`a->rows` by `b->cols`)
  * @param a
  *      the LHS matrix
  * @param b
  *      the RHS matrix
  *
- * @return the result of `a` * `b`, or `NULL` on failure
+ * @return `dst`, or `NULL` on failure
  *
  * */
-Matrix* strassen(Matrix* a, Matrix* b)
+Matrix* strassen_into(Matrix* dst, Matrix* a, Matrix* b)
 {
-    if(a == NULL || b == NULL) /* null guard */
+    if(dst == NULL || a == NULL || b == NULL) /* null guard */
     {
         return NULL;
     }
 
     /* bounds check */
-    if(a->rows != b-> rows || a->cols != b->cols || a->rows != a->cols)
+    if(a->cols != b->rows || dst->rows != a->rows || dst->cols != b->cols)
     {
         return NULL;
     }
 
-    if(a->rows <= STRASSEN_MIN_SIZE) /* base case */
+    if(dst->data == a->data || dst->data == b->data) /* aliasing check */
     {
-        return matrix_multiply(a, b);
+        return NULL;
     }
 
-    unsigned int original_size = a->rows;
+    unsigned int m = a->rows;
+    unsigned int k = a->cols;
+    unsigned int n = b->cols;
 
-    /* padding */
-    if(!((a->rows != 0) && ((a->rows & (a->rows - 1)) == 0)))
+    if(m <= STRASSEN_MIN_SIZE || k <= STRASSEN_MIN_SIZE ||
+            n <= STRASSEN_MIN_SIZE) /* base case */
     {
-        pad_to_power_2(a);
-        pad_to_power_2(b);
+        return matrix_multiply_into(dst, a, b);
     }
 
-    unsigned int n = a->rows / 2;
+    unsigned int threads = gaisan_get_num_threads();
+    bool parallel = threads > 1 && threads <= STRASSEN_NUM_PRODUCTS;
+
+    /* size the workspace for the chosen schedule */
+    size_t hm = m / 2;
+    size_t hk = k / 2;
+    size_t hn = n / 2;
+    size_t len = parallel ?
+        4 * hm * hk + 4 * hk * hn + 3 * hm * hn +
+            STRASSEN_NUM_PRODUCTS * strassen_workspace(hm, hk, hn) :
+        strassen_workspace(m, k, n);
+    size_t bytes = (len * sizeof(long double) + MATRIX_ALIGNMENT - 1) /
+        MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
 
-    /* submatrices */
-    Matrix* A[4];
-    Matrix* B[4];
-    Matrix* C[4];
-    Matrix* P[7];
+    GaisanArena* arena = gaisan_thread_arena();
+    size_t mark = arena_mark(arena);
+    long double* ws = arena_alloc(arena, bytes);
 
-    /* initialise submatrices */
-    for(unsigned int i=0;i<STRASSEN_NUM_SUBMATRICES;i++)
+    if(ws == NULL) /* allocation check */
     {
-        A[i] = matrix_init(n, n);
-        B[i] = matrix_init(n, n);
-        C[i] = matrix_init(n, n);
+        arena_release(arena, mark);
+        return NULL;
     }
 
-    /* extract submatrices */
-    for(unsigned int i=0;i<n;i++)
+    if(parallel)
     {
-        for(unsigned int j=0;j<n;j++)
-        {
-            /* top-left */
-            A[0]->cells[i][j] = a->cells[i][j];
-            B[0]->cells[i][j] = b->cells[i][j];
-
-            /* top-right */
-            A[1]->cells[i][j] = a->cells[i][n+j];
-            B[1]->cells[i][j] = b->cells[i][n+j];
-
-            /* bottom-left */
-            A[2]->cells[i][j] = a->cells[n+i][j];
-            B[2]->cells[i][j] = b->cells[n+i][j];
-
-            /* bottom-right */
-            A[3]->cells[i][j] = a->cells[n+i][n+j];
-            B[3]->cells[i][j] = b->cells[n+i][n+j];
-        }
+        strassen_parallel(m & ~1u, k & ~1u, n & ~1u, a->data, a->stride,
+                b->data, b->stride, dst->data, dst->stride, ws);
+        strassen_peel(m, k, n, a->data, a->stride, b->data, b->stride,
+                dst->data, dst->stride);
+    }
+    else
+    {
+        strassen_rec(m, k, n, a->data, a->stride, b->data, b->stride,
+                dst->data, dst->stride, ws);
     }
-    
-    /* calculate component matrices */
-    P[0] = strassen(A[0], matrix_subtract(B[1], B[3]));
-    P[1] = strassen(matrix_add(A[0], A[1]), B[3]);
-    P[2] = strassen(matrix_add(A[2], A[3]), B[0]);
-    P[3] = strassen(A[3], matrix_subtract(B[2], B[0]));
-    P[4] = strassen(matrix_add(A[0], A[3]), matrix_add(B[0], B[3]));
-    P[5] = strassen(matrix_subtract(A[1], A[3]), matrix_add(B[2], B[3]));
-    P[6] = strassen(matrix_subtract(A[0], A[2]), matrix_add(B[0], B[1]));
 
-    /* calculate submatrices of result matrix */
-    C[0] = matrix_add(matrix_subtract(matrix_add(P[4], P[3]), P[1]), P[5]);
-    C[1] = matrix_add(P[0], P[1]);
-    C[2] = matrix_add(P[2], P[3]);
-    C[3] = matrix_subtract(matrix_add(P[0], P[4]), matrix_add(P[2], P[6]));
-    
-    /* join */
-    Matrix* top_row = matrix_right_augment(C[0], C[1]);
-    Matrix* bottom_row = matrix_right_augment(C[2], C[3]);
-    Matrix* c = matrix_bottom_augment(top_row, bottom_row);
+    arena_release(arena, mark);
 
-    /* trim padding (if any) */
-    if(c->rows != original_size)
+    return dst;
+}
+
+/**
+ * Multiplies the two matrices `a` and `b` using the Strassen-Winograd
+ *      algorithm (see `strassen_into`)
+ *
+ * Neither input is modified and matrices need not be square nor of
+ *      power-of-two size.
+ *
+ * @param a
+ *      the LHS matrix
+ * @param b
+ *      the RHS matrix
+ *
+ * @return the result of `a` * `b`, or `NULL` on failure
+ *
+ * */
+Matrix* strassen(Matrix* a, Matrix* b)
+{
+    if(a == NULL || b == NULL) /* null guard */
     {
-        trim(original_size, c);
+        return NULL;
     }
 
-    /* free matrices */
-    matrix_free(top_row);
-    matrix_free(bottom_row);
+    Matrix* res = matrix_init(a->rows, b->cols);
 
-    for(unsigned int i=0;i<STRASSEN_NUM_SUBMATRICES;i++)
+    if(strassen_into(res, a, b) == NULL) /* check for failure */
     {
-        matrix_free(A[i]);
-        matrix_free(B[i]);
-        matrix_free(C[i]);
+        matrix_free(res);
+        return NULL;
     }
-    
-    return c;
+
+    return res;
 }
 
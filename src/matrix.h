@@ -9,12 +9,32 @@
 #define MATRIX_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 
+/**
+ * Dense, row-major matrix
+ *
+ * Cells live in a single aligned, contiguous buffer, `data`, in which row `i`
+ * begins at `data + i * stride`. `stride` (the leading dimension) is at least
+ * `cols` and is padded so that every row starts on a `MATRIX_ALIGNMENT`
+ * boundary. `cells` holds a pointer to the start of each row so that cells
+ * may still be accessed as `cells[i][j]`.
+ *
+ * A matrix loaded with `map_matrix_bin` (see `misc.h`) does not own `data`:
+ * it points into a read-only file mapping, recorded in `mapping`, which is
+ * released by `matrix_free`. Such a matrix must not be written to or grown.
+ *
+ * */
 typedef struct
 {
     unsigned int rows;
     unsigned int cols;
+    unsigned int stride; /* leading dimension (elements between rows) */
+    unsigned int capacity; /* number of rows allocated in `data` */
+    long double* data;
     long double** cells;
+    void* mapping; /* read-only file mapping backing `data`, or NULL */
+    size_t mapping_len; /* length (in bytes) of `mapping` */
 } Matrix;
 
 /* Initialisation */
@@ -34,11 +54,20 @@ Matrix* matrix_scale(long double k, Matrix* matrix);
 Matrix* matrix_subtract(Matrix* a, Matrix* b);
 Matrix* matrix_multiply(Matrix* a, Matrix* b);
 
+/* Arithmetic Operations (into caller-owned matrices) */
+Matrix* matrix_add_into(Matrix* dst, Matrix* a, Matrix* b);
+Matrix* matrix_scale_into(Matrix* dst, long double k, Matrix* matrix);
+Matrix* matrix_subtract_into(Matrix* dst, Matrix* a, Matrix* b);
+Matrix* matrix_multiply_into(Matrix* dst, Matrix* a, Matrix* b);
+Matrix* matrix_axpy(long double k, Matrix* x, Matrix* y);
+
 /* Comparison */
 bool matrix_equal(Matrix* a, Matrix* b);
 
 /* Miscellaneous Operations */
 Matrix* matrix_transpose(Matrix* matrix);
+Matrix* matrix_transpose_into(Matrix* dst, Matrix* matrix);
+Matrix* matrix_transpose_inplace(Matrix* matrix);
 Matrix* matrix_invert(Matrix* matrix);
 
 /* Utilities */
@@ -54,6 +83,7 @@ void matrix_pop_col(Matrix* matrix);
 /* Algorithms */
 Matrix* matrix_gauss_elim(Matrix* A, Matrix* b);
 Matrix* strassen(Matrix* a, Matrix* b);
+Matrix* strassen_into(Matrix* dst, Matrix* a, Matrix* b);
 
 #endif /* MATRIX_H_ */
 
@@ -6,14 +6,24 @@
  * printing tables of data, printing matrices, etc.).
  *
  * */
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
-#include <ctype.h>
+#include <float.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "matrix.h"
 #include "constants.h"
+#include "alloc.h"
+#include "thread.h"
 #include "misc.h"
 
 /**
@@ -72,7 +82,7 @@ size_t widest_long_double(long double* doubles, unsigned int num_elems)
     size_t max_width = 0; /* max width of all long doubles in list */
 
     /* allocate list of strings */
-    char** strings = calloc(num_elems + 1, sizeof(char*));
+    char** strings = gaisan_calloc(num_elems + 1, sizeof(char*));
 
     if(strings == NULL) /* allocation check */
     {
@@ -81,7 +91,7 @@ size_t widest_long_double(long double* doubles, unsigned int num_elems)
 
     for(unsigned int i=0;i<num_elems;i++)
     {
-        strings[i] = calloc(MAX_FLOAT_WIDTH + 1, sizeof(char));
+        strings[i] = gaisan_calloc(MAX_FLOAT_WIDTH + 1, sizeof(char));
 
         if(strings[i] == NULL) /* allocation check */
         {
@@ -102,10 +112,10 @@ size_t widest_long_double(long double* doubles, unsigned int num_elems)
     /* tidy up */
     for(unsigned int i=0;i<num_elems;i++)
     {
-        free(strings[i]);
+        gaisan_free(strings[i]);
     }
 
-    free(strings);
+    gaisan_free(strings);
 
     return max_width;
 }
@@ -236,131 +246,917 @@ void print_matrix(Matrix* mat)
     write_matrix(stdout, mat);
 }
 
+/* fast-path limits: largest significand (in digits) and power of ten that a
+ * `long double` holds exactly, so that one multiplication or division yields
+ * a correctly rounded result */
+#if LDBL_MANT_DIG >= 64
+#define PARSE_EXACT_DIGITS 19
+#define PARSE_EXACT_POW10 27
+#else
+#define PARSE_EXACT_DIGITS 15
+#define PARSE_EXACT_POW10 22
+#endif
+
+/* exactly representable powers of ten used by the fast path */
+static const long double parse_pow10[] =
+{
+    1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L,
+    1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L, 1e20L,
+    1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L
+};
+
 /**
- * Reads a matrix from the file `file`
+ * Returns whether `ch` separates values within a row of a text matrix
  *
- * @param file
- *      the file to be read from
+ * */
+static inline bool is_space(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+/**
+ * Parses a decimal number (optionally signed, with an optional fraction and
+ *      exponent) beginning at `p`
+ *
+ * Numbers with at most `PARSE_EXACT_DIGITS` significant digits and a
+ *      (scaled) decimal exponent of at most `PARSE_EXACT_POW10` in magnitude
+ *      are converted directly with a single, correctly rounded, operation;
+ *      everything else (including infinities and NaNs) is handed to
+ *      `strtold`.
  *
- * @return the matrix contained in `file`, or `NULL` on failure
+ * @param p
+ *      start of the number
+ * @param value
+ *      receives the value parsed
+ *
+ * @return pointer to the first character after the number, or `NULL` if no
+ *      number begins at `p`
  *
  * */
-Matrix* read_matrix(FILE* file)
+static const char* parse_long_double(const char* p, long double* value)
 {
-    if(file == NULL) /* null guard */
+    const char* s = p;
+    bool negative = false;
+
+    if(*s == '+' || *s == '-')
     {
-        return NULL;
+        negative = *s == '-';
+        s++;
+    }
+
+    uint64_t significand = 0;
+    int digits = 0; /* significant digits held in `significand` */
+    int exponent = 0; /* power of ten by which `significand` is scaled */
+    bool seen_digit = false;
+    bool exact = true;
+
+    for(;*s >= '0' && *s <= '9';s++) /* integer part */
+    {
+        seen_digit = true;
+
+        if(significand == 0 && *s == '0') /* leading zero */
+        {
+            continue;
+        }
+
+        if(digits == PARSE_EXACT_DIGITS)
+        {
+            exact = false;
+            break;
+        }
+
+        significand = significand * 10 + (uint64_t)(*s - '0');
+        digits++;
+    }
+
+    if(exact && *s == '.') /* fractional part */
+    {
+        for(s++;*s >= '0' && *s <= '9';s++)
+        {
+            seen_digit = true;
+
+            if(significand == 0 && *s == '0') /* leading zero */
+            {
+                exponent--;
+                continue;
+            }
+
+            if(digits == PARSE_EXACT_DIGITS)
+            {
+                exact = false;
+                break;
+            }
+
+            significand = significand * 10 + (uint64_t)(*s - '0');
+            digits++;
+            exponent--;
+        }
+    }
+
+    if(exact && seen_digit && (*s == 'e' || *s == 'E')) /* exponent */
+    {
+        const char* e = s + 1;
+        bool negative_exp = false;
+        int exp_value = 0;
+
+        if(*e == '+' || *e == '-')
+        {
+            negative_exp = *e == '-';
+            e++;
+        }
+
+        if(*e < '0' || *e > '9') /* malformed exponent */
+        {
+            exact = false;
+        }
+
+        for(;exact && *e >= '0' && *e <= '9';e++)
+        {
+            if(exp_value > 10 * PARSE_EXACT_POW10) /* far out of range */
+            {
+                exact = false;
+                break;
+            }
+
+            exp_value = exp_value * 10 + (*e - '0');
+        }
+
+        exponent += negative_exp ? -exp_value : exp_value;
+        s = e;
+    }
+
+    if(exact && seen_digit)
+    {
+        if(significand == 0)
+        {
+            *value = negative ? -0.0L : 0.0L;
+            return s;
+        }
+
+        if(exponent >= -PARSE_EXACT_POW10 && exponent <= PARSE_EXACT_POW10)
+        {
+            long double v = (long double)significand;
+
+            if(exponent >= 0)
+            {
+                v *= parse_pow10[exponent];
+            }
+            else
+            {
+                v /= parse_pow10[-exponent];
+            }
+
+            *value = negative ? -v : v;
+            return s;
+        }
     }
 
-    /* buffer variables */
-    size_t cap = 0; /* current capacity of buffer */
-    size_t len = 0; /* current length of buffer */
-    char* buf = calloc(INIT_BUF_LEN, sizeof(char)); /* buffer */
+    /* slow path */
+    char* end = NULL;
+    *value = strtold(p, &end);
+
+    return end == p ? NULL : end;
+}
+
+/**
+ * Returns whether the line beginning at `p` is blank (i.e. holds nothing but
+ *      whitespace)
+ *
+ * */
+static bool line_is_blank(const char* p)
+{
+    while(is_space(*p))
+    {
+        p++;
+    }
 
-    /* data array variables */
-    unsigned int r = 0; /* current row */
-    unsigned int c = 0; /* current column */
-    unsigned int rows = 1; /* number of rows */
-    unsigned int cols = 1; /* number of columns */
-    long double** data = calloc(1, sizeof(long double*));
-    data[0] = calloc(1, sizeof(long double));
+    return *p == '\n' || *p == '\0';
+}
 
-    char ch = '\0'; /* current character */
-    bool newline_prev = false;
-    bool first_row = true;
+/**
+ * Parses one row of a text matrix
+ *
+ * Values are separated by whitespace and/or single commas.
+ *
+ * @param p
+ *      start of the row
+ * @param row
+ *      receives the values parsed (may be `NULL` to only count them)
+ * @param cols
+ *      capacity of `row`
+ * @param count
+ *      receives the number of values in the row
+ *
+ * @return pointer to the start of the next line (or to the terminating `NULL`
+ *      byte), or `NULL` if the row is malformed or holds more than `cols`
+ *      values
+ *
+ * */
+static const char* parse_row(const char* p, long double* row,
+        unsigned int cols, unsigned int* count)
+{
+    unsigned int n = 0;
+    bool need_value = false; /* set after a comma */
 
-    /* main parsing loop */
     while(true)
     {
-        ch = fgetc(file); /* fetch new character */
+        while(is_space(*p))
+        {
+            p++;
+        }
 
-        if(ch == EOF) /* check for EOF */
+        if(*p == '\n' || *p == '\0') /* end of row */
         {
+            if(need_value) /* trailing comma */
+            {
+                return NULL;
+            }
+
             break;
         }
 
-        if(isdigit(ch) || ch == '.' || ch == '-') /* value in-process */
+        if(*p == ',')
         {
-            if(len + 1 == cap) /* buffer full, expand */
+            if(n == 0 || need_value) /* empty field */
             {
-                cap *= BUF_EXPAND_FACTOR;
-                buf = realloc(buf, cap * sizeof(char));
+                return NULL;
             }
-            
-            buf[len++] = ch; /* append to buffer */
-            newline_prev = false;
+
+            need_value = true;
+            p++;
+            continue;
         }
-        else if(isblank(ch) || ch == '\n') /* captured new value */
+
+        long double value = 0;
+        const char* end = parse_long_double(p, &value);
+
+        if(end == NULL || !(is_space(*end) || *end == ',' || *end == '\n' ||
+                    *end == '\0')) /* invalid character */
         {
-            
-            buf[len] = '\0'; /* NULL-terminate buffer */
-            data[r][c++] = atof(buf); /* save value */ 
+            return NULL;
+        }
 
-            if(isblank(ch)) /* add column */
+        if(row != NULL)
+        {
+            if(n == cols) /* bounds check */
             {
-                if(first_row)
-                {
-                    data[r] = realloc(data[r], ++cols * sizeof(long double));
-                }
-                
-                newline_prev = false;
+                return NULL;
             }
-            else if(ch == '\n') /* add row */
+
+            row[n] = value;
+        }
+
+        n++;
+        need_value = false;
+        p = end;
+    }
+
+    *count = n;
+
+    return *p == '\n' ? p + 1 : p;
+}
+
+/**
+ * A contiguous run of whole lines of a text matrix, parsed by one task
+ *
+ * */
+typedef struct
+{
+    size_t begin; /* offset of the first line */
+    size_t end; /* offset just past the last line */
+    size_t stop; /* offset just past the first blank line, or `end` */
+    unsigned int rows; /* rows before `stop` */
+    unsigned int first_row; /* index in the matrix of the chunk's first row */
+    bool blank; /* whether the chunk contains a blank line */
+    bool failed;
+} ReadChunk;
+
+/**
+ * Arguments shared by the tasks parsing a text matrix
+ *
+ * */
+typedef struct
+{
+    const char* text; /* `NULL`-terminated text */
+    ReadChunk* chunks;
+    Matrix* mat; /* destination (`NULL` during the counting pass) */
+} ReadJob;
+
+/**
+ * Counts the rows of chunk `c`, stopping at its first blank line
+ *
+ * */
+static void read_count_task(unsigned int c, void* arg)
+{
+    ReadJob* job = arg;
+    ReadChunk* chunk = &job->chunks[c];
+    const char* p = job->text + chunk->begin;
+    const char* end = job->text + chunk->end;
+
+    chunk->stop = chunk->end;
+
+    while(p < end)
+    {
+        const char* eol = memchr(p, '\n', (size_t)(end - p));
+        const char* next = eol == NULL ? end : eol + 1;
+
+        if(line_is_blank(p))
+        {
+            chunk->blank = true;
+            chunk->stop = (size_t)(next - job->text);
+            break;
+        }
+
+        if(chunk->rows == UINT_MAX) /* bounds check */
+        {
+            chunk->failed = true;
+            break;
+        }
+
+        chunk->rows++;
+        p = next;
+    }
+}
+
+/**
+ * Parses the rows of chunk `c` into the destination matrix
+ *
+ * */
+static void read_parse_task(unsigned int c, void* arg)
+{
+    ReadJob* job = arg;
+    ReadChunk* chunk = &job->chunks[c];
+    const char* p = job->text + chunk->begin;
+
+    for(unsigned int r=0;r<chunk->rows;r++)
+    {
+        unsigned int count = 0;
+
+        p = parse_row(p, job->mat->cells[chunk->first_row + r],
+                job->mat->cols, &count);
+
+        if(p == NULL || count != job->mat->cols) /* malformed row */
+        {
+            chunk->failed = true;
+            return;
+        }
+    }
+}
+
+/**
+ * Reads the remainder of `file` into a `NULL`-terminated buffer, in blocks
+ *      of at least `READ_BLOCK_SIZE` bytes
+ *
+ * @param file
+ *      the file to read
+ * @param len
+ *      receives the number of bytes read
+ *
+ * @return the buffer (to be released with `gaisan_free`), or `NULL` on
+ *      failure
+ *
+ * */
+static char* read_stream(FILE* file, size_t* len)
+{
+    size_t cap = READ_BLOCK_SIZE;
+    struct stat st;
+    long pos = ftell(file);
+
+    /* size regular files up front so they are read in one go */
+    if(pos >= 0 && fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode) &&
+            st.st_size >= pos && (uint64_t)(st.st_size - pos) < SIZE_MAX - 2)
+    {
+        cap = (size_t)(st.st_size - pos) + 2;
+    }
+
+    char* buf = gaisan_malloc(cap);
+
+    if(buf == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    size_t n = 0;
+
+    while(true)
+    {
+        if(cap - n < 2) /* buffer full, expand */
+        {
+            char* bigger = gaisan_realloc(buf, cap * BUF_EXPAND_FACTOR);
+
+            if(bigger == NULL) /* allocation check */
             {
-                if(newline_prev) /* encountered blank line */
-                {
-                    free(buf);
-                    break;
-                }
-                
-                data = realloc(data, ++rows * sizeof(long double*));
-                data[++r] = calloc(cols, sizeof(long double));
-                
-                c = 0; /* reset column index */
-                newline_prev = true; /* set newline flag */
-                first_row = false;
+                gaisan_free(buf);
+                return NULL;
             }
-            
-            /* reset buffer */
-            free(buf);
-            len = 0;
-            cap = INIT_BUF_LEN;
-            buf = calloc(cap, sizeof(char));
+
+            buf = bigger;
+            cap *= BUF_EXPAND_FACTOR;
         }
-        else /* invalid character */
+
+        size_t got = fread(buf + n, 1, cap - n - 1, file);
+        n += got;
+
+        if(got == 0)
         {
-            /* free data array */
-            for(unsigned int i=0;i<rows;i++)
+            break;
+        }
+    }
+
+    if(ferror(file)) /* check for failure */
+    {
+        gaisan_free(buf);
+        return NULL;
+    }
+
+    buf[n] = '\0';
+    *len = n;
+
+    return buf;
+}
+
+/**
+ * Reads a matrix from the file `file`
+ *
+ * Each non-blank line holds one row, whose values are separated by
+ *      whitespace and/or commas (so both the output of `write_matrix` and
+ *      CSV are accepted). Values may carry a sign, a fraction and an
+ *      exponent. Blank lines before the first row are skipped; a blank line
+ *      after it ends the matrix.
+ *
+ * The whole remainder of `file` is read into one buffer (in large blocks)
+ *      before it is parsed, so peak memory use is the size of that text plus
+ *      the matrix. Large inputs are split into runs of lines parsed in
+ *      parallel (see `thread.h`).
+ *
+ * If the matrix ends at a blank line and `file` is seekable, `file` is left
+ *      positioned just after that line so that further matrices may be read
+ *      from it. A stream that cannot seek (such as a pipe) is always read to
+ *      its end, so anything after the matrix is consumed and discarded.
+ *
+ * @param file
+ *      the file to be read from
+ *
+ * @return the matrix contained in `file`, or `NULL` on failure (including
+ *      malformed input and rows of differing lengths)
+ *
+ * */
+Matrix* read_matrix(FILE* file)
+{
+    if(file == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    long start = ftell(file);
+    size_t len = 0;
+    char* text = read_stream(file, &len);
+
+    if(text == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    /* skip leading blank lines */
+    size_t begin = 0;
+
+    while(begin < len && line_is_blank(text + begin))
+    {
+        const char* eol = memchr(text + begin, '\n', len - begin);
+        begin = eol == NULL ? len : (size_t)(eol - text) + 1;
+    }
+
+    /* the first row fixes the number of columns */
+    unsigned int cols = 0;
+
+    if(begin == len || parse_row(text + begin, NULL, 0, &cols) == NULL)
+    {
+        gaisan_free(text);
+        return NULL;
+    }
+
+    /* split the text into runs of whole lines */
+    size_t num_chunks = (len - begin) / READ_TASK_SIZE;
+    unsigned int threads = gaisan_get_num_threads();
+
+    num_chunks = num_chunks > threads ? threads : num_chunks;
+    num_chunks = num_chunks == 0 ? 1 : num_chunks;
+
+    ReadChunk* chunks = gaisan_calloc(num_chunks, sizeof(ReadChunk));
+
+    if(chunks == NULL) /* allocation check */
+    {
+        gaisan_free(text);
+        return NULL;
+    }
+
+    for(size_t c=0;c<num_chunks;c++)
+    {
+        chunks[c].begin = c == 0 ? begin : chunks[c - 1].end;
+        chunks[c].end = len;
+
+        size_t split = begin + (len - begin) / num_chunks * (c + 1);
+
+        if(c + 1 < num_chunks && split > chunks[c].begin)
+        {
+            const char* eol = memchr(text + split, '\n', len - split);
+            chunks[c].end = eol == NULL ? len : (size_t)(eol - text) + 1;
+        }
+        else if(c + 1 < num_chunks)
+        {
+            chunks[c].end = chunks[c].begin;
+        }
+    }
+
+    ReadJob job = {text, chunks, NULL};
+    parallel_for(num_chunks, read_count_task, &job);
+
+    /* the matrix runs up to the first blank line */
+    size_t rows = 0;
+    size_t stop = len;
+    bool failed = false;
+    bool done = false;
+
+    for(size_t c=0;c<num_chunks;c++)
+    {
+        if(done)
+        {
+            chunks[c].rows = 0;
+            continue;
+        }
+
+        chunks[c].first_row = (unsigned int)rows;
+        rows += chunks[c].rows;
+        failed |= chunks[c].failed || rows > UINT_MAX;
+
+        if(chunks[c].blank)
+        {
+            stop = chunks[c].stop;
+            done = true;
+        }
+    }
+
+    Matrix* mat = failed ? NULL : matrix_init((unsigned int)rows, cols);
+
+    if(mat != NULL)
+    {
+        job.mat = mat;
+        parallel_for(num_chunks, read_parse_task, &job);
+
+        for(size_t c=0;c<num_chunks;c++)
+        {
+            if(chunks[c].failed) /* check for failure */
             {
-                free(data[i]);
+                matrix_free(mat);
+                mat = NULL;
+                break;
             }
+        }
+    }
 
-            free(data);
-            free(buf);
-            
-            return NULL;
+    /* hand back whatever follows the matrix */
+    if(mat != NULL && stop < len && start >= 0)
+    {
+        fseek(file, start + (long)stop, SEEK_SET);
+    }
+
+    gaisan_free(chunks);
+    gaisan_free(text);
+
+    return mat;
+}
+
+/**
+ * Returns the row stride (in cells) used for a matrix with `cols` columns
+ *      in a binary matrix file
+ *
+ * @param cols
+ *      number of columns in the matrix
+ *
+ * @return `cols` rounded up to a whole number of `MATRIX_ALIGNMENT` blocks
+ *
+ * */
+static uint64_t matrix_bin_stride(unsigned int cols)
+{
+    uint64_t align = MATRIX_ALIGNMENT / sizeof(long double);
+
+    if(align == 0)
+    {
+        align = 1;
+    }
+
+    return ((cols + align - 1) / align) * align;
+}
+
+/**
+ * Fills in the header of a binary matrix file holding a `rows` by `cols`
+ *      matrix of native `long double`s
+ *
+ * Each row is padded to a whole number of `MATRIX_ALIGNMENT` bytes and the
+ *      first row begins on a `MATRIX_ALIGNMENT` boundary.
+ *
+ * @param header
+ *      the header to fill in
+ * @param rows
+ *      number of rows in the matrix
+ * @param cols
+ *      number of columns in the matrix
+ *
+ * */
+void matrix_bin_header_init(MatrixBinHeader* header, unsigned int rows,
+        unsigned int cols)
+{
+    if(header == NULL) /* null guard */
+    {
+        return;
+    }
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, MATRIX_BIN_MAGIC, sizeof(header->magic));
+    header->version = MATRIX_BIN_VERSION;
+    header->endian = MATRIX_BIN_ENDIAN;
+    header->elem_type = MATRIX_BIN_LONG_DOUBLE;
+    header->elem_size = sizeof(long double);
+    header->mant_dig = LDBL_MANT_DIG;
+    header->rows = rows;
+    header->cols = cols;
+    header->stride = matrix_bin_stride(cols);
+    header->data_offset = ((sizeof(*header) + MATRIX_ALIGNMENT - 1) /
+            MATRIX_ALIGNMENT) * MATRIX_ALIGNMENT;
+}
+
+/**
+ * Validates a binary matrix file header
+ *
+ * @param header
+ *      the header read from the file
+ * @param file_size
+ *      total size (in bytes) of the file, or 0 if unknown
+ *
+ * @return true if the file holds a matrix of native `long double`s that fits
+ *      within `file_size`, false otherwise
+ *
+ * */
+bool matrix_bin_header_check(const MatrixBinHeader* header,
+        uint64_t file_size)
+{
+    if(header == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(memcmp(header->magic, MATRIX_BIN_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != MATRIX_BIN_VERSION)
+    {
+        return false;
+    }
+
+    /* only native byte order and element format can be loaded */
+    if(header->endian != MATRIX_BIN_ENDIAN ||
+            header->elem_type != MATRIX_BIN_LONG_DOUBLE ||
+            header->elem_size != sizeof(long double) ||
+            header->mant_dig != LDBL_MANT_DIG)
+    {
+        return false;
+    }
+
+    if(header->rows == 0 || header->cols == 0 ||
+            header->stride < header->cols || header->stride > UINT_MAX ||
+            header->data_offset < sizeof(MatrixBinHeader) ||
+            header->data_offset % sizeof(long double) != 0) /* bounds check */
+    {
+        return false;
+    }
+
+    if(file_size != 0) /* data must lie entirely within the file */
+    {
+        if(file_size < header->data_offset ||
+                ((file_size - header->data_offset) / sizeof(long double)) /
+                header->stride < header->rows)
+        {
+            return false;
         }
     }
 
-    /* adjust */
-    rows--;
+    return true;
+}
 
-    Matrix* matrix = matrix_init(rows, cols);
+/**
+ * Writes the matrix `mat` to `file` in Gaisan's binary matrix format
+ *
+ * The file consists of a 64-byte header, recording the format version, byte
+ *      order, element type and shape of the matrix, followed by the cells
+ *      stored row-major as raw `long double`s. Each row is padded to a whole
+ *      number of `MATRIX_ALIGNMENT` bytes and the first row begins on a
+ *      `MATRIX_ALIGNMENT` boundary, so the file can be mapped into memory
+ *      and used directly (see `map_matrix_bin`).
+ *
+ * Cells are stored exactly, so a matrix survives a round trip bit-for-bit.
+ *
+ * @param file
+ *      the file to write the matrix to (opened in binary mode)
+ * @param mat
+ *      the matrix being written
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool write_matrix_bin(FILE* file, Matrix* mat)
+{
+    if(file == NULL || mat == NULL) /* null guard */
+    {
+        return false;
+    }
 
-    /* copy data into matrix and free as we go */    
-    for(unsigned int i=0;i<rows;i++)
+    MatrixBinHeader header;
+    matrix_bin_header_init(&header, mat->rows, mat->cols);
+
+    if(fwrite(&header, sizeof(header), 1, file) != 1) /* check for failure */
+    {
+        return false;
+    }
+
+    /* zero padding (after the header and at the end of each row) */
+    static const long double zeros[MATRIX_ALIGNMENT] = {0};
+    size_t header_pad = header.data_offset - sizeof(header);
+    size_t row_pad = header.stride - mat->cols;
+
+    if(header_pad > 0 && fwrite(zeros, 1, header_pad, file) != header_pad)
+    {
+        return false;
+    }
+
+    for(unsigned int i=0;i<mat->rows;i++)
     {
-        for(unsigned int j=0;j<cols;j++)
+        if(fwrite(mat->cells[i], sizeof(long double), mat->cols, file) !=
+                mat->cols) /* check for failure */
         {
-            matrix->cells[i][j] = data[i][j];
+            return false;
         }
 
-        free(data[i]);
+        if(row_pad > 0 &&
+                fwrite(zeros, sizeof(long double), row_pad, file) != row_pad)
+        {
+            return false;
+        }
     }
-   
-    free(data[rows]);
-    free(data);
-    
-    return matrix;
+
+    return fflush(file) == 0;
+}
+
+/**
+ * Discards the next `n` bytes of `file`
+ *
+ * @return true on success, false if the file ended first
+ *
+ * */
+static bool skip_bytes(FILE* file, uint64_t n)
+{
+    for(uint64_t i=0;i<n;i++)
+    {
+        if(fgetc(file) == EOF)
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
+/**
+ * Reads a matrix written by `write_matrix_bin` from `file`, copying it into
+ *      a newly allocated matrix
+ *
+ * Unlike `map_matrix_bin`, this works on any stream (e.g. pipes) and the
+ *      result may be modified freely.
+ *
+ * @param file
+ *      the file to be read from (opened in binary mode)
+ *
+ * @return the matrix contained in `file`, or `NULL` on failure (including
+ *      files written on a machine with a different byte order or
+ *      `long double` format)
+ *
+ * */
+Matrix* read_matrix_bin(FILE* file)
+{
+    if(file == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    MatrixBinHeader header;
+
+    if(fread(&header, sizeof(header), 1, file) != 1 ||
+            !matrix_bin_header_check(&header, 0))
+    {
+        return NULL;
+    }
+
+    if(!skip_bytes(file, header.data_offset - sizeof(header)))
+    {
+        return NULL;
+    }
+
+    Matrix* mat = matrix_init(header.rows, header.cols);
+
+    if(mat == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    uint64_t row_pad = (header.stride - header.cols) * sizeof(long double);
+
+    for(unsigned int i=0;i<mat->rows;i++)
+    {
+        if(fread(mat->cells[i], sizeof(long double), mat->cols, file) !=
+                mat->cols || (i + 1 < mat->rows && !skip_bytes(file, row_pad)))
+        {
+            matrix_free(mat);
+            return NULL;
+        }
+    }
+
+    return mat;
+}
+
+/**
+ * Maps a matrix written by `write_matrix_bin` directly into memory
+ *
+ * No cells are copied or parsed: the returned matrix refers to the file's
+ *      pages, which the operating system loads on first access, so even
+ *      very large matrices open in constant time. The matrix is read-only;
+ *      writing to its cells is undefined behaviour and functions that grow
+ *      it leave it unchanged. Use `matrix_copy` to obtain a modifiable
+ *      matrix. `matrix_free` unmaps the file.
+ *
+ * @param path
+ *      path of the file to map
+ *
+ * @return the (read-only) matrix contained in the file at `path`, or `NULL`
+ *      on failure (including files written on a machine with a different
+ *      byte order or `long double` format)
+ *
+ * */
+Matrix* map_matrix_bin(const char* path)
+{
+    if(path == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0) /* check for failure */
+    {
+        return NULL;
+    }
+
+    struct stat st;
+
+    if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(MatrixBinHeader)
+            || (uint64_t)st.st_size > SIZE_MAX)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    size_t len = (size_t)st.st_size;
+    void* mapping = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); /* the mapping keeps the file alive */
+
+    if(mapping == MAP_FAILED) /* check for failure */
+    {
+        return NULL;
+    }
+
+    const MatrixBinHeader* header = mapping;
+    Matrix* mat = NULL;
+    long double** cells = NULL;
+
+    if(!matrix_bin_header_check(header, len) ||
+            (mat = gaisan_calloc(1, sizeof(Matrix))) == NULL ||
+            (cells = gaisan_calloc(header->rows, sizeof(long double*))) ==
+            NULL)
+    {
+        gaisan_free(mat);
+        munmap(mapping, len);
+        return NULL;
+    }
+
+    mat->rows = header->rows;
+    mat->cols = header->cols;
+    mat->stride = (unsigned int)header->stride;
+    mat->capacity = header->rows;
+    mat->data = (long double*)((char*)mapping + header->data_offset);
+    mat->cells = cells;
+    mat->mapping = mapping;
+    mat->mapping_len = len;
+
+    for(unsigned int i=0;i<mat->rows;i++)
+    {
+        cells[i] = mat->data + (size_t)i * mat->stride;
+    }
+
+    return mat;
+}
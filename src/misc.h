@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "matrix.h"
 
@@ -17,11 +18,50 @@
 
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
 
+/* binary matrix file identification */
+#define MATRIX_BIN_MAGIC "GAISANMX"
+#define MATRIX_BIN_ENDIAN 0x01020304u
+
+/* element type codes for binary matrix files */
+#define MATRIX_BIN_FLOAT 1u
+#define MATRIX_BIN_DOUBLE 2u
+#define MATRIX_BIN_LONG_DOUBLE 3u
+
+/**
+ * Header of a binary matrix file (exactly 64 bytes, written in the byte
+ *      order of the machine that produced the file)
+ *
+ * */
+typedef struct
+{
+    char magic[8]; /* `MATRIX_BIN_MAGIC`, not NULL-terminated */
+    uint32_t version; /* `MATRIX_BIN_VERSION` */
+    uint32_t endian; /* `MATRIX_BIN_ENDIAN` as written by the producer */
+    uint32_t elem_type; /* one of the `MATRIX_BIN_*` element type codes */
+    uint32_t elem_size; /* size (in bytes) of one stored element */
+    uint32_t mant_dig; /* mantissa digits of the element type */
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t reserved0;
+    uint64_t stride; /* elements between the starts of consecutive rows */
+    uint64_t data_offset; /* byte offset of row 0 from the start of file */
+    uint64_t reserved1;
+} MatrixBinHeader;
+
 void print_table(char** labels, long double** data, unsigned int num_rows);
 
 void write_matrix(FILE* file, Matrix* mat);
 Matrix* read_matrix(FILE* file);
 
+bool write_matrix_bin(FILE* file, Matrix* mat);
+Matrix* read_matrix_bin(FILE* file);
+Matrix* map_matrix_bin(const char* path);
+
+void matrix_bin_header_init(MatrixBinHeader* header, unsigned int rows,
+        unsigned int cols);
+bool matrix_bin_header_check(const MatrixBinHeader* header,
+        uint64_t file_size);
+
 void print_matrix(Matrix* mat);
 
 #endif /* MISC_H_ */
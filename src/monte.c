@@ -10,8 +10,29 @@
 #include <time.h>
 #include <math.h>
 
+#include "alloc.h"
 #include "monte.h"
 
+/**
+ * Fills `vec` with pseudorandom values, bounded elementwise by `bounds`
+ *
+ * */
+static void random_fill(unsigned int dim, long double** bounds,
+        long double* vec)
+{
+    /* integer bounds */
+    unsigned int a = 0;
+    unsigned int b = 0;
+
+    for(unsigned int i=0;i<dim;i++) /* construct vector elementwise */
+    {
+        a = floorl(bounds[i][0]);
+        b = floorl(bounds[i][1]);
+
+        vec[i] = rand() % (b + 1 - a) + a;
+    }
+}
+
 /**
  * Generates a pseudorandom vector of length `dim`, bounded elementwise by
  *      `bounds`
@@ -36,24 +57,14 @@ long double* random_vector(unsigned int dim, long double** bounds)
         return NULL;
     }
 
-    long double* vec = calloc(dim, sizeof(long double));
+    long double* vec = gaisan_calloc(dim, sizeof(long double));
 
     if(vec == NULL) /* allocation check */
     {
         return NULL;
     }
 
-    /* integer bounds */
-    unsigned int a = 0;
-    unsigned int b = 0;
-
-    for(unsigned int i=0;i<dim;i++) /* construct vector elementwise */
-    {
-        a = floorl(bounds[i][0]);
-        b = floorl(bounds[i][1]);
-
-        vec[i] = rand() % (b + 1 - a) + a;
-    }
+    random_fill(dim, bounds, vec);
 
     return vec;
 }
@@ -124,25 +135,30 @@ long double monte_carlo(bool (*memb)(long double*, unsigned int),
     srand(time(NULL)); /* seed PRNG */
 
     unsigned int hits = 0;
-    long double* vec = NULL;
 
-    for(unsigned int i=0;i<n;i++) /* generate points */
+    /* one scratch point, refilled for every sample */
+    GaisanArena* arena = gaisan_thread_arena();
+    size_t mark = arena_mark(arena);
+    long double* vec = arena_alloc(arena, dim * sizeof(long double));
+
+    if(vec == NULL) /* check for failure */
     {
-        vec = random_vector(dim, dom); /* construct random point */
+        arena_release(arena, mark);
+        return NAN;
+    }
 
-        if(vec == NULL) /* check for failure */
-        {
-            return NAN;
-        }
+    for(unsigned int i=0;i<n;i++) /* generate points */
+    {
+        random_fill(dim, dom, vec); /* construct random point */
 
         if(memb(vec, dim)) /* check for membership */
         {
             hits++; /* increment hit counter */
         }
-
-        free(vec);
     }
 
+    arena_release(arena, mark);
+
     /* calculate answer */
     long double total_area = nbox_area(dim, dom);
     long double prop = (long double)hits / (long double)n;
@@ -0,0 +1,586 @@
+/**
+ * @file ooc.c
+ * @author Jack McPherson
+ *
+ * Implements out-of-core matrix operations on matrices stored in Gaisan's
+ * binary matrix format (see `write_matrix_bin`).
+ *
+ * Operands are streamed through memory one tile at a time, so the working
+ * set is bounded by a caller-supplied budget rather than by the size of the
+ * problem. While one pair of tiles is being multiplied, the next pair is
+ * read on a separate I/O thread.
+ *
+ * */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "misc.h"
+#include "ooc.h"
+
+/**
+ * An open binary matrix file
+ *
+ * */
+typedef struct
+{
+    int fd;
+    MatrixBinHeader header;
+} OocFile;
+
+/**
+ * A tile of an on-disk matrix, held in memory with leading dimension `ld`
+ *
+ * */
+typedef struct
+{
+    const OocFile* file;
+    unsigned int row; /* first row of the tile within the matrix */
+    unsigned int col; /* first column of the tile within the matrix */
+    unsigned int rows;
+    unsigned int cols;
+    unsigned int ld;
+    long double* data;
+} OocTile;
+
+/**
+ * Work for the I/O thread: the next pair of operand tiles to read
+ *
+ * */
+typedef struct
+{
+    OocTile a;
+    OocTile b;
+    bool ok; /* set by the loader */
+} OocLoad;
+
+/**
+ * The I/O thread of an out-of-core multiply, which performs one posted load
+ *      at a time
+ *
+ * */
+typedef struct
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake; /* signalled when a load is posted or on shutdown */
+    pthread_cond_t done; /* signalled when the posted load completes */
+    OocLoad* load; /* the posted load, NULL once it completes */
+    bool shutdown;
+} OocLoader;
+
+/**
+ * Tiling of an out-of-core product `c = a * b`, with `a` m by k and `b` k by n
+ *
+ * */
+typedef struct
+{
+    const OocFile* a;
+    const OocFile* b;
+    unsigned int m;
+    unsigned int n;
+    unsigned int k;
+    unsigned int mb; /* tile height of `a` and `c` */
+    unsigned int nb; /* tile width of `b` and `c` */
+    unsigned int kb; /* tile width of `a`, height of `b` */
+    unsigned int tiles_n; /* tiles across a row of `c` */
+    unsigned int panels; /* tiles across a row of `a` */
+} OocPlan;
+
+/**
+ * Opens the binary matrix file at `path` and validates its header
+ *
+ * @return true on success, false otherwise (`file->fd` is closed)
+ *
+ * */
+static bool ooc_open(const char* path, OocFile* file)
+{
+    file->fd = open(path, O_RDONLY);
+
+    if(file->fd < 0) /* check for failure */
+    {
+        return false;
+    }
+
+    struct stat st;
+
+    if(fstat(file->fd, &st) != 0 ||
+            pread(file->fd, &file->header, sizeof(file->header), 0) !=
+            (ssize_t)sizeof(file->header) ||
+            !matrix_bin_header_check(&file->header, (uint64_t)st.st_size))
+    {
+        close(file->fd);
+        file->fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Returns whether the descriptors `fd1` and `fd2` refer to the same file
+ *      (or whether either cannot be examined)
+ *
+ * */
+static bool ooc_same_file(int fd1, int fd2)
+{
+    struct stat st1;
+    struct stat st2;
+
+    if(fstat(fd1, &st1) != 0 || fstat(fd2, &st2) != 0) /* check for failure */
+    {
+        return true;
+    }
+
+    return st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino;
+}
+
+/**
+ * Returns the byte offset within `file` of cell `(i, j)`
+ *
+ * */
+static off_t ooc_offset(const OocFile* file, unsigned int i, unsigned int j)
+{
+    return (off_t)(file->header.data_offset + ((uint64_t)i *
+                file->header.stride + j) * sizeof(long double));
+}
+
+/**
+ * Reads or writes exactly `len` bytes at `offset`, retrying short transfers
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+static bool ooc_transfer(int fd, void* buf, size_t len, off_t offset,
+        bool write)
+{
+    char* p = buf;
+
+    while(len > 0)
+    {
+        ssize_t n = write ? pwrite(fd, p, len, offset) :
+            pread(fd, p, len, offset);
+
+        if(n <= 0) /* check for failure */
+        {
+            return false;
+        }
+
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+
+    return true;
+}
+
+/**
+ * Reads (or writes, if `write` is set) `tile` from (to) its file, one row
+ *      segment at a time
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+static bool ooc_tile_io(const OocTile* tile, bool write)
+{
+    for(unsigned int i=0;i<tile->rows;i++)
+    {
+        if(!ooc_transfer(tile->file->fd, tile->data + (size_t)i * tile->ld,
+                    tile->cols * sizeof(long double),
+                    ooc_offset(tile->file, tile->row + i, tile->col), write))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Reads a pair of operand tiles
+ *
+ * */
+static void ooc_load(OocLoad* load)
+{
+    load->ok = ooc_tile_io(&load->a, false) && ooc_tile_io(&load->b, false);
+}
+
+/**
+ * Main loop of the I/O thread
+ *
+ * */
+static void* ooc_loader_main(void* arg)
+{
+    OocLoader* loader = arg;
+
+    pthread_mutex_lock(&loader->lock);
+
+    while(true)
+    {
+        while(loader->load == NULL && !loader->shutdown)
+        {
+            pthread_cond_wait(&loader->wake, &loader->lock);
+        }
+
+        if(loader->load == NULL) /* shut down with nothing pending */
+        {
+            break;
+        }
+
+        OocLoad* load = loader->load;
+        pthread_mutex_unlock(&loader->lock);
+
+        ooc_load(load);
+
+        pthread_mutex_lock(&loader->lock);
+        loader->load = NULL;
+        pthread_cond_signal(&loader->done);
+    }
+
+    pthread_mutex_unlock(&loader->lock);
+
+    return NULL;
+}
+
+/**
+ * Starts the I/O thread
+ *
+ * @return true on success, false otherwise (`loader` is left unused)
+ *
+ * */
+static bool ooc_loader_start(OocLoader* loader)
+{
+    loader->load = NULL;
+    loader->shutdown = false;
+
+    if(pthread_mutex_init(&loader->lock, NULL) != 0) /* check for failure */
+    {
+        return false;
+    }
+
+    if(pthread_cond_init(&loader->wake, NULL) != 0)
+    {
+        pthread_mutex_destroy(&loader->lock);
+        return false;
+    }
+
+    if(pthread_cond_init(&loader->done, NULL) != 0)
+    {
+        pthread_cond_destroy(&loader->wake);
+        pthread_mutex_destroy(&loader->lock);
+        return false;
+    }
+
+    if(pthread_create(&loader->thread, NULL, &ooc_loader_main, loader) != 0)
+    {
+        pthread_cond_destroy(&loader->done);
+        pthread_cond_destroy(&loader->wake);
+        pthread_mutex_destroy(&loader->lock);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Hands `load` to the I/O thread, which must be idle
+ *
+ * */
+static void ooc_loader_post(OocLoader* loader, OocLoad* load)
+{
+    pthread_mutex_lock(&loader->lock);
+    loader->load = load;
+    pthread_cond_signal(&loader->wake);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+/**
+ * Waits until the I/O thread has completed the posted load
+ *
+ * */
+static void ooc_loader_wait(OocLoader* loader)
+{
+    pthread_mutex_lock(&loader->lock);
+
+    while(loader->load != NULL)
+    {
+        pthread_cond_wait(&loader->done, &loader->lock);
+    }
+
+    pthread_mutex_unlock(&loader->lock);
+}
+
+/**
+ * Stops and joins the I/O thread (after any posted load completes)
+ *
+ * */
+static void ooc_loader_stop(OocLoader* loader)
+{
+    pthread_mutex_lock(&loader->lock);
+    loader->shutdown = true;
+    pthread_cond_signal(&loader->wake);
+    pthread_mutex_unlock(&loader->lock);
+
+    pthread_join(loader->thread, NULL);
+
+    pthread_cond_destroy(&loader->done);
+    pthread_cond_destroy(&loader->wake);
+    pthread_mutex_destroy(&loader->lock);
+}
+
+/**
+ * Describes in `load` the operand tiles needed at step `s` of `plan`
+ *
+ * Steps run over the tiles of `c` in row-major order and, for each of them,
+ *      over the panels of the inner dimension.
+ *
+ * */
+static void ooc_step(const OocPlan* plan, uint64_t s, OocLoad* load,
+        long double* a_buf, long double* b_buf)
+{
+    unsigned int p = (unsigned int)(s % plan->panels);
+    unsigned int j = (unsigned int)(s / plan->panels % plan->tiles_n);
+    unsigned int i = (unsigned int)(s / plan->panels / plan->tiles_n);
+
+    unsigned int h = plan->m - i * plan->mb;
+    unsigned int w = plan->n - j * plan->nb;
+    unsigned int d = plan->k - p * plan->kb;
+
+    h = h < plan->mb ? h : plan->mb;
+    w = w < plan->nb ? w : plan->nb;
+    d = d < plan->kb ? d : plan->kb;
+
+    load->a = (OocTile){plan->a, i * plan->mb, p * plan->kb, h, d, plan->kb,
+        a_buf};
+    load->b = (OocTile){plan->b, p * plan->kb, j * plan->nb, d, w, plan->nb,
+        b_buf};
+}
+
+/**
+ * Returns the largest tile edge `t` such that one result tile and two
+ *      (double-buffered) tiles of each operand, all `t` by `t`, fit within
+ *      `budget` bytes
+ *
+ * */
+static unsigned int ooc_tile_size(size_t budget)
+{
+    long double t = sqrtl((long double)budget /
+            (OOC_NUM_TILES * sizeof(long double)));
+
+    if(t >= OOC_TILE_ALIGN) /* keep tiles kernel-friendly */
+    {
+        t = floorl(t / OOC_TILE_ALIGN) * OOC_TILE_ALIGN;
+    }
+
+    return t >= UINT_MAX ? UINT_MAX : (unsigned int)t;
+}
+
+/**
+ * Multiplies two matrices stored on disk, writing the product to disk
+ *
+ * `a_path` and `b_path` name files written by `write_matrix_bin` (or by this
+ *      function). The product is computed tile by tile: each tile of the
+ *      result is accumulated in memory from a row of tiles of `a` and a
+ *      column of tiles of `b`, which are streamed in (the next pair being
+ *      read while the current pair is multiplied), and is then written to
+ *      `c_path`. The result file can be loaded with `map_matrix_bin` or
+ *      `read_matrix_bin`, or passed back to this function.
+ *
+ * At most `budget` bytes of tile buffers are in use at once, whatever the
+ *      size of the operands; I/O grows as the budget shrinks.
+ *
+ * @param a_path
+ *      path of the left operand
+ * @param b_path
+ *      path of the right operand
+ * @param c_path
+ *      path of the result (created or truncated; must not be the same file
+ *          as either operand)
+ * @param budget
+ *      memory budget (in bytes) for tile buffers, or 0 for
+ *          `OOC_DEFAULT_BUDGET`
+ *
+ * @return true on success, false otherwise (including a budget too small to
+ *      hold even 1 by 1 tiles)
+ *
+ * */
+bool matrix_multiply_ooc(const char* a_path, const char* b_path,
+        const char* c_path, size_t budget)
+{
+    if(a_path == NULL || b_path == NULL || c_path == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    unsigned int t = ooc_tile_size(budget == 0 ? OOC_DEFAULT_BUDGET : budget);
+
+    if(t == 0) /* bounds check */
+    {
+        return false;
+    }
+
+    OocFile a;
+    OocFile b;
+
+    if(!ooc_open(a_path, &a))
+    {
+        return false;
+    }
+
+    if(!ooc_open(b_path, &b))
+    {
+        close(a.fd);
+        return false;
+    }
+
+    unsigned int m = a.header.rows;
+    unsigned int k = a.header.cols;
+    unsigned int n = b.header.cols;
+
+    /* tile dimensions (never larger than the matrices themselves) */
+    unsigned int mb = m < t ? m : t;
+    unsigned int nb = n < t ? n : t;
+    unsigned int kb = k < t ? k : t;
+
+    OocFile c;
+    c.fd = -1;
+    matrix_bin_header_init(&c.header, m, n);
+
+    long double* buffers = NULL;
+    bool ok = b.header.rows == k; /* bounds check */
+
+    if(ok) /* open the result without truncating it yet */
+    {
+        c.fd = open(c_path, O_RDWR | O_CREAT, 0644);
+        ok = c.fd >= 0;
+    }
+
+    /* the result must not overwrite an operand (under any name) */
+    if(ok && (ooc_same_file(c.fd, a.fd) || ooc_same_file(c.fd, b.fd)))
+    {
+        close(c.fd);
+        c.fd = -1; /* and so is left untouched below */
+        ok = false;
+    }
+
+    if(ok) /* create the result, zero-filled */
+    {
+        ok = ftruncate(c.fd, 0) == 0 &&
+            ooc_transfer(c.fd, &c.header, sizeof(c.header), 0, true) &&
+            ftruncate(c.fd, ooc_offset(&c, m, 0)) == 0;
+    }
+
+    if(ok)
+    {
+        size_t a_size = (size_t)mb * kb;
+        size_t b_size = (size_t)kb * nb;
+        buffers = gaisan_malloc(((size_t)mb * nb + 2 * a_size + 2 * b_size) *
+                sizeof(long double));
+        ok = buffers != NULL; /* allocation check */
+    }
+
+    if(ok)
+    {
+        unsigned int tiles_m = (m + mb - 1) / mb;
+        OocPlan plan = {&a, &b, m, n, k, mb, nb, kb, (n + nb - 1) / nb,
+            (k + kb - 1) / kb};
+        uint64_t num_steps = (uint64_t)tiles_m * plan.tiles_n * plan.panels;
+
+        long double* a_buf[2] = {buffers + (size_t)mb * nb,
+            buffers + (size_t)mb * nb + (size_t)mb * kb};
+        long double* b_buf[2] = {a_buf[1] + (size_t)mb * kb,
+            a_buf[1] + (size_t)mb * kb + (size_t)kb * nb};
+        OocTile c_tile = {&c, 0, 0, 0, 0, nb, buffers};
+        OocLoad loads[2];
+        OocLoader loader;
+
+        ooc_step(&plan, 0, &loads[0], a_buf[0], b_buf[0]);
+        ooc_load(&loads[0]);
+        ok = loads[0].ok;
+
+        /* one I/O thread serves every step */
+        bool async = ok && num_steps > 1 && ooc_loader_start(&loader);
+
+        for(uint64_t s=0;ok && s<num_steps;s++)
+        {
+            unsigned int cur = (unsigned int)(s % 2);
+            unsigned int nxt = 1 - cur;
+
+            if(s + 1 < num_steps) /* start reading the next pair */
+            {
+                ooc_step(&plan, s + 1, &loads[nxt], a_buf[nxt], b_buf[nxt]);
+
+                if(async)
+                {
+                    ooc_loader_post(&loader, &loads[nxt]);
+                }
+            }
+
+            OocTile* at = &loads[cur].a;
+            OocTile* bt = &loads[cur].b;
+
+            c_tile.row = at->row;
+            c_tile.col = bt->col;
+            c_tile.rows = at->rows;
+            c_tile.cols = bt->cols;
+
+            /* the first panel overwrites the result tile, the rest add */
+            gemm(at->rows, bt->cols, at->cols, 1.0L, at->data, at->ld, 1,
+                    bt->data, bt->ld, 1, at->col == 0 ? 0.0L : 1.0L,
+                    c_tile.data, c_tile.ld, 1);
+
+            if(at->col + at->cols == k) /* result tile complete */
+            {
+                ok = ooc_tile_io(&c_tile, true);
+            }
+
+            if(s + 1 < num_steps)
+            {
+                if(async)
+                {
+                    ooc_loader_wait(&loader);
+                }
+                else /* no thread available, read synchronously */
+                {
+                    ooc_load(&loads[nxt]);
+                }
+
+                ok = ok && loads[nxt].ok;
+            }
+        }
+
+        if(async)
+        {
+            ooc_loader_stop(&loader);
+        }
+    }
+
+    /* tidy up */
+    gaisan_free(buffers);
+    close(a.fd);
+    close(b.fd);
+
+    if(c.fd >= 0 && close(c.fd) != 0)
+    {
+        ok = false;
+    }
+
+    if(!ok && c.fd >= 0) /* don't leave a partial result behind */
+    {
+        unlink(c_path);
+    }
+
+    return ok;
+}
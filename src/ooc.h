@@ -0,0 +1,17 @@
+/**
+ * @file ooc.h
+ * @author Jack McPherson
+ *
+ * Declarations for out-of-core (on-disk) matrix operations.
+ *
+ * */
+#ifndef OOC_H_
+#define OOC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+bool matrix_multiply_ooc(const char* a_path, const char* b_path,
+        const char* c_path, size_t budget);
+
+#endif /* OOC_H_ */
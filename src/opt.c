@@ -7,88 +7,74 @@
  *
  * */
 #include <stdlib.h>
-#include <math.h>
+#include <tgmath.h>
 
 #include "constants.h"
 #include "diff.h"
 #include "opt.h"
 
-long double golden_section_min(long double a, long double b,
-        long double (*f)(long double), long double tol)
-{
-    if(f == NULL) /* null guard */
-    {
-        return NAN;
-    }
-
-    if(tol <= 0)
-    {
-        return NAN;
-    }
-
-    if(a == b)
-    {
-        return NAN;
-    }
-
-    long double min = 0.0;
-
-    long double x_1 = a;
-    long double x_2 = b;
-    long double x_3 = 0.0;
-    long double x_4 = 0.0;
-
-    long double df = 0.0; /* derivative at current minimum */
-
-    do
-    {
-        x_3 = (x_1 + x_2) / GOLDEN_RATIO;
-
-        /* choose x_4 */
-        if(fabs(x_1 - x_3) > fabs(x_2 - x_3)) /* left */
-        {
-            x_4 = (x_1 + x_3) / 2;
-
-            /* tighten bounds */
-            if(f(x_3) < f(x_4)) /* right */
-            {
-                min = x_3;
-                x_1 = x_4;
-                df = cdiff(min, f, DEFAULT_STEP_SIZE);
-                continue;
-            }
-            else /* left */
-            {
-                min = x_4;
-                x_2 = x_3;
-                df = cdiff(min, f, DEFAULT_STEP_SIZE);
-                continue;
-            }
-        }
-        else /* right */
-        {
-            x_4 = (x_2 + x_3) / 2;
-
-            /* tighten bounds */
-            if(f(x_3) < f(x_4)) /* left */
-            {
-                min = x_3;
-                x_2 = x_4;
-                df = cdiff(min, f, DEFAULT_STEP_SIZE);
-                continue;
-            }
-            else /* right */
-            {
-                min = x_4;
-                x_1 = x_3;
-                df = cdiff(min, f, DEFAULT_STEP_SIZE);
-                continue;
-            }
-        }
+/**
+ * Defines the optimisation methods over `T`, with names suffixed by `s`;
+ * derivatives are taken with step size `step`
+ *
+ * */
+#define OPT_DEFINE(T, s, step) \
+    T golden_section_min##s(T a, T b, T (*f)(T), T tol) \
+    { \
+        if(f == NULL) /* null guard */ \
+        { \
+            return NAN; \
+        } \
+        \
+        if(tol <= 0) \
+        { \
+            return NAN; \
+        } \
+        \
+        if(a == b) \
+        { \
+            return NAN; \
+        } \
+        \
+        T x_1 = a < b ? a : b; /* bracket */ \
+        T x_2 = a < b ? b : a; \
+        T x_3 = x_2 - (x_2 - x_1) / (T)GOLDEN_RATIO; /* interior points */ \
+        T x_4 = x_1 + (x_2 - x_1) / (T)GOLDEN_RATIO; \
+        T f_3 = f(x_3); \
+        T f_4 = f(x_4); \
+        \
+        T min = 0.0; \
+        T df = 0.0; /* derivative at current minimum */ \
+        \
+        do \
+        { \
+            /* tighten bounds, reusing one interior point */ \
+            if(f_3 < f_4) /* left */ \
+            { \
+                x_2 = x_4; \
+                x_4 = x_3; \
+                f_4 = f_3; \
+                x_3 = x_2 - (x_2 - x_1) / (T)GOLDEN_RATIO; \
+                f_3 = f(x_3); \
+            } \
+            else /* right */ \
+            { \
+                x_1 = x_3; \
+                x_3 = x_4; \
+                f_3 = f_4; \
+                x_4 = x_1 + (x_2 - x_1) / (T)GOLDEN_RATIO; \
+                f_4 = f(x_4); \
+            } \
+            \
+            min = (x_1 + x_2) / 2; \
+            df = cdiff##s(min, f, step); \
+        } \
+        /* stop once the bracket cannot shrink at this precision */ \
+        while(fabs(df) > tol && x_1 < x_3 && x_4 < x_2); \
+        \
+        return min; \
     }
-    while(fabs(df) > tol);
-
-    return min;
-}
-
 
+OPT_DEFINE(long double, , DEFAULT_STEP_SIZE)
+OPT_DEFINE(double, _d, DEFAULT_STEP_SIZE)
+OPT_DEFINE(float, _f, DEFAULT_STEP_SIZE_F)
@@ -4,15 +4,33 @@
  *
  * Declarations for optimisation methods.
  *
+ * `golden_section_min` is also provided in `double`
+ * (`golden_section_min_d`) and `float` (`golden_section_min_f`), generated
+ * from the same source. The `ggolden_section_min` macro selects among them
+ * by the type of the function being minimised.
+ *
  * */
 #ifndef OPT_H_
 #define OPT_H_
 
+#include "diff.h"
+
 long double newton_min(long double a, long double (*f)(long double),
         long double tol);
 
-long double golden_section_min(long double a, long double b,
-        long double (*f)(long double), long double tol);
+/**
+ * Declares the optimisation methods over `T`, with names suffixed by `s`
+ *
+ * */
+#define OPT_DECLARE(T, s) \
+    T golden_section_min##s(T a, T b, T (*f)(T), T tol);
+
+OPT_DECLARE(long double, )
+OPT_DECLARE(double, _d)
+OPT_DECLARE(float, _f)
 
-#endif /* OPT_H_ */
+#define ggolden_section_min(a, b, f, tol) \
+    SCALAR_SELECT(f, golden_section_min, golden_section_min_d, \
+            golden_section_min_f)(a, b, f, tol)
 
+#endif /* OPT_H_ */
@@ -10,25 +10,33 @@
 
 #include "poly.h"
 
-long double horner(long double x, unsigned int degree, long double* coeffs)
-{
-    if(coeffs == NULL) /* null guard */
-    {
-        return NAN;
-    }
-
-    if(degree == 0) /* trivial case of constant polynomial */
-    {
-        return coeffs[degree];
-    }
-
-    long double y = 0;
-
-    for(unsigned int i=0;i<=degree;i++)
-    {
-        y = y * x + coeffs[i];
+/**
+ * Defines the polynomial methods over `T`, with names suffixed by `s`
+ *
+ * */
+#define POLY_DEFINE(T, s) \
+    T horner##s(T x, unsigned int degree, T* coeffs) \
+    { \
+        if(coeffs == NULL) /* null guard */ \
+        { \
+            return NAN; \
+        } \
+        \
+        if(degree == 0) /* trivial case of constant polynomial */ \
+        { \
+            return coeffs[degree]; \
+        } \
+        \
+        T y = 0; \
+        \
+        for(unsigned int i=0;i<=degree;i++) \
+        { \
+            y = y * x + coeffs[i]; \
+        } \
+        \
+        return y; \
     }
 
-    return y;
-}
-
+POLY_DEFINE(long double, )
+POLY_DEFINE(double, _d)
+POLY_DEFINE(float, _f)
@@ -4,11 +4,29 @@
  *
  * Declarations for polynomial methods.
  *
+ * `horner` is also provided in `double` (`horner_d`) and `float`
+ * (`horner_f`), generated from the same source. The `ghorner` macro selects
+ * among them by the type of the coefficients.
+ *
  * */
 #ifndef POLY_H_
 #define POLY_H_
 
-long double horner(long double x, unsigned int degree, long double* coeffs);
+/**
+ * Declares the polynomial methods over `T`, with names suffixed by `s`
+ *
+ * */
+#define POLY_DECLARE(T, s) \
+    T horner##s(T x, unsigned int degree, T* coeffs);
 
-#endif /* POLY_H_ */
+POLY_DECLARE(long double, )
+POLY_DECLARE(double, _d)
+POLY_DECLARE(float, _f)
+
+#define ghorner(x, degree, coeffs) \
+    _Generic((coeffs), \
+            long double*: horner, \
+            double*: horner_d, \
+            float*: horner_f)(x, degree, coeffs)
 
+#endif /* POLY_H_ */
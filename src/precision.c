@@ -0,0 +1,752 @@
+/**
+ * @file precision.c
+ * @author Jack McPherson
+ *
+ * Implements the `float` and `double` matrix types.
+ *
+ * Both precisions are generated from one template, `PRECISION_DEFINE`,
+ * which mirrors the `long double` code in matrix.c and gemm.c: the same
+ * storage layout, the same guards, and the same packed, cache-blocked GEMM
+ * with its fixed grid of parallel tiles (so results do not depend on the
+ * number of threads). What differs is the microkernel's register tile,
+ * which is sized per precision so that each row of it fills whole vector
+ * registers and the compiler vectorises the update along the row.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "thread.h"
+#include "matrix.h"
+#include "precision.h"
+
+/**
+ * Defines every operation declared by `PRECISION_DECLARE(T, M, p, g)`, with
+ * a GEMM microkernel tile of `MR` x `NR`
+ *
+ * */
+#define PRECISION_DEFINE(T, M, p, g, MR, NR) \
+    /* row stride (in cells) keeping every row MATRIX_ALIGNMENT-aligned */ \
+    static unsigned int p##_padded_stride(unsigned int cols) \
+    { \
+        unsigned int align = MATRIX_ALIGNMENT / sizeof(T); \
+        \
+        if(align == 0) \
+        { \
+            align = 1; \
+        } \
+        \
+        return ((cols + align - 1) / align) * align; \
+    } \
+    \
+    M* p##_init(unsigned int rows, unsigned int cols) \
+    { \
+        if(rows == 0 || cols == 0) /* bounds check */ \
+        { \
+            return NULL; \
+        } \
+        \
+        M* matrix = gaisan_calloc(1, sizeof(M)); \
+        \
+        if(matrix == NULL) /* allocation check */ \
+        { \
+            return NULL; \
+        } \
+        \
+        unsigned int stride = p##_padded_stride(cols); \
+        size_t bytes = (size_t)rows * stride * sizeof(T); \
+        \
+        matrix->data = gaisan_aligned_alloc(MATRIX_ALIGNMENT, bytes); \
+        matrix->cells = gaisan_calloc(rows, sizeof(T*)); \
+        \
+        if(matrix->data == NULL || \
+                matrix->cells == NULL) /* allocation check */ \
+        { \
+            gaisan_free(matrix->data); \
+            gaisan_free(matrix->cells); \
+            gaisan_free(matrix); \
+            return NULL; \
+        } \
+        \
+        memset(matrix->data, 0, bytes); \
+        \
+        for(unsigned int i=0;i<rows;i++) \
+        { \
+            matrix->cells[i] = matrix->data + (size_t)i * stride; \
+        } \
+        \
+        matrix->rows = rows; \
+        matrix->cols = cols; \
+        matrix->stride = stride; \
+        \
+        return matrix; \
+    } \
+    \
+    void p##_free(M* matrix) \
+    { \
+        if(matrix == NULL) /* null guard */ \
+        { \
+            return; \
+        } \
+        \
+        gaisan_free(matrix->data); \
+        gaisan_free(matrix->cells); \
+        gaisan_free(matrix); \
+    } \
+    \
+    M* p##_copy(M* matrix) \
+    { \
+        if(matrix == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        M* res = p##_init(matrix->rows, matrix->cols); \
+        \
+        if(res == NULL) /* check for failure */ \
+        { \
+            return NULL; \
+        } \
+        \
+        for(unsigned int i=0;i<matrix->rows;i++) \
+        { \
+            memcpy(res->cells[i], matrix->cells[i], \
+                    matrix->cols * sizeof(T)); \
+        } \
+        \
+        return res; \
+    } \
+    \
+    M* p##_from_matrix(Matrix* matrix) \
+    { \
+        if(matrix == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        M* res = p##_init(matrix->rows, matrix->cols); \
+        \
+        if(res == NULL) /* check for failure */ \
+        { \
+            return NULL; \
+        } \
+        \
+        for(unsigned int i=0;i<matrix->rows;i++) \
+        { \
+            const long double* row = matrix->cells[i]; \
+            T* row_res = res->cells[i]; \
+            \
+            for(unsigned int j=0;j<matrix->cols;j++) \
+            { \
+                row_res[j] = (T)row[j]; \
+            } \
+        } \
+        \
+        return res; \
+    } \
+    \
+    Matrix* p##_to_matrix(M* matrix) \
+    { \
+        if(matrix == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        Matrix* res = matrix_init(matrix->rows, matrix->cols); \
+        \
+        if(res == NULL) /* check for failure */ \
+        { \
+            return NULL; \
+        } \
+        \
+        for(unsigned int i=0;i<matrix->rows;i++) \
+        { \
+            const T* row = matrix->cells[i]; \
+            long double* row_res = res->cells[i]; \
+            \
+            for(unsigned int j=0;j<matrix->cols;j++) \
+            { \
+                row_res[j] = row[j]; \
+            } \
+        } \
+        \
+        return res; \
+    } \
+    \
+    M* p##_add_into(M* dst, M* a, M* b) \
+    { \
+        if(dst == NULL || a == NULL || b == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        /* bounds check */ \
+        if(a->rows != b->rows || a->cols != b->cols || \
+                dst->rows != a->rows || dst->cols != a->cols) \
+        { \
+            return NULL; \
+        } \
+        \
+        for(unsigned int i=0;i<a->rows;i++) \
+        { \
+            const T* row_a = a->cells[i]; \
+            const T* row_b = b->cells[i]; \
+            T* row_dst = dst->cells[i]; \
+            \
+            for(unsigned int j=0;j<a->cols;j++) \
+            { \
+                row_dst[j] = row_a[j] + row_b[j]; \
+            } \
+        } \
+        \
+        return dst; \
+    } \
+    \
+    M* p##_subtract_into(M* dst, M* a, M* b) \
+    { \
+        if(dst == NULL || a == NULL || b == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        /* bounds check */ \
+        if(a->rows != b->rows || a->cols != b->cols || \
+                dst->rows != a->rows || dst->cols != a->cols) \
+        { \
+            return NULL; \
+        } \
+        \
+        for(unsigned int i=0;i<a->rows;i++) \
+        { \
+            const T* row_a = a->cells[i]; \
+            const T* row_b = b->cells[i]; \
+            T* row_dst = dst->cells[i]; \
+            \
+            for(unsigned int j=0;j<a->cols;j++) \
+            { \
+                row_dst[j] = row_a[j] - row_b[j]; \
+            } \
+        } \
+        \
+        return dst; \
+    } \
+    \
+    M* p##_scale_into(M* dst, T k, M* matrix) \
+    { \
+        if(dst == NULL || matrix == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        /* bounds check */ \
+        if(dst->rows != matrix->rows || dst->cols != matrix->cols) \
+        { \
+            return NULL; \
+        } \
+        \
+        for(unsigned int i=0;i<matrix->rows;i++) \
+        { \
+            const T* row = matrix->cells[i]; \
+            T* row_dst = dst->cells[i]; \
+            \
+            for(unsigned int j=0;j<matrix->cols;j++) \
+            { \
+                row_dst[j] = k * row[j]; \
+            } \
+        } \
+        \
+        return dst; \
+    } \
+    \
+    M* p##_axpy(T k, M* x, M* y) \
+    { \
+        if(x == NULL || y == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        if(x->rows != y->rows || x->cols != y->cols) /* bounds check */ \
+        { \
+            return NULL; \
+        } \
+        \
+        for(unsigned int i=0;i<x->rows;i++) \
+        { \
+            const T* row_x = x->cells[i]; \
+            T* row_y = y->cells[i]; \
+            \
+            for(unsigned int j=0;j<x->cols;j++) \
+            { \
+                row_y[j] += k * row_x[j]; \
+            } \
+        } \
+        \
+        return y; \
+    } \
+    \
+    M* p##_transpose_into(M* dst, M* matrix) \
+    { \
+        if(dst == NULL || matrix == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        /* bounds check */ \
+        if(dst->rows != matrix->cols || dst->cols != matrix->rows) \
+        { \
+            return NULL; \
+        } \
+        \
+        if(dst->data == matrix->data) /* aliasing check */ \
+        { \
+            return NULL; \
+        } \
+        \
+        /* square tiles, so rows read and written both stay in cache */ \
+        for(unsigned int i0=0;i0<matrix->rows;i0+=TRANSPOSE_BLOCK) \
+        { \
+            unsigned int i1 = matrix->rows - i0 < TRANSPOSE_BLOCK ? \
+                matrix->rows : i0 + TRANSPOSE_BLOCK; \
+            \
+            for(unsigned int j0=0;j0<matrix->cols;j0+=TRANSPOSE_BLOCK) \
+            { \
+                unsigned int j1 = matrix->cols - j0 < TRANSPOSE_BLOCK ? \
+                    matrix->cols : j0 + TRANSPOSE_BLOCK; \
+                \
+                for(unsigned int i=i0;i<i1;i++) \
+                { \
+                    const T* row = matrix->cells[i]; \
+                    \
+                    for(unsigned int j=j0;j<j1;j++) \
+                    { \
+                        dst->cells[j][i] = row[j]; \
+                    } \
+                } \
+            } \
+        } \
+        \
+        return dst; \
+    } \
+    \
+    bool p##_equal(M* a, M* b) \
+    { \
+        if(a == NULL || b == NULL) /* null guard */ \
+        { \
+            return false; \
+        } \
+        \
+        if(a->rows != b->rows || a->cols != b->cols) /* different sizes */ \
+        { \
+            return false; \
+        } \
+        \
+        for(unsigned int i=0;i<a->rows;i++) \
+        { \
+            if(memcmp(a->cells[i], b->cells[i], a->cols * sizeof(T)) != 0) \
+            { \
+                for(unsigned int j=0;j<a->cols;j++) /* e.g. 0.0 == -0.0 */ \
+                { \
+                    if(a->cells[i][j] != b->cells[i][j]) \
+                    { \
+                        return false; \
+                    } \
+                } \
+            } \
+        } \
+        \
+        return true; \
+    } \
+    \
+    /* packs an mc x kc block of A into MR-row micro-panels */ \
+    static void g##_pack_a(unsigned int mc, unsigned int kc, const T* a, \
+            unsigned int rsa, unsigned int csa, T* buf) \
+    { \
+        for(unsigned int i=0;i<mc;i+=MR) \
+        { \
+            unsigned int mr = mc - i < MR ? mc - i : MR; \
+            \
+            for(unsigned int q=0;q<kc;q++) \
+            { \
+                const T* col = a + (size_t)i * rsa + (size_t)q * csa; \
+                \
+                for(unsigned int ii=0;ii<MR;ii++) \
+                { \
+                    *buf++ = ii < mr ? col[(size_t)ii * rsa] : (T)0; \
+                } \
+            } \
+        } \
+    } \
+    \
+    /* packs a kc x nc slab of B into NR-column micro-panels */ \
+    static void g##_pack_b(unsigned int kc, unsigned int nc, const T* b, \
+            unsigned int rsb, unsigned int csb, T* buf) \
+    { \
+        for(unsigned int j=0;j<nc;j+=NR) \
+        { \
+            unsigned int nr = nc - j < NR ? nc - j : NR; \
+            \
+            for(unsigned int q=0;q<kc;q++) \
+            { \
+                const T* row = b + (size_t)q * rsb + (size_t)j * csb; \
+                \
+                if(nr == NR && csb == 1) /* contiguous: vector copy */ \
+                { \
+                    memcpy(buf, row, NR * sizeof(T)); \
+                    buf += NR; \
+                    continue; \
+                } \
+                \
+                for(unsigned int jj=0;jj<NR;jj++) \
+                { \
+                    *buf++ = jj < nr ? row[(size_t)jj * csb] : (T)0; \
+                } \
+            } \
+        } \
+    } \
+    \
+    /* C += alpha * A * B for one MR x NR tile, held in vector registers: \
+     * each row of the tile is NR / (vector width) registers wide and the \
+     * inner loop broadcasts one entry of A across them */ \
+    static void g##_microkernel(unsigned int kc, T alpha, \
+            const T* restrict a, const T* restrict b, unsigned int mr, \
+            unsigned int nr, T* c, unsigned int rsc, unsigned int csc) \
+    { \
+        T acc[MR][NR] = {{0}}; \
+        \
+        for(unsigned int q=0;q<kc;q++) \
+        { \
+            for(unsigned int i=0;i<MR;i++) \
+            { \
+                const T a_iq = a[i]; \
+                \
+                for(unsigned int j=0;j<NR;j++) \
+                { \
+                    acc[i][j] += a_iq * b[j]; \
+                } \
+            } \
+            \
+            a += MR; \
+            b += NR; \
+        } \
+        \
+        for(unsigned int i=0;i<mr;i++) \
+        { \
+            for(unsigned int j=0;j<nr;j++) \
+            { \
+                c[(size_t)i * rsc + (size_t)j * csc] += alpha * acc[i][j]; \
+            } \
+        } \
+    } \
+    \
+    /* C += alpha * A * B directly, for small products and when the \
+     * packing buffers cannot be allocated */ \
+    static void g##_direct(unsigned int m, unsigned int n, unsigned int k, \
+            T alpha, const T* a, unsigned int rsa, unsigned int csa, \
+            const T* b, unsigned int rsb, unsigned int csb, T* c, \
+            unsigned int rsc, unsigned int csc) \
+    { \
+        for(unsigned int i=0;i<m;i++) \
+        { \
+            T* row_c = c + (size_t)i * rsc; \
+            \
+            for(unsigned int q=0;q<k;q++) \
+            { \
+                const T a_iq = alpha * a[(size_t)i * rsa + (size_t)q * csa]; \
+                const T* row_b = b + (size_t)q * rsb; \
+                \
+                for(unsigned int j=0;j<n;j++) \
+                { \
+                    row_c[(size_t)j * csc] += a_iq * row_b[(size_t)j * csb]; \
+                } \
+            } \
+        } \
+    } \
+    \
+    /* C += alpha * A * B by the packed, cache-blocked kernel */ \
+    static void g##_blocked(unsigned int m, unsigned int n, unsigned int k, \
+            T alpha, const T* a, unsigned int rsa, unsigned int csa, \
+            const T* b, unsigned int rsb, unsigned int csb, T* c, \
+            unsigned int rsc, unsigned int csc) \
+    { \
+        unsigned int mc_max = m < GEMM_MC ? m : GEMM_MC; \
+        unsigned int kc_max = k < GEMM_KC ? k : GEMM_KC; \
+        unsigned int nc_max = n < GEMM_NC ? n : GEMM_NC; \
+        \
+        mc_max = (mc_max + MR - 1) / MR * MR; \
+        nc_max = (nc_max + NR - 1) / NR * NR; \
+        \
+        size_t a_bytes = (size_t)mc_max * kc_max * sizeof(T); \
+        size_t b_bytes = (size_t)kc_max * nc_max * sizeof(T); \
+        \
+        a_bytes = (a_bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * \
+            MATRIX_ALIGNMENT; \
+        b_bytes = (b_bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * \
+            MATRIX_ALIGNMENT; \
+        \
+        GaisanArena* arena = gaisan_thread_arena(); \
+        size_t mark = arena_mark(arena); \
+        T* a_buf = arena_alloc(arena, a_bytes); \
+        T* b_buf = arena_alloc(arena, b_bytes); \
+        \
+        if(a_buf == NULL || b_buf == NULL) /* allocation check */ \
+        { \
+            arena_release(arena, mark); \
+            g##_direct(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, \
+                    csc); \
+            return; \
+        } \
+        \
+        for(unsigned int jc=0;jc<n;jc+=GEMM_NC) \
+        { \
+            unsigned int nc = n - jc < GEMM_NC ? n - jc : GEMM_NC; \
+            \
+            for(unsigned int pc=0;pc<k;pc+=GEMM_KC) \
+            { \
+                unsigned int kc = k - pc < GEMM_KC ? k - pc : GEMM_KC; \
+                \
+                g##_pack_b(kc, nc, b + (size_t)pc * rsb + \
+                        (size_t)jc * csb, rsb, csb, b_buf); \
+                \
+                for(unsigned int ic=0;ic<m;ic+=GEMM_MC) \
+                { \
+                    unsigned int mc = m - ic < GEMM_MC ? m - ic : GEMM_MC; \
+                    \
+                    g##_pack_a(mc, kc, a + (size_t)ic * rsa + \
+                            (size_t)pc * csa, rsa, csa, a_buf); \
+                    \
+                    for(unsigned int jr=0;jr<nc;jr+=NR) \
+                    { \
+                        unsigned int nr = nc - jr < NR ? nc - jr : NR; \
+                        \
+                        for(unsigned int ir=0;ir<mc;ir+=MR) \
+                        { \
+                            unsigned int mr = mc - ir < MR ? mc - ir : MR; \
+                            \
+                            g##_microkernel(kc, alpha, \
+                                    a_buf + (size_t)ir * kc, \
+                                    b_buf + (size_t)jr * kc, mr, nr, \
+                                    c + (size_t)(ic + ir) * rsc + \
+                                        (size_t)(jc + jr) * csc, \
+                                    rsc, csc); \
+                        } \
+                    } \
+                } \
+            } \
+        } \
+        \
+        arena_release(arena, mark); \
+    } \
+    \
+    /* arguments of a parallel GEMM, shared by every tile task */ \
+    typedef struct \
+    { \
+        unsigned int m; \
+        unsigned int n; \
+        unsigned int k; \
+        T alpha; \
+        const T* a; \
+        unsigned int rsa; \
+        unsigned int csa; \
+        const T* b; \
+        unsigned int rsb; \
+        unsigned int csb; \
+        T* c; \
+        unsigned int rsc; \
+        unsigned int csc; \
+        unsigned int tiles_n; \
+    } g##_job; \
+    \
+    /* computes tile t of a parallel GEMM (tiles are numbered row-major) */ \
+    static void g##_tile(unsigned int t, void* arg) \
+    { \
+        const g##_job* job = arg; \
+        \
+        unsigned int i = (t / job->tiles_n) * GEMM_TILE_M; \
+        unsigned int j = (t % job->tiles_n) * GEMM_TILE_N; \
+        unsigned int m = job->m - i < GEMM_TILE_M ? job->m - i : \
+            GEMM_TILE_M; \
+        unsigned int n = job->n - j < GEMM_TILE_N ? job->n - j : \
+            GEMM_TILE_N; \
+        \
+        g##_blocked(m, n, job->k, job->alpha, \
+                job->a + (size_t)i * job->rsa, job->rsa, job->csa, \
+                job->b + (size_t)j * job->csb, job->rsb, job->csb, \
+                job->c + (size_t)i * job->rsc + (size_t)j * job->csc, \
+                job->rsc, job->csc); \
+    } \
+    \
+    void g(unsigned int m, unsigned int n, unsigned int k, T alpha, \
+            const T* a, unsigned int rsa, unsigned int csa, const T* b, \
+            unsigned int rsb, unsigned int csb, T beta, T* c, \
+            unsigned int rsc, unsigned int csc) \
+    { \
+        if(a == NULL || b == NULL || c == NULL) /* null guard */ \
+        { \
+            return; \
+        } \
+        \
+        if(m == 0 || n == 0) /* trivial case */ \
+        { \
+            return; \
+        } \
+        \
+        for(unsigned int i=0;i<m && beta!=(T)1;i++) /* C = beta * C */ \
+        { \
+            T* row = c + (size_t)i * rsc; \
+            \
+            for(unsigned int j=0;j<n;j++) \
+            { \
+                row[(size_t)j * csc] = beta == (T)0 ? (T)0 : \
+                    beta * row[(size_t)j * csc]; \
+            } \
+        } \
+        \
+        if(k == 0 || alpha == (T)0) /* nothing to accumulate */ \
+        { \
+            return; \
+        } \
+        \
+        /* small products are dominated by packing costs */ \
+        if((size_t)m * n * k < GEMM_SMALL_FLOPS) \
+        { \
+            g##_direct(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, \
+                    csc); \
+            return; \
+        } \
+        \
+        /* a fixed grid of tiles, independent of the number of threads */ \
+        if((size_t)m * n * k >= GEMM_PARALLEL_FLOPS && \
+                gaisan_get_num_threads() > 1) \
+        { \
+            g##_job job = {m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, \
+                rsc, csc, (n + GEMM_TILE_N - 1) / GEMM_TILE_N}; \
+            unsigned int tiles_m = (m + GEMM_TILE_M - 1) / GEMM_TILE_M; \
+            \
+            parallel_for(tiles_m * job.tiles_n, &g##_tile, &job); \
+            \
+            return; \
+        } \
+        \
+        g##_blocked(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, rsc, csc); \
+    } \
+    \
+    M* p##_multiply_into(M* dst, M* a, M* b) \
+    { \
+        if(dst == NULL || a == NULL || b == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        /* bounds check */ \
+        if(a->cols != b->rows || dst->rows != a->rows || \
+                dst->cols != b->cols) \
+        { \
+            return NULL; \
+        } \
+        \
+        if(dst->data == a->data || dst->data == b->data) /* aliasing check */ \
+        { \
+            return NULL; \
+        } \
+        \
+        g(a->rows, b->cols, a->cols, (T)1, a->data, a->stride, 1, b->data, \
+                b->stride, 1, (T)0, dst->data, dst->stride, 1); \
+        \
+        return dst; \
+    } \
+    \
+    M* p##_add(M* a, M* b) \
+    { \
+        if(a == NULL || b == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        M* res = p##_init(a->rows, a->cols); \
+        \
+        if(p##_add_into(res, a, b) == NULL) /* check for failure */ \
+        { \
+            p##_free(res); \
+            return NULL; \
+        } \
+        \
+        return res; \
+    } \
+    \
+    M* p##_subtract(M* a, M* b) \
+    { \
+        if(a == NULL || b == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        M* res = p##_init(a->rows, a->cols); \
+        \
+        if(p##_subtract_into(res, a, b) == NULL) /* check for failure */ \
+        { \
+            p##_free(res); \
+            return NULL; \
+        } \
+        \
+        return res; \
+    } \
+    \
+    M* p##_scale(T k, M* matrix) \
+    { \
+        if(matrix == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        M* res = p##_init(matrix->rows, matrix->cols); \
+        \
+        if(p##_scale_into(res, k, matrix) == NULL) /* check for failure */ \
+        { \
+            p##_free(res); \
+            return NULL; \
+        } \
+        \
+        return res; \
+    } \
+    \
+    M* p##_multiply(M* a, M* b) \
+    { \
+        if(a == NULL || b == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        M* res = p##_init(a->rows, b->cols); \
+        \
+        if(p##_multiply_into(res, a, b) == NULL) /* check for failure */ \
+        { \
+            p##_free(res); \
+            return NULL; \
+        } \
+        \
+        return res; \
+    } \
+    \
+    M* p##_transpose(M* matrix) \
+    { \
+        if(matrix == NULL) /* null guard */ \
+        { \
+            return NULL; \
+        } \
+        \
+        M* res = p##_init(matrix->cols, matrix->rows); \
+        \
+        if(p##_transpose_into(res, matrix) == NULL) /* check for failure */ \
+        { \
+            p##_free(res); \
+            return NULL; \
+        } \
+        \
+        return res; \
+    }
+
+PRECISION_DEFINE(float, MatrixF, matrixf, gemmf, GEMMF_MR, GEMMF_NR)
+PRECISION_DEFINE(double, MatrixD, matrixd, gemmd, GEMMD_MR, GEMMD_NR)
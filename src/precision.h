@@ -0,0 +1,144 @@
+/**
+ * @file precision.h
+ * @author Jack McPherson
+ *
+ * Dense matrices of `float` (`MatrixF`) and `double` (`MatrixD`), and a
+ * precision-generic front door over them and `Matrix`.
+ *
+ * `Matrix` holds `long double`, which on x86-64 is 80-bit x87 arithmetic:
+ * sixteen bytes per element and no SIMD at all. `MatrixF` and `MatrixD`
+ * have the same layout as `Matrix` (aligned, padded rows, `cells[i][j]`
+ * access) but their kernels are plain loops over `float` and `double` which
+ * the compiler vectorises, and their GEMM has a register tile sized for
+ * vector registers rather than the x87 stack. Prefer them wherever the
+ * extra precision of `long double` is not needed.
+ *
+ * Each precision is instantiated from the same template. For each the
+ * following are provided (shown for `double`; the `float` versions are
+ * `matrixf_*` and `gemmf`):
+ *
+ * - `MatrixD* matrixd_init(unsigned int rows, unsigned int cols)`
+ * - `void matrixd_free(MatrixD* matrix)`
+ * - `MatrixD* matrixd_copy(MatrixD* matrix)`
+ * - `MatrixD* matrixd_from_matrix(Matrix* matrix)` (rounds each cell)
+ * - `Matrix* matrixd_to_matrix(MatrixD* matrix)`
+ * - `MatrixD* matrixd_add(MatrixD* a, MatrixD* b)`
+ * - `MatrixD* matrixd_subtract(MatrixD* a, MatrixD* b)`
+ * - `MatrixD* matrixd_scale(double k, MatrixD* matrix)`
+ * - `MatrixD* matrixd_multiply(MatrixD* a, MatrixD* b)`
+ * - `MatrixD* matrixd_transpose(MatrixD* matrix)`
+ * - `MatrixD* matrixd_add_into(MatrixD* dst, MatrixD* a, MatrixD* b)`
+ * - `MatrixD* matrixd_subtract_into(MatrixD* dst, MatrixD* a, MatrixD* b)`
+ * - `MatrixD* matrixd_scale_into(MatrixD* dst, double k, MatrixD* matrix)`
+ * - `MatrixD* matrixd_multiply_into(MatrixD* dst, MatrixD* a, MatrixD* b)`
+ * - `MatrixD* matrixd_transpose_into(MatrixD* dst, MatrixD* matrix)`
+ * - `MatrixD* matrixd_axpy(double k, MatrixD* x, MatrixD* y)`
+ * - `bool matrixd_equal(MatrixD* a, MatrixD* b)`
+ * - `void gemmd(...)`, with the arguments of `gemm` (see gemm.h) in
+ *   `double`
+ *
+ * The `gmatrix_*` macros select the `Matrix`, `MatrixD` or `MatrixF`
+ * version of an operation from the type of its (first matrix) argument, so
+ * code written against them changes precision by changing one declaration.
+ *
+ * */
+#ifndef PRECISION_H_
+#define PRECISION_H_
+
+#include <stdbool.h>
+
+#include "matrix.h"
+
+/**
+ * Declares the matrix type `M` of element type `T`, its operations (named
+ * `p_*`) and its GEMM kernel (named `g`)
+ *
+ * */
+#define PRECISION_DECLARE(T, M, p, g) \
+    typedef struct \
+    { \
+        unsigned int rows; \
+        unsigned int cols; \
+        unsigned int stride; /* leading dimension (elements between rows) */ \
+        T* data; \
+        T** cells; \
+    } M; \
+    \
+    M* p##_init(unsigned int rows, unsigned int cols); \
+    void p##_free(M* matrix); \
+    M* p##_copy(M* matrix); \
+    M* p##_from_matrix(Matrix* matrix); \
+    Matrix* p##_to_matrix(M* matrix); \
+    \
+    M* p##_add(M* a, M* b); \
+    M* p##_subtract(M* a, M* b); \
+    M* p##_scale(T k, M* matrix); \
+    M* p##_multiply(M* a, M* b); \
+    M* p##_transpose(M* matrix); \
+    \
+    M* p##_add_into(M* dst, M* a, M* b); \
+    M* p##_subtract_into(M* dst, M* a, M* b); \
+    M* p##_scale_into(M* dst, T k, M* matrix); \
+    M* p##_multiply_into(M* dst, M* a, M* b); \
+    M* p##_transpose_into(M* dst, M* matrix); \
+    M* p##_axpy(T k, M* x, M* y); \
+    \
+    bool p##_equal(M* a, M* b); \
+    \
+    void g(unsigned int m, unsigned int n, unsigned int k, T alpha, \
+            const T* a, unsigned int rsa, unsigned int csa, const T* b, \
+            unsigned int rsb, unsigned int csb, T beta, T* c, \
+            unsigned int rsc, unsigned int csc);
+
+PRECISION_DECLARE(float, MatrixF, matrixf, gemmf)
+PRECISION_DECLARE(double, MatrixD, matrixd, gemmd)
+
+/**
+ * Selects `long_double`, `dbl` or `flt` according to the type of the
+ * matrix `x`
+ *
+ * */
+#define PRECISION_SELECT(x, long_double, dbl, flt) \
+    _Generic((x), \
+            Matrix*: long_double, \
+            MatrixD*: dbl, \
+            MatrixF*: flt)
+
+#define gmatrix_free(m) \
+    PRECISION_SELECT(m, matrix_free, matrixd_free, matrixf_free)(m)
+#define gmatrix_copy(m) \
+    PRECISION_SELECT(m, matrix_copy, matrixd_copy, matrixf_copy)(m)
+#define gmatrix_add(a, b) \
+    PRECISION_SELECT(a, matrix_add, matrixd_add, matrixf_add)(a, b)
+#define gmatrix_subtract(a, b) \
+    PRECISION_SELECT(a, matrix_subtract, matrixd_subtract, \
+            matrixf_subtract)(a, b)
+#define gmatrix_scale(k, m) \
+    PRECISION_SELECT(m, matrix_scale, matrixd_scale, matrixf_scale)(k, m)
+#define gmatrix_multiply(a, b) \
+    PRECISION_SELECT(a, matrix_multiply, matrixd_multiply, \
+            matrixf_multiply)(a, b)
+#define gmatrix_transpose(m) \
+    PRECISION_SELECT(m, matrix_transpose, matrixd_transpose, \
+            matrixf_transpose)(m)
+#define gmatrix_add_into(dst, a, b) \
+    PRECISION_SELECT(dst, matrix_add_into, matrixd_add_into, \
+            matrixf_add_into)(dst, a, b)
+#define gmatrix_subtract_into(dst, a, b) \
+    PRECISION_SELECT(dst, matrix_subtract_into, matrixd_subtract_into, \
+            matrixf_subtract_into)(dst, a, b)
+#define gmatrix_scale_into(dst, k, m) \
+    PRECISION_SELECT(dst, matrix_scale_into, matrixd_scale_into, \
+            matrixf_scale_into)(dst, k, m)
+#define gmatrix_multiply_into(dst, a, b) \
+    PRECISION_SELECT(dst, matrix_multiply_into, matrixd_multiply_into, \
+            matrixf_multiply_into)(dst, a, b)
+#define gmatrix_transpose_into(dst, m) \
+    PRECISION_SELECT(dst, matrix_transpose_into, matrixd_transpose_into, \
+            matrixf_transpose_into)(dst, m)
+#define gmatrix_axpy(k, x, y) \
+    PRECISION_SELECT(x, matrix_axpy, matrixd_axpy, matrixf_axpy)(k, x, y)
+#define gmatrix_equal(a, b) \
+    PRECISION_SELECT(a, matrix_equal, matrixd_equal, matrixf_equal)(a, b)
+
+#endif /* PRECISION_H_ */
@@ -0,0 +1,775 @@
+/**
+ * @file qr.c
+ * @author Jack McPherson
+ *
+ * Implements blocked Householder QR factorisation and linear least squares.
+ *
+ * Reflectors are generated `QR_BLOCK_SIZE` columns at a time. Each panel's
+ * reflectors are accumulated into the compact WY form `I - V * T * V^T`, so
+ * applying them to the trailing columns (or to right-hand sides) costs two
+ * GEMMs and a small triangular multiply.
+ *
+ * Tall, skinny least-squares problems use TSQR instead: the rows are cut
+ * into cache-sized blocks which are reduced to triangular factors
+ * independently (and in parallel), after which the stacked factors are
+ * reduced in turn. Right-hand sides are carried along as extra columns, so
+ * `Q` is never formed.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <math.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "thread.h"
+#include "matrix.h"
+#include "view.h"
+#include "qr.h"
+
+/**
+ * Forms the explicit `rows` x `nb` matrix V of the panel whose first
+ *      reflector starts at `a` (unit diagonal, zeros above it)
+ *
+ * */
+static void qr_form_v(unsigned int rows, unsigned int nb, const long double* a,
+        unsigned int lda, long double* v)
+{
+    for(unsigned int i=0;i<rows;i++)
+    {
+        for(unsigned int p=0;p<nb;p++)
+        {
+            v[(size_t)i * nb + p] = i > p ? a[(size_t)i * lda + p] :
+                (i == p ? 1.0 : 0.0);
+        }
+    }
+}
+
+/**
+ * Forms the `nb` x `nb` upper triangular T of the compact WY representation
+ *      `H_1 * ... * H_nb = I - V * T * V^T` (`g` is scratch for `V^T * V`)
+ *
+ * */
+static void qr_form_t(unsigned int rows, unsigned int nb, const long double* v,
+        const long double* tau, long double* t, long double* g)
+{
+    gemm(nb, nb, rows, 1.0, v, 1, nb, v, nb, 1, 0.0, g, nb, 1);
+
+    memset(t, 0, (size_t)nb * nb * sizeof(long double));
+
+    for(unsigned int j=0;j<nb;j++)
+    {
+        t[(size_t)j * nb + j] = tau[j];
+
+        /* T[0:j, j] = -tau_j * T[0:j, 0:j] * V[:, 0:j]^T * v_j */
+        for(unsigned int i=0;i<j;i++)
+        {
+            long double sum = 0.0;
+
+            for(unsigned int p=i;p<j;p++)
+            {
+                sum += t[(size_t)i * nb + p] * g[(size_t)p * nb + j];
+            }
+
+            t[(size_t)i * nb + j] = -tau[j] * sum;
+        }
+    }
+}
+
+/**
+ * Computes `C = (I - V * T^T * V^T) * C` (i.e. applies the transpose of a
+ *      block reflector), or `C = (I - V * T * V^T) * C` if `transpose` is
+ *      false, for the `rows` x `cols` matrix C (`w` is scratch of `nb` x
+ *      `cols`)
+ *
+ * */
+static void qr_apply_block(unsigned int rows, unsigned int nb,
+        unsigned int cols, const long double* v, const long double* t,
+        long double* c, unsigned int ldc, long double* w, bool transpose)
+{
+    /* W = V^T * C */
+    gemm(nb, cols, rows, 1.0, v, 1, nb, c, ldc, 1, 0.0, w, cols, 1);
+
+    if(transpose) /* W = T^T * W, bottom row first so inputs are intact */
+    {
+        for(unsigned int i=nb;i-->0;)
+        {
+            long double* row_i = w + (size_t)i * cols;
+            const long double t_ii = t[(size_t)i * nb + i];
+
+            for(unsigned int l=0;l<cols;l++)
+            {
+                row_i[l] *= t_ii;
+            }
+
+            for(unsigned int p=0;p<i;p++)
+            {
+                const long double t_pi = t[(size_t)p * nb + i];
+                const long double* row_p = w + (size_t)p * cols;
+
+                for(unsigned int l=0;l<cols;l++)
+                {
+                    row_i[l] += t_pi * row_p[l];
+                }
+            }
+        }
+    }
+    else /* W = T * W, top row first */
+    {
+        for(unsigned int i=0;i<nb;i++)
+        {
+            long double* row_i = w + (size_t)i * cols;
+            const long double t_ii = t[(size_t)i * nb + i];
+
+            for(unsigned int l=0;l<cols;l++)
+            {
+                row_i[l] *= t_ii;
+            }
+
+            for(unsigned int p=i + 1;p<nb;p++)
+            {
+                const long double t_ip = t[(size_t)i * nb + p];
+                const long double* row_p = w + (size_t)p * cols;
+
+                for(unsigned int l=0;l<cols;l++)
+                {
+                    row_i[l] += t_ip * row_p[l];
+                }
+            }
+        }
+    }
+
+    /* C -= V * W */
+    gemm(rows, cols, nb, -1.0, v, nb, 1, w, cols, 1, 1.0, c, ldc, 1);
+}
+
+/**
+ * Generates Householder reflectors for the `nb` columns of the `rows`-tall
+ *      panel at `a`, applying each one to the remaining columns of the panel
+ *      only (`w` is scratch of `nb` cells)
+ *
+ * */
+static void qr_panel(unsigned int rows, unsigned int nb, long double* a,
+        unsigned int lda, long double* tau, long double* w)
+{
+    for(unsigned int j=rows;j<nb;j++) /* no rows left to reflect */
+    {
+        tau[j] = 0.0;
+    }
+
+    for(unsigned int j=0;j<nb && j<rows;j++)
+    {
+        long double* row_j = a + (size_t)j * lda;
+        long double alpha = row_j[j];
+        long double sigma = 0.0;
+
+        for(unsigned int i=j+1;i<rows;i++)
+        {
+            long double x = a[(size_t)i * lda + j];
+            sigma += x * x;
+        }
+
+        if(sigma == 0.0) /* already reduced, H_j = I */
+        {
+            tau[j] = 0.0;
+            continue;
+        }
+
+        long double norm = sqrtl(alpha * alpha + sigma);
+        long double beta = alpha >= 0.0 ? -norm : norm;
+        long double scale = 1.0 / (alpha - beta);
+
+        tau[j] = (beta - alpha) / beta;
+        row_j[j] = beta;
+
+        for(unsigned int i=j+1;i<rows;i++)
+        {
+            a[(size_t)i * lda + j] *= scale;
+        }
+
+        /* w = v^T * A[j:, j+1:nb], then A -= tau * v * w */
+        for(unsigned int l=j+1;l<nb;l++)
+        {
+            w[l] = row_j[l];
+        }
+
+        for(unsigned int i=j+1;i<rows;i++)
+        {
+            const long double* row_i = a + (size_t)i * lda;
+
+            for(unsigned int l=j+1;l<nb;l++)
+            {
+                w[l] += row_i[j] * row_i[l];
+            }
+        }
+
+        for(unsigned int l=j+1;l<nb;l++)
+        {
+            row_j[l] -= tau[j] * w[l];
+        }
+
+        for(unsigned int i=j+1;i<rows;i++)
+        {
+            long double* row_i = a + (size_t)i * lda;
+
+            for(unsigned int l=j+1;l<nb;l++)
+            {
+                row_i[l] -= tau[j] * row_i[j] * w[l];
+            }
+        }
+    }
+}
+
+/**
+ * Factorises the first `k` columns of the `m` x `n` matrix at `a` in place,
+ *      applying the reflectors to all `n` columns
+ *
+ * @return true on success, false on allocation failure
+ *
+ * */
+static bool qr_householder(unsigned int m, unsigned int n, unsigned int k,
+        long double* a, unsigned int lda, long double* tau)
+{
+    unsigned int nb_max = k < QR_BLOCK_SIZE ? k : QR_BLOCK_SIZE;
+
+    if(nb_max == 0) /* trivial case */
+    {
+        return true;
+    }
+
+    long double* v = gaisan_malloc((size_t)m * nb_max * sizeof(long double));
+    long double* t = gaisan_malloc((size_t)nb_max * nb_max *
+            sizeof(long double));
+    long double* g = gaisan_malloc((size_t)nb_max * nb_max *
+            sizeof(long double));
+    long double* w = gaisan_malloc((size_t)nb_max * n * sizeof(long double));
+
+    if(v == NULL || t == NULL || g == NULL || w == NULL) /* allocation check */
+    {
+        gaisan_free(v);
+        gaisan_free(t);
+        gaisan_free(g);
+        gaisan_free(w);
+        return false;
+    }
+
+    for(unsigned int j=0;j<k;j+=QR_BLOCK_SIZE)
+    {
+        unsigned int nb = k - j < QR_BLOCK_SIZE ? k - j : QR_BLOCK_SIZE;
+        unsigned int rows = m - j;
+        long double* panel = a + (size_t)j * lda + j;
+
+        qr_panel(rows, nb, panel, lda, tau + j, w);
+
+        if(j + nb >= n)
+        {
+            continue;
+        }
+
+        /* apply the panel's block reflector to the trailing columns */
+        qr_form_v(rows, nb, panel, lda, v);
+        qr_form_t(rows, nb, v, tau + j, t, g);
+        qr_apply_block(rows, nb, n - j - nb, v, t, panel + nb, lda, w,
+                true);
+    }
+
+    gaisan_free(v);
+    gaisan_free(t);
+    gaisan_free(g);
+    gaisan_free(w);
+
+    return true;
+}
+
+/**
+ * Computes the Householder QR factorisation of the matrix `A`
+ *
+ * @param A
+ *      the `m` x `n` matrix to factorise, with `m >= n` (not modified)
+ *
+ * @return the factorisation, or `NULL` on failure
+ *
+ * */
+QR* qr_factor(Matrix* A)
+{
+    return qr_factor_view(matrix_view(A));
+}
+
+/**
+ * Computes the Householder QR factorisation of the matrix viewed by `A`
+ *
+ * @param A
+ *      view of the `m` x `n` matrix to factorise, with `m >= n` (not
+ *          modified)
+ *
+ * @return the factorisation, or `NULL` on failure
+ *
+ * */
+QR* qr_factor_view(MatrixView A)
+{
+    if(A.data == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(A.rows < A.cols) /* bounds check */
+    {
+        return NULL;
+    }
+
+    QR* qr = gaisan_calloc(1, sizeof(QR));
+
+    if(qr == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    qr->factors = matrix_init(A.rows, A.cols);
+    qr->tau = gaisan_calloc(A.cols, sizeof(long double));
+
+    if(qr->factors == NULL || qr->tau == NULL) /* check for failure */
+    {
+        qr_free(qr);
+        return NULL;
+    }
+
+    view_copy(matrix_view(qr->factors), A);
+
+    if(!qr_householder(A.rows, A.cols, A.cols, qr->factors->data,
+                qr->factors->stride, qr->tau))
+    {
+        qr_free(qr);
+        return NULL;
+    }
+
+    return qr;
+}
+
+/**
+ * Frees memory consumed by `qr`
+ *
+ * @param qr
+ *      the factorisation to be free'd
+ *
+ * */
+void qr_free(QR* qr)
+{
+    if(qr == NULL) /* null guard */
+    {
+        return;
+    }
+
+    matrix_free(qr->factors);
+    gaisan_free(qr->tau);
+    gaisan_free(qr);
+}
+
+/**
+ * Computes `Q^T * b` using the factorisation `qr`
+ *
+ * @param qr
+ *      the factorisation of `A`
+ * @param b
+ *      the matrix to be multiplied (`m` rows)
+ *
+ * @return `Q^T * b`, or `NULL` on failure
+ *
+ * */
+Matrix* qr_apply_qt(QR* qr, Matrix* b)
+{
+    if(qr == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    unsigned int m = qr->factors->rows;
+    unsigned int n = qr->factors->cols;
+    unsigned int lda = qr->factors->stride;
+
+    if(b->rows != m) /* bounds check */
+    {
+        return NULL;
+    }
+
+    Matrix* y = matrix_copy(b);
+
+    if(y == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    unsigned int nb_max = n < QR_BLOCK_SIZE ? n : QR_BLOCK_SIZE;
+
+    long double* v = gaisan_malloc((size_t)m * nb_max * sizeof(long double));
+    long double* t = gaisan_malloc((size_t)nb_max * nb_max *
+            sizeof(long double));
+    long double* g = gaisan_malloc((size_t)nb_max * nb_max *
+            sizeof(long double));
+    long double* w = gaisan_malloc((size_t)nb_max * b->cols *
+            sizeof(long double));
+
+    if(v == NULL || t == NULL || g == NULL || w == NULL) /* allocation check */
+    {
+        gaisan_free(v);
+        gaisan_free(t);
+        gaisan_free(g);
+        gaisan_free(w);
+        matrix_free(y);
+        return NULL;
+    }
+
+    for(unsigned int j=0;j<n;j+=QR_BLOCK_SIZE)
+    {
+        unsigned int nb = n - j < QR_BLOCK_SIZE ? n - j : QR_BLOCK_SIZE;
+        unsigned int rows = m - j;
+
+        qr_form_v(rows, nb, qr->factors->data + (size_t)j * lda + j, lda, v);
+        qr_form_t(rows, nb, v, qr->tau + j, t, g);
+        qr_apply_block(rows, nb, y->cols, v, t,
+                y->data + (size_t)j * y->stride, y->stride, w, true);
+    }
+
+    gaisan_free(v);
+    gaisan_free(t);
+    gaisan_free(g);
+    gaisan_free(w);
+
+    return y;
+}
+
+/**
+ * Forms the leading `n` columns of `Q` explicitly from the factorisation
+ *      `qr` of an `m` x `n` matrix
+ *
+ * The blocks of reflectors are applied to the first `n` columns of the
+ *      identity in reverse order, each one touching only the rows and
+ *      columns it can change.
+ *
+ * @param qr
+ *      the factorisation of `A`
+ *
+ * @return the `m` x `n` matrix of orthonormal columns, or `NULL` on failure
+ *
+ * */
+Matrix* qr_form_q(QR* qr)
+{
+    if(qr == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    unsigned int m = qr->factors->rows;
+    unsigned int n = qr->factors->cols;
+    unsigned int lda = qr->factors->stride;
+    Matrix* q = matrix_init(m, n);
+
+    if(q == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        q->cells[i][i] = 1.0;
+    }
+
+    unsigned int nb_max = n < QR_BLOCK_SIZE ? n : QR_BLOCK_SIZE;
+
+    if(nb_max == 0) /* trivial case */
+    {
+        return q;
+    }
+
+    long double* v = gaisan_malloc((size_t)m * nb_max * sizeof(long double));
+    long double* t = gaisan_malloc((size_t)nb_max * nb_max *
+            sizeof(long double));
+    long double* g = gaisan_malloc((size_t)nb_max * nb_max *
+            sizeof(long double));
+    long double* w = gaisan_malloc((size_t)nb_max * n * sizeof(long double));
+
+    if(v == NULL || t == NULL || g == NULL || w == NULL) /* allocation check */
+    {
+        gaisan_free(v);
+        gaisan_free(t);
+        gaisan_free(g);
+        gaisan_free(w);
+        matrix_free(q);
+        return NULL;
+    }
+
+    /* Q = H_1 * ... * H_n, so the last block acts first; columns to the left
+     * of a block are still zero in the rows it touches */
+    for(unsigned int j=((n - 1) / QR_BLOCK_SIZE) * QR_BLOCK_SIZE;;
+            j-=QR_BLOCK_SIZE)
+    {
+        unsigned int nb = n - j < QR_BLOCK_SIZE ? n - j : QR_BLOCK_SIZE;
+        unsigned int rows = m - j;
+
+        qr_form_v(rows, nb, qr->factors->data + (size_t)j * lda + j, lda, v);
+        qr_form_t(rows, nb, v, qr->tau + j, t, g);
+        qr_apply_block(rows, nb, n - j, v, t,
+                q->data + (size_t)j * q->stride + j, q->stride, w, false);
+
+        if(j == 0)
+        {
+            break;
+        }
+    }
+
+    gaisan_free(v);
+    gaisan_free(t);
+    gaisan_free(g);
+    gaisan_free(w);
+
+    return q;
+}
+
+/**
+ * Solves `R * x = y` for the leading `n` rows of `y`, where `R` is the upper
+ *      triangle of the `n` x `n` block at `r`
+ *
+ * @return `x` (`n` x `cols`), or `NULL` if `R` is singular
+ *
+ * */
+static Matrix* qr_back_substitute(unsigned int n, const long double* r,
+        unsigned int ldr, unsigned int cols, const long double* y,
+        unsigned int ldy)
+{
+    for(unsigned int i=0;i<n;i++)
+    {
+        if(r[(size_t)i * ldr + i] == 0.0) /* rank deficient */
+        {
+            return NULL;
+        }
+    }
+
+    Matrix* x = matrix_init(n, cols);
+
+    if(x == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        memcpy(x->data + (size_t)i * x->stride, y + (size_t)i * ldy,
+                cols * sizeof(long double));
+    }
+
+    trsm_upper(false, n, cols, r, ldr, 1, x->data, x->stride);
+
+    return x;
+}
+
+/**
+ * Solves the least-squares problem `min ||A * x - b||` using the
+ *      factorisation `qr` of `A`
+ *
+ * @param qr
+ *      the factorisation of `A` (`m` x `n`)
+ * @param b
+ *      the right-hand side(s), one per column (`m` rows)
+ *
+ * @return the `n`-row solution `x`, or `NULL` on failure (including when `A`
+ *      is rank deficient)
+ *
+ * */
+Matrix* qr_solve(QR* qr, Matrix* b)
+{
+    Matrix* y = qr_apply_qt(qr, b);
+
+    if(y == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    Matrix* x = qr_back_substitute(qr->factors->cols, qr->factors->data,
+            qr->factors->stride, y->cols, y->data, y->stride);
+
+    matrix_free(y);
+
+    return x;
+}
+
+/**
+ * Arguments of the leaf reductions of a TSQR
+ *
+ * */
+typedef struct
+{
+    unsigned int m; /* rows of the augmented matrix [A | b] */
+    unsigned int n; /* columns of A */
+    unsigned int cols; /* columns of [A | b] */
+    unsigned int block; /* rows per leaf */
+    const long double* a;
+    unsigned int lda;
+    long double* out; /* stacked n x cols triangles, one per leaf */
+    atomic_bool failed;
+} TsqrJob;
+
+/**
+ * Reduces leaf `i` of a TSQR to an `n` x `cols` upper trapezoid
+ *
+ * */
+static void tsqr_leaf(unsigned int i, void* arg)
+{
+    TsqrJob* job = arg;
+
+    unsigned int start = i * job->block;
+    unsigned int rows = job->m - start < job->block ? job->m - start :
+        job->block;
+    unsigned int k = rows < job->n ? rows : job->n;
+
+    long double* buf = gaisan_malloc((size_t)rows * job->cols *
+            sizeof(long double));
+    long double* tau = gaisan_malloc(job->n * sizeof(long double));
+    long double* out = job->out + (size_t)i * job->n * job->cols;
+
+    if(buf == NULL || tau == NULL) /* allocation check */
+    {
+        gaisan_free(buf);
+        gaisan_free(tau);
+        atomic_store(&job->failed, true);
+        return;
+    }
+
+    for(unsigned int r=0;r<rows;r++)
+    {
+        memcpy(buf + (size_t)r * job->cols,
+                job->a + (size_t)(start + r) * job->lda,
+                job->cols * sizeof(long double));
+    }
+
+    if(!qr_householder(rows, job->cols, k, buf, job->cols, tau))
+    {
+        atomic_store(&job->failed, true);
+    }
+
+    /* keep the upper trapezoid; short leaves are padded with zero rows */
+    memset(out, 0, (size_t)job->n * job->cols * sizeof(long double));
+
+    for(unsigned int r=0;r<k;r++)
+    {
+        memcpy(out + (size_t)r * job->cols + r,
+                buf + (size_t)r * job->cols + r,
+                (job->cols - r) * sizeof(long double));
+    }
+
+    gaisan_free(buf);
+    gaisan_free(tau);
+}
+
+/**
+ * Reduces the `m` x `cols` augmented matrix `[A | b]` at `a` so that its
+ *      leading `n` rows hold `[R | Q^T b]`, written to `out` (`n` x `cols`)
+ *
+ * @return true on success, false on failure
+ *
+ * */
+static bool tsqr(unsigned int m, unsigned int n, unsigned int cols,
+        const long double* a, unsigned int lda, long double* out)
+{
+    unsigned int block = TSQR_BLOCK_ROWS < 2 * n ? 2 * n : TSQR_BLOCK_ROWS;
+    unsigned int leaves = (m + block - 1) / block;
+
+    if(leaves == 1) /* small enough to factorise directly */
+    {
+        TsqrJob job = {m, n, cols, block, a, lda, out, false};
+        tsqr_leaf(0, &job);
+        return !atomic_load(&job.failed);
+    }
+
+    long double* stacked = gaisan_malloc((size_t)leaves * n * cols *
+            sizeof(long double));
+
+    if(stacked == NULL) /* allocation check */
+    {
+        return false;
+    }
+
+    TsqrJob job = {m, n, cols, block, a, lda, stacked, false};
+
+    parallel_for(leaves, &tsqr_leaf, &job);
+
+    bool ok = !atomic_load(&job.failed) &&
+        tsqr(leaves * n, n, cols, stacked, cols, out);
+
+    gaisan_free(stacked);
+
+    return ok;
+}
+
+/**
+ * Solves the linear least-squares problem `min ||A * x - b||`
+ *
+ * Tall, skinny problems (at least `TSQR_MIN_ASPECT` times as many rows as
+ *      columns) are reduced with TSQR; all others with a blocked Householder
+ *      QR of `[A | b]`.
+ *
+ * @param A
+ *      the `m` x `n` coefficient matrix, with `m >= n` and full column rank
+ * @param b
+ *      the right-hand side(s), one per column (`m` rows)
+ *
+ * @return the `n`-row solution `x`, or `NULL` on failure (including when `A`
+ *      is rank deficient)
+ *
+ * */
+Matrix* qr_least_squares(Matrix* A, Matrix* b)
+{
+    if(A == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(A->rows < A->cols || b->rows != A->rows) /* bounds check */
+    {
+        return NULL;
+    }
+
+    /* right-hand sides ride along as extra columns */
+    Matrix* ab = matrix_right_augment(A, b);
+
+    if(ab == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    unsigned int m = A->rows;
+    unsigned int n = A->cols;
+    Matrix* x = NULL;
+
+    if(m >= TSQR_MIN_ASPECT * n && m > 2 * TSQR_BLOCK_ROWS)
+    {
+        long double* r = gaisan_malloc((size_t)n * ab->cols *
+                sizeof(long double));
+
+        if(r != NULL && tsqr(m, n, ab->cols, ab->data, ab->stride, r))
+        {
+            x = qr_back_substitute(n, r, ab->cols, b->cols, r + n, ab->cols);
+        }
+
+        gaisan_free(r);
+    }
+    else
+    {
+        long double* tau = gaisan_malloc(n * sizeof(long double));
+
+        if(tau != NULL && qr_householder(m, ab->cols, n, ab->data, ab->stride,
+                    tau))
+        {
+            x = qr_back_substitute(n, ab->data, ab->stride, b->cols,
+                    ab->data + n, ab->stride);
+        }
+
+        gaisan_free(tau);
+    }
+
+    matrix_free(ab);
+
+    return x;
+}
+
@@ -0,0 +1,39 @@
+/**
+ * @file qr.h
+ * @author Jack McPherson
+ *
+ * Declarations for Householder QR factorisation and least-squares solves.
+ *
+ * */
+#ifndef QR_H_
+#define QR_H_
+
+#include "matrix.h"
+#include "view.h"
+
+/**
+ * Householder QR factorisation `A = Q * R` of an `m` x `n` matrix (`m >= n`)
+ *
+ * `factors` holds `R` in its upper triangle and the Householder vectors
+ * (with implicit unit leading entries) below the diagonal; `tau` holds the
+ * `n` Householder scalars, so that `Q = H_1 * ... * H_n` with
+ * `H_i = I - tau[i] * v_i * v_i^T`.
+ *
+ * */
+typedef struct
+{
+    Matrix* factors;
+    long double* tau;
+} QR;
+
+QR* qr_factor(Matrix* A);
+QR* qr_factor_view(MatrixView A);
+void qr_free(QR* qr);
+
+Matrix* qr_apply_qt(QR* qr, Matrix* b);
+Matrix* qr_form_q(QR* qr);
+Matrix* qr_solve(QR* qr, Matrix* b);
+Matrix* qr_least_squares(Matrix* A, Matrix* b);
+
+#endif /* QR_H_ */
+
@@ -0,0 +1,535 @@
+/**
+ * @file refine.c
+ * @author Jack McPherson
+ *
+ * Implements mixed-precision iterative refinement for dense linear systems.
+ *
+ * `A` is rounded to `float` or `double` and factorised there by a blocked,
+ * right-looking LU with partial pivoting (the same algorithm as lu.c, but
+ * with the vectorised GEMM of precision.c doing the trailing updates). The
+ * O(n^3) work therefore runs at single or double precision speed. Each
+ * refinement step then costs O(n^2): the residual `r = b - A * x` is formed
+ * in `long double` from the original `A`, the correction `A * d = r` is
+ * solved with the low precision factors, and `x += d` is accumulated in
+ * `long double`.
+ *
+ * Each step shrinks the error by roughly `cond(A)` times the unit roundoff
+ * of the factorisation, so for matrices that are not too ill-conditioned a
+ * few steps reach `long double` accuracy (a normwise backward error of
+ * `sqrt(n)` times `LDBL_EPSILON`, the test used by LAPACK's `dsgesv`). If
+ * the backward error stops falling, the factorisation is singular in the
+ * lower precision or `A` does not fit in its range, the system is instead
+ * solved by `lu_factor` and `lu_solve` in `long double`.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <float.h>
+#include <tgmath.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "precision.h"
+#include "lu.h"
+#include "refine.h"
+
+/**
+ * Returns the largest magnitude of any entry of `matrix`
+ *
+ * */
+static long double refine_max_abs(Matrix* matrix)
+{
+    long double max = 0.0;
+
+    for(unsigned int i=0;i<matrix->rows;i++)
+    {
+        const long double* row = matrix->cells[i];
+
+        for(unsigned int j=0;j<matrix->cols;j++)
+        {
+            max = fmaxl(max, fabsl(row[j]));
+        }
+    }
+
+    return max;
+}
+
+/**
+ * Returns the infinity norm (largest absolute row sum) of `matrix`
+ *
+ * */
+static long double refine_norm_inf(Matrix* matrix)
+{
+    long double norm = 0.0;
+
+    for(unsigned int i=0;i<matrix->rows;i++)
+    {
+        const long double* row = matrix->cells[i];
+        long double sum = 0.0;
+
+        for(unsigned int j=0;j<matrix->cols;j++)
+        {
+            sum += fabsl(row[j]);
+        }
+
+        norm = fmaxl(norm, sum);
+    }
+
+    return norm;
+}
+
+/**
+ * Computes `r = b - A * x` in `long double`, and returns the largest
+ *      normwise backward error `||r_j|| / (||A|| * ||x_j||)` over the
+ *      columns `j`, via `error`; returns whether every column meets the
+ *      convergence test `||r_j|| <= ||x_j|| * tol`
+ *
+ * */
+static bool refine_residual(Matrix* A, Matrix* b, Matrix* x, Matrix* r,
+        long double anorm, long double tol, long double* error)
+{
+    unsigned int n = A->rows;
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        memcpy(r->cells[i], b->cells[i], b->cols * sizeof(long double));
+    }
+
+    gemm(n, b->cols, n, -1.0, A->data, A->stride, 1, x->data, x->stride, 1,
+            1.0, r->data, r->stride, 1);
+
+    bool converged = true;
+
+    *error = 0.0;
+
+    for(unsigned int j=0;j<b->cols;j++)
+    {
+        long double rnorm = 0.0;
+        long double xnorm = 0.0;
+
+        for(unsigned int i=0;i<n;i++)
+        {
+            rnorm = fmaxl(rnorm, fabsl(r->cells[i][j]));
+            xnorm = fmaxl(xnorm, fabsl(x->cells[i][j]));
+        }
+
+        if(rnorm > xnorm * tol)
+        {
+            converged = false;
+        }
+
+        if(rnorm > 0.0) /* a zero residual is a zero error, even if x = 0 */
+        {
+            long double scale = anorm * xnorm;
+
+            *error = fmaxl(*error, scale > 0.0 ? rnorm / scale : LDBL_MAX);
+        }
+    }
+
+    return converged;
+}
+
+/**
+ * Defines the refinement driver `refine_##s` over the matrix type `M` of
+ *      element type `T` (operations `p_*`, GEMM `g`), whose largest finite
+ *      value is `max`
+ *
+ * */
+#define REFINE_DEFINE(T, M, p, g, s, max) \
+    /* factorises the panel of columns [j0, j0 + nb) as lu.c's lu_panel, \
+     * returning false at the first zero pivot */ \
+    static bool refine_panel_##s(unsigned int n, unsigned int j0, \
+            unsigned int nb, T* a, unsigned int lda, unsigned int* perm) \
+    { \
+        for(unsigned int j=j0;j<j0+nb;j++) \
+        { \
+            /* partial pivoting: largest magnitude in column j */ \
+            unsigned int piv = j; \
+            T max_val = fabs(a[(size_t)j * lda + j]); \
+            \
+            for(unsigned int i=j+1;i<n;i++) \
+            { \
+                if(fabs(a[(size_t)i * lda + j]) > max_val) \
+                { \
+                    max_val = fabs(a[(size_t)i * lda + j]); \
+                    piv = i; \
+                } \
+            } \
+            \
+            if(max_val == 0.0) /* singular in this precision */ \
+            { \
+                return false; \
+            } \
+            \
+            if(piv != j) \
+            { \
+                T* row_j = a + (size_t)j * lda; \
+                T* row_p = a + (size_t)piv * lda; \
+                \
+                for(unsigned int l=0;l<n;l++) \
+                { \
+                    T tmp = row_j[l]; \
+                    row_j[l] = row_p[l]; \
+                    row_p[l] = tmp; \
+                } \
+                \
+                unsigned int tmp_perm = perm[j]; \
+                perm[j] = perm[piv]; \
+                perm[piv] = tmp_perm; \
+            } \
+            \
+            /* multipliers, then rank-1 update of the rest of the panel */ \
+            const T* row_j = a + (size_t)j * lda; \
+            const T pivot = row_j[j]; \
+            \
+            for(unsigned int i=j+1;i<n;i++) \
+            { \
+                T* row_i = a + (size_t)i * lda; \
+                const T l_ij = row_i[j] / pivot; \
+                \
+                row_i[j] = l_ij; \
+                \
+                for(unsigned int l=j+1;l<j0+nb;l++) \
+                { \
+                    row_i[l] -= l_ij * row_j[l]; \
+                } \
+            } \
+        } \
+        \
+        return true; \
+    } \
+    \
+    /* X = L^-1 * X for unit lower triangular L, as gemm.c's trsm_lower */ \
+    static void refine_lower_##s(unsigned int n, unsigned int r, \
+            const T* t, unsigned int ldt, T* x, unsigned int ldx) \
+    { \
+        for(unsigned int j=0;j<n;j+=TRSM_BLOCK_SIZE) \
+        { \
+            unsigned int nb = n - j < TRSM_BLOCK_SIZE ? n - j : \
+                TRSM_BLOCK_SIZE; \
+            \
+            for(unsigned int i=j;i<j+nb;i++) \
+            { \
+                T* row_i = x + (size_t)i * ldx; \
+                \
+                for(unsigned int q=j;q<i;q++) \
+                { \
+                    const T t_iq = t[(size_t)i * ldt + q]; \
+                    const T* row_q = x + (size_t)q * ldx; \
+                    \
+                    for(unsigned int l=0;l<r;l++) \
+                    { \
+                        row_i[l] -= t_iq * row_q[l]; \
+                    } \
+                } \
+            } \
+            \
+            if(j + nb < n) /* eliminate the solved block from below */ \
+            { \
+                g(n - j - nb, r, nb, -1.0, t + (size_t)(j + nb) * ldt + j, \
+                        ldt, 1, x + (size_t)j * ldx, ldx, 1, 1.0, \
+                        x + (size_t)(j + nb) * ldx, ldx, 1); \
+            } \
+        } \
+    } \
+    \
+    /* X = U^-1 * X for upper triangular U, as gemm.c's trsm_upper */ \
+    static void refine_upper_##s(unsigned int n, unsigned int r, \
+            const T* t, unsigned int ldt, T* x, unsigned int ldx) \
+    { \
+        for(unsigned int end=n;end>0;) \
+        { \
+            unsigned int nb = end < TRSM_BLOCK_SIZE ? end : \
+                TRSM_BLOCK_SIZE; \
+            unsigned int j = end - nb; \
+            \
+            for(unsigned int i=end;i-->j;) \
+            { \
+                T* row_i = x + (size_t)i * ldx; \
+                \
+                for(unsigned int q=i+1;q<end;q++) \
+                { \
+                    const T t_iq = t[(size_t)i * ldt + q]; \
+                    const T* row_q = x + (size_t)q * ldx; \
+                    \
+                    for(unsigned int l=0;l<r;l++) \
+                    { \
+                        row_i[l] -= t_iq * row_q[l]; \
+                    } \
+                } \
+                \
+                const T t_ii = t[(size_t)i * ldt + i]; \
+                \
+                for(unsigned int l=0;l<r;l++) \
+                { \
+                    row_i[l] /= t_ii; \
+                } \
+            } \
+            \
+            if(j > 0) /* eliminate the solved block from above */ \
+            { \
+                g(j, r, nb, -1.0, t + j, ldt, 1, x + (size_t)j * ldx, ldx, \
+                        1, 1.0, x, ldx, 1); \
+            } \
+            \
+            end = j; \
+        } \
+    } \
+    \
+    /* blocked LU of `lu` in place, as lu.c's lu_factor_view */ \
+    static bool refine_lu_##s(M* lu, unsigned int* perm) \
+    { \
+        unsigned int n = lu->rows; \
+        T* a = lu->data; \
+        unsigned int lda = lu->stride; \
+        \
+        for(unsigned int i=0;i<n;i++) \
+        { \
+            perm[i] = i; \
+        } \
+        \
+        for(unsigned int j=0;j<n;j+=LU_BLOCK_SIZE) \
+        { \
+            unsigned int nb = n - j < LU_BLOCK_SIZE ? n - j : LU_BLOCK_SIZE; \
+            unsigned int rest = n - j - nb; \
+            \
+            if(!refine_panel_##s(n, j, nb, a, lda, perm)) \
+            { \
+                return false; \
+            } \
+            \
+            if(rest == 0) \
+            { \
+                continue; \
+            } \
+            \
+            /* U12 = L11^-1 * A12 */ \
+            refine_lower_##s(nb, rest, a + (size_t)j * lda + j, lda, \
+                    a + (size_t)j * lda + j + nb, lda); \
+            \
+            /* A22 -= L21 * U12 */ \
+            g(rest, rest, nb, -1.0, a + (size_t)(j + nb) * lda + j, lda, 1, \
+                    a + (size_t)j * lda + j + nb, lda, 1, 1.0, \
+                    a + (size_t)(j + nb) * lda + j + nb, lda, 1); \
+        } \
+        \
+        return true; \
+    } \
+    \
+    /* d = A^-1 * (rhs rounded to T), from the factors `lu` */ \
+    static void refine_correct_##s(M* lu, const unsigned int* perm, \
+            Matrix* rhs, M* d) \
+    { \
+        for(unsigned int i=0;i<d->rows;i++) /* gather P * rhs */ \
+        { \
+            const long double* src = rhs->cells[perm[i]]; \
+            T* dst = d->cells[i]; \
+            \
+            for(unsigned int l=0;l<d->cols;l++) \
+            { \
+                dst[l] = (T)src[l]; \
+            } \
+        } \
+        \
+        refine_lower_##s(d->rows, d->cols, lu->data, lu->stride, d->data, \
+                d->stride); \
+        refine_upper_##s(d->rows, d->cols, lu->data, lu->stride, d->data, \
+                d->stride); \
+    } \
+    \
+    /* solves A * x = b by refinement from a T factorisation, returning \
+     * false (with x unspecified) if a full precision solve is needed */ \
+    static bool refine_##s(Matrix* A, Matrix* b, Matrix* x, \
+            unsigned int max_iter, RefineResult* result) \
+    { \
+        /* out of range: A and b do not round to T */ \
+        if(refine_max_abs(A) > max || refine_max_abs(b) > max) \
+        { \
+            return false; \
+        } \
+        \
+        unsigned int n = A->rows; \
+        \
+        M* lu = p##_from_matrix(A); \
+        M* d = p##_init(n, b->cols); \
+        Matrix* r = matrix_init(n, b->cols); \
+        unsigned int* perm = gaisan_calloc(n, sizeof(unsigned int)); \
+        \
+        bool ok = lu != NULL && d != NULL && r != NULL && perm != NULL && \
+            refine_lu_##s(lu, perm); \
+        \
+        long double anorm = refine_norm_inf(A); \
+        long double tol = anorm * LDBL_EPSILON * sqrtl(n); \
+        long double error = 0.0; \
+        long double last = 0.0; \
+        \
+        if(ok) /* initial solution, entirely in T */ \
+        { \
+            refine_correct_##s(lu, perm, b, d); \
+            \
+            for(unsigned int i=0;i<n;i++) \
+            { \
+                for(unsigned int l=0;l<b->cols;l++) \
+                { \
+                    x->cells[i][l] = d->cells[i][l]; \
+                } \
+            } \
+        } \
+        \
+        for(unsigned int iter=0;ok;iter++) \
+        { \
+            bool converged = refine_residual(A, b, x, r, anorm, tol, \
+                    &error); \
+            \
+            result->iterations = iter; \
+            result->residual = error; \
+            \
+            if(converged) \
+            { \
+                break; \
+            } \
+            \
+            /* out of steps, stagnating, or a residual out of range */ \
+            if(iter == max_iter || (iter > 0 && \
+                        !(error < REFINE_STALL_RATIO * last)) || \
+                    refine_max_abs(r) > max) \
+            { \
+                ok = false; \
+                break; \
+            } \
+            \
+            last = error; \
+            \
+            refine_correct_##s(lu, perm, r, d); \
+            \
+            for(unsigned int i=0;i<n;i++) /* x += d */ \
+            { \
+                for(unsigned int l=0;l<b->cols;l++) \
+                { \
+                    x->cells[i][l] += d->cells[i][l]; \
+                } \
+            } \
+        } \
+        \
+        p##_free(lu); \
+        p##_free(d); \
+        matrix_free(r); \
+        gaisan_free(perm); \
+        \
+        return ok; \
+    }
+
+REFINE_DEFINE(float, MatrixF, matrixf, gemmf, f, FLT_MAX)
+REFINE_DEFINE(double, MatrixD, matrixd, gemmd, d, DBL_MAX)
+
+/**
+ * Returns the default options for `refine_solve`: a `double` factorisation
+ *      and up to `REFINE_MAX_ITER` refinement steps
+ *
+ * @return the default options
+ *
+ * */
+RefineOpts refine_default_opts(void)
+{
+    RefineOpts opts = {REFINE_DOUBLE, REFINE_MAX_ITER};
+
+    return opts;
+}
+
+/**
+ * Solves `A * x = b` to `long double` accuracy by iterative refinement from
+ *      a `float` or `double` LU factorisation of `A`, falling back to a
+ *      `long double` LU if refinement fails
+ *
+ * @param A
+ *      the square matrix of the system (not modified)
+ * @param b
+ *      the right-hand side(s), one per column
+ * @param opts
+ *      the options, or `NULL` for `refine_default_opts()`
+ * @param result
+ *      if not `NULL`, receives how the solution was obtained
+ *
+ * @return the solution `x`, or `NULL` on failure (including when `A` is
+ *      singular)
+ *
+ * */
+Matrix* refine_solve(Matrix* A, Matrix* b, const RefineOpts* opts,
+        RefineResult* result)
+{
+    if(A == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(A->rows != A->cols || b->rows != A->rows) /* bounds check */
+    {
+        return NULL;
+    }
+
+    RefineOpts defaults = refine_default_opts();
+    RefineResult local = {false, 0, 0.0};
+
+    if(opts == NULL)
+    {
+        opts = &defaults;
+    }
+
+    if(result == NULL)
+    {
+        result = &local;
+    }
+
+    *result = local;
+
+    Matrix* x = matrix_init(b->rows, b->cols);
+
+    if(x == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    bool refined = opts->precision == REFINE_FLOAT ?
+        refine_f(A, b, x, opts->max_iter, result) :
+        refine_d(A, b, x, opts->max_iter, result);
+
+    if(refined)
+    {
+        return x;
+    }
+
+    /* refinement failed: solve in full precision */
+    matrix_free(x);
+
+    result->fallback = true;
+
+    LU* lu = lu_factor(A);
+
+    if(lu == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    x = lu_solve(lu, b);
+
+    lu_free(lu);
+
+    if(x != NULL)
+    {
+        Matrix* r = matrix_init(b->rows, b->cols);
+
+        if(r != NULL)
+        {
+            long double anorm = refine_norm_inf(A);
+
+            refine_residual(A, b, x, r, anorm, 0.0, &result->residual);
+        }
+
+        matrix_free(r);
+    }
+
+    return x;
+}
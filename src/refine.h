@@ -0,0 +1,40 @@
+/**
+ * @file refine.h
+ * @author Jack McPherson
+ *
+ * Declarations for mixed-precision iterative refinement: dense linear
+ * systems solved to `long double` accuracy from a `float` or `double` LU
+ * factorisation.
+ *
+ * */
+#ifndef REFINE_H_
+#define REFINE_H_
+
+#include <stdbool.h>
+
+#include "matrix.h"
+
+typedef enum
+{
+    REFINE_FLOAT,
+    REFINE_DOUBLE
+} RefinePrecision;
+
+typedef struct
+{
+    RefinePrecision precision; /* precision of the LU factorisation */
+    unsigned int max_iter; /* refinement steps before falling back */
+} RefineOpts;
+
+typedef struct
+{
+    bool fallback; /* solved by a `long double` LU after refinement failed */
+    unsigned int iterations; /* refinement steps taken */
+    long double residual; /* final ||b - Ax|| / (||A|| ||x||), infinity norms */
+} RefineResult;
+
+RefineOpts refine_default_opts(void);
+Matrix* refine_solve(Matrix* A, Matrix* b, const RefineOpts* opts,
+        RefineResult* result);
+
+#endif /* REFINE_H_ */
@@ -6,73 +6,81 @@
  *
  * */
 #include <stdlib.h>
-#include <math.h>
+#include <tgmath.h>
 
 #include "constants.h"
 #include "diff.h"
 #include "root.h"
 
-long double bisect(long double a, long double b, long double (*f)(long double),
-        long double tol)
-{
-    if(f == NULL) /* null guard */
-    {
-        return NAN;
-    }
-
-    if(tol <= 0.0)
-    {
-        return NAN;
-    }
-
-    if(a == b)
-    {
-        return NAN;
-    }
-
-    long double A = a;
-    long double B = b;
-    long double root = 0.0;
-
-    do
-    {
-        root = (A + B) / 2;
-
-        if(f(A) * f(root) < 0) /* root on left */
-        {
-            B = root;
-        }
-        else if(f(B) * f(root) < 0) /* root on right */
-        {
-            A = root;
-        }
-    }
-    while(fabs(f(root)) > tol);
-
-    return root;
-}
-
-long double newton(long double a, long double (*f)(long double),
-        long double tol)
-{
-    if(f == NULL)
-    {
-        return NAN;
-    }
-
-    if(tol <= 0.0)
-    {
-        return NAN;
-    }
-
-    long double root = a;
-
-    do
-    {
-        root -= (f(root)) / (cdiff(root, f, DEFAULT_STEP_SIZE));
+/**
+ * Defines the rootfinding methods over `T`, with names suffixed by `s`;
+ * Newton's method differentiates with step size `step`
+ *
+ * */
+#define ROOT_DEFINE(T, s, step) \
+    T bisect##s(T a, T b, T (*f)(T), T tol) \
+    { \
+        if(f == NULL) /* null guard */ \
+        { \
+            return NAN; \
+        } \
+        \
+        if(tol <= 0.0) \
+        { \
+            return NAN; \
+        } \
+        \
+        if(a == b) \
+        { \
+            return NAN; \
+        } \
+        \
+        T A = a; \
+        T B = b; \
+        T root = 0.0; \
+        \
+        do \
+        { \
+            root = (A + B) / 2; \
+            \
+            if(f(A) * f(root) < 0) /* root on left */ \
+            { \
+                B = root; \
+            } \
+            else if(f(B) * f(root) < 0) /* root on right */ \
+            { \
+                A = root; \
+            } \
+        } \
+        /* stop once the bracket cannot shrink at this precision */ \
+        while(fabs(f(root)) > tol && (A + B) / 2 != A && (A + B) / 2 != B); \
+        \
+        return root; \
+    } \
+    \
+    T newton##s(T a, T (*f)(T), T tol) \
+    { \
+        if(f == NULL) \
+        { \
+            return NAN; \
+        } \
+        \
+        if(tol <= 0.0) \
+        { \
+            return NAN; \
+        } \
+        \
+        T root = a; \
+        \
+        do \
+        { \
+            root -= (f(root)) / (cdiff##s(root, f, step)); \
+        } \
+        while(fabs(f(root)) > tol); \
+        \
+        return root; \
     }
-    while(fabs(f(root)) > tol);
-
-    return root;
-}
 
+ROOT_DEFINE(long double, , DEFAULT_STEP_SIZE)
+ROOT_DEFINE(double, _d, DEFAULT_STEP_SIZE)
+ROOT_DEFINE(float, _f, DEFAULT_STEP_SIZE_F)
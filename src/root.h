@@ -4,16 +4,35 @@
  *
  * Declarations for rootfinding methods.
  *
+ * `bisect` and `newton` are also provided in `double` (`bisect_d`,
+ * `newton_d`) and `float` (`bisect_f`, `newton_f`), generated from the same
+ * source. The `gbisect` and `gnewton` macros select among them by the type
+ * of the function whose root is sought.
+ *
  * */
 #ifndef ROOT_H_
 #define ROOT_H_
 
-long double bisect(long double a, long double b, long double (*f)(long double),
-        long double tol);
+#include "diff.h"
+
+/**
+ * Declares the rootfinding methods over `T`, with names suffixed by `s`
+ *
+ * */
+#define ROOT_DECLARE(T, s) \
+    T bisect##s(T a, T b, T (*f)(T), T tol); \
+    T newton##s(T a, T (*f)(T), T tol);
+
+ROOT_DECLARE(long double, )
+ROOT_DECLARE(double, _d)
+ROOT_DECLARE(float, _f)
+
 long double fixed_point(long double a, long double (*f)(long double),
         long double tol);
-long double newton(long double a, long double (*f)(long double),
-        long double tol);
 
-#endif /* ROOT_H_ */
+#define gbisect(a, b, f, tol) \
+    SCALAR_SELECT(f, bisect, bisect_d, bisect_f)(a, b, f, tol)
+#define gnewton(a, f, tol) \
+    SCALAR_SELECT(f, newton, newton_d, newton_f)(a, f, tol)
 
+#endif /* ROOT_H_ */
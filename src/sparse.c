@@ -0,0 +1,835 @@
+/**
+ * @file sparse.c
+ * @author Jack McPherson
+ *
+ * Implements sparse matrices in compressed row (CSR) and compressed column
+ * (CSC) form: assembly from triplets, conversion to and from dense matrices,
+ * transposition and sparse-dense products.
+ *
+ * Storage is proportional to the number of nonzeros. Conversions and
+ * assembly are linear-time counting sorts; CSR products are split into row
+ * blocks holding roughly equal numbers of nonzeros and run on the worker
+ * pool.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "thread.h"
+#include "matrix.h"
+#include "sparse.h"
+
+/**
+ * Allocates an empty sparse matrix with room for `nnz` nonzeros
+ *
+ * */
+static SparseMatrix* sparse_alloc(unsigned int rows, unsigned int cols,
+        SparseFormat format, size_t nnz)
+{
+    SparseMatrix* sparse = gaisan_calloc(1, sizeof(SparseMatrix));
+
+    if(sparse == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    unsigned int major = format == SPARSE_CSR ? rows : cols;
+
+    sparse->rows = rows;
+    sparse->cols = cols;
+    sparse->format = format;
+    sparse->nnz = nnz;
+    sparse->ptr = gaisan_calloc((size_t)major + 1, sizeof(size_t));
+    sparse->idx = gaisan_calloc(nnz > 0 ? nnz : 1, sizeof(unsigned int));
+    sparse->vals = gaisan_calloc(nnz > 0 ? nnz : 1, sizeof(long double));
+
+    if(sparse->ptr == NULL || sparse->idx == NULL || sparse->vals == NULL)
+    {
+        sparse_free(sparse);
+        return NULL;
+    }
+
+    return sparse;
+}
+
+/**
+ * Transposes compressed arrays: given `nmajor` segments of indices into
+ *      `nminor`, produces `nminor` segments of indices into `nmajor`
+ *
+ * Output indices are increasing within each segment, whatever the order of
+ *      the input.
+ *
+ * */
+static void sparse_transpose_arrays(unsigned int nmajor, unsigned int nminor,
+        const size_t* ptr, const unsigned int* idx, const long double* vals,
+        size_t* out_ptr, unsigned int* out_idx, long double* out_vals)
+{
+    size_t nnz = ptr[nmajor];
+
+    memset(out_ptr, 0, ((size_t)nminor + 1) * sizeof(size_t));
+
+    for(size_t e=0;e<nnz;e++) /* count */
+    {
+        out_ptr[idx[e] + 1]++;
+    }
+
+    for(unsigned int i=0;i<nminor;i++) /* prefix sum */
+    {
+        out_ptr[i + 1] += out_ptr[i];
+    }
+
+    for(unsigned int i=0;i<nmajor;i++) /* scatter, bumping segment starts */
+    {
+        for(size_t e=ptr[i];e<ptr[i + 1];e++)
+        {
+            size_t dst = out_ptr[idx[e]]++;
+
+            out_idx[dst] = i;
+            out_vals[dst] = vals[e];
+        }
+    }
+
+    for(unsigned int i=nminor;i>0;i--) /* restore segment starts */
+    {
+        out_ptr[i] = out_ptr[i - 1];
+    }
+
+    out_ptr[0] = 0;
+}
+
+/**
+ * Initialises an empty triplet list for a `rows` x `cols` sparse matrix
+ *
+ * @param rows
+ *      number of rows in the matrix
+ * @param cols
+ *      number of columns in the matrix
+ *
+ * @return pointer to the builder, or `NULL` on failure
+ *
+ * */
+SparseBuilder* sparse_builder_init(unsigned int rows, unsigned int cols)
+{
+    if(rows == 0 || cols == 0) /* bounds check */
+    {
+        return NULL;
+    }
+
+    SparseBuilder* builder = gaisan_calloc(1, sizeof(SparseBuilder));
+
+    if(builder == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    builder->rows = rows;
+    builder->cols = cols;
+
+    return builder;
+}
+
+/**
+ * Frees memory consumed by `builder`
+ *
+ * @param builder
+ *      the builder to be free'd
+ *
+ * */
+void sparse_builder_free(SparseBuilder* builder)
+{
+    if(builder == NULL) /* null guard */
+    {
+        return;
+    }
+
+    gaisan_free(builder->row_idx);
+    gaisan_free(builder->col_idx);
+    gaisan_free(builder->vals);
+    gaisan_free(builder);
+}
+
+/**
+ * Appends the entry `(i, j, val)`; entries with the same position are
+ *      summed on assembly
+ *
+ * @param builder
+ *      the builder being appended to
+ * @param i
+ *      row index
+ * @param j
+ *      column index
+ * @param val
+ *      value of the entry
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool sparse_builder_add(SparseBuilder* builder, unsigned int i,
+        unsigned int j, long double val)
+{
+    if(builder == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(i >= builder->rows || j >= builder->cols) /* bounds check */
+    {
+        return false;
+    }
+
+    if(builder->len == builder->cap) /* buffer full, expand */
+    {
+        size_t cap = builder->cap == 0 ? INIT_BUF_LEN :
+            builder->cap * BUF_EXPAND_FACTOR;
+
+        unsigned int* row_idx = gaisan_realloc(builder->row_idx,
+                cap * sizeof(unsigned int));
+
+        if(row_idx == NULL) /* allocation check */
+        {
+            return false;
+        }
+
+        builder->row_idx = row_idx;
+
+        unsigned int* col_idx = gaisan_realloc(builder->col_idx,
+                cap * sizeof(unsigned int));
+
+        if(col_idx == NULL) /* allocation check */
+        {
+            return false;
+        }
+
+        builder->col_idx = col_idx;
+
+        long double* vals = gaisan_realloc(builder->vals,
+                cap * sizeof(long double));
+
+        if(vals == NULL) /* allocation check */
+        {
+            return false;
+        }
+
+        builder->vals = vals;
+        builder->cap = cap;
+    }
+
+    builder->row_idx[builder->len] = i;
+    builder->col_idx[builder->len] = j;
+    builder->vals[builder->len] = val;
+    builder->len++;
+
+    return true;
+}
+
+/**
+ * Assembles the entries of `builder` into a sparse matrix, summing
+ *      duplicates
+ *
+ * @param builder
+ *      the triplet list (not modified)
+ * @param format
+ *      the format of the result
+ *
+ * @return the assembled matrix, or `NULL` on failure
+ *
+ * */
+SparseMatrix* sparse_from_builder(SparseBuilder* builder, SparseFormat format)
+{
+    if(builder == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    bool csr = format == SPARSE_CSR;
+    unsigned int nmajor = csr ? builder->rows : builder->cols;
+    unsigned int nminor = csr ? builder->cols : builder->rows;
+    const unsigned int* major = csr ? builder->row_idx : builder->col_idx;
+    const unsigned int* minor = csr ? builder->col_idx : builder->row_idx;
+    size_t len = builder->len;
+
+    /* bucket by minor index first (the transpose of what we want) ... */
+    SparseMatrix* tmp = sparse_alloc(builder->rows, builder->cols,
+            csr ? SPARSE_CSC : SPARSE_CSR, len);
+    SparseMatrix* sparse = sparse_alloc(builder->rows, builder->cols, format,
+            len);
+
+    if(tmp == NULL || sparse == NULL) /* check for failure */
+    {
+        sparse_free(tmp);
+        sparse_free(sparse);
+        return NULL;
+    }
+
+    for(size_t e=0;e<len;e++)
+    {
+        tmp->ptr[minor[e] + 1]++;
+    }
+
+    for(unsigned int i=0;i<nminor;i++)
+    {
+        tmp->ptr[i + 1] += tmp->ptr[i];
+    }
+
+    for(size_t e=0;e<len;e++)
+    {
+        size_t dst = tmp->ptr[minor[e]]++;
+
+        tmp->idx[dst] = major[e];
+        tmp->vals[dst] = builder->vals[e];
+    }
+
+    for(unsigned int i=nminor;i>0;i--)
+    {
+        tmp->ptr[i] = tmp->ptr[i - 1];
+    }
+
+    tmp->ptr[0] = 0;
+
+    /* ... then transpose, which leaves every segment sorted */
+    sparse_transpose_arrays(nminor, nmajor, tmp->ptr, tmp->idx, tmp->vals,
+            sparse->ptr, sparse->idx, sparse->vals);
+
+    sparse_free(tmp);
+
+    /* merge duplicates, which are now adjacent */
+    size_t w = 0;
+    size_t read = 0;
+
+    for(unsigned int i=0;i<nmajor;i++)
+    {
+        size_t end = sparse->ptr[i + 1];
+        size_t start = w;
+
+        sparse->ptr[i] = w;
+
+        for(;read<end;read++)
+        {
+            if(w > start && sparse->idx[w - 1] == sparse->idx[read])
+            {
+                sparse->vals[w - 1] += sparse->vals[read];
+            }
+            else
+            {
+                sparse->idx[w] = sparse->idx[read];
+                sparse->vals[w] = sparse->vals[read];
+                w++;
+            }
+        }
+    }
+
+    sparse->ptr[nmajor] = w;
+    sparse->nnz = w;
+
+    return sparse;
+}
+
+/**
+ * Frees memory consumed by `sparse`
+ *
+ * @param sparse
+ *      the matrix to be free'd
+ *
+ * */
+void sparse_free(SparseMatrix* sparse)
+{
+    if(sparse == NULL) /* null guard */
+    {
+        return;
+    }
+
+    gaisan_free(sparse->ptr);
+    gaisan_free(sparse->idx);
+    gaisan_free(sparse->vals);
+    gaisan_free(sparse);
+}
+
+/**
+ * Performs a (deep) copy of `sparse`
+ *
+ * @param sparse
+ *      the matrix to be copied
+ *
+ * @return pointer to copy of matrix or `NULL` on failure
+ *
+ * */
+SparseMatrix* sparse_copy(SparseMatrix* sparse)
+{
+    if(sparse == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    SparseMatrix* res = sparse_alloc(sparse->rows, sparse->cols,
+            sparse->format, sparse->nnz);
+
+    if(res == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    unsigned int major = sparse->format == SPARSE_CSR ? sparse->rows :
+        sparse->cols;
+
+    memcpy(res->ptr, sparse->ptr, ((size_t)major + 1) * sizeof(size_t));
+    memcpy(res->idx, sparse->idx, sparse->nnz * sizeof(unsigned int));
+    memcpy(res->vals, sparse->vals, sparse->nnz * sizeof(long double));
+
+    return res;
+}
+
+/**
+ * Converts the dense matrix `matrix` to sparse form, dropping zeros
+ *
+ * @param matrix
+ *      the dense matrix
+ * @param format
+ *      the format of the result
+ *
+ * @return the sparse matrix, or `NULL` on failure
+ *
+ * */
+SparseMatrix* sparse_from_dense(Matrix* matrix, SparseFormat format)
+{
+    if(matrix == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    size_t nnz = 0;
+
+    for(unsigned int i=0;i<matrix->rows;i++)
+    {
+        const long double* row = matrix->data + (size_t)i * matrix->stride;
+
+        for(unsigned int j=0;j<matrix->cols;j++)
+        {
+            nnz += row[j] != 0.0;
+        }
+    }
+
+    SparseMatrix* csr = sparse_alloc(matrix->rows, matrix->cols, SPARSE_CSR,
+            nnz);
+
+    if(csr == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    size_t e = 0;
+
+    for(unsigned int i=0;i<matrix->rows;i++)
+    {
+        const long double* row = matrix->data + (size_t)i * matrix->stride;
+
+        for(unsigned int j=0;j<matrix->cols;j++)
+        {
+            if(row[j] != 0.0)
+            {
+                csr->idx[e] = j;
+                csr->vals[e] = row[j];
+                e++;
+            }
+        }
+
+        csr->ptr[i + 1] = e;
+    }
+
+    if(format == SPARSE_CSR)
+    {
+        return csr;
+    }
+
+    SparseMatrix* csc = sparse_convert(csr, SPARSE_CSC);
+
+    sparse_free(csr);
+
+    return csc;
+}
+
+/**
+ * Converts the sparse matrix `sparse` to a dense matrix
+ *
+ * @param sparse
+ *      the sparse matrix
+ *
+ * @return the dense matrix, or `NULL` on failure
+ *
+ * */
+Matrix* sparse_to_dense(SparseMatrix* sparse)
+{
+    if(sparse == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    Matrix* matrix = matrix_init(sparse->rows, sparse->cols);
+
+    if(matrix == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    bool csr = sparse->format == SPARSE_CSR;
+    unsigned int major = csr ? sparse->rows : sparse->cols;
+
+    for(unsigned int i=0;i<major;i++)
+    {
+        for(size_t e=sparse->ptr[i];e<sparse->ptr[i + 1];e++)
+        {
+            unsigned int r = csr ? i : sparse->idx[e];
+            unsigned int c = csr ? sparse->idx[e] : i;
+
+            matrix->data[(size_t)r * matrix->stride + c] = sparse->vals[e];
+        }
+    }
+
+    return matrix;
+}
+
+/**
+ * Converts `sparse` to the given format (CSR to CSC or vice versa)
+ *
+ * @param sparse
+ *      the matrix to convert
+ * @param format
+ *      the format of the result
+ *
+ * @return the converted matrix (a copy if it is already in `format`), or
+ *      `NULL` on failure
+ *
+ * */
+SparseMatrix* sparse_convert(SparseMatrix* sparse, SparseFormat format)
+{
+    if(sparse == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    if(sparse->format == format) /* trivial case */
+    {
+        return sparse_copy(sparse);
+    }
+
+    SparseMatrix* res = sparse_alloc(sparse->rows, sparse->cols, format,
+            sparse->nnz);
+
+    if(res == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    bool csr = sparse->format == SPARSE_CSR;
+
+    sparse_transpose_arrays(csr ? sparse->rows : sparse->cols,
+            csr ? sparse->cols : sparse->rows, sparse->ptr, sparse->idx,
+            sparse->vals, res->ptr, res->idx, res->vals);
+
+    return res;
+}
+
+/**
+ * Transposes the sparse matrix `sparse` (keeping its format)
+ *
+ * @param sparse
+ *      the matrix to be transposed
+ *
+ * @return the transpose of the matrix, or `NULL` on failure
+ *
+ * */
+SparseMatrix* sparse_transpose(SparseMatrix* sparse)
+{
+    if(sparse == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    SparseFormat other = sparse->format == SPARSE_CSR ? SPARSE_CSC :
+        SPARSE_CSR;
+    SparseMatrix* res = sparse_convert(sparse, other);
+
+    if(res == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    /* CSC of A is CSR of A^T */
+    unsigned int rows = res->rows;
+
+    res->rows = res->cols;
+    res->cols = rows;
+    res->format = sparse->format;
+
+    return res;
+}
+
+/**
+ * Returns the first row of task `t` out of `tasks` when the rows of the CSR
+ *      matrix `sparse` are split into blocks of roughly equal nonzero count
+ *
+ * */
+static unsigned int sparse_task_row(const SparseMatrix* sparse,
+        unsigned int t, unsigned int tasks)
+{
+    if(t >= tasks)
+    {
+        return sparse->rows;
+    }
+
+    size_t target = sparse->nnz / tasks * t +
+        sparse->nnz % tasks * t / tasks;
+
+    /* first row whose nonzeros begin at or after `target` */
+    unsigned int lo = 0;
+    unsigned int hi = sparse->rows;
+
+    while(lo < hi)
+    {
+        unsigned int mid = lo + (hi - lo) / 2;
+
+        if(sparse->ptr[mid] < target)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/**
+ * Returns the number of row blocks to split a CSR product into
+ *
+ * */
+static unsigned int sparse_num_tasks(const SparseMatrix* sparse,
+        size_t work_per_nnz)
+{
+    size_t tasks = sparse->nnz * work_per_nnz / SPARSE_TASK_WORK;
+
+    if(tasks < 1)
+    {
+        tasks = 1;
+    }
+
+    if(tasks > sparse->rows)
+    {
+        tasks = sparse->rows;
+    }
+
+    return (unsigned int)tasks;
+}
+
+/**
+ * Arguments of a parallel CSR product, shared by every row block
+ *
+ * */
+typedef struct
+{
+    const SparseMatrix* sparse;
+    unsigned int tasks;
+    long double alpha;
+    long double beta;
+    const long double* x; /* dense operand */
+    unsigned int ldx;
+    long double* y; /* dense result */
+    unsigned int ldy;
+    unsigned int cols; /* columns of the dense operand */
+} SparseJob;
+
+/**
+ * Computes row block `t` of `Y = alpha * A * X + beta * Y` for CSR `A`
+ *
+ * */
+static void sparse_csr_block(unsigned int t, void* arg)
+{
+    const SparseJob* job = arg;
+    const SparseMatrix* a = job->sparse;
+    unsigned int first = sparse_task_row(a, t, job->tasks);
+    unsigned int last = sparse_task_row(a, t + 1, job->tasks);
+
+    for(unsigned int i=first;i<last;i++)
+    {
+        long double* row_y = job->y + (size_t)i * job->ldy;
+
+        if(job->cols == 1) /* matrix-vector */
+        {
+            long double sum = 0.0;
+
+            for(size_t e=a->ptr[i];e<a->ptr[i + 1];e++)
+            {
+                sum += a->vals[e] * job->x[(size_t)a->idx[e] * job->ldx];
+            }
+
+            row_y[0] = job->beta == 0.0 ? job->alpha * sum :
+                job->alpha * sum + job->beta * row_y[0];
+
+            continue;
+        }
+
+        for(unsigned int j=0;j<job->cols;j++)
+        {
+            row_y[j] = job->beta == 0.0 ? 0.0 : job->beta * row_y[j];
+        }
+
+        for(size_t e=a->ptr[i];e<a->ptr[i + 1];e++)
+        {
+            const long double a_ik = job->alpha * a->vals[e];
+            const long double* row_x = job->x + (size_t)a->idx[e] * job->ldx;
+
+            for(unsigned int j=0;j<job->cols;j++)
+            {
+                row_y[j] += a_ik * row_x[j];
+            }
+        }
+    }
+}
+
+/**
+ * Computes `Y = alpha * A * X + beta * Y` for dense, row-major `X` and `Y`
+ *      with `cols` columns
+ *
+ * */
+static void sparse_product(const SparseMatrix* a, long double alpha,
+        const long double* x, unsigned int ldx, long double beta,
+        long double* y, unsigned int ldy, unsigned int cols)
+{
+    if(a->format == SPARSE_CSR) /* rows are independent: parallelise */
+    {
+        SparseJob job = {a, sparse_num_tasks(a, cols), alpha, beta, x, ldx, y,
+            ldy, cols};
+
+        parallel_for(job.tasks, &sparse_csr_block, &job);
+
+        return;
+    }
+
+    /* CSC scatters into rows of Y, so runs serially */
+    for(unsigned int i=0;i<a->rows;i++)
+    {
+        long double* row_y = y + (size_t)i * ldy;
+
+        for(unsigned int j=0;j<cols;j++)
+        {
+            row_y[j] = beta == 0.0 ? 0.0 : beta * row_y[j];
+        }
+    }
+
+    for(unsigned int k=0;k<a->cols;k++)
+    {
+        const long double* row_x = x + (size_t)k * ldx;
+
+        for(size_t e=a->ptr[k];e<a->ptr[k + 1];e++)
+        {
+            const long double a_ik = alpha * a->vals[e];
+            long double* row_y = y + (size_t)a->idx[e] * ldy;
+
+            for(unsigned int j=0;j<cols;j++)
+            {
+                row_y[j] += a_ik * row_x[j];
+            }
+        }
+    }
+}
+
+/**
+ * Computes the sparse matrix-vector product `y = alpha * A * x + beta * y`
+ *
+ * @param sparse
+ *      the sparse matrix `A` (`m` x `n`)
+ * @param alpha
+ *      scalar multiple of `A * x`
+ * @param x
+ *      vector of length `n`
+ * @param beta
+ *      scalar multiple of `y` (if zero, `y` need not be initialised)
+ * @param y
+ *      vector of length `m`, which receives the result (must not overlap
+ *          `x`)
+ *
+ * */
+void sparse_spmv(SparseMatrix* sparse, long double alpha, const long double* x,
+        long double beta, long double* y)
+{
+    if(sparse == NULL || x == NULL || y == NULL) /* null guard */
+    {
+        return;
+    }
+
+    sparse_product(sparse, alpha, x, 1, beta, y, 1, 1);
+}
+
+/**
+ * Multiplies the sparse matrix `sparse` by the dense matrix `b`, storing the
+ *      result in `dst`
+ *
+ * @param dst
+ *      the matrix receiving the result (`sparse->rows` by `b->cols`, not
+ *          sharing storage with `b`)
+ * @param sparse
+ *      the sparse LHS matrix
+ * @param b
+ *      the dense RHS matrix
+ *
+ * @return `dst`, or `NULL` on failure
+ *
+ * */
+Matrix* sparse_multiply_into(Matrix* dst, SparseMatrix* sparse, Matrix* b)
+{
+    if(dst == NULL || sparse == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    /* bounds check */
+    if(sparse->cols != b->rows || dst->rows != sparse->rows ||
+            dst->cols != b->cols)
+    {
+        return NULL;
+    }
+
+    if(dst->data == b->data) /* aliasing check */
+    {
+        return NULL;
+    }
+
+    sparse_product(sparse, 1.0, b->data, b->stride, 0.0, dst->data,
+            dst->stride, b->cols);
+
+    return dst;
+}
+
+/**
+ * Multiplies the sparse matrix `sparse` by the dense matrix `b`
+ *
+ * @param sparse
+ *      the sparse LHS matrix
+ * @param b
+ *      the dense RHS matrix (a single column for a matrix-vector product)
+ *
+ * @return result of `sparse` * `b`, or `NULL` on failure
+ *
+ * */
+Matrix* sparse_multiply(SparseMatrix* sparse, Matrix* b)
+{
+    if(sparse == NULL || b == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    Matrix* res = matrix_init(sparse->rows, b->cols);
+
+    if(sparse_multiply_into(res, sparse, b) == NULL) /* check for failure */
+    {
+        matrix_free(res);
+        return NULL;
+    }
+
+    return res;
+}
+
@@ -0,0 +1,80 @@
+/**
+ * @file sparse.h
+ * @author Jack McPherson
+ *
+ * Declarations for sparse matrices in compressed row (CSR) and compressed
+ * column (CSC) form.
+ *
+ * */
+#ifndef SPARSE_H_
+#define SPARSE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "matrix.h"
+
+typedef enum
+{
+    SPARSE_CSR,
+    SPARSE_CSC
+} SparseFormat;
+
+/**
+ * Sparse matrix in compressed row or column form
+ *
+ * For CSR, the nonzeros of row `i` are `vals[ptr[i]..ptr[i+1])` in columns
+ * `idx[ptr[i]..ptr[i+1])`; CSC is the same with rows and columns swapped.
+ * Indices within each row (column) are strictly increasing.
+ *
+ * */
+typedef struct
+{
+    unsigned int rows;
+    unsigned int cols;
+    SparseFormat format;
+    size_t nnz;
+    size_t* ptr;
+    unsigned int* idx;
+    long double* vals;
+} SparseMatrix;
+
+/**
+ * Coordinate (triplet) list used to assemble a sparse matrix
+ *
+ * */
+typedef struct
+{
+    unsigned int rows;
+    unsigned int cols;
+    size_t len;
+    size_t cap;
+    unsigned int* row_idx;
+    unsigned int* col_idx;
+    long double* vals;
+} SparseBuilder;
+
+/* Assembly */
+SparseBuilder* sparse_builder_init(unsigned int rows, unsigned int cols);
+void sparse_builder_free(SparseBuilder* builder);
+bool sparse_builder_add(SparseBuilder* builder, unsigned int i,
+        unsigned int j, long double val);
+SparseMatrix* sparse_from_builder(SparseBuilder* builder,
+        SparseFormat format);
+
+/* Initialisation and conversion */
+void sparse_free(SparseMatrix* sparse);
+SparseMatrix* sparse_copy(SparseMatrix* sparse);
+SparseMatrix* sparse_from_dense(Matrix* matrix, SparseFormat format);
+Matrix* sparse_to_dense(SparseMatrix* sparse);
+SparseMatrix* sparse_convert(SparseMatrix* sparse, SparseFormat format);
+SparseMatrix* sparse_transpose(SparseMatrix* sparse);
+
+/* Products */
+void sparse_spmv(SparseMatrix* sparse, long double alpha, const long double* x,
+        long double beta, long double* y);
+Matrix* sparse_multiply(SparseMatrix* sparse, Matrix* b);
+Matrix* sparse_multiply_into(Matrix* dst, SparseMatrix* sparse, Matrix* b);
+
+#endif /* SPARSE_H_ */
+
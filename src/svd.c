@@ -0,0 +1,1307 @@
+/**
+ * @file svd.c
+ * @author Jack McPherson
+ *
+ * Implements dense and randomized singular value decompositions.
+ *
+ * The dense SVD transposes wide matrices and QR factorises very tall ones,
+ * then reduces what remains to upper bidiagonal form `B = U^T * A * V` by
+ * alternating left and right Householder reflections. As in the symmetric
+ * eigensolver, reflectors are generated a panel at a time while their effect
+ * is tracked in two skinny matrices, so that half the work of the reduction
+ * is a pair of GEMMs on the trailing matrix. `B` is diagonalised by
+ * implicit-shift QR sweeps (Golub and Kahan), whose rotations are
+ * accumulated into the transposes of `U` and `V` so that every rotation runs
+ * along a contiguous row. Singular values alone skip the accumulation
+ * entirely.
+ *
+ * The randomized SVD (Halko, Martinsson and Tropp) finds the top `k`
+ * singular triplets from a few passes over `A`: the range of `A` is sampled
+ * by `Y = A * Omega` for a Gaussian `Omega` with `k + oversample` columns,
+ * sharpened by power iterations (re-orthonormalising between passes so the
+ * small singular values are not lost to rounding), and `A` is projected onto
+ * it. Only the small projected matrix then needs a dense SVD; every pass
+ * over `A` is a GEMM.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "gemm.h"
+#include "thread.h"
+#include "matrix.h"
+#include "view.h"
+#include "qr.h"
+#include "svd.h"
+
+/**
+ * A Householder reflector `I - tau * v * v^T` to be applied to a block of a
+ *      matrix, in parallel bands
+ *
+ * */
+typedef struct
+{
+    long double* a;
+    unsigned int lda;
+    unsigned int rows;
+    unsigned int cols;
+    const long double* v;
+    long double tau;
+    long double* w; /* scratch of `cols` cells (left application only) */
+    unsigned int tasks;
+} SvdReflect;
+
+/**
+ * Generates the Householder reflector `H = I - tau * v * v^T` mapping
+ *      `(alpha, x)` onto `(beta, 0)`
+ *
+ * On return `*alpha` holds `beta` and `x` (of `len` entries, `incx` apart)
+ *      holds the tail of `v`, whose leading entry is an implicit 1.
+ *
+ * @return `tau` (0 if `x` is already zero, in which case `H = I`)
+ *
+ * */
+static long double svd_reflector(unsigned int len, long double* alpha,
+        long double* x, size_t incx)
+{
+    long double sigma = 0.0L;
+
+    for(unsigned int i=0;i<len;i++)
+    {
+        sigma += x[i * incx] * x[i * incx];
+    }
+
+    if(sigma == 0.0L) /* already reduced */
+    {
+        return 0.0L;
+    }
+
+    long double norm = sqrtl(*alpha * *alpha + sigma);
+    long double beta = *alpha >= 0.0L ? -norm : norm;
+    long double scale = 1.0L / (*alpha - beta);
+    long double tau = (beta - *alpha) / beta;
+
+    for(unsigned int i=0;i<len;i++)
+    {
+        x[i * incx] *= scale;
+    }
+
+    *alpha = beta;
+
+    return tau;
+}
+
+/**
+ * Computes `A = H * A` for a band of the columns of the block (task `c`)
+ *
+ * */
+static void svd_left_task(unsigned int c, void* arg)
+{
+    const SvdReflect* job = arg;
+    unsigned int first = (unsigned int)((size_t)job->cols * c / job->tasks);
+    unsigned int last = (unsigned int)((size_t)job->cols * (c + 1) /
+            job->tasks);
+    long double* w = job->w;
+
+    for(unsigned int j=first;j<last;j++)
+    {
+        w[j] = 0.0L;
+    }
+
+    /* w = A^T * v */
+    for(unsigned int r=0;r<job->rows;r++)
+    {
+        const long double* row = job->a + (size_t)r * job->lda;
+        const long double v_r = job->v[r];
+
+        for(unsigned int j=first;j<last;j++)
+        {
+            w[j] += v_r * row[j];
+        }
+    }
+
+    /* A -= tau * v * w^T */
+    for(unsigned int r=0;r<job->rows;r++)
+    {
+        long double* row = job->a + (size_t)r * job->lda;
+        const long double s = job->tau * job->v[r];
+
+        for(unsigned int j=first;j<last;j++)
+        {
+            row[j] -= s * w[j];
+        }
+    }
+}
+
+/**
+ * Computes `A = A * H` for a band of the rows of the block (task `c`)
+ *
+ * */
+static void svd_right_task(unsigned int c, void* arg)
+{
+    const SvdReflect* job = arg;
+    unsigned int first = (unsigned int)((size_t)job->rows * c / job->tasks);
+    unsigned int last = (unsigned int)((size_t)job->rows * (c + 1) /
+            job->tasks);
+
+    for(unsigned int r=first;r<last;r++)
+    {
+        long double* row = job->a + (size_t)r * job->lda;
+        long double dot = 0.0L;
+
+        for(unsigned int j=0;j<job->cols;j++)
+        {
+            dot += row[j] * job->v[j];
+        }
+
+        dot *= job->tau;
+
+        for(unsigned int j=0;j<job->cols;j++)
+        {
+            row[j] -= dot * job->v[j];
+        }
+    }
+}
+
+/**
+ * Applies the reflector `I - tau * v * v^T` (`v` contiguous, leading entry
+ *      1) to the `rows` x `cols` block at `a`, from the left if `left` is
+ *      true and from the right otherwise
+ *
+ * */
+static void svd_reflect(long double* a, unsigned int lda, unsigned int rows,
+        unsigned int cols, const long double* v, long double tau,
+        long double* w, bool left)
+{
+    if(tau == 0.0L || rows == 0 || cols == 0) /* H = I */
+    {
+        return;
+    }
+
+    size_t tasks = (size_t)rows * cols / SVD_TASK_SIZE;
+    unsigned int threads = gaisan_get_num_threads();
+    unsigned int bands = left ? cols : rows;
+
+    tasks = tasks > threads ? threads : tasks;
+    tasks = tasks > bands ? bands : tasks;
+    tasks = tasks == 0 ? 1 : tasks;
+
+    SvdReflect job = {a, lda, rows, cols, v, tau, w, (unsigned int)tasks};
+
+    parallel_for((unsigned int)tasks, left ? svd_left_task : svd_right_task,
+            &job);
+}
+
+/**
+ * Reduces the `m` x `n` matrix at `a` (`m >= n`) to upper bidiagonal form
+ *      one reflector at a time (see `svd_bidiagonalise`)
+ *
+ * `v` and `w` are scratch of `m` cells each.
+ *
+ * */
+static void svd_bidiag_unblocked(unsigned int m, unsigned int n,
+        long double* a, unsigned int lda, long double* d, long double* e,
+        long double* tauq, long double* taup, long double* v, long double* w)
+{
+    for(unsigned int i=0;i<n;i++)
+    {
+        long double* a_ii = a + (size_t)i * lda + i;
+
+        /* annihilate A[i+1:, i] */
+        tauq[i] = svd_reflector(m - i - 1, a_ii, a_ii + lda, lda);
+        d[i] = *a_ii;
+        v[0] = 1.0L;
+
+        for(unsigned int r=1;r<m - i;r++)
+        {
+            v[r] = a_ii[(size_t)r * lda];
+        }
+
+        svd_reflect(a_ii + 1, lda, m - i, n - i - 1, v, tauq[i], w, true);
+
+        if(i + 1 == n)
+        {
+            taup[i] = 0.0L;
+            break;
+        }
+
+        /* annihilate A[i, i+2:] */
+        taup[i] = svd_reflector(n - i - 2, a_ii + 1, a_ii + 2, 1);
+        e[i] = a_ii[1];
+        v[0] = 1.0L;
+
+        for(unsigned int c=1;c<n - i - 1;c++)
+        {
+            v[c] = a_ii[1 + c];
+        }
+
+        svd_reflect(a_ii + lda + 1, lda, m - i - 1, n - i - 1, v, taup[i], w,
+                false);
+    }
+}
+
+/**
+ * Reduces the first `nb` rows and columns of the `m` x `n` matrix at `a` to
+ *      upper bidiagonal form (`nb < n <= m`)
+ *
+ * The trailing matrix is not updated; instead `X` (`m` x `nb`) and `Y`
+ *      (`n` x `nb`) are formed so that the update is
+ *      `A22 -= V * Y^T + X * U^T`, where the columns of `V` and rows of `U^T`
+ *      are the left and right reflectors (stored in `a`, with their unit
+ *      entries written in place of the diagonal and superdiagonal, which go
+ *      to `d` and `e`). `t` is scratch of `m + n + 2 * nb` cells.
+ *
+ * */
+static void svd_panel(unsigned int m, unsigned int n, unsigned int nb,
+        long double* a, unsigned int lda, long double* d, long double* e,
+        long double* tauq, long double* taup, long double* x, long double* y,
+        long double* t)
+{
+    long double* ty = t; /* n cells */
+    long double* tx = ty + n; /* m cells */
+    long double* s1 = tx + m; /* nb cells */
+    long double* s2 = s1 + nb; /* nb cells */
+
+    for(unsigned int i=0;i<nb;i++)
+    {
+        long double* a_i = a + (size_t)i * lda;
+
+        /* bring column i up to date with the panel's earlier reflectors */
+        for(unsigned int r=i;r<m && i>0;r++)
+        {
+            const long double* a_r = a + (size_t)r * lda;
+            const long double* x_r = x + (size_t)r * nb;
+            const long double* y_i = y + (size_t)i * nb;
+            long double sum = 0.0L;
+
+            for(unsigned int p=0;p<i;p++)
+            {
+                sum += a_r[p] * y_i[p] + x_r[p] * a[(size_t)p * lda + i];
+            }
+
+            a[(size_t)r * lda + i] -= sum;
+        }
+
+        /* annihilate A[i+1:, i] */
+        tauq[i] = svd_reflector(m - i - 1, a_i + i, a_i + lda + i, lda);
+        d[i] = a_i[i];
+        a_i[i] = 1.0L;
+
+        /* Y[i+1:, i] = tauq * (A^T * u - Y * (V^T * u) - U * (X^T * u)),
+         * with u the reflector just formed and A the stale trailing block */
+        for(unsigned int c=i + 1;c<n;c++)
+        {
+            ty[c] = 0.0L;
+        }
+
+        for(unsigned int p=0;p<i;p++)
+        {
+            s1[p] = 0.0L;
+            s2[p] = 0.0L;
+        }
+
+        for(unsigned int r=i;r<m;r++)
+        {
+            const long double* a_r = a + (size_t)r * lda;
+            const long double* x_r = x + (size_t)r * nb;
+            const long double u_r = a_r[i];
+
+            for(unsigned int c=i + 1;c<n;c++)
+            {
+                ty[c] += u_r * a_r[c];
+            }
+
+            for(unsigned int p=0;p<i;p++)
+            {
+                s1[p] += a_r[p] * u_r;
+                s2[p] += x_r[p] * u_r;
+            }
+        }
+
+        for(unsigned int c=i + 1;c<n;c++)
+        {
+            const long double* y_c = y + (size_t)c * nb;
+            long double sum = 0.0L;
+
+            for(unsigned int p=0;p<i;p++)
+            {
+                sum += y_c[p] * s1[p];
+            }
+
+            ty[c] -= sum;
+        }
+
+        for(unsigned int p=0;p<i;p++)
+        {
+            const long double* a_p = a + (size_t)p * lda;
+
+            for(unsigned int c=i + 1;c<n;c++)
+            {
+                ty[c] -= a_p[c] * s2[p];
+            }
+        }
+
+        for(unsigned int c=0;c<n;c++)
+        {
+            y[(size_t)c * nb + i] = c > i ? tauq[i] * ty[c] : 0.0L;
+        }
+
+        /* bring row i up to date, including the reflector just applied */
+        for(unsigned int c=i + 1;c<n;c++)
+        {
+            const long double* y_c = y + (size_t)c * nb;
+            long double sum = 0.0L;
+
+            for(unsigned int p=0;p<=i;p++)
+            {
+                sum += y_c[p] * a_i[p];
+            }
+
+            a_i[c] -= sum;
+        }
+
+        for(unsigned int p=0;p<i;p++)
+        {
+            const long double* a_p = a + (size_t)p * lda;
+            const long double x_ip = x[(size_t)i * nb + p];
+
+            for(unsigned int c=i + 1;c<n;c++)
+            {
+                a_i[c] -= a_p[c] * x_ip;
+            }
+        }
+
+        /* annihilate A[i, i+2:] */
+        taup[i] = svd_reflector(n - i - 2, a_i + i + 1, a_i + i + 2, 1);
+        e[i] = a_i[i + 1];
+        a_i[i + 1] = 1.0L;
+
+        /* X[i+1:, i] = taup * (A * v - V * (Y^T * v) - X * (U * v)), with v
+         * the reflector just formed */
+        for(unsigned int p=0;p<=i;p++)
+        {
+            s1[p] = 0.0L;
+            s2[p] = 0.0L;
+        }
+
+        for(unsigned int c=i + 1;c<n;c++)
+        {
+            const long double* y_c = y + (size_t)c * nb;
+            const long double v_c = a_i[c];
+
+            for(unsigned int p=0;p<=i;p++)
+            {
+                s1[p] += y_c[p] * v_c;
+            }
+        }
+
+        for(unsigned int p=0;p<i;p++)
+        {
+            const long double* a_p = a + (size_t)p * lda;
+            long double sum = 0.0L;
+
+            for(unsigned int c=i + 1;c<n;c++)
+            {
+                sum += a_p[c] * a_i[c];
+            }
+
+            s2[p] = sum;
+        }
+
+        for(unsigned int r=0;r<m;r++)
+        {
+            long double* x_r = x + (size_t)r * nb;
+
+            if(r <= i)
+            {
+                x_r[i] = 0.0L;
+                continue;
+            }
+
+            const long double* a_r = a + (size_t)r * lda;
+            long double sum = 0.0L;
+
+            for(unsigned int c=i + 1;c<n;c++)
+            {
+                sum += a_r[c] * a_i[c];
+            }
+
+            for(unsigned int p=0;p<=i;p++)
+            {
+                sum -= a_r[p] * s1[p];
+            }
+
+            for(unsigned int p=0;p<i;p++)
+            {
+                sum -= x_r[p] * s2[p];
+            }
+
+            x_r[i] = taup[i] * sum;
+        }
+    }
+}
+
+/**
+ * Reduces the `m` x `n` matrix at `a` (`m >= n`) to upper bidiagonal form,
+ *      leaving the diagonal in `d`, the superdiagonal in `e` and the left
+ *      and right reflectors (with scalars `tauq` and `taup`) below the
+ *      diagonal and to the right of the superdiagonal of `a`
+ *
+ * Reflectors are generated `SVD_BLOCK_SIZE` at a time by `svd_panel`, after
+ *      which the trailing matrix receives two GEMM updates; the last block
+ *      is reduced directly. `v` and `w` are scratch of `m` cells each.
+ *
+ * @return true on success, false on allocation failure
+ *
+ * */
+static bool svd_bidiagonalise(unsigned int m, unsigned int n, long double* a,
+        unsigned int lda, long double* d, long double* e, long double* tauq,
+        long double* taup, long double* v, long double* w)
+{
+    unsigned int nb = SVD_BLOCK_SIZE;
+    unsigned int j = 0;
+
+    if(n > nb)
+    {
+        GaisanArena* arena = gaisan_thread_arena();
+        size_t mark = arena_mark(arena);
+        long double* x = arena_alloc(arena, (size_t)m * nb *
+                sizeof(long double));
+        long double* y = arena_alloc(arena, (size_t)n * nb *
+                sizeof(long double));
+        long double* t = arena_alloc(arena, ((size_t)m + n + 2 * nb) *
+                sizeof(long double));
+
+        if(x == NULL || y == NULL || t == NULL) /* check for failure */
+        {
+            arena_release(arena, mark);
+            return false;
+        }
+
+        for(;n - j > nb;j+=nb)
+        {
+            unsigned int mm = m - j;
+            unsigned int nn = n - j;
+            long double* panel = a + (size_t)j * lda + j;
+
+            svd_panel(mm, nn, nb, panel, lda, d + j, e + j, tauq + j,
+                    taup + j, x, y, t);
+
+            /* A22 -= V * Y^T + X * U^T */
+            gemm(mm - nb, nn - nb, nb, -1.0L, panel + (size_t)nb * lda, lda, 1,
+                    y + (size_t)nb * nb, 1, nb, 1.0L,
+                    panel + (size_t)nb * lda + nb, lda, 1);
+            gemm(mm - nb, nn - nb, nb, -1.0L, x + (size_t)nb * nb, nb, 1,
+                    panel + nb, lda, 1, 1.0L, panel + (size_t)nb * lda + nb,
+                    lda, 1);
+
+            /* put the bidiagonal back in place of the unit entries */
+            for(unsigned int p=0;p<nb;p++)
+            {
+                panel[(size_t)p * lda + p] = d[j + p];
+                panel[(size_t)p * lda + p + 1] = e[j + p];
+            }
+        }
+
+        arena_release(arena, mark);
+    }
+
+    svd_bidiag_unblocked(m - j, n - j, a + (size_t)j * lda + j, lda, d + j,
+            e + j, tauq + j, taup + j, v, w);
+
+    return true;
+}
+
+/**
+ * Forms `U^T` (`n` x `m`) and `V^T` (`n` x `n`) from the reflectors left in
+ *      `a` by `svd_bidiagonalise`
+ *
+ * Both are accumulated backwards, so each reflector touches only the
+ *      trailing block it can change. `v` and `w` are scratch of `m` cells.
+ *
+ * */
+static void svd_form_vectors(unsigned int m, unsigned int n,
+        const long double* a, unsigned int lda, const long double* tauq,
+        const long double* taup, long double* ut, unsigned int ldut,
+        long double* vt, unsigned int ldvt, long double* v, long double* w)
+{
+    /* U^T = [I 0] * H_{n-1} * ... * H_0 */
+    for(unsigned int i=0;i<n;i++)
+    {
+        ut[(size_t)i * ldut + i] = 1.0L;
+        vt[(size_t)i * ldvt + i] = 1.0L;
+    }
+
+    for(unsigned int i=n;i-->0;)
+    {
+        const long double* a_ii = a + (size_t)i * lda + i;
+
+        v[0] = 1.0L;
+
+        for(unsigned int r=1;r<m - i;r++)
+        {
+            v[r] = a_ii[(size_t)r * lda];
+        }
+
+        svd_reflect(ut + (size_t)i * ldut + i, ldut, n - i, m - i, v, tauq[i],
+                w, false);
+    }
+
+    /* V^T = G_{n-2} * ... * G_0, where G_i acts on coordinates i+1: */
+    for(unsigned int i=n > 1 ? n - 1 : 0;i-->0;)
+    {
+        const long double* a_ii = a + (size_t)i * lda + i;
+
+        v[0] = 1.0L;
+
+        for(unsigned int c=1;c<n - i - 1;c++)
+        {
+            v[c] = a_ii[1 + c];
+        }
+
+        svd_reflect(vt + (size_t)(i + 1) * ldvt + i + 1, ldvt, n - i - 1,
+                n - i - 1, v, taup[i], w, false);
+    }
+}
+
+/**
+ * Computes `(x, y) = (c * x + s * y, c * y - s * x)` for rows of `len`
+ *      entries
+ *
+ * */
+static void svd_rotate(long double* x, long double* y, unsigned int len,
+        long double c, long double s)
+{
+    for(unsigned int j=0;j<len;j++)
+    {
+        long double a = x[j];
+        long double b = y[j];
+
+        x[j] = a * c + b * s;
+        y[j] = b * c - a * s;
+    }
+}
+
+/**
+ * Diagonalises the `n` x `n` upper bidiagonal matrix with diagonal `d` and
+ *      superdiagonal `f` (`f[i]` couples `d[i - 1]` and `d[i]`; `f[0]` is
+ *      ignored) by implicit-shift QR sweeps
+ *
+ * On return `d` holds the singular values (non-negative, unsorted). If
+ *      non-`NULL`, the rows of `ut` (of `m` entries) and `vt` (of `n`
+ *      entries) receive the left and right rotations respectively. `f` is
+ *      destroyed.
+ *
+ * @return true on success, false if a singular value failed to converge
+ *
+ * */
+static bool svd_bidiag_qr(unsigned int n, long double* d, long double* f,
+        long double* ut, unsigned int ldut, unsigned int m, long double* vt,
+        unsigned int ldvt)
+{
+    long double anorm = 0.0L;
+
+    f[0] = 0.0L;
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        anorm = fmaxl(anorm, fabsl(d[i]) + fabsl(f[i]));
+    }
+
+    long double tol = LDBL_EPSILON * anorm;
+
+    for(unsigned int k=n;k-->0;)
+    {
+        for(unsigned int iter=0;;iter++)
+        {
+            /* find the top l of the unreduced block ending at k */
+            unsigned int l = k;
+            bool cancel = true;
+
+            for(l=k;;l--)
+            {
+                if(l == 0 || fabsl(f[l]) <= tol)
+                {
+                    cancel = false;
+                    break;
+                }
+
+                if(fabsl(d[l - 1]) <= tol)
+                {
+                    break;
+                }
+            }
+
+            if(cancel) /* d[l-1] is negligible: rotate f[l] away */
+            {
+                long double c = 0.0L;
+                long double s = 1.0L;
+
+                for(unsigned int i=l;i<=k;i++)
+                {
+                    long double g = s * f[i];
+
+                    f[i] *= c;
+
+                    if(fabsl(g) <= tol)
+                    {
+                        break;
+                    }
+
+                    long double h = hypotl(g, d[i]);
+
+                    c = d[i] / h;
+                    s = -g / h;
+                    d[i] = h;
+
+                    if(ut != NULL)
+                    {
+                        svd_rotate(ut + (size_t)(l - 1) * ldut,
+                                ut + (size_t)i * ldut, m, c, s);
+                    }
+                }
+            }
+
+            long double z = d[k];
+
+            if(l == k) /* converged */
+            {
+                if(z < 0.0L)
+                {
+                    d[k] = -z;
+
+                    for(unsigned int j=0;vt!=NULL && j<n;j++)
+                    {
+                        vt[(size_t)k * ldvt + j] = -vt[(size_t)k * ldvt + j];
+                    }
+                }
+
+                break;
+            }
+
+            if(iter == SVD_MAX_ITER) /* check for failure */
+            {
+                return false;
+            }
+
+            /* shift from the trailing 2 x 2 block of B^T * B */
+            long double x = d[l];
+            long double y = d[k - 1];
+            long double g = f[k - 1];
+            long double h = f[k];
+            long double p = ((y - z) * (y + z) + (g - h) * (g + h)) /
+                (2.0L * h * y);
+
+            g = hypotl(p, 1.0L);
+            p = ((x - z) * (x + z) + h * (y / (p + copysignl(g, p)) - h)) / x;
+
+            /* chase the bulge from l down to k */
+            long double c = 1.0L;
+            long double s = 1.0L;
+
+            for(unsigned int j=l;j<k;j++)
+            {
+                unsigned int i = j + 1;
+
+                g = f[i];
+                y = d[i];
+                h = s * g;
+                g = c * g;
+                z = hypotl(p, h);
+                f[j] = z;
+                c = p / z;
+                s = h / z;
+                p = x * c + g * s;
+                g = g * c - x * s;
+                h = y * s;
+                y *= c;
+
+                if(vt != NULL)
+                {
+                    svd_rotate(vt + (size_t)j * ldvt, vt + (size_t)i * ldvt,
+                            n, c, s);
+                }
+
+                z = hypotl(p, h);
+                d[j] = z;
+
+                if(z != 0.0L)
+                {
+                    c = p / z;
+                    s = h / z;
+                }
+
+                p = c * g + s * y;
+                x = c * y - s * g;
+
+                if(ut != NULL)
+                {
+                    svd_rotate(ut + (size_t)j * ldut, ut + (size_t)i * ldut,
+                            m, c, s);
+                }
+            }
+
+            f[l] = 0.0L;
+            f[k] = p;
+            d[k] = x;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Frees memory consumed by `svd`
+ *
+ * @param svd
+ *      the decomposition to be free'd
+ *
+ * */
+void svd_free(SVD* svd)
+{
+    if(svd == NULL) /* null guard */
+    {
+        return;
+    }
+
+    gaisan_free(svd->values);
+    matrix_free(svd->U);
+    matrix_free(svd->V);
+    gaisan_free(svd);
+}
+
+/**
+ * Allocates a decomposition of rank `rank`, with `m` x `rank` and `n` x
+ *      `rank` singular vector matrices if `vectors` is true
+ *
+ * @return the (zeroed) decomposition, or `NULL` on failure
+ *
+ * */
+static SVD* svd_alloc(unsigned int m, unsigned int n, unsigned int rank,
+        bool vectors)
+{
+    SVD* svd = gaisan_calloc(1, sizeof(SVD));
+
+    if(svd == NULL) /* allocation check */
+    {
+        return NULL;
+    }
+
+    svd->rank = rank;
+    svd->values = gaisan_calloc(rank, sizeof(long double));
+
+    if(vectors)
+    {
+        svd->U = matrix_init(m, rank);
+        svd->V = matrix_init(n, rank);
+    }
+
+    if(svd->values == NULL || (vectors && (svd->U == NULL ||
+                    svd->V == NULL))) /* check for failure */
+    {
+        svd_free(svd);
+        return NULL;
+    }
+
+    return svd;
+}
+
+static SVD* svd_tall(unsigned int m, unsigned int n, long double* a,
+        unsigned int lda, bool vectors);
+
+/**
+ * Computes the SVD of the tall `m` x `n` matrix at `a` by first factorising
+ *      it as `Q * R`, so that only the `n` x `n` factor `R` is bidiagonalised
+ *
+ * @return the decomposition, or `NULL` on failure
+ *
+ * */
+static SVD* svd_tall_qr(unsigned int m, unsigned int n, long double* a,
+        unsigned int lda, bool vectors)
+{
+    MatrixView view = {m, n, lda, 1, a};
+    QR* qr = qr_factor_view(view);
+    Matrix* r = matrix_init(n, n);
+
+    if(qr == NULL || r == NULL) /* check for failure */
+    {
+        qr_free(qr);
+        matrix_free(r);
+        return NULL;
+    }
+
+    for(unsigned int i=0;i<n;i++)
+    {
+        memcpy(r->cells[i] + i, qr->factors->cells[i] + i,
+                (n - i) * sizeof(long double));
+    }
+
+    SVD* svd = svd_tall(n, n, r->data, r->stride, vectors);
+    Matrix* q = svd != NULL && vectors ? qr_form_q(qr) : NULL;
+    Matrix* u = q != NULL ? matrix_init(m, n) : NULL;
+
+    matrix_free(r);
+    qr_free(qr);
+
+    if(svd != NULL && vectors && u == NULL) /* check for failure */
+    {
+        matrix_free(q);
+        svd_free(svd);
+        return NULL;
+    }
+
+    if(vectors && svd != NULL) /* U = Q * U_R */
+    {
+        gemm(m, n, n, 1.0L, q->data, q->stride, 1, svd->U->data,
+                svd->U->stride, 1, 0.0L, u->data, u->stride, 1);
+        matrix_free(svd->U);
+        svd->U = u;
+    }
+
+    matrix_free(q);
+
+    return svd;
+}
+
+/**
+ * Computes the SVD of the `m` x `n` matrix at `a` (`m >= n`), which is
+ *      destroyed
+ *
+ * @return the decomposition, or `NULL` on failure
+ *
+ * */
+static SVD* svd_tall(unsigned int m, unsigned int n, long double* a,
+        unsigned int lda, bool vectors)
+{
+    if(m >= (size_t)SVD_QR_ASPECT * n && n > 1)
+    {
+        return svd_tall_qr(m, n, a, lda, vectors);
+    }
+
+    SVD* svd = svd_alloc(m, n, n, vectors);
+    long double* work = gaisan_calloc(6 * (size_t)n + 2 * (size_t)m,
+            sizeof(long double));
+    unsigned int* idx = gaisan_calloc(n, sizeof(unsigned int));
+    Matrix* ut = vectors ? matrix_init(n, m) : NULL;
+    Matrix* vt = vectors ? matrix_init(n, n) : NULL;
+
+    if(svd == NULL || work == NULL || idx == NULL ||
+            (vectors && (ut == NULL || vt == NULL))) /* check for failure */
+    {
+        svd_free(svd);
+        gaisan_free(work);
+        gaisan_free(idx);
+        matrix_free(ut);
+        matrix_free(vt);
+        return NULL;
+    }
+
+    long double* d = work;
+    long double* f = d + n;
+    long double* tauq = f + n;
+    long double* taup = tauq + n;
+    long double* e = taup + n;
+    long double* v = e + n;
+    long double* w = v + m;
+
+    bool ok = svd_bidiagonalise(m, n, a, lda, d, e, tauq, taup, v, w);
+
+    if(ok && vectors)
+    {
+        svd_form_vectors(m, n, a, lda, tauq, taup, ut->data, ut->stride,
+                vt->data, vt->stride, v, w);
+    }
+
+    for(unsigned int i=1;i<n;i++)
+    {
+        f[i] = e[i - 1];
+    }
+
+    ok = ok && svd_bidiag_qr(n, d, f, vectors ? ut->data : NULL,
+            vectors ? ut->stride : 0, m, vectors ? vt->data : NULL,
+            vectors ? vt->stride : 0);
+
+    if(ok)
+    {
+        /* order by descending singular value (insertion sort, since the
+         * values usually come out nearly sorted) */
+        for(unsigned int i=0;i<n;i++)
+        {
+            unsigned int j = i;
+
+            for(;j>0 && d[idx[j - 1]] < d[i];j--)
+            {
+                idx[j] = idx[j - 1];
+            }
+
+            idx[j] = i;
+        }
+
+        for(unsigned int c=0;c<n;c++)
+        {
+            svd->values[c] = d[idx[c]];
+        }
+
+        for(unsigned int c=0;vectors && c<n;c++)
+        {
+            const long double* u_c = ut->cells[idx[c]];
+            const long double* v_c = vt->cells[idx[c]];
+
+            for(unsigned int r=0;r<m;r++)
+            {
+                svd->U->cells[r][c] = u_c[r];
+            }
+
+            for(unsigned int r=0;r<n;r++)
+            {
+                svd->V->cells[r][c] = v_c[r];
+            }
+        }
+    }
+
+    gaisan_free(work);
+    gaisan_free(idx);
+    matrix_free(ut);
+    matrix_free(vt);
+
+    if(!ok) /* check for failure */
+    {
+        svd_free(svd);
+        return NULL;
+    }
+
+    return svd;
+}
+
+/**
+ * Computes the thin singular value decomposition of the matrix `A`
+ *
+ * @param A
+ *      the `m` x `n` matrix to decompose (not modified)
+ * @param vectors
+ *      whether to compute singular vectors as well as singular values
+ *
+ * @return the decomposition, of rank `min(m, n)`, or `NULL` on failure
+ *
+ * */
+SVD* svd_factor(Matrix* A, bool vectors)
+{
+    return svd_factor_view(matrix_view(A), vectors);
+}
+
+/**
+ * Computes the thin singular value decomposition of the matrix viewed by
+ *      `A`
+ *
+ * @param A
+ *      view of the `m` x `n` matrix to decompose (not modified)
+ * @param vectors
+ *      whether to compute singular vectors as well as singular values
+ *
+ * @return the decomposition, of rank `min(m, n)`, or `NULL` on failure
+ *
+ * */
+SVD* svd_factor_view(MatrixView A, bool vectors)
+{
+    if(A.data == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    /* work on A^T if A is wide, then swap U and V */
+    bool wide = A.rows < A.cols;
+    MatrixView src = wide ? view_transpose(A) : A;
+    Matrix* work = matrix_init(src.rows, src.cols);
+
+    if(work == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    view_copy(matrix_view(work), src);
+
+    SVD* svd = svd_tall(work->rows, work->cols, work->data, work->stride,
+            vectors);
+
+    matrix_free(work);
+
+    if(svd != NULL && wide)
+    {
+        Matrix* tmp = svd->U;
+
+        svd->U = svd->V;
+        svd->V = tmp;
+    }
+
+    return svd;
+}
+
+/**
+ * Returns the next output of the SplitMix64 generator with state `state`
+ *
+ * */
+static unsigned long long svd_random(unsigned long long* state)
+{
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+/**
+ * Fills `matrix` with independent standard normal samples (Box-Muller)
+ *
+ * */
+static void svd_gaussian(Matrix* matrix, unsigned long long seed)
+{
+    const long double two_pi = 8.0L * atanl(1.0L);
+    unsigned long long state = seed;
+    size_t count = (size_t)matrix->rows * matrix->cols;
+
+    for(size_t i=0;i<count;i+=2)
+    {
+        /* uniform on (0, 1], so the logarithm is finite */
+        long double u1 = ((svd_random(&state) >> 11) + 1.0L) /
+            9007199254740992.0L;
+        long double u2 = (svd_random(&state) >> 11) / 9007199254740992.0L;
+        long double r = sqrtl(-2.0L * logl(u1));
+
+        matrix->cells[i / matrix->cols][i % matrix->cols] =
+            r * cosl(two_pi * u2);
+
+        if(i + 1 < count)
+        {
+            matrix->cells[(i + 1) / matrix->cols][(i + 1) % matrix->cols] =
+                r * sinl(two_pi * u2);
+        }
+    }
+}
+
+/**
+ * Replaces the columns of the tall matrix `y` by an orthonormal basis for
+ *      their span
+ *
+ * @return true on success, false on failure
+ *
+ * */
+static bool svd_orthonormalise(Matrix* y)
+{
+    QR* qr = qr_factor(y);
+    Matrix* q = qr_form_q(qr);
+
+    qr_free(qr);
+
+    if(q == NULL) /* check for failure */
+    {
+        return false;
+    }
+
+    view_copy(matrix_view(y), matrix_view(q));
+    matrix_free(q);
+
+    return true;
+}
+
+/**
+ * Returns the default options for the randomized SVD
+ *
+ * @return `RSVD_OVERSAMPLE` extra samples, `RSVD_POWER_ITERS` power
+ *      iterations and a fixed seed
+ *
+ * */
+SvdRandOpts svd_randomized_default_opts(void)
+{
+    SvdRandOpts opts = {RSVD_OVERSAMPLE, RSVD_POWER_ITERS, 1};
+
+    return opts;
+}
+
+/**
+ * Computes the `k` largest singular triplets of the matrix `A` by randomized
+ *      range finding
+ *
+ * @param A
+ *      the `m` x `n` matrix to decompose (not modified)
+ * @param k
+ *      the number of singular triplets wanted (`1 <= k <= min(m, n)`)
+ * @param opts
+ *      sampling options (`NULL` for the defaults)
+ *
+ * @return the truncated decomposition, of rank `k`, or `NULL` on failure
+ *
+ * */
+SVD* svd_randomized(Matrix* A, unsigned int k, const SvdRandOpts* opts)
+{
+    return svd_randomized_view(matrix_view(A), k, opts);
+}
+
+/**
+ * Computes the `k` largest singular triplets of the matrix viewed by `A` by
+ *      randomized range finding
+ *
+ * With `l = k + oversample` samples and `q` power iterations, `A` is read
+ *      `2 * q + 2` times, each time by a GEMM with an `l`-column matrix, and
+ *      the only dense SVD is of an `l` x `n` matrix.
+ *
+ * @param A
+ *      view of the `m` x `n` matrix to decompose (not modified)
+ * @param k
+ *      the number of singular triplets wanted (`1 <= k <= min(m, n)`)
+ * @param opts
+ *      sampling options (`NULL` for the defaults)
+ *
+ * @return the truncated decomposition, of rank `k`, or `NULL` on failure
+ *
+ * */
+SVD* svd_randomized_view(MatrixView A, unsigned int k,
+        const SvdRandOpts* opts)
+{
+    SvdRandOpts defaults = svd_randomized_default_opts();
+    opts = opts == NULL ? &defaults : opts;
+
+    if(A.data == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    unsigned int m = A.rows;
+    unsigned int n = A.cols;
+    unsigned int small = m < n ? m : n;
+
+    if(k == 0 || k > small) /* bounds check */
+    {
+        return NULL;
+    }
+
+    unsigned int l = small - k < opts->oversample ? small : k +
+        opts->oversample;
+    Matrix* omega = matrix_init(n, l);
+    Matrix* y = matrix_init(m, l);
+    Matrix* b = matrix_init(l, n);
+
+    if(omega == NULL || y == NULL || b == NULL) /* check for failure */
+    {
+        matrix_free(omega);
+        matrix_free(y);
+        matrix_free(b);
+        return NULL;
+    }
+
+    svd_gaussian(omega, opts->seed);
+
+    /* Y = A * Omega, then Y = A * orth(A^T * orth(Y)) per power iteration */
+    gemm(m, l, n, 1.0L, A.data, A.rs, A.cs, omega->data, omega->stride, 1,
+            0.0L, y->data, y->stride, 1);
+
+    bool ok = svd_orthonormalise(y);
+
+    for(unsigned int it=0;ok && it<opts->power_iters;it++)
+    {
+        gemm(n, l, m, 1.0L, A.data, A.cs, A.rs, y->data, y->stride, 1, 0.0L,
+                omega->data, omega->stride, 1);
+        ok = svd_orthonormalise(omega);
+
+        if(ok)
+        {
+            gemm(m, l, n, 1.0L, A.data, A.rs, A.cs, omega->data,
+                    omega->stride, 1, 0.0L, y->data, y->stride, 1);
+            ok = svd_orthonormalise(y);
+        }
+    }
+
+    /* B = Q^T * A, whose SVD gives A ~ (Q * U_B) * S * V_B^T */
+    SVD* small_svd = NULL;
+
+    if(ok)
+    {
+        gemm(l, n, m, 1.0L, y->data, 1, y->stride, A.data, A.rs, A.cs, 0.0L,
+                b->data, b->stride, 1);
+        small_svd = svd_factor(b, true);
+    }
+
+    SVD* svd = small_svd != NULL ? svd_alloc(m, n, k, true) : NULL;
+
+    if(svd != NULL)
+    {
+        memcpy(svd->values, small_svd->values, k * sizeof(long double));
+        gemm(m, k, l, 1.0L, y->data, y->stride, 1, small_svd->U->data,
+                small_svd->U->stride, 1, 0.0L, svd->U->data, svd->U->stride,
+                1);
+        view_copy(matrix_view(svd->V), matrix_subview(small_svd->V, 0, 0, n,
+                    k));
+    }
+
+    svd_free(small_svd);
+    matrix_free(omega);
+    matrix_free(y);
+    matrix_free(b);
+
+    return svd;
+}
+
+/**
+ * Computes the Moore-Penrose pseudo-inverse of the matrix `A`
+ *
+ * @param A
+ *      the `m` x `n` matrix to pseudo-invert (not modified)
+ * @param tol
+ *      singular values at or below `tol` are treated as zero; if negative,
+ *          `max(m, n) * LDBL_EPSILON` times the largest singular value
+ *
+ * @return the `n` x `m` pseudo-inverse, or `NULL` on failure
+ *
+ * */
+Matrix* svd_pinv(Matrix* A, long double tol)
+{
+    if(A == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    SVD* svd = svd_factor(A, true);
+    Matrix* pinv = matrix_init(A->cols, A->rows);
+
+    if(svd == NULL || pinv == NULL) /* check for failure */
+    {
+        svd_free(svd);
+        matrix_free(pinv);
+        return NULL;
+    }
+
+    if(tol < 0.0L)
+    {
+        unsigned int big = A->rows > A->cols ? A->rows : A->cols;
+        tol = big * LDBL_EPSILON * svd->values[0];
+    }
+
+    /* A^+ = V * S^-1 * U^T over the numerically non-zero singular values */
+    unsigned int rank = 0;
+
+    while(rank < svd->rank && svd->values[rank] > tol)
+    {
+        rank++;
+    }
+
+    for(unsigned int r=0;r<A->cols;r++)
+    {
+        for(unsigned int c=0;c<rank;c++)
+        {
+            svd->V->cells[r][c] /= svd->values[c];
+        }
+    }
+
+    gemm(A->cols, A->rows, rank, 1.0L, svd->V->data, svd->V->stride, 1,
+            svd->U->data, 1, svd->U->stride, 0.0L, pinv->data, pinv->stride,
+            1);
+
+    svd_free(svd);
+
+    return pinv;
+}
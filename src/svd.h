@@ -0,0 +1,52 @@
+/**
+ * @file svd.h
+ * @author Jack McPherson
+ *
+ * Declarations for dense and randomized singular value decompositions.
+ *
+ * */
+#ifndef SVD_H_
+#define SVD_H_
+
+#include <stdbool.h>
+
+#include "matrix.h"
+#include "view.h"
+
+/**
+ * (Possibly truncated) singular value decomposition `A ~ U * diag(values) *
+ * V^T` of an `m` x `n` matrix `A`
+ *
+ * `values` holds the `rank` singular values in descending order. The
+ * columns of `U` (`m` x `rank`) and `V` (`n` x `rank`) are the corresponding
+ * orthonormal left and right singular vectors. Both are `NULL` if only
+ * singular values were requested.
+ *
+ * */
+typedef struct
+{
+    unsigned int rank;
+    long double* values;
+    Matrix* U;
+    Matrix* V;
+} SVD;
+
+typedef struct
+{
+    unsigned int oversample; /* extra sample columns beyond the rank */
+    unsigned int power_iters; /* passes of (A * A^T) to sharpen the range */
+    unsigned long long seed; /* seed for the Gaussian test matrix */
+} SvdRandOpts;
+
+SVD* svd_factor(Matrix* A, bool vectors);
+SVD* svd_factor_view(MatrixView A, bool vectors);
+void svd_free(SVD* svd);
+
+SvdRandOpts svd_randomized_default_opts(void);
+SVD* svd_randomized(Matrix* A, unsigned int k, const SvdRandOpts* opts);
+SVD* svd_randomized_view(MatrixView A, unsigned int k,
+        const SvdRandOpts* opts);
+
+Matrix* svd_pinv(Matrix* A, long double tol);
+
+#endif /* SVD_H_ */
@@ -0,0 +1,284 @@
+/**
+ * @file thread.c
+ * @author Jack McPherson
+ *
+ * Implements a persistent pthreads worker pool used to parallelise the
+ * library's heavier kernels.
+ *
+ * The pool is created lazily on the first parallel call and resized (again
+ * lazily) whenever the requested thread count changes. Only one parallel
+ * region runs on the pool at a time; a parallel call made while the pool is
+ * busy (including a nested call from inside a task) simply runs serially on
+ * the calling thread.
+ *
+ * */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "alloc.h"
+#include "thread.h"
+
+/* requested thread count (0 means "not yet resolved") */
+static atomic_uint num_threads = 0;
+
+/* set while a parallel region owns the pool */
+static atomic_flag pool_busy = ATOMIC_FLAG_INIT;
+
+/* pool state, guarded by `pool_lock` */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static pthread_t* pool_workers = NULL;
+static unsigned int pool_size = 0;
+static bool pool_shutdown = false;
+static unsigned long pool_epoch = 0; /* job generation when workers started */
+
+/* the current parallel region */
+static struct
+{
+    void (*task)(unsigned int, void*);
+    void* arg;
+    unsigned int n;
+    atomic_uint next;
+    unsigned int pending;
+    unsigned long generation;
+} job;
+
+/**
+ * Sets the number of threads used by parallel kernels
+ *
+ * A value of zero restores the default, which is taken from the environment
+ *      variable `GAISAN_NUM_THREADS` if set and otherwise is the number of
+ *      online processors.
+ *
+ * @param n
+ *      the number of threads to use (including the calling thread)
+ *
+ * */
+void gaisan_set_num_threads(unsigned int n)
+{
+    atomic_store(&num_threads, n);
+}
+
+/**
+ * Returns the number of threads used by parallel kernels
+ *
+ * @return the number of threads (always at least 1)
+ *
+ * */
+unsigned int gaisan_get_num_threads(void)
+{
+    unsigned int n = atomic_load(&num_threads);
+
+    if(n != 0)
+    {
+        return n;
+    }
+
+    const char* env = getenv(GAISAN_NUM_THREADS_ENV);
+
+    if(env != NULL) /* environment override */
+    {
+        n = strtoul(env, NULL, 10);
+    }
+
+    if(n == 0) /* fall back to the processor count */
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cpus > 0 ? (unsigned int)cpus : 1;
+    }
+
+    if(n > GAISAN_MAX_THREADS)
+    {
+        n = GAISAN_MAX_THREADS;
+    }
+
+    atomic_store(&num_threads, n);
+
+    return n;
+}
+
+/**
+ * Claims and runs tasks of the current parallel region until none remain
+ *
+ * */
+static void pool_run_tasks(void)
+{
+    unsigned int i = 0;
+
+    while((i = atomic_fetch_add(&job.next, 1)) < job.n)
+    {
+        job.task(i, job.arg);
+    }
+}
+
+/**
+ * Main loop of a worker thread
+ *
+ * */
+static void* pool_worker(void* unused)
+{
+    (void)unused;
+
+    pthread_mutex_lock(&pool_lock);
+    unsigned long seen = pool_epoch;
+
+    while(true)
+    {
+        while(job.generation == seen && !pool_shutdown)
+        {
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        }
+
+        if(pool_shutdown)
+        {
+            break;
+        }
+
+        seen = job.generation;
+        pthread_mutex_unlock(&pool_lock);
+
+        pool_run_tasks();
+
+        pthread_mutex_lock(&pool_lock);
+
+        if(--job.pending == 0)
+        {
+            pthread_cond_signal(&pool_done);
+        }
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+
+    gaisan_thread_arena_free(); /* created by the first task that needed it */
+
+    return NULL;
+}
+
+/**
+ * Stops and joins every worker thread
+ *
+ * */
+static void pool_stop(void)
+{
+    pthread_mutex_lock(&pool_lock);
+    pool_shutdown = true;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    for(unsigned int i=0;i<pool_size;i++)
+    {
+        pthread_join(pool_workers[i], NULL);
+    }
+
+    gaisan_free(pool_workers);
+    pool_workers = NULL;
+    pool_size = 0;
+    pool_shutdown = false;
+}
+
+/**
+ * Ensures the pool has exactly `workers` worker threads (fewer if thread
+ *      creation fails)
+ *
+ * */
+static void pool_resize(unsigned int workers)
+{
+    if(workers == pool_size)
+    {
+        return;
+    }
+
+    pool_stop();
+
+    pool_workers = gaisan_calloc(workers, sizeof(pthread_t));
+
+    if(pool_workers == NULL) /* allocation check */
+    {
+        return;
+    }
+
+    pool_epoch = job.generation;
+
+    while(pool_size < workers)
+    {
+        if(pthread_create(&pool_workers[pool_size], NULL, &pool_worker,
+                    NULL) != 0)
+        {
+            break;
+        }
+
+        pool_size++;
+    }
+}
+
+/**
+ * Runs `task(i, arg)` for every `i` in `[0, n)`, spreading the calls over the
+ *      worker pool; returns once every call has completed
+ *
+ * Tasks are claimed dynamically, so callers wanting deterministic results
+ *      must ensure that each task's output does not depend on which thread
+ *      runs it or in which order tasks run.
+ *
+ * @param n
+ *      the number of tasks
+ * @param task
+ *      the function to run for each task index
+ * @param arg
+ *      opaque argument passed to every call of `task`
+ *
+ * */
+void parallel_for(unsigned int n, void (*task)(unsigned int, void*),
+        void* arg)
+{
+    if(task == NULL || n == 0) /* null guard */
+    {
+        return;
+    }
+
+    unsigned int threads = gaisan_get_num_threads();
+
+    /* run serially if parallelism is pointless or the pool is taken */
+    if(threads <= 1 || n == 1 || atomic_flag_test_and_set(&pool_busy))
+    {
+        for(unsigned int i=0;i<n;i++)
+        {
+            task(i, arg);
+        }
+
+        return;
+    }
+
+    pool_resize(threads - 1);
+
+    /* publish the region and wake the workers */
+    pthread_mutex_lock(&pool_lock);
+    job.task = task;
+    job.arg = arg;
+    job.n = n;
+    atomic_store(&job.next, 0);
+    job.pending = pool_size;
+    job.generation++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    pool_run_tasks(); /* the caller works too */
+
+    pthread_mutex_lock(&pool_lock);
+
+    while(job.pending > 0)
+    {
+        pthread_cond_wait(&pool_done, &pool_lock);
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+
+    atomic_flag_clear(&pool_busy);
+}
+
@@ -0,0 +1,18 @@
+/**
+ * @file thread.h
+ * @author Jack McPherson
+ *
+ * Declarations for Gaisan's worker thread pool.
+ *
+ * */
+#ifndef THREAD_H_
+#define THREAD_H_
+
+void gaisan_set_num_threads(unsigned int n);
+unsigned int gaisan_get_num_threads(void);
+
+void parallel_for(unsigned int n, void (*task)(unsigned int, void*),
+        void* arg);
+
+#endif /* THREAD_H_ */
+
@@ -0,0 +1,453 @@
+/**
+ * @file view.c
+ * @author Jack McPherson
+ *
+ * Implements non-owning matrix views: zero-copy slicing and transposition
+ * of existing matrices, and arithmetic directly on (possibly strided)
+ * sub-blocks.
+ *
+ * */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "gemm.h"
+#include "matrix.h"
+#include "view.h"
+
+static const MatrixView view_empty = {0, 0, 0, 0, NULL};
+
+/**
+ * Returns a view of the whole of `matrix`
+ *
+ * @param matrix
+ *      the matrix being viewed
+ *
+ * @return the view, which is empty if `matrix` is `NULL`
+ *
+ * */
+MatrixView matrix_view(Matrix* matrix)
+{
+    if(matrix == NULL) /* null guard */
+    {
+        return view_empty;
+    }
+
+    MatrixView view = {matrix->rows, matrix->cols, matrix->stride, 1,
+        matrix->data};
+
+    return view;
+}
+
+/**
+ * Returns a view of the `rows` x `cols` block of `matrix` whose top-left
+ *      entry is `(row, col)`
+ *
+ * @return the view, which is empty if the block does not fit in `matrix`
+ *
+ * */
+MatrixView matrix_subview(Matrix* matrix, unsigned int row, unsigned int col,
+        unsigned int rows, unsigned int cols)
+{
+    return view_sub(matrix_view(matrix), row, col, rows, cols);
+}
+
+/**
+ * Returns a view of the `rows` x `cols` block of `view` whose top-left
+ *      entry is `(row, col)`
+ *
+ * @return the view, which is empty if the block does not fit in `view`
+ *
+ * */
+MatrixView view_sub(MatrixView view, unsigned int row, unsigned int col,
+        unsigned int rows, unsigned int cols)
+{
+    if(view.data == NULL) /* null guard */
+    {
+        return view_empty;
+    }
+
+    /* bounds check */
+    if(row > view.rows || col > view.cols || rows > view.rows - row ||
+            cols > view.cols - col)
+    {
+        return view_empty;
+    }
+
+    MatrixView sub = {rows, cols, view.rs, view.cs,
+        view.data + (size_t)row * view.rs + (size_t)col * view.cs};
+
+    return sub;
+}
+
+/**
+ * Returns the transpose of `view`, sharing its storage
+ *
+ * */
+MatrixView view_transpose(MatrixView view)
+{
+    MatrixView res = {view.cols, view.rows, view.cs, view.rs, view.data};
+
+    return res;
+}
+
+/**
+ * Returns row `i` of `view` as a 1 x `cols` view
+ *
+ * */
+MatrixView view_row(MatrixView view, unsigned int i)
+{
+    return view_sub(view, i, 0, 1, view.cols);
+}
+
+/**
+ * Returns column `j` of `view` as a `rows` x 1 view
+ *
+ * */
+MatrixView view_col(MatrixView view, unsigned int j)
+{
+    return view_sub(view, 0, j, view.rows, 1);
+}
+
+/**
+ * Returns entry `(i, j)` of `view` (NaN if out of bounds)
+ *
+ * */
+long double view_get(MatrixView view, unsigned int i, unsigned int j)
+{
+    if(view.data == NULL || i >= view.rows || j >= view.cols)
+    {
+        return NAN;
+    }
+
+    return view.data[(size_t)i * view.rs + (size_t)j * view.cs];
+}
+
+/**
+ * Sets entry `(i, j)` of `view` to `val`
+ *
+ * */
+void view_set(MatrixView view, unsigned int i, unsigned int j,
+        long double val)
+{
+    if(view.data == NULL || i >= view.rows || j >= view.cols)
+    {
+        return;
+    }
+
+    view.data[(size_t)i * view.rs + (size_t)j * view.cs] = val;
+}
+
+/**
+ * Copies `view` into a new (owning) matrix
+ *
+ * @param view
+ *      the view to be copied
+ *
+ * @return the matrix, or `NULL` on failure
+ *
+ * */
+Matrix* view_to_matrix(MatrixView view)
+{
+    if(view.data == NULL) /* null guard */
+    {
+        return NULL;
+    }
+
+    Matrix* matrix = matrix_init(view.rows, view.cols);
+
+    if(matrix == NULL) /* check for failure */
+    {
+        return NULL;
+    }
+
+    view_copy(matrix_view(matrix), view);
+
+    return matrix;
+}
+
+static bool view_same_shape(MatrixView a, MatrixView b)
+{
+    return a.rows == b.rows && a.cols == b.cols;
+}
+
+/**
+ * Computes `dst = alpha * a + beta * b`, ignoring `b` if it is empty
+ *
+ * */
+static void view_combine(MatrixView dst, long double alpha, MatrixView a,
+        long double beta, MatrixView b)
+{
+    for(unsigned int i=0;i<dst.rows;i++)
+    {
+        long double* row_dst = dst.data + (size_t)i * dst.rs;
+        const long double* row_a = a.data + (size_t)i * a.rs;
+        const long double* row_b = b.data == NULL ? NULL :
+            b.data + (size_t)i * b.rs;
+
+        if(dst.cs == 1 && a.cs == 1 && (row_b == NULL || b.cs == 1))
+        {
+            /* unit stride: keep the common case vectorisable */
+            for(unsigned int j=0;j<dst.cols;j++)
+            {
+                row_dst[j] = row_b == NULL ? alpha * row_a[j] :
+                    alpha * row_a[j] + beta * row_b[j];
+            }
+
+            continue;
+        }
+
+        for(unsigned int j=0;j<dst.cols;j++)
+        {
+            long double val = alpha * row_a[(size_t)j * a.cs];
+
+            if(row_b != NULL)
+            {
+                val += beta * row_b[(size_t)j * b.cs];
+            }
+
+            row_dst[(size_t)j * dst.cs] = val;
+        }
+    }
+}
+
+/**
+ * Copies the entries of `src` into `dst`
+ *
+ * @param dst
+ *      the view receiving the entries (same shape as `src`)
+ * @param src
+ *      the view being copied (must not partially overlap `dst`, though it
+ *          may be the transpose of `dst`)
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool view_copy(MatrixView dst, MatrixView src)
+{
+    if(dst.data == NULL || src.data == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(!view_same_shape(dst, src)) /* bounds check */
+    {
+        return false;
+    }
+
+    if(dst.cs == 1 && src.cs == 1) /* rows are contiguous */
+    {
+        for(unsigned int i=0;i<dst.rows;i++)
+        {
+            memmove(dst.data + (size_t)i * dst.rs,
+                    src.data + (size_t)i * src.rs,
+                    dst.cols * sizeof(long double));
+        }
+
+        return true;
+    }
+
+    if(dst.cs == 1 && src.rs == 1) /* src is the transpose of rows */
+    {
+        if(dst.data == src.data && dst.rs == src.cs) /* square, in place */
+        {
+            transpose_inplace(dst.rows, dst.data, dst.rs);
+            return true;
+        }
+
+        transpose(src.cols, src.rows, src.data, src.cs, dst.data, dst.rs);
+        return true;
+    }
+
+    if(dst.rs == 1 && src.cs == 1) /* dst is the transpose of rows */
+    {
+        transpose(src.rows, src.cols, src.data, src.rs, dst.data, dst.cs);
+        return true;
+    }
+
+    view_combine(dst, 1.0, src, 0.0, view_empty);
+
+    return true;
+}
+
+/**
+ * Sets every entry of `dst` to `val`
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool view_fill(MatrixView dst, long double val)
+{
+    if(dst.data == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    for(unsigned int i=0;i<dst.rows;i++)
+    {
+        long double* row = dst.data + (size_t)i * dst.rs;
+
+        for(unsigned int j=0;j<dst.cols;j++)
+        {
+            row[(size_t)j * dst.cs] = val;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Adds two views, `a` and `b`, storing the result in `dst`
+ *
+ * `dst` may coincide with `a` and/or `b`, but must not partially overlap
+ *      them.
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool view_add(MatrixView dst, MatrixView a, MatrixView b)
+{
+    if(dst.data == NULL || a.data == NULL || b.data == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(!view_same_shape(dst, a) || !view_same_shape(a, b)) /* bounds check */
+    {
+        return false;
+    }
+
+    view_combine(dst, 1.0, a, 1.0, b);
+
+    return true;
+}
+
+/**
+ * Subtracts the view `b` from the view `a`, storing the result in `dst`
+ *
+ * `dst` may coincide with `a` and/or `b`, but must not partially overlap
+ *      them.
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool view_subtract(MatrixView dst, MatrixView a, MatrixView b)
+{
+    if(dst.data == NULL || a.data == NULL || b.data == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(!view_same_shape(dst, a) || !view_same_shape(a, b)) /* bounds check */
+    {
+        return false;
+    }
+
+    view_combine(dst, 1.0, a, -1.0, b);
+
+    return true;
+}
+
+/**
+ * Multiplies the view `a` by the scalar `k`, storing the result in `dst`
+ *      (which may coincide with `a`)
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool view_scale(MatrixView dst, long double k, MatrixView a)
+{
+    if(dst.data == NULL || a.data == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(!view_same_shape(dst, a)) /* bounds check */
+    {
+        return false;
+    }
+
+    view_combine(dst, k, a, 0.0, view_empty);
+
+    return true;
+}
+
+/**
+ * Adds `k` times the view `x` to the view `y` in place
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool view_axpy(long double k, MatrixView x, MatrixView y)
+{
+    if(x.data == NULL || y.data == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    if(!view_same_shape(x, y)) /* bounds check */
+    {
+        return false;
+    }
+
+    view_combine(y, k, x, 1.0, y);
+
+    return true;
+}
+
+/**
+ * Computes `c = alpha * a * b + beta * c`
+ *
+ * @param alpha
+ *      scalar multiple of the product
+ * @param a
+ *      the `m` x `k` LHS view
+ * @param b
+ *      the `k` x `n` RHS view
+ * @param beta
+ *      scalar multiple of `c` (if zero, `c` need not be initialised)
+ * @param c
+ *      the `m` x `n` view receiving the result (must not overlap `a` or
+ *          `b`)
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool view_gemm(long double alpha, MatrixView a, MatrixView b,
+        long double beta, MatrixView c)
+{
+    if(a.data == NULL || b.data == NULL || c.data == NULL) /* null guard */
+    {
+        return false;
+    }
+
+    /* bounds check */
+    if(a.cols != b.rows || c.rows != a.rows || c.cols != b.cols)
+    {
+        return false;
+    }
+
+    if(c.data == a.data || c.data == b.data) /* aliasing check */
+    {
+        return false;
+    }
+
+    gemm(c.rows, c.cols, a.cols, alpha, a.data, a.rs, a.cs, b.data, b.rs,
+            b.cs, beta, c.data, c.rs, c.cs);
+
+    return true;
+}
+
+/**
+ * Multiplies the views `a` and `b`, storing the result in `dst` (which must
+ *      not overlap either)
+ *
+ * @return true on success, false otherwise
+ *
+ * */
+bool view_multiply(MatrixView dst, MatrixView a, MatrixView b)
+{
+    return view_gemm(1.0, a, b, 0.0, dst);
+}
+
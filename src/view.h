@@ -0,0 +1,59 @@
+/**
+ * @file view.h
+ * @author Jack McPherson
+ *
+ * Declarations for non-owning matrix views.
+ *
+ * */
+#ifndef VIEW_H_
+#define VIEW_H_
+
+#include <stdbool.h>
+
+#include "matrix.h"
+
+/**
+ * A non-owning, strided window onto matrix storage
+ *
+ * Entry `(i, j)` of the view is `data[i * rs + j * cs]`. A view of a whole
+ * matrix has `rs == stride` and `cs == 1`; its transpose swaps the two. A
+ * view with `data == NULL` is empty, and is what the view constructors
+ * return on failure. Views are small values and are passed by value; they
+ * stay valid only as long as the storage they point into.
+ *
+ * */
+typedef struct
+{
+    unsigned int rows;
+    unsigned int cols;
+    unsigned int rs; /* elements between consecutive rows */
+    unsigned int cs; /* elements between consecutive columns */
+    long double* data;
+} MatrixView;
+
+MatrixView matrix_view(Matrix* matrix);
+MatrixView matrix_subview(Matrix* matrix, unsigned int row, unsigned int col,
+        unsigned int rows, unsigned int cols);
+MatrixView view_sub(MatrixView view, unsigned int row, unsigned int col,
+        unsigned int rows, unsigned int cols);
+MatrixView view_transpose(MatrixView view);
+MatrixView view_row(MatrixView view, unsigned int i);
+MatrixView view_col(MatrixView view, unsigned int j);
+
+long double view_get(MatrixView view, unsigned int i, unsigned int j);
+void view_set(MatrixView view, unsigned int i, unsigned int j,
+        long double val);
+Matrix* view_to_matrix(MatrixView view);
+
+bool view_copy(MatrixView dst, MatrixView src);
+bool view_fill(MatrixView dst, long double val);
+bool view_add(MatrixView dst, MatrixView a, MatrixView b);
+bool view_subtract(MatrixView dst, MatrixView a, MatrixView b);
+bool view_scale(MatrixView dst, long double k, MatrixView a);
+bool view_axpy(long double k, MatrixView x, MatrixView y);
+bool view_multiply(MatrixView dst, MatrixView a, MatrixView b);
+bool view_gemm(long double alpha, MatrixView a, MatrixView b,
+        long double beta, MatrixView c);
+
+#endif /* VIEW_H_ */
+